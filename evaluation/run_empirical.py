@@ -82,10 +82,12 @@ def run_empirical(config):
 
     SP_df = pd.DataFrame([config["SP"]])  # create a dataframe for the starting point-dict (so we can use the nice API)
 
+    # calculate the resource splits according to Astrahl for all allowances at once (one tool run)
+    astrahl_curve = experiment.astrahl.calculate_allowance_curve(config["SP"], EMPIRICAL_ALLOWANCES, algorithm_config=HYPER_PARAMS, cleanup=True)
+
     for allowance in EMPIRICAL_ALLOWANCES:
         print("Allowance", allowance, "- Astrahl")
-        # calculate the resource splits according to Astrahl,
-        astrahl_splits = experiment.astrahl.calculate_allowances(config["SP"], allowance, algorithm_config=HYPER_PARAMS, cleanup=True)
+        astrahl_splits = astrahl_curve[allowance]
         # then probabilistically fix faults and calculate failure probability EMPIRICAL_SAMPLE_SIZE times
         astrahl_means = experiment.mean_fix_and_prob(astrahl_splits, fault_counts_df, FAULT_OBSERVABILITY, EMPIRICAL_SAMPLE_SIZE)
 
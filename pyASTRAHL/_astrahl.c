@@ -0,0 +1,220 @@
+/********************************************************************
+ * _astrahl.c
+ *
+ * Defines the CPython extension module pyASTRAHL._astrahl, calling the
+ * C API of libastrahl.so (see src/astrahl.h) on buffers of doubles
+ * (e.g., numpy arrays) without copying them, and without the GIL.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include "astrahl.h"
+
+// the name of the capsules holding models
+#define ASTRAHL_CAPSULE "pyASTRAHL._astrahl.model"
+
+// the messages of the error codes of the library
+static const char* astrahl_messages[] = {
+  "success",
+  "malformed input (see the standard error)",
+  "the model cannot answer the request (see the standard error)",
+  "bad arguments"
+};
+
+// raises the exception of the error [code], and returns NULL
+static PyObject* astrahl_raise( int code ) {
+  PyErr_SetString( code == ASTRAHL_ERROR_ARGUMENT ? PyExc_ValueError :
+                   PyExc_RuntimeError, astrahl_messages[ code ] );
+  return NULL;
+}
+
+// releases the model of a capsule
+static void astrahl_capsule_free( PyObject* capsule ) {
+  astrahl_model_free( PyCapsule_GetPointer( capsule, ASTRAHL_CAPSULE ) );
+}
+
+// reads the model of a capsule, NULL (with an exception) if it is not one
+static astrahl_model astrahl_capsule_model( PyObject* capsule ) {
+  return PyCapsule_GetPointer( capsule, ASTRAHL_CAPSULE );
+}
+
+// gets the buffer of an object, which must be a contiguous array of [length]
+// doubles (writable if [writable]), and returns whether it is one (otherwise,
+// with an exception, the buffer being released)
+static int astrahl_doubles( PyObject* obj, Py_buffer* view, Py_ssize_t length,
+                            int writable ) {
+  int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+  if ( writable )
+    flags |= PyBUF_WRITABLE;
+  if ( PyObject_GetBuffer( obj, view, flags ) != 0 )
+    return 0;
+  if ( view->itemsize != sizeof( double ) || view->format == NULL ||
+       strcmp( view->format, "d" ) != 0 ||
+       view->len != length * ( Py_ssize_t ) sizeof( double ) ) {
+    PyBuffer_Release( view );
+    PyErr_Format( PyExc_ValueError,
+                  "expected a contiguous array of %zd doubles", length );
+    return 0;
+  }
+  return 1;
+}
+
+/*
+ * Creation
+ */
+
+static PyObject* astrahl_py_model_new( PyObject* self, PyObject* args ) {
+  ( void ) self;
+  Py_buffer json;
+  if ( ! PyArg_ParseTuple( args, "y*", &json ) )
+    return NULL;
+  astrahl_model m;
+  int code;
+  Py_BEGIN_ALLOW_THREADS
+  code = astrahl_model_new( json.buf, json.len, &m );
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release( &json );
+  if ( code != ASTRAHL_OK )
+    return astrahl_raise( code );
+  return PyCapsule_New( m, ASTRAHL_CAPSULE, astrahl_capsule_free );
+}
+
+static PyObject* astrahl_py_model_load( PyObject* self, PyObject* args ) {
+  ( void ) self;
+  const char* filename;
+  Py_buffer json = { 0 };
+  if ( ! PyArg_ParseTuple( args, "s|z*", &filename, &json ) )
+    return NULL;
+  astrahl_model m;
+  int code;
+  Py_BEGIN_ALLOW_THREADS
+  code = astrahl_model_load( filename, json.buf, json.len, &m );
+  Py_END_ALLOW_THREADS
+  if ( json.obj != NULL )
+    PyBuffer_Release( &json );
+  if ( code != ASTRAHL_OK )
+    return astrahl_raise( code );
+  return PyCapsule_New( m, ASTRAHL_CAPSULE, astrahl_capsule_free );
+}
+
+/*
+ * Usage
+ */
+
+static PyObject* astrahl_py_wires( PyObject* self, PyObject* args ) {
+  ( void ) self;
+  PyObject* capsule;
+  if ( ! PyArg_ParseTuple( args, "O", &capsule ) )
+    return NULL;
+  astrahl_model m = astrahl_capsule_model( capsule );
+  if ( m == NULL )
+    return NULL;
+  return PyLong_FromLong( astrahl_model_wires( m ) );
+}
+
+static PyObject* astrahl_py_propagate_batch( PyObject* self,
+                                             PyObject* args ) {
+  ( void ) self;
+  PyObject *capsule, *points, *probabilities;
+  int num, threads;
+  if ( ! PyArg_ParseTuple( args, "OiOOi", &capsule, &num, &points,
+                           &probabilities, &threads ) )
+    return NULL;
+  astrahl_model m = astrahl_capsule_model( capsule );
+  if ( m == NULL )
+    return NULL;
+  Py_ssize_t n = astrahl_model_wires( m );
+  Py_buffer pts, prb;
+  if ( ! astrahl_doubles( points, &pts, num * n, 0 ) )
+    return NULL;
+  if ( ! astrahl_doubles( probabilities, &prb, num, 1 ) ) {
+    PyBuffer_Release( &pts );
+    return NULL;
+  }
+  int code;
+  Py_BEGIN_ALLOW_THREADS
+  code = astrahl_propagate_batch( m, num, pts.buf, threads, prb.buf );
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release( &pts );
+  PyBuffer_Release( &prb );
+  if ( code != ASTRAHL_OK )
+    return astrahl_raise( code );
+  Py_RETURN_NONE;
+}
+
+static PyObject* astrahl_py_splits_batch( PyObject* self, PyObject* args ) {
+  ( void ) self;
+  PyObject *capsule, *points, *budgets, *confidences, *bounds, *splits;
+  int num, threads;
+  unsigned long long seed;
+  if ( ! PyArg_ParseTuple( args, "OiOOKiOOO", &capsule, &num, &points,
+                           &budgets, &seed, &threads, &confidences, &bounds,
+                           &splits ) )
+    return NULL;
+  astrahl_model m = astrahl_capsule_model( capsule );
+  if ( m == NULL )
+    return NULL;
+  Py_ssize_t n = astrahl_model_wires( m );
+  // the buffers, the inputs first
+  PyObject* objs[ 5 ] = { points, budgets, confidences, bounds, splits };
+  Py_ssize_t lengths[ 5 ] = { num * n, num, num, num, num * n };
+  Py_buffer views[ 5 ];
+  for ( int k = 0; k < 5; ++k )
+    if ( ! astrahl_doubles( objs[ k ], views + k, lengths[ k ], k >= 2 ) ) {
+      while ( k-- > 0 )
+        PyBuffer_Release( views + k );
+      return NULL;
+    }
+  int code;
+  Py_BEGIN_ALLOW_THREADS
+  code = astrahl_splits_batch( m, num, views[ 0 ].buf, views[ 1 ].buf, seed,
+                               threads, views[ 2 ].buf, views[ 3 ].buf,
+                               views[ 4 ].buf );
+  Py_END_ALLOW_THREADS
+  for ( int k = 0; k < 5; ++k )
+    PyBuffer_Release( views + k );
+  if ( code != ASTRAHL_OK )
+    return astrahl_raise( code );
+  Py_RETURN_NONE;
+}
+
+/*
+ * Module
+ */
+
+static PyMethodDef astrahl_methods[] = {
+  { "model_new", astrahl_py_model_new, METH_VARARGS,
+    "model_new(json) -> model: creates a model from the JSON text (bytes) of "
+    "a problem." },
+  { "model_load", astrahl_py_model_load, METH_VARARGS,
+    "model_load(filename, json=None) -> model: loads a model file, with the "
+    "JSON text (bytes) of its uncertainty and algorithm." },
+  { "wires", astrahl_py_wires, METH_VARARGS,
+    "wires(model) -> int: the number of wires of a model." },
+  { "propagate_batch", astrahl_py_propagate_batch, METH_VARARGS,
+    "propagate_batch(model, num, points, probabilities, threads): fills the "
+    "probabilities of failure of num points (num x wires doubles)." },
+  { "splits_batch", astrahl_py_splits_batch, METH_VARARGS,
+    "splits_batch(model, num, points, budgets, seed, threads, confidences, "
+    "bounds, splits): fills the allocations of num points and budgets." },
+  { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef astrahl_module = {
+  PyModuleDef_HEAD_INIT,
+  "_astrahl",
+  "Native entry points of the tool (see src/astrahl.h).",
+  -1,
+  astrahl_methods,
+  NULL,
+  NULL,
+  NULL,
+  NULL
+};
+
+PyMODINIT_FUNC PyInit__astrahl( void ) {
+  return PyModule_Create( &astrahl_module );
+}
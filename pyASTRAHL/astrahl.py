@@ -2,23 +2,34 @@ import json
 import tempfile
 import os
 import subprocess
+import numpy as np
 import pandas as pd
 
-from typing import Dict
+from typing import Dict, List
 
 from .api import Expression, Const, Wire
 
+try:
+    from . import _astrahl  # the native entry points (built with `make python` in src, see the README)
+except ImportError:
+    _astrahl = None
+
 FILE_DIR = os.path.dirname(__file__)
 
 class Astrahl(object):
     TOOL_PATH = os.path.join(FILE_DIR, "..", "src")
     TOOL_NAME = "main"
     SPLITS_KEYWORD = "splits"
+    SWEEP_KEYWORD = "sweep"
+    PARETO_KEYWORD = "pareto"
     PROBABILITY_KEYWORD = "propagate"
+    BATCH_KEYWORD = "batch"
     TOOL_INPUT_TMP_PATH = os.path.join(FILE_DIR, "..", "tmp")
 
-    def __init__(self, fault_tree, confidence_functions=None):
+    def __init__(self, fault_tree, confidence_functions=None, cache_file=None):
         self.ft = fault_tree
+        self.cache_file = cache_file  # warm-start cache shared by all splits runs (see README)
+        self._native_models = {}  # the native models of the problem, one per algorithm configuration
         self.conf_funcs = {}
         if confidence_functions:  # sometimes we pass None when we don't need them
             for wire, func_expression in confidence_functions.items():
@@ -31,7 +42,7 @@ class Astrahl(object):
                 raise ValueError()
 
         # create ordered list
-        if fault_tree is not None:  # it is only None in batch execution mode (see batch_run_splits.py)
+        if fault_tree is not None:  # it is only None when the tool is only triggered on existing files
             self._wire_order = sorted(list(self.ft.wires), key=str)
 
         # create tmp directory
@@ -60,29 +71,92 @@ class Astrahl(object):
         algorithm_config: some hyper-parameters for the algorithm (default should be Dict = {"max_step": 10000, "p_init": 0.999, "lambda": 1.0}
         cleanup : remove the file afterwards?
         """
-        splits_config, alg_config = self.create_splits_config(point, total_budget, algorithm_config)
-        splits_file = self._write_config_to_file(splits_config, suffix="splits_cfg")
-        alg_file = self._write_config_to_file(alg_config, suffix="alg_cfg")
-
-        result = self._tool_trigger(self.__class__.SPLITS_KEYWORD, splits_file, alg_file)
-        lastline = result.splitlines()[-1]
-        # print(lastline)
-        words = [key_val.split("=") for key_val in lastline.split()]  # convert the output (1=0.3 2=0.3 4=0.4 5=0.5) to [(1,0.3), (2,0.3), ...]
-        wire_splits = {self._wire_order[int(key)]: float(value) for (key, value) in words}
+        splits_file = None
+        if self._native():
+            splits = self.splits_batch(self._point_matrix([point]), total_budget, algorithm_config)[0]
+            wire_splits = {wire: float(value) for wire, value in zip(self._wire_order, splits)}
+        else:
+            splits_config = self.create_splits_config(point, total_budget, algorithm_config)
+            splits_file = self._write_config_to_file(splits_config, suffix="splits_cfg")
+
+            result = self._tool_trigger(self.__class__.SPLITS_KEYWORD, splits_file)
+            lastline = result.splitlines()[-1]
+            # print(lastline)
+            words = [key_val.split("=") for key_val in lastline.split()]  # convert the output (1=0.3 2=0.3 4=0.4 5=0.5) to [(1,0.3), (2,0.3), ...]
+            wire_splits = {self._wire_order[int(key)]: float(value) for (key, value) in words}
         # print(wire_splits)
 
         # checks
         assert abs(sum(wire_splits.values()) - total_budget) < (10**-7), "There was a significant difference between Astrahl's suggested split and the Total Resource Budget.\nAllowances: {}\nSum Allowances: {}\nTotal Budget: {}\nDifference: {}".format(wire_splits, total_budget, sum(wire_splits.values()), abs(sum(wire_splits.values()) - total_budget) )  # assert that input and output match
-        assert all([v >= 0 for v in wire_splits.values()]), "Astrahl calculated a negative allowance.\nAllowances: {}\nSplits Config: {}\nAlgorithm Config: {}".format(wire_splits, splits_file, alg_file)  # assert that all values are positive
+        assert all([v >= 0 for v in wire_splits.values()]), "Astrahl calculated a negative allowance.\nAllowances: {}\nSplits Config: {}".format(wire_splits, splits_file)  # assert that all values are positive
 
-        if cleanup:
+        if cleanup and splits_file:
             os.remove(splits_file)
-            os.remove(alg_file)
 
         return wire_splits
 
+    def calculate_allowance_curve(self, point: Dict, budgets: List[float], algorithm_config: Dict, cleanup: bool = True):
+        """
+        Same as calculate_allowances, but for several budgets in a single tool run (each allocation starts from the previous one).
+        point : a dict of {wire: value} that shows the current starting confidence of each wire
+        budgets : the budgets we want to invest
+        algorithm_config: some hyper-parameters for the algorithm
+        cleanup : remove the file afterwards?
+        returns a dict of {budget: {wire: allowance}}
+        """
+        splits_config = self.create_splits_config(point, 0, algorithm_config)
+        splits_config["resources"] = [float(budget) for budget in budgets]
+        splits_file = self._write_config_to_file(splits_config, suffix="sweep_cfg")
+
+        result = self._tool_trigger(self.__class__.SWEEP_KEYWORD, splits_file)
+        # the output is a CSV with header "resources,confidence,0,1,..." and one row per budget, in increasing order
+        rows = [line.split(",") for line in result.strip().splitlines()[1:]]
+        curve = {}
+        for budget, row in zip(sorted(budgets), rows):
+            wire_splits = {self._wire_order[index]: float(value) for index, value in enumerate(row[2:])}
+            assert abs(sum(wire_splits.values()) - budget) < (10**-7), "There was a significant difference between Astrahl's suggested split and the Total Resource Budget.\nAllowances: {}\nTotal Budget: {}".format(wire_splits, budget)
+            assert all([v >= 0 for v in wire_splits.values()]), "Astrahl calculated a negative allowance.\nAllowances: {}\nSplits Config: {}".format(wire_splits, splits_file)
+            curve[budget] = wire_splits
+
+        if cleanup:
+            os.remove(splits_file)
+
+        return curve
+
+    def calculate_pareto_front(self, point: Dict, total_budget: float, costs: Dict[str, Dict], algorithm_config: Dict = None, cleanup: bool = True):
+        """
+        Trade the confidence against some costs (e.g. calendar time) with NSGA-II.
+        point : a dict of {wire: value} that shows the current starting confidence of each wire
+        total_budget : how many resources we want to invest
+        costs : a dict of {cost name: {wire: Expression}}, where the expression is the cost of spending resources on the wire
+        algorithm_config: the parameters of NSGA-II (e.g. {"population": 100, "generations": 200})
+        cleanup : remove the file afterwards?
+        returns a DataFrame with columns confidence, the cost names and the wires, one row per allocation of the front
+        """
+        splits_config = self.create_splits_config(point, total_budget, {"type": "nsga", "nsga": dict(algorithm_config or {})})
+        splits_config["costs"] = [
+            {"name": name,
+             "funcs": [{"index": self._wire_order.index(wire),
+                        "expression": exp.to_json(self._wire_order.index(wire) * 2, self._wire_order.index(wire))}
+                       for wire, exp in wire_costs.items()]}
+            for name, wire_costs in costs.items()]
+        pareto_file = self._write_config_to_file(splits_config, suffix="pareto_cfg")
+
+        result = self._tool_trigger(self.__class__.PARETO_KEYWORD, pareto_file)
+        lines = result.strip().splitlines()
+        header = lines[0].split(",")
+        columns = header[:1 + len(costs)] + [self._wire_order[int(index)] for index in header[1 + len(costs):]]
+        front = pd.DataFrame([[float(value) for value in line.split(",")] for line in lines[1:]], columns=columns)
+
+        if cleanup:
+            os.remove(pareto_file)
+
+        return front
+
     def calculate_probability(self, point: dict, cleanup: bool = True):
         """Calculate the confidence in a system at a given point."""
+        if self._native():
+            return float(self.propagate_batch(self._point_matrix([point]))[0])
         probability_config = self.create_probability_config(point)
         prob_file = self._write_config_to_file(probability_config, suffix="prob")
         result = self._tool_trigger(self.__class__.PROBABILITY_KEYWORD, prob_file)
@@ -92,95 +166,126 @@ class Astrahl(object):
 
     def batch_calculate_splits(self, points_df, total_budget: float,  algorithm_config: Dict):
         """
-        Python is limited by the number of files we can open at once.
-        Therefore, for bulk tests, we want the file system (not Python) to create individual configuration files.
-        jq and split help us in achieving this.
+        Computes the splits of many points in a single tool run (batch mode): the fault tree and the confidence
+        functions are parsed and compiled once, and the points are streamed to the tool as JSON Lines.
 
         points_df: has points as rows and wires as columns
         total_budget: how much we want to spend
         algorithm_config: (same for all) some hyper-parameters for the algorithm (default should be Dict = {"max_step": 10000, "p_init": 0.999, "lambda": 1.0}
         """
-        splits_configs = []
-        alg_configs = []
-        # iterate over the points_df and create one splits_config and one alogrithm_config for each row
-        # note that while the algorithm_config input is the same for all, the actual information written to file
-        # is specific for each splits_config (as it requires the point-configuration)
+        if self._native():
+            splits = self.splits_batch(self._point_matrix(points_df), total_budget, algorithm_config)
+            return self._check_splits(pd.DataFrame(splits, columns=self._wire_order), total_budget)
+
+        requests = []
+        # iterate over the points_df and create one request for each row
+        # the algorithm configuration does not depend on the point, so it is given once with the problem
         for rowidx, row in points_df.iterrows():
-            splits_config, alg_config = self.create_splits_config(row, total_budget, algorithm_config)
-            splits_configs.append(splits_config)
-            alg_configs.append(alg_config)
-
-        # Create two temporary files (one for splits, one for algorithm configs) and write the respective values in each
-        with tempfile.TemporaryDirectory(dir="./tmp") as tmpdir:
-            with tempfile.NamedTemporaryFile(mode="w", dir=tmpdir, prefix="batch_splits_", suffix=".json") as splits_config_file:
-                # write all splits configs into a config file
-                splits_filename = splits_config_file.name
-                splits_config_file.write(json.dumps(splits_configs, indent=4))
-
-                # write all algorithm configs into a config file
-                with tempfile.NamedTemporaryFile(mode="w", dir=tmpdir, prefix="batch_algs_", suffix=".json") as alg_config_file:
-                    alg_filename = alg_config_file.name
-                    alg_config_file.write(json.dumps(alg_configs, indent=4))
-
-                    # compose the command. We will do the following:
-                    # use `jq` and `split` to grab each individual splits config in the file and write it into its own file of format config.splits.XXXXX
-                    # use `jq` and `split` to grab each individual algorithm config in the file and write it into its own file of format config.alg.XXXXX
-                    # --> NOTE, the XXXXX will match ! (splits starts at aaaaa -> aaaab -> aaaac -> ...)
-
-                    # then, trigger our batch_run_splits.py file with the temporary directory as parameter
-                    command = "jq -c '.[]' {0} | split -l 1 -a 5 - {2}/config.splits.;".format(splits_filename, alg_filename, tmpdir)
-                    command += "jq -c '.[]' {1} | split -l 1 -a 5 - {2}/config.alg.;".format(splits_filename, alg_filename, tmpdir)
-                    command += "python3 {0}/batch_run_splits.py {1}".format(FILE_DIR, tmpdir)
-                    output = os.popen(command).read()
-
-                    # The output of the command will a list of tool output strings
-                    # we parse each into a dict individually, similar to the non-batch way (see above)
-                    splits = []
-                    for line in output.splitlines():
-                        words = [key_val.split("=") for key_val in line.split()]
-                        wire_splits = {self._wire_order[int(key)]: float(value) for (key, value) in words}
-                        splits.append(wire_splits)
-
-                    # create a pd.DataFrame (one row per input-point, columns are wires, cells show how much to spend on each wire)
-                    # run a few checks to assert the data is correct
-                    # no cell-values are negative
-                    # all allowances for a given point (row) amount to the total_budget
-                    splits_df = pd.DataFrame(splits)
-                    assert not (splits_df < 0).any().any(), "There are no negative values in the increases"
-                    assert ((splits_df.sum(axis=1) - total_budget).abs() < (10 ** -10)).all(), "All increases sum up to the TEST Budget"
-                    return splits_df
+            splits_config = self.create_splits_config(row, total_budget, algorithm_config)
+            requests.append({"mode": self.__class__.SPLITS_KEYWORD, "point": splits_config["point"],
+                             "resources": splits_config["resources"]})
+        problem = {"ft": self.ft.to_json(self._wire_order), "conf_funcs": self._conf_funcs_json(),
+                   "algorithm": self._algorithm_json(algorithm_config)}
+
+        # the tool answers with one row per request, in order, whose splits (after the first 4 columns) are indexed
+        # like _wire_order
+        answers = self._batch_trigger(problem, requests)
+
+        # create a pd.DataFrame (one row per input-point, columns are wires, cells show how much to spend on each wire)
+        return self._check_splits(pd.DataFrame(answers[:, 4:], columns=self._wire_order[:answers.shape[1] - 4]),
+                                  total_budget)
+
+    def _check_splits(self, splits_df: pd.DataFrame, total_budget: float):
+        """
+        run a few checks to assert the data is correct
+        no cell-values are negative
+        all allowances for a given point (row) amount to the total_budget
+        """
+        assert not (splits_df < 0).any().any(), "There are no negative values in the increases"
+        assert ((splits_df.sum(axis=1) - total_budget).abs() < (10 ** -10)).all(), "All increases sum up to the TEST Budget"
+        return splits_df
 
     def batch_calculate_probability(self, points_df: pd.DataFrame):
         """
-        Python is limited by the number of files we can open at once.
-        Therefore, for bulk tests, we want the file system (not Python) to create individual configuration files.
-        jq and split help us in achieving this.
+        Computes the probabilities of failure of many points in a single tool run (batch mode): the fault tree is
+        parsed once, and the points are streamed to the tool as JSON Lines.
 
         points_df: has points as rows and wires as columns
         """
-        # convert each row into a probability config
+        if self._native():
+            return pd.Series(self.propagate_batch(self._point_matrix(points_df)))
+
+        # convert each row into a request
         configs = points_df.apply(lambda row: self.create_probability_config(row.to_dict()), axis=1)
-        configs = configs.to_list()  # configs is a pandas Series, make it into a vanilla Python list
-
-        with tempfile.TemporaryDirectory(dir="./tmp") as tmpdir:
-            with tempfile.NamedTemporaryFile(mode="w", dir=tmpdir, prefix="batch_", suffix=".json") as batchconfig:
-                filename = batchconfig.name
-                # print("Batch file name {}".format(filename))
-                batchconfig.write(json.dumps(configs, indent=4))  # write the list of configs into the temporary file
-
-                # call the command line to use
-                # `jq` to split a configuration into individual lines (one line per configuration)
-                # use `split` to grab an individual line (config) and write each it into its own file (with prefix="tmpfolder/config.")
-                # use `ls` to write all created files into files.txt
-                # read this files.txt and feed individually into our QCL tool (src/main propagate -f filename)
-                command = "jq -c '.[]' {0} | split -l 1 -a 5 - {1}/config.;  ls {1}/config* > {1}/files.txt; while read in; do src/main propagate -f $in; done < {1}/files.txt".format(
-                    filename, tmpdir)
-
-                # the above command will trigger QCL on each line in files.txt
-                # thus QCL will print one float-value (1 per config)
-                # we read this output, split it and parse it into floats
-                output = os.popen(command).read()
-                return pd.Series([float(line) for line in output.splitlines()])
+        requests = [{"mode": self.__class__.PROBABILITY_KEYWORD, "point": config["point"]} for config in configs.to_list()]
+        problem = {"ft": self.ft.to_json(self._wire_order)}
+        # the probabilities are the values (third column) of the answers
+        return pd.Series(self._batch_trigger(problem, requests)[:, 2])
+
+    # ------------------- NATIVE -------------------
+
+    def propagate_batch(self, points: np.ndarray, threads: int = 0):
+        """
+        Computes the probabilities of failure of many points with the native extension, in parallel (without the GIL).
+
+        points: a matrix with one row per point, whose columns are the probabilities of failure of the wires (in the
+        order of _wire_order, see _point_matrix)
+        threads: the number of threads (one per processor by default)
+        returns the probabilities (one per point)
+        """
+        model = self._native_model()
+        points = np.ascontiguousarray(points, dtype=np.float64)
+        probabilities = np.empty(points.shape[0])
+        _astrahl.propagate_batch(model, points.shape[0], points, probabilities, threads)
+        return probabilities
+
+    def splits_batch(self, points: np.ndarray, budgets, algorithm_config, seed: int = 1, threads: int = 0):
+        """
+        Computes the splits of many points with the native extension, in parallel (without the GIL), the random numbers
+        of point k being seeded by seed + k (so that the splits do not depend on the number of threads).
+
+        points: a matrix with one row per point, whose columns are the resources already spent on the wires (in the
+        order of _wire_order, see _point_matrix)
+        budgets: the resources to spend (one for all points, or one per point)
+        algorithm_config: the algorithm (see _algorithm_json)
+        seed: the seed of the random numbers (by default, the points get the seeds of the requests of the batch mode)
+        threads: the number of threads (one per processor by default)
+        returns a matrix with one row per point, whose columns are the resources to spend on the wires
+        """
+        model = self._native_model(algorithm_config)
+        points = np.ascontiguousarray(points, dtype=np.float64)
+        num = points.shape[0]
+        budgets = np.ascontiguousarray(np.broadcast_to(np.asarray(budgets, dtype=np.float64), (num,)))
+        confidences, bounds, splits = np.empty(num), np.empty(num), np.empty(points.shape)
+        _astrahl.splits_batch(model, num, points, budgets, seed, threads, confidences, bounds, splits)
+        return splits
+
+    def _native(self):
+        """whether the native extension is used (its models have no warm-start cache)"""
+        return _astrahl is not None and not self.cache_file
+
+    def _native_model(self, algorithm_config=None):
+        """
+        algorithm_config: the algorithm of the model (None for propagations)
+        returns the native model of the problem, created (parsed and compiled) once per algorithm configuration
+        """
+        problem = {"ft": self.ft.to_json(self._wire_order)}
+        if algorithm_config is not None:
+            problem["conf_funcs"] = self._conf_funcs_json()
+            problem["algorithm"] = self._algorithm_json(algorithm_config)
+        key = json.dumps(problem, sort_keys=True)
+        if key not in self._native_models:
+            self._native_models[key] = _astrahl.model_new(key.encode())
+        return self._native_models[key]
+
+    def _point_matrix(self, points):
+        """
+        points: a pd.DataFrame (points as rows and wires as columns) or a list of dicts of {wire: value}
+        returns the matrix of the points, whose columns are in the order of _wire_order
+        """
+        if isinstance(points, pd.DataFrame):
+            return points[self._wire_order].to_numpy(dtype=np.float64)
+        return np.array([[point[wire] for wire in self._wire_order] for point in points], dtype=np.float64)
 
     # ------------------- CONFIGS -------------------
 
@@ -194,6 +299,28 @@ class Astrahl(object):
         if not all([self._check_point(point)]):
             return None
 
+        cfg = {
+            "ft": self.ft.to_json(self._wire_order),
+            "conf_funcs": self._conf_funcs_json(),
+            "point": [{"index": self._wire_order.index(wire), "name": str(wire), "value": value} for wire, value in
+                      point.items()],
+            "resources": float(resources),
+            "algorithm": self._algorithm_json(algorithm_config)
+        }
+        return cfg
+
+    def _algorithm_json(self, algorithm_config):
+        """
+        algorithm_config: the name of a preset (e.g. "sa_lambda"), a complete configuration selecting its own algorithm
+        (e.g. {"type": "discrete", "discrete": {"unit": TESTCOST}} to allocate whole tests, or {"preset": ...} with
+        overrides), or the hyper-parameters of simulated annealing polished by hill climbing
+        """
+        if isinstance(algorithm_config, str) or "type" in algorithm_config or "preset" in algorithm_config:
+            return algorithm_config
+        # the hand-tuned initial temperature of simulated annealing is computed at the point of the input
+        return {"type": "sahc", "sa": {k: v for k, v in algorithm_config.items()}}
+
+    def _conf_funcs_json(self):
         conf_funcs = []
         for wire, exp in self.conf_funcs.items():
             windex = self._wire_order.index(wire)
@@ -201,19 +328,7 @@ class Astrahl(object):
             neg_exp_json = exp[1].to_json(windex * 2 + 1, windex)
             conf_funcs.append({"index": windex * 2, "name": "{} pos".format(wire), "expression": pos_exp_json})
             conf_funcs.append({"index": windex * 2 + 1, "name": "{} neg".format(wire), "expression": neg_exp_json})
-        cfg = {
-            "ft": self.ft.to_json(self._wire_order),
-            "conf_funcs": conf_funcs,
-            "point": [{"index": self._wire_order.index(wire), "name": str(wire), "value": value} for wire, value in
-                      point.items()],
-            "resources": float(resources)
-        }
-        # Algorithm config stuff
-        alg_config_json = {"type": "sa",
-                           "sa": {k: v for k, v in algorithm_config.items()}
-                          }
-        alg_config_json["sa"]["point"] = [v for v in cfg["point"]]
-        return cfg, alg_config_json
+        return conf_funcs
 
     def create_probability_config(self, point: Dict):
         # check if the data looks alright
@@ -245,6 +360,8 @@ class Astrahl(object):
         command = [exe, _function, '-f', config_filename]
         if alg_filename:
             command.extend(["-o", alg_filename])
+        if _function in (self.__class__.SPLITS_KEYWORD, self.__class__.SWEEP_KEYWORD, self.__class__.PARETO_KEYWORD) and self.cache_file:
+            command.extend(["--cache", self.cache_file])
 
         process = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
         # print("Opening subprocess with command `{}`".format(' '.join(process.args)))
@@ -259,6 +376,33 @@ class Astrahl(object):
         # delete the file we created
         return result
 
+    def _batch_trigger(self, problem: Dict, requests: List[Dict]):
+        """
+        problem: the fault tree (and confidence functions) shared by all requests, sent as the first line
+        requests: the requests (one per line), answered in order
+        returns the answers, as a matrix with one row per request (see the batch mode in the README): the line of the
+        request, the resources, the value (confidence or probability), its bound, and the splits of each wire
+        """
+        exe = os.path.join(self.__class__.TOOL_PATH, self.__class__.TOOL_NAME)
+        command = [exe, self.__class__.BATCH_KEYWORD, "--format", "npy"]
+        if self.cache_file:
+            command.extend(["--cache", self.cache_file])
+
+        # the answers are written to a file (so that the tool writes them as they come) and mapped by numpy, without
+        # parsing them
+        lines = [json.dumps(problem)] + [json.dumps(request) for request in requests]
+        handle, answers_file = tempfile.mkstemp(dir=self.TOOL_INPUT_TMP_PATH, suffix=".npy")
+        with os.fdopen(handle, "wb") as out:
+            process = subprocess.run(command, input="\n".join(lines) + "\n", stdout=out, stderr=subprocess.PIPE,
+                                     universal_newlines=True)
+        stderr = process.stderr.replace('cJSON_to_exp: no "name" specified, using "wire_index"', '').strip()
+        if stderr:
+            print("The tool invocation caused an error:\n\t{}".format(stderr))
+
+        answers = np.load(answers_file, mmap_mode="r")
+        os.remove(answers_file)
+        return answers
+
     def _write_config_to_file(self, configuration: Dict, suffix: str = ""):
         """
         configuration: what we want to write (is a Dict) (will be written as JSON)
@@ -0,0 +1,329 @@
+/********************************************************************
+ * astrahl.c
+ *
+ * Defines the C API of the shared library libastrahl.so, to embed the
+ * tool in other programs.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#define GC_THREADS // so that the collector knows about the calling threads
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <gc.h>
+#include <cjson/cJSON.h>
+#include "utils.h"
+#include "parallel.h"
+#include "fault_tree.h"
+#include "reader.h"
+#include "model.h"
+#include "optimisation.h"
+#include "batch.h"
+#include "astrahl.h"
+
+// a model is the batch of its problem (see [problem_to_batch]), allocated so
+// that the collector keeps it while the caller holds it
+struct astrahl_model_s {
+  batch b;
+};
+
+// the collector is initialised by the first call
+pthread_once_t astrahl_once = PTHREAD_ONCE_INIT;
+
+void astrahl_init() {
+  GC_INIT();
+  GC_allow_register_threads();
+}
+
+// registers the calling thread with the collector (the threads of the caller
+// are not created through it), and returns whether it was not registered yet
+bool astrahl_enter() {
+  pthread_once( &astrahl_once, astrahl_init );
+  struct GC_stack_base sb;
+  if ( GC_get_stack_base( &sb ) != GC_SUCCESS )
+    return false;
+  return GC_register_my_thread( &sb ) == GC_SUCCESS;
+}
+
+// unregisters the calling thread if it was [registered] by [astrahl_enter]
+void astrahl_leave( bool registered ) {
+  if ( registered )
+    GC_unregister_my_thread();
+}
+
+// copies a point of [n] values into memory of the collector
+double* astrahl_point( int n, const double* point ) {
+  double* sigma = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  memcpy( sigma, point, n * sizeof( double ) );
+  return sigma;
+}
+
+/*
+ * Creation
+ */
+
+// the problem of the [json] text of [length] bytes, whose "algorithm" may not
+// open a trace file (whose file would never be closed)
+problem astrahl_problem( const char* json, size_t length ) {
+  // the reader does not modify the text
+  problem p = reader_problem( ( char* ) json, length );
+  if ( optim_params_trace_file(
+         cJSON_GetObjectItemCaseSensitive( p->json, "algorithm" ) ) ) {
+    cJSON_Delete( p->json );
+    fprintf( stderr, "astrahl: no trace file allowed in models.\n" );
+    error_exit();
+  }
+  return p;
+}
+
+// a model of the batch [b], allocated once the batch is created, so that
+// failed creations leak nothing
+astrahl_model astrahl_model_of( batch b ) {
+  astrahl_model m = GC_MALLOC_UNCOLLECTABLE( sizeof( struct astrahl_model_s ) );
+  m->b = b;
+  return m;
+}
+
+int astrahl_model_new( const char* json, size_t length, astrahl_model* res ) {
+  if ( json == NULL || res == NULL )
+    return ASTRAHL_ERROR_ARGUMENT;
+  bool registered = astrahl_enter();
+  problem volatile p = NULL;
+  error_handler h;
+  if ( setjmp( h.env ) != 0 ) {
+    if ( p != NULL )
+      cJSON_Delete( p->json );
+    astrahl_leave( registered );
+    return ASTRAHL_ERROR_INPUT;
+  }
+  error_push( &h );
+  p = astrahl_problem( json, length );
+  batch b = problem_to_batch( p, NULL, NULL );
+  error_pop( &h );
+  cJSON_Delete( p->json );
+  *res = astrahl_model_of( b );
+  astrahl_leave( registered );
+  return ASTRAHL_OK;
+}
+
+int astrahl_model_load( const char* filename, const char* json,
+                        size_t length, astrahl_model* res ) {
+  if ( filename == NULL || res == NULL )
+    return ASTRAHL_ERROR_ARGUMENT;
+  bool registered = astrahl_enter();
+  problem volatile p = NULL;
+  error_handler h;
+  if ( setjmp( h.env ) != 0 ) {
+    if ( p != NULL )
+      cJSON_Delete( p->json );
+    astrahl_leave( registered );
+    return ASTRAHL_ERROR_INPUT;
+  }
+  error_push( &h );
+  if ( json != NULL )
+    p = astrahl_problem( json, length );
+  batch b = model_to_batch( model_load( ( char* ) filename ), p, NULL, NULL );
+  error_pop( &h );
+  if ( p != NULL )
+    cJSON_Delete( p->json );
+  *res = astrahl_model_of( b );
+  astrahl_leave( registered );
+  return ASTRAHL_OK;
+}
+
+void astrahl_model_free( astrahl_model m ) {
+  if ( m == NULL )
+    return;
+  bool registered = astrahl_enter();
+  GC_FREE( m );
+  astrahl_leave( registered );
+}
+
+/*
+ * Usage
+ */
+
+int astrahl_model_wires( astrahl_model m ) {
+  if ( m == NULL )
+    return -1;
+  return m->b->n;
+}
+
+int astrahl_propagate( astrahl_model m, const double* point,
+                       double* probability ) {
+  if ( m == NULL || point == NULL || probability == NULL )
+    return ASTRAHL_ERROR_ARGUMENT;
+  bool registered = astrahl_enter();
+  error_handler h;
+  if ( setjmp( h.env ) != 0 ) {
+    astrahl_leave( registered );
+    return ASTRAHL_ERROR_INPUT;
+  }
+  error_push( &h );
+  double res = fltt_propagate_prob( batch_fltt( m->b ),
+                                    astrahl_point( m->b->n, point ) );
+  error_pop( &h );
+  *probability = res;
+  astrahl_leave( registered );
+  return ASTRAHL_OK;
+}
+
+int astrahl_splits( astrahl_model m, const double* point, double resources,
+                    uint64_t seed, double* confidence, double* bound,
+                    double* splits ) {
+  return astrahl_sweep( m, point, 1, &resources, seed, confidence, bound,
+                        splits );
+}
+
+int astrahl_sweep( astrahl_model m, const double* point, int num,
+                   const double* budgets, uint64_t seed, double* confidences,
+                   double* bounds, double* splits ) {
+  if ( m == NULL || point == NULL || num < 0 || budgets == NULL ||
+       confidences == NULL || bounds == NULL || splits == NULL )
+    return ASTRAHL_ERROR_ARGUMENT;
+  bool registered = astrahl_enter();
+  error_handler h;
+  if ( setjmp( h.env ) != 0 ) {
+    astrahl_leave( registered );
+    return ASTRAHL_ERROR_INPUT;
+  }
+  error_push( &h );
+  batch b = m->b;
+  // the results are only copied to the outputs on success
+  double* conf = GC_MALLOC_ATOMIC( ( num + 1 ) * sizeof( double ) );
+  double* bnd = GC_MALLOC_ATOMIC( ( num + 1 ) * sizeof( double ) );
+  double* res = GC_MALLOC_ATOMIC( ( num * b->n + 1 ) * sizeof( double ) );
+  rng_seed( seed );
+  char* error = batch_splits( b, NULL, astrahl_point( b->n, point ), num > 1,
+                              num, ( double* ) budgets, conf, bnd, res );
+  error_pop( &h );
+  if ( error == NULL ) {
+    memcpy( confidences, conf, num * sizeof( double ) );
+    memcpy( bounds, bnd, num * sizeof( double ) );
+    memcpy( splits, res, num * b->n * sizeof( double ) );
+  } else
+    fprintf( stderr, "astrahl_sweep: %s.\n", error );
+  astrahl_leave( registered );
+  return error == NULL ? ASTRAHL_OK : ASTRAHL_ERROR_REQUEST;
+}
+
+// the state shared by the threads answering a batch of points: the model, the
+// points, their budgets and the seed (for splits), the outputs, the code of
+// the first error (if any), and the lock protecting it
+typedef struct astrahl_job_s {
+  batch b;
+  const double* points;
+  const double* budgets;
+  uint64_t seed;
+  double* probabilities;
+  double* confidences;
+  double* bounds;
+  double* splits;
+  int code;
+  pthread_mutex_t lock;
+} *astrahl_job;
+
+// records the [code] of an error of a job, unless it already had one
+void astrahl_job_fail( astrahl_job job, int code ) {
+  pthread_mutex_lock( &job->lock );
+  if ( job->code == ASTRAHL_OK )
+    job->code = code;
+  pthread_mutex_unlock( &job->lock );
+}
+
+// computes the probability of failure at the point [i] of a job, the errors
+// of threads returning to their own handler
+void astrahl_propagate_one( int i, int worker, void* arg ) {
+  ( void ) worker;
+  astrahl_job job = arg;
+  error_handler h;
+  if ( setjmp( h.env ) != 0 ) {
+    astrahl_job_fail( job, ASTRAHL_ERROR_INPUT );
+    return;
+  }
+  error_push( &h );
+  job->probabilities[ i ] =
+    fltt_propagate_prob( batch_fltt( job->b ),
+                         astrahl_point( job->b->n,
+                                        job->points + i * job->b->n ) );
+  error_pop( &h );
+}
+
+// computes the allocation at the point [i] of a job
+void astrahl_splits_one( int i, int worker, void* arg ) {
+  ( void ) worker;
+  astrahl_job job = arg;
+  int n = job->b->n;
+  error_handler h;
+  if ( setjmp( h.env ) != 0 ) {
+    astrahl_job_fail( job, ASTRAHL_ERROR_INPUT );
+    return;
+  }
+  error_push( &h );
+  rng_seed( job->seed + i );
+  char* error = batch_splits( job->b, NULL,
+                              astrahl_point( n, job->points + i * n ), false,
+                              1, ( double* ) job->budgets + i,
+                              job->confidences + i, job->bounds + i,
+                              job->splits + i * n );
+  error_pop( &h );
+  if ( error != NULL ) {
+    fprintf( stderr, "astrahl_splits_batch: %s.\n", error );
+    astrahl_job_fail( job, ASTRAHL_ERROR_REQUEST );
+  }
+}
+
+// creates the job of a batch of [num] points and runs [f] on each one with
+// [threads] threads
+int astrahl_run( astrahl_job job, int num, int threads,
+                 void ( * f ) ( int i, int worker, void* arg ) ) {
+  bool registered = astrahl_enter();
+  job->code = ASTRAHL_OK;
+  pthread_mutex_init( &job->lock, NULL );
+  // the errors of points are recorded by [f], those of the threads themselves
+  // (e.g., a thread that cannot be created) return here
+  error_handler h;
+  if ( setjmp( h.env ) == 0 ) {
+    error_push( &h );
+    parallel_steal( threads, num, f, job );
+    error_pop( &h );
+  } else
+    astrahl_job_fail( job, ASTRAHL_ERROR_INPUT );
+  pthread_mutex_destroy( &job->lock );
+  astrahl_leave( registered );
+  return job->code;
+}
+
+int astrahl_propagate_batch( astrahl_model m, int num, const double* points,
+                             int threads, double* probabilities ) {
+  if ( m == NULL || num < 0 || points == NULL || probabilities == NULL )
+    return ASTRAHL_ERROR_ARGUMENT;
+  struct astrahl_job_s job;
+  job.b = m->b;
+  job.points = points;
+  job.probabilities = probabilities;
+  return astrahl_run( &job, num, threads, astrahl_propagate_one );
+}
+
+int astrahl_splits_batch( astrahl_model m, int num, const double* points,
+                          const double* budgets, uint64_t seed, int threads,
+                          double* confidences, double* bounds,
+                          double* splits ) {
+  if ( m == NULL || num < 0 || points == NULL || budgets == NULL ||
+       confidences == NULL || bounds == NULL || splits == NULL )
+    return ASTRAHL_ERROR_ARGUMENT;
+  struct astrahl_job_s job;
+  job.b = m->b;
+  job.points = points;
+  job.budgets = budgets;
+  job.seed = seed;
+  job.confidences = confidences;
+  job.bounds = bounds;
+  job.splits = splits;
+  return astrahl_run( &job, num, threads, astrahl_splits_one );
+}
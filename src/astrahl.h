@@ -0,0 +1,170 @@
+/********************************************************************
+ * astrahl.h
+ *
+ * Header of astrahl.c, the C API of the shared library libastrahl.so.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_ASTRAHL_H__
+#define __CCL_ASTRAHL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*********
+ * Types *
+ *********/
+
+/* The codes returned by the functions of the library:
+ * - [ASTRAHL_OK]: success,
+ * - [ASTRAHL_ERROR_INPUT]: a malformed input (its message is printed on the
+ *   standard error),
+ * - [ASTRAHL_ERROR_REQUEST]: a model that cannot answer the request (no
+ *   confidence functions or no optimisation parameters for splits),
+ * - [ASTRAHL_ERROR_ARGUMENT]: a NULL pointer, or a negative number of
+ *   budgets.
+ * The outputs of failed calls are left unchanged (except for batches).
+ */
+#define ASTRAHL_OK             0
+#define ASTRAHL_ERROR_INPUT    1
+#define ASTRAHL_ERROR_REQUEST  2
+#define ASTRAHL_ERROR_ARGUMENT 3
+
+/* The type of models, i.e., fault trees with their confidence functions,
+ * objective, and default optimisation parameters, parsed and compiled once
+ * and kept until [astrahl_model_free]. Calls on the same model may run
+ * concurrently (from any thread), and they never end the process.
+ */
+typedef struct astrahl_model_s* astrahl_model;
+
+/************
+ * Creation *
+ ************/
+
+/* astrahl_model_new: creates a model from the JSON text of a problem, i.e.,
+ * an object with a fault tree "ft", and optional "conf_funcs", "uncertainty",
+ * and "algorithm" (see the batch mode, models never opening trace files).
+ * inputs:
+ * - the [json] text (not necessarily terminated by '\0'),
+ * - its [length],
+ * - a pointer [res] to the model created.
+ * output: a code (see [ASTRAHL_OK]).
+ */
+int astrahl_model_new( const char* json, size_t length, astrahl_model* res );
+
+/* astrahl_model_load: creates a model from a model file (see the compile
+ * mode), mapped in memory.
+ * inputs:
+ * - the [filename] of the model file,
+ * - the JSON text of an object giving its optional "uncertainty" and
+ *   "algorithm" (or NULL, see [astrahl_model_new]),
+ * - its [length],
+ * - a pointer [res] to the model created.
+ * output: a code (see [ASTRAHL_OK]).
+ */
+int astrahl_model_load( const char* filename, const char* json,
+                        size_t length, astrahl_model* res );
+
+/* astrahl_model_free: releases a model.
+ * inputs:
+ * - the model [m] (or NULL).
+ * output: nothing.
+ */
+void astrahl_model_free( astrahl_model m );
+
+/*********
+ * Usage *
+ *********/
+
+/* astrahl_model_wires: gives the number of wires of a model, i.e., the size
+ * of its points and splits.
+ * inputs:
+ * - the model [m].
+ * output: the number of wires (-1 if [m] is NULL).
+ */
+int astrahl_model_wires( astrahl_model m );
+
+/* astrahl_propagate: computes the probability of failure of a model.
+ * inputs:
+ * - the model [m],
+ * - the [point] (the probability of failure of each wire),
+ * - a pointer to the [probability].
+ * output: a code (see [ASTRAHL_OK]).
+ */
+int astrahl_propagate( astrahl_model m, const double* point,
+                       double* probability );
+
+/* astrahl_splits: computes the allocation of resources of a model (see the
+ * splits mode).
+ * inputs:
+ * - the model [m],
+ * - the [point] (the resources already spent on each wire),
+ * - the [resources] to spend,
+ * - the [seed] of the random numbers,
+ * - pointers to the [confidence] and its [bound] (NaN for results that are
+ *   not certified),
+ * - an array of [astrahl_model_wires] doubles, filled with the [splits].
+ * output: a code (see [ASTRAHL_OK]).
+ */
+int astrahl_splits( astrahl_model m, const double* point, double resources,
+                    uint64_t seed, double* confidence, double* bound,
+                    double* splits );
+
+/* astrahl_sweep: computes the allocations of several budgets of a model (see
+ * the sweep mode), each one starting from the previous one.
+ * inputs:
+ * - the model [m],
+ * - the [point] (the resources already spent on each wire),
+ * - the number [num] of budgets,
+ * - the [budgets],
+ * - the [seed] of the random numbers,
+ * - arrays of [num] doubles, filled with the [confidences] and their [bounds]
+ *   (see [astrahl_splits]),
+ * - an array of [num] [astrahl_model_wires] doubles, filled with the
+ *   [splits] (those of budget k from k [astrahl_model_wires]).
+ * output: a code (see [ASTRAHL_OK]).
+ */
+int astrahl_sweep( astrahl_model m, const double* point, int num,
+                   const double* budgets, uint64_t seed, double* confidences,
+                   double* bounds, double* splits );
+
+/* astrahl_propagate_batch: computes the probabilities of failure of a model
+ * at several points, in parallel.
+ * inputs:
+ * - the model [m],
+ * - the number [num] of points,
+ * - the [points] (point k from k [astrahl_model_wires], see
+ *   [astrahl_propagate]),
+ * - the number of [threads] (0 or less for one per processor),
+ * - an array of [num] doubles, filled with the [probabilities].
+ * output: a code (see [ASTRAHL_OK]), the outputs being partly filled on
+ * errors.
+ */
+int astrahl_propagate_batch( astrahl_model m, int num, const double* points,
+                             int threads, double* probabilities );
+
+/* astrahl_splits_batch: computes the allocations of resources of a model at
+ * several points (see [astrahl_splits]), in parallel, the random numbers of
+ * point k being seeded by [seed] + k, so that the results do not depend on
+ * the number of threads.
+ * inputs:
+ * - the model [m],
+ * - the number [num] of points,
+ * - the [points] (point k from k [astrahl_model_wires]),
+ * - the [budgets] of the points ([num] doubles),
+ * - the [seed] of the random numbers,
+ * - the number of [threads] (0 or less for one per processor),
+ * - arrays of [num] doubles, filled with the [confidences] and their [bounds]
+ *   (see [astrahl_splits]),
+ * - an array of [num] [astrahl_model_wires] doubles, filled with the
+ *   [splits] (those of point k from k [astrahl_model_wires]).
+ * output: a code (see [ASTRAHL_OK]), the outputs being partly filled on
+ * errors.
+ */
+int astrahl_splits_batch( astrahl_model m, int num, const double* points,
+                          const double* budgets, uint64_t seed, int threads,
+                          double* confidences, double* bounds,
+                          double* splits );
+
+#endif // __CCL_ASTRAHL_H__
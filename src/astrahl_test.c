@@ -0,0 +1,128 @@
+/********************************************************************
+ * astrahl_test.c
+ *
+ * Defines a battery of tests for the C API of the shared library.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#define _POSIX_C_SOURCE 200809L // for access
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "utils.h"
+#include "astrahl.h"
+#include "astrahl_test.h"
+
+// the fault tree of the tests, on 3 wires
+#define ASTRAHL_TEST_FT \
+  "\"ft\":{\"type\":\"or\",\"subtree1\":{\"type\":\"wire\",\"index\":0}," \
+  "\"subtree2\":{\"type\":\"and\",\"subtree1\":{\"type\":\"wire\"," \
+  "\"index\":1},\"subtree2\":{\"type\":\"wire\",\"index\":2}}}"
+
+// the trace file that models may not open
+#define ASTRAHL_TEST_TRACE "astrahl_test_trace.csv"
+
+void astrahl_test_result( int* res, bool passed, int i, int total ) {
+  printf( "Test %d/%d: ", i, total );
+  if ( passed ) {
+    ++( *res );
+    printf_green();
+    printf( "passed.\n" );
+  } else {
+    printf_bold_red();
+    printf( "FAILED!\n" );
+  }
+  printf_reset();
+}
+
+void astrahl_test_summary( int res, int total ) {
+  printf( "==========================\n" );
+  printf( "Passed tests: " );
+  if ( res == total )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", res, total );
+  printf_reset();
+  printf( ".\n" );
+  printf( "==========================\n" );
+}
+
+// the code of [astrahl_model_new] on [json] (the model being freed)
+int astrahl_test_new( char* json ) {
+  astrahl_model m = NULL;
+  int code = astrahl_model_new( json, strlen( json ), &m );
+  astrahl_model_free( m );
+  return code;
+}
+
+int astrahl_test_codes() {
+  int res = 0;
+  int total = ASTRAHL_TEST_CODES_NUMBER;
+  printf( "Starting library error code tests (error messages expected).\n" );
+  printf( "==========================\n" );
+  astrahl_model m = NULL;
+  astrahl_test_result( &res,
+                       astrahl_model_new( NULL, 0, &m ) ==
+                       ASTRAHL_ERROR_ARGUMENT && m == NULL, 1, total );
+  astrahl_test_result( &res, astrahl_test_new( "{\"ft\":" ) ==
+                             ASTRAHL_ERROR_INPUT, 2, total );
+  astrahl_test_result( &res, astrahl_test_new( "{\"point\":[]}" ) ==
+                             ASTRAHL_ERROR_INPUT, 3, total );
+  // a point of simulated annealing without index
+  astrahl_test_result( &res,
+                       astrahl_test_new(
+                         "{" ASTRAHL_TEST_FT ",\"algorithm\":{\"type\":\"sa\","
+                         "\"sa\":{\"max_step\":100,\"p_init\":0.5,"
+                         "\"function_constant\":1,\"lambda\":35,"
+                         "\"point\":[{\"value\":1}]}}}" ) ==
+                       ASTRAHL_ERROR_INPUT, 4, total );
+  // trace files are refused before they are opened
+  astrahl_test_result( &res,
+                       astrahl_test_new(
+                         "{" ASTRAHL_TEST_FT ",\"algorithm\":{\"type\":\"ga\","
+                         "\"trace\":{\"file\":\"" ASTRAHL_TEST_TRACE "\"}}}" )
+                       == ASTRAHL_ERROR_INPUT &&
+                       access( ASTRAHL_TEST_TRACE, F_OK ) != 0, 5, total );
+  astrahl_test_result( &res,
+                       astrahl_model_load( "astrahl_test_missing.model", NULL,
+                                           0, &m ) == ASTRAHL_ERROR_INPUT &&
+                       m == NULL, 6, total );
+  char* json = "{" ASTRAHL_TEST_FT "}";
+  astrahl_test_result( &res,
+                       astrahl_model_new( json, strlen( json ), &m ) ==
+                       ASTRAHL_OK && astrahl_model_wires( m ) == 3, 7,
+                       total );
+  double point[ 3 ] = { 0.1, 0.2, 0.3 };
+  double probability, confidence, bound, splits[ 3 ];
+  astrahl_test_result( &res, astrahl_propagate( m, NULL, &probability ) ==
+                             ASTRAHL_ERROR_ARGUMENT, 8, total );
+  // the model has no confidence functions
+  astrahl_test_result( &res,
+                       astrahl_splits( m, point, 10, 0, &confidence, &bound,
+                                       splits ) == ASTRAHL_ERROR_REQUEST,
+                       9, total );
+  astrahl_model_free( m );
+  astrahl_test_result( &res, astrahl_model_wires( NULL ) == -1, 10, total );
+  astrahl_test_summary( res, total );
+  return res;
+}
+
+void astrahl_test() {
+  int total = ASTRAHL_TEST_CODES_NUMBER;
+  int n = astrahl_test_codes();
+  printf( "===================\n" );
+  printf( "Total tests passed: " );
+  if ( n == total )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", n, total );
+  printf_reset();
+  printf( ".\n" );
+  printf( "===================\n" );
+}
@@ -0,0 +1,30 @@
+/********************************************************************
+ * astrahl_test.h
+ *
+ * Header of astrahl_test.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_ASTRAHL_TEST_H__
+#define __CCL_ASTRAHL_TEST_H__
+
+/* astrahl_test_codes: runs a series of tests to check whether the functions
+ * of the library return the expected codes (see [ASTRAHL_OK]) on malformed
+ * inputs and arguments, instead of ending the process.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define ASTRAHL_TEST_CODES_NUMBER 10
+// int astrahl_test_codes();
+
+/* astrahl_test: runs a series of tests to check whether the library behaves
+ * as desired.
+ * inputs: none.
+ * output: none.
+ * side effect: prints the series of tests.
+ */
+void astrahl_test();
+
+#endif // __CCL_ASTRAHL_TEST_H__
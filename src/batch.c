@@ -0,0 +1,748 @@
+/********************************************************************
+ * batch.c
+ *
+ * Defines functions to answer many requests on a single problem in a
+ * single run.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#define _POSIX_C_SOURCE 200809L // for getline and open_memstream
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <gc.h>
+#include <cjson/cJSON.h>
+#include "utils.h"
+#include "expression.h"
+#include "logic.h"
+#include "proof.h"
+#include "fault_tree.h"
+#include "objective.h"
+#include "optimisation.h"
+#include "robust.h"
+#include "trace.h"
+#include "warm_start.h"
+#include "module.h"
+#include "parallel.h"
+#include "reader.h"
+#include "model.h"
+#include "batch.h"
+
+/*
+ * Creation
+ */
+
+// the largest index of a wire of [t]
+int batch_max_wire( fault_tree t ) {
+  if ( t->fault_tree_type == WIRE )
+    return t->index;
+  int res = -1;
+  for ( int i = 0; i < t->ports; ++i ) {
+    int m = batch_max_wire( t->children[ i ] );
+    if ( m > res )
+      res = m;
+  }
+  return res;
+}
+
+// a batch of the fault tree [ft] on [n] wires with the confidence functions
+// [cfd_res] (or NULL), or of the model [m] (if [ft] is NULL), whose
+// "uncertainty" and "algorithm" are read from [json] (or NULL)
+batch batch_new( fault_tree ft, model m, int n, expression* cfd_res,
+                 cJSON* json, optim_params params ) {
+  batch b = GC_MALLOC( sizeof( struct batch_s ) );
+  b->ft = ft;
+  b->log = fltt_logic();
+  b->n = n;
+  b->cfd_res = cfd_res;
+  b->m = m;
+  b->uncertainty = NULL;
+  if ( cfd_res != NULL || m != NULL )
+    b->uncertainty = cJSON_to_uncertainty(
+      cJSON_GetObjectItemCaseSensitive( json, "uncertainty" ), 2 * n );
+  b->params = params;
+  cJSON* algorithm = cJSON_GetObjectItemCaseSensitive( json, "algorithm" );
+  if ( b->params == NULL && algorithm != NULL )
+    b->params = cJSON_to_optim_params( algorithm );
+  if ( b->params != NULL )
+    b->params->uncertainty = b->uncertainty;
+  b->p = NULL;
+  b->obj = NULL;
+  b->robust_obj = NULL;
+  b->ws = NULL;
+  pthread_mutex_init( &b->lock, NULL );
+  return b;
+}
+
+batch problem_to_batch( problem p, optim_params params, char* filename ) {
+  if ( p->ft == NULL ) {
+    fprintf( stderr, "problem_to_batch: no fault tree (\"ft\").\n" );
+    error_exit();
+  }
+  int n = batch_max_wire( p->ft ) + 1;
+  // the confidence functions of wire i are at 2 i and 2 i + 1
+  if ( n < ( p->cfd_num + 1 ) / 2 )
+    n = ( p->cfd_num + 1 ) / 2;
+  expression* cfd_res = NULL;
+  if ( p->cfd_res != NULL ) {
+    cfd_res = GC_MALLOC( 2 * n * sizeof( expression ) );
+    for ( int i = 0; i < p->cfd_num; ++i )
+      cfd_res[ i ] = p->cfd_res[ i ];
+  }
+  batch b = batch_new( p->ft, NULL, n, cfd_res, p->json, params );
+  if ( filename != NULL && p->cfd_res != NULL )
+    b->ws = ws_load( filename, reader_key( p ), b->n );
+  return b;
+}
+
+batch model_to_batch( model m, problem p, optim_params params,
+                      char* filename ) {
+  batch b = batch_new( NULL, m, m->n, NULL, p == NULL ? NULL : p->json,
+                       params );
+  b->obj = m->obj;
+  if ( filename != NULL )
+    b->ws = ws_load( filename, m->key, b->n );
+  return b;
+}
+
+batch_cache batch_cache_new( optim_params params, char* filename ) {
+  batch_cache c = GC_MALLOC( sizeof( struct batch_cache_s ) );
+  c->params = params;
+  c->filename = filename;
+  c->keys = NULL;
+  c->texts = NULL;
+  c->problems = NULL;
+  c->size = 0;
+  c->capacity = 0;
+  c->oldest = 0;
+  pthread_mutex_init( &c->lock, NULL );
+  return c;
+}
+
+batch batch_cache_get( batch_cache c, cJSON* json ) {
+  // the problem is identified by the printing of its parts
+  char* names[ 3 ] = { "ft", "conf_funcs", "uncertainty" };
+  char* parts[ 3 ];
+  int length = 3;
+  for ( int k = 0; k < 3; ++k ) {
+    cJSON* item = cJSON_GetObjectItemCaseSensitive( json, names[ k ] );
+    parts[ k ] = item == NULL ? NULL : cJSON_PrintUnformatted( item );
+    if ( parts[ k ] != NULL )
+      length += strlen( names[ k ] ) + strlen( parts[ k ] ) + 4;
+  }
+  if ( parts[ 0 ] == NULL ) {
+    for ( int k = 1; k < 3; ++k )
+      free( parts[ k ] );
+    return NULL;
+  }
+  char* text = GC_MALLOC_ATOMIC( length * sizeof( char ) );
+  int pos = snprintf( text, length, "{" );
+  for ( int k = 0; k < 3; ++k )
+    if ( parts[ k ] != NULL ) {
+      pos += snprintf( text + pos, length - pos, "%s\"%s\":%s",
+                       k == 0 ? "" : ",", names[ k ], parts[ k ] );
+      free( parts[ k ] );
+    }
+  snprintf( text + pos, length - pos, "}" );
+  uint64_t key = hash_string( text, HASH_INIT );
+  // hashes of untrusted texts may collide, so that they are only a shortcut
+  pthread_mutex_lock( &c->lock );
+  for ( int i = 0; i < c->size; ++i )
+    if ( c->keys[ i ] == key && strcmp( c->texts[ i ], text ) == 0 ) {
+      batch b = c->problems[ i ];
+      pthread_mutex_unlock( &c->lock );
+      return b;
+    }
+  pthread_mutex_unlock( &c->lock );
+  // read outside of the lock, two threads may read the same new problem, but
+  // only the first one is kept
+  problem p = reader_problem( text, strlen( text ) );
+  batch b = problem_to_batch( p, c->params, c->filename );
+  cJSON_Delete( p->json );
+  pthread_mutex_lock( &c->lock );
+  for ( int i = 0; i < c->size; ++i )
+    if ( c->keys[ i ] == key && strcmp( c->texts[ i ], text ) == 0 ) {
+      b = c->problems[ i ];
+      pthread_mutex_unlock( &c->lock );
+      return b;
+    }
+  if ( c->size == c->capacity && c->size < BATCH_CACHE_SIZE ) {
+    c->capacity = 2 * c->capacity + 8;
+    if ( c->capacity > BATCH_CACHE_SIZE )
+      c->capacity = BATCH_CACHE_SIZE;
+    uint64_t* keys = GC_MALLOC_ATOMIC( c->capacity * sizeof( uint64_t ) );
+    char** texts = GC_MALLOC( c->capacity * sizeof( char* ) );
+    batch* problems = GC_MALLOC( c->capacity * sizeof( batch ) );
+    for ( int i = 0; i < c->size; ++i ) {
+      keys[ i ] = c->keys[ i ];
+      texts[ i ] = c->texts[ i ];
+      problems[ i ] = c->problems[ i ];
+    }
+    c->keys = keys;
+    c->texts = texts;
+    c->problems = problems;
+  }
+  // full caches replace their oldest problem (still used by the requests
+  // already answered on it)
+  int i = c->size;
+  if ( c->size == BATCH_CACHE_SIZE ) {
+    i = c->oldest;
+    c->oldest = ( c->oldest + 1 ) % BATCH_CACHE_SIZE;
+  } else
+    ++c->size;
+  c->keys[ i ] = key;
+  c->texts[ i ] = text;
+  c->problems[ i ] = b;
+  pthread_mutex_unlock( &c->lock );
+  return b;
+}
+
+/*
+ * Usage
+ */
+
+char* batch_read_line( FILE* in ) {
+  char* buf = NULL;
+  size_t size = 0;
+  ssize_t length = getline( &buf, &size, in );
+  if ( length < 0 ) {
+    free( buf );
+    return NULL;
+  }
+  while ( length > 0 &&
+          ( buf[ length - 1 ] == '\n' || buf[ length - 1 ] == '\r' ) )
+    buf[ --length ] = '\0';
+  char* res = GC_MALLOC_ATOMIC( ( length + 1 ) * sizeof( char ) );
+  memcpy( res, buf, length + 1 );
+  free( buf );
+  return res;
+}
+
+enum CASE_BATCH_FORMAT batch_format_lexer( char* name ) {
+  if      ( strcmp( name, "jsonl" ) == 0 ) return BATCH_JSONL;
+  else if ( strcmp( name, "csv" )   == 0 ) return BATCH_CSV;
+  else if ( strcmp( name, "npy" )   == 0 ) return BATCH_NPY;
+  fprintf( stderr, "batch_format_lexer: Unknown format %s.\n", name );
+  error_exit();
+}
+
+// reads the point of [request] (resources already spent, or probabilities of
+// failure), as an array of [b]->n doubles (0 for missing wires), or NULL if it
+// is malformed
+double* batch_point( batch b, cJSON* request ) {
+  double* sigma = GC_MALLOC_ATOMIC( b->n * sizeof( double ) );
+  for ( int i = 0; i < b->n; ++i )
+    sigma[ i ] = 0;
+  cJSON* coord;
+  cJSON_ArrayForEach( coord,
+                      cJSON_GetObjectItemCaseSensitive( request, "point" ) ) {
+    cJSON* index = cJSON_GetObjectItemCaseSensitive( coord, "index" );
+    cJSON* value = cJSON_GetObjectItemCaseSensitive( coord, "value" );
+    if ( ! cJSON_IsNumber( index ) || ! cJSON_IsNumber( value ) ||
+         index->valueint < 0 || index->valueint >= b->n )
+      return NULL;
+    sigma[ index->valueint ] = value->valuedouble;
+  }
+  return sigma;
+}
+
+fault_tree batch_fltt( batch b ) {
+  pthread_mutex_lock( &b->lock );
+  fault_tree ft = b->ft;
+  pthread_mutex_unlock( &b->lock );
+  if ( ft != NULL )
+    return ft;
+  // rebuilt outside of the lock, only the first tree being kept (see
+  // [batch_objective])
+  ft = model_fltt( b->m );
+  pthread_mutex_lock( &b->lock );
+  if ( b->ft == NULL )
+    b->ft = ft;
+  ft = b->ft;
+  pthread_mutex_unlock( &b->lock );
+  return ft;
+}
+
+// the confidence functions of [b] (NULL if it has none), rebuilt from its
+// model the first time they are needed
+expression* batch_cfd_res( batch b ) {
+  if ( b->m == NULL )
+    return b->cfd_res;
+  pthread_mutex_lock( &b->lock );
+  expression* cfd_res = b->cfd_res;
+  pthread_mutex_unlock( &b->lock );
+  if ( cfd_res != NULL )
+    return cfd_res;
+  cfd_res = model_cfd_res( b->m );
+  pthread_mutex_lock( &b->lock );
+  if ( b->cfd_res == NULL )
+    b->cfd_res = cfd_res;
+  cfd_res = b->cfd_res;
+  pthread_mutex_unlock( &b->lock );
+  return cfd_res;
+}
+
+// the objective of [params] (compiled once for the default parameters, or
+// for all deterministic ones), [dflt] telling whether [params] are the
+// default ones
+objective batch_objective( batch b, optim_params params, bool dflt ) {
+  pthread_mutex_lock( &b->lock );
+  proof p = b->p;
+  objective obj = b->obj;
+  objective robust_obj = b->robust_obj;
+  pthread_mutex_unlock( &b->lock );
+  // compiled outside of the lock, since compilations may fail (see
+  // [error_exit]): two threads may compile the same objective, but only the
+  // first one is kept. The objectives of models are already compiled, their
+  // proofs are only needed for robust objectives
+  if ( p == NULL && ( obj == NULL || params->robust != NULL ) )
+    p = fltt_to_prf( b->n, batch_fltt( b ), b->log );
+  objective res;
+  if ( params->robust == NULL )
+    res = obj != NULL ? obj : obj_from_proof( b->n, p, batch_cfd_res( b ) );
+  else if ( dflt && robust_obj != NULL )
+    res = robust_obj;
+  else
+    res = optim_objective( b->n, p, batch_cfd_res( b ), params );
+  // scenarios drawn for other parameters are not shared
+  pthread_mutex_lock( &b->lock );
+  if ( b->p == NULL )
+    b->p = p;
+  if ( params->robust == NULL ) {
+    if ( b->obj == NULL )
+      b->obj = res;
+    res = b->obj;
+  } else if ( dflt ) {
+    if ( b->robust_obj == NULL )
+      b->robust_obj = res;
+    res = b->robust_obj;
+  }
+  pthread_mutex_unlock( &b->lock );
+  return res;
+}
+
+// prints a number of an answer (null if it is not finite)
+void batch_print_number( FILE* out, double x ) {
+  if ( isfinite( x ) )
+    fprintf( out, "%.*g", DBL_DIG + 2, x );
+  else
+    fprintf( out, "null" );
+}
+
+// starts printing the answer to [request], with its "id" (if any)
+void batch_print_id( FILE* out, cJSON* request ) {
+  fprintf( out, "{" );
+  cJSON* id = cJSON_GetObjectItemCaseSensitive( request, "id" );
+  if ( id != NULL ) {
+    char* s = cJSON_PrintUnformatted( id );
+    fprintf( out, "\"id\":%s,", s );
+    free( s );
+  }
+}
+
+// prints a row of the answers in the csv or npy [format] (see
+// [CASE_BATCH_FORMAT]): the line [number] of the request, the [resources],
+// the [value], its [bound], and the [splits] of the [n] wires (NULL for
+// propagations), non-finite numbers being empty in csv
+void batch_print_row( FILE* out, enum CASE_BATCH_FORMAT format, int n,
+                      int number, double resources, double value,
+                      double bound, double* splits ) {
+  double* row = GC_MALLOC_ATOMIC( ( BATCH_COLUMNS + n ) * sizeof( double ) );
+  row[ 0 ] = number;
+  row[ 1 ] = resources;
+  row[ 2 ] = value;
+  row[ 3 ] = bound;
+  for ( int i = 0; i < n; ++i )
+    row[ BATCH_COLUMNS + i ] = splits == NULL ? NAN : splits[ i ];
+  if ( format == BATCH_NPY ) {
+    fwrite( row, sizeof( double ), BATCH_COLUMNS + n, out );
+    return;
+  }
+  for ( int i = 0; i < BATCH_COLUMNS + n; ++i ) {
+    if ( i > 0 )
+      fprintf( out, "," );
+    if ( isfinite( row[ i ] ) )
+      fprintf( out, "%.*g", DBL_DIG + 2, row[ i ] );
+  }
+  fprintf( out, "\n" );
+}
+
+// adds an allocation to [ws] (see [ws_store]) under the lock of [b], which is
+// released if it fails (e.g., if the cache file cannot be written)
+void batch_store( batch b, warm_start ws, double* sigma, double res,
+                  double* result ) {
+  error_handler h;
+  pthread_mutex_lock( &b->lock );
+  if ( setjmp( h.env ) != 0 ) {
+    pthread_mutex_unlock( &b->lock );
+    error_exit();
+  }
+  error_push( &h );
+  ws_store( ws, sigma, res, result );
+  error_pop( &h );
+  pthread_mutex_unlock( &b->lock );
+}
+
+// computes the allocation of [res] from [sigma], starting from the closest
+// one of [ws] (if any) and adding it to [ws], and fills [report]
+double* batch_split( batch b, optim_params params, bool dflt, warm_start ws,
+                     double* sigma, double res, optim_report report ) {
+  if ( ws != NULL ) {
+    pthread_mutex_lock( &b->lock );
+    params->start = ws_seed( ws, sigma, res );
+    pthread_mutex_unlock( &b->lock );
+  }
+  double* result;
+  if ( params->modules != NULL )
+    result = module_repartition( b->n, batch_fltt( b ), b->log,
+                                 batch_cfd_res( b ), sigma, res, params,
+                                 report );
+  else
+    result = resource_repartition_objective(
+      b->n, batch_objective( b, params, dflt ), sigma, res, params, report );
+  if ( ws != NULL )
+    batch_store( b, ws, sigma, res, result );
+  return result;
+}
+
+char* batch_splits( batch b, optim_params params, double* sigma, bool sweep,
+                    int num, double* budgets, double* confidences,
+                    double* bounds, double* splits ) {
+  if ( b->cfd_res == NULL && b->m == NULL )
+    return "no confidence functions";
+  if ( params == NULL )
+    params = b->params;
+  if ( params == NULL )
+    return "no optimisation parameters";
+  // requests may run concurrently, so each one has its own parameters and
+  // trace (improved allocations are not printed, they would break the
+  // answers)
+  optim_params own = GC_MALLOC( sizeof( struct optim_params_s ) );
+  *own = *params;
+  own->trace = GC_MALLOC( sizeof( struct trace_s ) );
+  *own->trace = *params->trace;
+  own->trace->anytime = false;
+  // sweeps start each optimisation from the previous allocation (kept in
+  // memory when there is no cache)
+  warm_start ws = b->ws;
+  if ( ws == NULL && sweep )
+    ws = ws_load( NULL, 0, b->n );
+  optim_report report = GC_MALLOC( sizeof( struct optim_report_s ) );
+  for ( int k = 0; k < num; ++k ) {
+    double* result = batch_split( b, own, params == b->params, ws, sigma,
+                                  budgets[ k ], report );
+    confidences[ k ] = report->confidence;
+    bounds[ k ] = isfinite( report->bound ) ? report->bound : NAN;
+    memcpy( splits + k * b->n, result, b->n * sizeof( double ) );
+  }
+  // the records of long-lived batches (e.g., servers) are written after each
+  // request, their file being only closed at the end (see [trace_close])
+  if ( own->trace->file != NULL )
+    fflush( own->trace->file );
+  return NULL;
+}
+
+// prints the [confidence], its [bound] (if it is a number), and the [splits]
+// of a budget, after [sep]
+void batch_print_split( batch b, double confidence, double bound,
+                        double* splits, char* sep, FILE* out ) {
+  fprintf( out, "%s\"confidence\":", sep );
+  batch_print_number( out, confidence );
+  if ( isfinite( bound ) ) {
+    fprintf( out, ",\"bound\":" );
+    batch_print_number( out, bound );
+  }
+  fprintf( out, ",\"splits\":[" );
+  for ( int i = 0; i < b->n; ++i ) {
+    if ( i > 0 )
+      fprintf( out, "," );
+    batch_print_number( out, splits[ i ] );
+  }
+  fprintf( out, "]" );
+}
+
+char* batch_request( batch b, cJSON* request, enum CASE_BATCH_FORMAT format,
+                     int number, FILE* out ) {
+  cJSON* mode = cJSON_GetObjectItemCaseSensitive( request, "mode" );
+  char* m = ARGS_MODE_SPLITS_STR;
+  if ( mode != NULL ) {
+    if ( ! cJSON_IsString( mode ) ||
+         ( strcmp( mode->valuestring, ARGS_MODE_PROPAGATE_STR ) != 0 &&
+           strcmp( mode->valuestring, ARGS_MODE_SPLITS_STR ) != 0 &&
+           strcmp( mode->valuestring, ARGS_MODE_SWEEP_STR ) != 0 ) )
+      return "unknown mode";
+    m = mode->valuestring;
+  }
+  double* sigma = batch_point( b, request );
+  if ( sigma == NULL )
+    return "bad point";
+  if ( strcmp( m, ARGS_MODE_PROPAGATE_STR ) == 0 && format != BATCH_JSONL ) {
+    batch_print_row( out, format, b->n, number, NAN,
+                     fltt_propagate_prob( batch_fltt( b ), sigma ), NAN, NULL );
+    return NULL;
+  }
+  if ( strcmp( m, ARGS_MODE_PROPAGATE_STR ) == 0 ) {
+    batch_print_id( out, request );
+    fprintf( out, "\"probability\":" );
+    batch_print_number( out, fltt_propagate_prob( batch_fltt( b ), sigma ) );
+    fprintf( out, "}\n" );
+    return NULL;
+  }
+  bool sweep = strcmp( m, ARGS_MODE_SWEEP_STR ) == 0;
+  cJSON* resources = cJSON_GetObjectItemCaseSensitive( request, "resources" );
+  if ( ! ( cJSON_IsNumber( resources ) ||
+           ( sweep && ( cJSON_IsArray( resources ) ||
+                        cJSON_IsObject( resources ) ) ) ) )
+    return "no resources";
+  if ( b->cfd_res == NULL && b->m == NULL )
+    return "no confidence functions";
+  optim_params params = b->params;
+  cJSON* algorithm = cJSON_GetObjectItemCaseSensitive( request, "algorithm" );
+  if ( algorithm != NULL ) {
+    // requests may come from clients of servers, which should not write files
+    if ( optim_params_trace_file( algorithm ) )
+      return "no trace file allowed in requests";
+    params = cJSON_to_optim_params( algorithm );
+    params->uncertainty = b->uncertainty;
+  }
+  int num;
+  double* budgets = cJSON_to_budgets( resources, &num );
+  double* confidences = GC_MALLOC_ATOMIC( num * sizeof( double ) );
+  double* bounds = GC_MALLOC_ATOMIC( num * sizeof( double ) );
+  double* splits = GC_MALLOC_ATOMIC( num * b->n * sizeof( double ) );
+  char* error = batch_splits( b, params, sigma, sweep, num, budgets,
+                              confidences, bounds, splits );
+  if ( error != NULL )
+    return error;
+  // rows have one line per budget
+  if ( format != BATCH_JSONL ) {
+    for ( int k = 0; k < num; ++k )
+      batch_print_row( out, format, b->n, number, budgets[ k ],
+                       confidences[ k ], bounds[ k ], splits + k * b->n );
+    return NULL;
+  }
+  batch_print_id( out, request );
+  if ( sweep )
+    fprintf( out, "\"sweep\":[" );
+  for ( int k = 0; k < num; ++k ) {
+    if ( sweep ) {
+      fprintf( out, k == 0 ? "{\"resources\":" : ",{\"resources\":" );
+      batch_print_number( out, budgets[ k ] );
+    }
+    batch_print_split( b, confidences[ k ], bounds[ k ], splits + k * b->n,
+                       sweep ? "," : "", out );
+    if ( sweep )
+      fprintf( out, "}" );
+  }
+  fprintf( out, sweep ? "]}\n" : "}\n" );
+  return NULL;
+}
+
+// answers the request on [line] (numbered [number]), with the problem of
+// [b], or the one of [c] if it has a fault tree, and a random number
+// generator seeded by its "seed" field or by [number]; returns an error
+// message if the request is malformed
+char* batch_line( batch b, batch_cache c, char* line, int number,
+                  enum CASE_BATCH_FORMAT format, FILE* out ) {
+  cJSON* request = cJSON_Parse( line );
+  if ( request == NULL )
+    return "invalid JSON";
+  batch problem = b;
+  if ( cJSON_GetObjectItemCaseSensitive( request, "ft" ) != NULL )
+    problem = batch_cache_get( c, request );
+  if ( format != BATCH_JSONL && problem->n != b->n ) {
+    cJSON_Delete( request );
+    return "not as many wires as the default problem";
+  }
+  cJSON* seed = cJSON_GetObjectItemCaseSensitive( request, "seed" );
+  rng_seed( cJSON_IsNumber( seed ) ? ( uint64_t ) seed->valuedouble :
+            ( uint64_t ) number );
+  char* error = batch_request( problem, request, format, number, out );
+  cJSON_Delete( request );
+  return error;
+}
+
+// the state shared by the threads answering a window of requests: the
+// problems, the format of the answers, the requests and their line numbers,
+// the answers (and their sizes) and errors of the requests answered (in
+// memory until the previous ones are printed), the next one to print, and
+// the first one that failed (-1 if none did, the others being skipped then)
+typedef struct batch_window_s {
+  batch b;
+  batch_cache c;
+  enum CASE_BATCH_FORMAT format;
+  int count;
+  char** lines;
+  int* numbers;
+  char** answers;
+  size_t* sizes;
+  char** errors;
+  bool* done;
+  int next;
+  int failed;
+  FILE* out;
+  pthread_mutex_t lock;
+} *batch_window;
+
+// answers the request [i] of a window, and prints the answers that are next
+// in the order of the requests (the reorder buffer)
+void batch_answer( int i, int worker, void* arg ) {
+  ( void ) worker;
+  batch_window w = arg;
+  pthread_mutex_lock( &w->lock );
+  bool stopped = w->failed >= 0;
+  pthread_mutex_unlock( &w->lock );
+  if ( stopped )
+    return;
+  FILE* out = open_memstream( w->answers + i, w->sizes + i );
+  if ( out == NULL ) {
+    fprintf( stderr, "batch_answer: could not open memory stream.\n" );
+    error_exit();
+  }
+  w->errors[ i ] = batch_line( w->b, w->c, w->lines[ i ], w->numbers[ i ],
+                               w->format, out );
+  fclose( out );
+  pthread_mutex_lock( &w->lock );
+  w->done[ i ] = true;
+  for ( ; w->failed < 0 && w->next < w->count && w->done[ w->next ];
+        ++w->next ) {
+    // the error is raised once all threads are stopped, since raising it here
+    // would only end this thread, with the lock held
+    if ( w->errors[ w->next ] != NULL ) {
+      w->failed = w->next;
+      break;
+    }
+    // NPY answers are binary
+    fwrite( w->answers[ w->next ], 1, w->sizes[ w->next ], w->out );
+    free( w->answers[ w->next ] );
+  }
+  fflush( w->out );
+  pthread_mutex_unlock( &w->lock );
+}
+
+// answers the requests of [in] in [format] (see [batch_run]), without the
+// header of the answers
+void batch_run_requests( batch b, batch_cache c, int threads,
+                         enum CASE_BATCH_FORMAT format, FILE* in,
+                         FILE* out ) {
+  threads = parallel_threads( threads );
+  char* s;
+  int line = 0;
+  // a single thread answers each request as soon as it is read
+  if ( threads == 1 ) {
+    while ( ( s = batch_read_line( in ) ) != NULL ) {
+      if ( strspn( s, " \t" ) == strlen( s ) ) {
+        ++line;
+        continue;
+      }
+      char* error = batch_line( b, c, s, ++line, format, out );
+      if ( error != NULL ) {
+        fprintf( stderr, "batch_run: %s on line %d.\n", error, line );
+        error_exit();
+      }
+      fflush( out );
+    }
+    return;
+  }
+  batch_window w = GC_MALLOC( sizeof( struct batch_window_s ) );
+  w->b = b;
+  w->c = c;
+  w->format = format;
+  w->lines = GC_MALLOC( BATCH_WINDOW * sizeof( char* ) );
+  w->numbers = GC_MALLOC_ATOMIC( BATCH_WINDOW * sizeof( int ) );
+  w->answers = GC_MALLOC_ATOMIC( BATCH_WINDOW * sizeof( char* ) );
+  w->sizes = GC_MALLOC_ATOMIC( BATCH_WINDOW * sizeof( size_t ) );
+  w->errors = GC_MALLOC_ATOMIC( BATCH_WINDOW * sizeof( char* ) );
+  w->done = GC_MALLOC_ATOMIC( BATCH_WINDOW * sizeof( bool ) );
+  w->out = out;
+  pthread_mutex_init( &w->lock, NULL );
+  bool more = true;
+  while ( more ) {
+    w->count = 0;
+    while ( w->count < BATCH_WINDOW &&
+            ( more = ( s = batch_read_line( in ) ) != NULL ) ) {
+      ++line;
+      if ( strspn( s, " \t" ) == strlen( s ) )
+        continue;
+      w->lines[ w->count ] = s;
+      w->numbers[ w->count ] = line;
+      w->done[ w->count++ ] = false;
+    }
+    w->next = 0;
+    w->failed = -1;
+    parallel_steal( threads, w->count, batch_answer, w );
+    if ( w->failed >= 0 ) {
+      pthread_mutex_destroy( &w->lock );
+      fprintf( stderr, "batch_run: %s on line %d.\n", w->errors[ w->failed ],
+               w->numbers[ w->failed ] );
+      error_exit();
+    }
+  }
+  pthread_mutex_destroy( &w->lock );
+}
+
+// prints the header of NPY answers of [rows] rows and [cols] columns (see
+// [BATCH_NPY_HEADER]): the magic string, the version (1.0), the length of
+// the rest, and a Python dictionary describing the matrix, padded with spaces
+void batch_print_npy_header( FILE* out, long rows, int cols ) {
+  uint16_t one = 1;
+  char header[ BATCH_NPY_HEADER ];
+  memset( header, ' ', BATCH_NPY_HEADER );
+  memcpy( header, "\x93NUMPY\x01\x00", 8 );
+  header[ 8 ] = ( BATCH_NPY_HEADER - 10 ) % 256;
+  header[ 9 ] = ( BATCH_NPY_HEADER - 10 ) / 256;
+  int length = snprintf( header + 10, BATCH_NPY_HEADER - 10,
+                         "{'descr': '%cf8', 'fortran_order': False, "
+                         "'shape': (%ld, %d), }",
+                         *( char* ) &one == 1 ? '<' : '>', rows, cols );
+  header[ 10 + length ] = ' ';
+  header[ BATCH_NPY_HEADER - 1 ] = '\n';
+  fwrite( header, 1, BATCH_NPY_HEADER, out );
+}
+
+void batch_run( batch b, batch_cache c, int threads,
+                enum CASE_BATCH_FORMAT format, FILE* in, FILE* out ) {
+  int cols = BATCH_COLUMNS + b->n;
+  if ( format == BATCH_CSV ) {
+    fprintf( out, "request,resources,value,bound" );
+    for ( int i = 0; i < b->n; ++i )
+      fprintf( out, ",%d", i );
+    fprintf( out, "\n" );
+  }
+  if ( format != BATCH_NPY ) {
+    batch_run_requests( b, c, threads, format, in, out );
+    return;
+  }
+  // the number of rows is only known at the end: the header is rewritten in
+  // files, and the rows are kept in memory in other streams (e.g., pipes)
+  long start = ftell( out );
+  if ( start >= 0 && fseek( out, start, SEEK_SET ) == 0 ) {
+    batch_print_npy_header( out, 0, cols );
+    batch_run_requests( b, c, threads, format, in, out );
+    long end = ftell( out );
+    fseek( out, start, SEEK_SET );
+    batch_print_npy_header( out, ( end - start - BATCH_NPY_HEADER ) /
+                                 ( cols * sizeof( double ) ), cols );
+    fseek( out, end, SEEK_SET );
+    fflush( out );
+    return;
+  }
+  char* rows;
+  size_t size;
+  FILE* mem = open_memstream( &rows, &size );
+  if ( mem == NULL ) {
+    fprintf( stderr, "batch_run: could not open memory stream.\n" );
+    error_exit();
+  }
+  batch_run_requests( b, c, threads, format, in, mem );
+  fclose( mem );
+  batch_print_npy_header( out, size / ( cols * sizeof( double ) ), cols );
+  fwrite( rows, 1, size, out );
+  free( rows );
+  fflush( out );
+}
@@ -0,0 +1,276 @@
+/********************************************************************
+ * batch.h
+ *
+ * Header of batch.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_BATCH_H__
+#define __CCL_BATCH_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <cjson/cJSON.h>
+#include "expression.h"
+#include "logic.h"
+#include "proof.h"
+#include "fault_tree.h"
+#include "objective.h"
+#include "optimisation.h"
+#include "robust.h"
+#include "warm_start.h"
+#include "reader.h"
+#include "model.h"
+
+/*********
+ * Types *
+ *********/
+
+/* The type structure for batches of requests on a single problem, i.e., a
+ * fault tree and confidence functions parsed and compiled once for all
+ * requests:
+ * - [ft] and [log]: the fault tree and the logic interpreting it,
+ * - [n]: the number of wires (larger than the indices of the wires of [ft]
+ *   and of the confidence functions),
+ * - [cfd_res]: the confidence functions (the positive and negative ones of
+ *   wire i being at 2 i and 2 i + 1), NULL if the problem has none (in which
+ *   case only probabilities can be computed),
+ * - [m]: the model of the batch (NULL for problems), whose [ft] and [cfd_res]
+ *   are only rebuilt when they are needed (see [batch_fltt]),
+ * - [uncertainty]: the uncertain constants of the confidence functions (or
+ *   NULL),
+ * - [params]: the default optimisation parameters (NULL if requests must give
+ *   their own),
+ * - [p]: the proof of [ft] (NULL until it is needed),
+ * - [obj]: the confidence in [p] (NULL until it is needed),
+ * - [robust_obj]: the objective of [params] when it is robust (NULL until it
+ *   is needed),
+ * - [ws]: the warm-start cache (or NULL),
+ * - [lock]: the lock protecting [p], [obj], [robust_obj], [ws], and the
+ *   [ft] and [cfd_res] of models, so that requests can be answered
+ *   concurrently.
+ */
+typedef struct batch_s {
+  fault_tree ft;
+  logic log;
+  int n;
+  expression* cfd_res;
+  model m;
+  uncertainty uncertainty;
+  optim_params params;
+  proof p;
+  objective obj;
+  objective robust_obj;
+  warm_start ws;
+  pthread_mutex_t lock;
+} *batch;
+
+/* The type structure for caches of problems, identified by the printing of
+ * their fault tree, confidence functions, and uncertain constants (and its
+ * hash, compared first), so that each problem is parsed and compiled once:
+ * - [params]: the default optimisation parameters of the problems,
+ * - [filename]: the warm-start cache shared by all problems (or NULL),
+ * - [keys], [texts], [problems], [size], and [capacity]: the problems,
+ * - [oldest]: the problem replaced next once there are [BATCH_CACHE_SIZE],
+ * - [lock]: the lock protecting the problems.
+ */
+typedef struct batch_cache_s {
+  optim_params params;
+  char* filename;
+  uint64_t* keys;
+  char** texts;
+  batch* problems;
+  int size;
+  int capacity;
+  int oldest;
+  pthread_mutex_t lock;
+} *batch_cache;
+
+// the largest number of problems kept by caches, beyond which the oldest
+// ones are replaced (so that long-lived servers use bounded memory)
+#define BATCH_CACHE_SIZE 1024
+
+// the number of requests read at once by [batch_run] with several threads
+#define BATCH_WINDOW 4096
+
+/* Different possible formats for the answers of batches:
+ * - JSON Lines (one JSON object per request, see [batch_request]),
+ * - CSV, with a header and one row per answer (a propagation, a split, or a
+ *   budget of a sweep), whose columns are the line of the "request", the
+ *   "resources", the "value" (the confidence of splits, the probability of
+ *   propagations), its "bound", and the splits of each wire (named by their
+ *   index), missing values being empty,
+ * - NPY (the format of numpy arrays, that numpy can map in memory), a matrix
+ *   of doubles with the same rows and columns, missing values being NaN.
+ * The answers of all requests have the same columns, so requests with their
+ * own problem must have the same number of wires as the default one.
+ */
+enum CASE_BATCH_FORMAT {
+  BATCH_JSONL,
+  BATCH_CSV,
+  BATCH_NPY
+};
+
+// the number of columns of rows (see [CASE_BATCH_FORMAT]) before the splits
+#define BATCH_COLUMNS 4
+
+// the size of the header of NPY answers (a multiple of 64, as numpy expects)
+#define BATCH_NPY_HEADER 128
+
+/************
+ * Creation *
+ ************/
+
+/* problem_to_batch: creates the batch of a problem (see [reader_problem]),
+ * i.e., a fault tree "ft", and optional "conf_funcs", "uncertainty", and
+ * "algorithm" (the default optimisation parameters, see
+ * [cJSON_to_optim_params]).
+ * inputs:
+ * - the problem [p],
+ * - the default optimisation parameters [params] (NULL to read them from
+ *   [json]),
+ * - the [filename] of a warm-start cache (or NULL).
+ * output: the batch.
+ */
+batch problem_to_batch( problem p, optim_params params, char* filename );
+
+/* model_to_batch: creates the batch of a model (see [model_load]), whose
+ * objective is used as it is, and whose fault tree and confidence functions
+ * are only rebuilt for the requests needing them (propagations, modules, and
+ * robust objectives).
+ * inputs:
+ * - the model [m],
+ * - the problem [p] giving its optional "uncertainty" and "algorithm" (see
+ *   [problem_to_batch], or NULL),
+ * - the default optimisation parameters [params] (NULL to read them from
+ *   [p]),
+ * - the [filename] of a warm-start cache (or NULL).
+ * output: the batch.
+ */
+batch model_to_batch( model m, problem p, optim_params params,
+                      char* filename );
+
+/* batch_cache_new: creates an empty cache of problems.
+ * inputs:
+ * - the default optimisation parameters [params] of the problems (or NULL),
+ * - the [filename] of a warm-start cache (or NULL).
+ * output: the cache.
+ */
+batch_cache batch_cache_new( optim_params params, char* filename );
+
+/* batch_cache_get: finds the problem of a JSON object (see
+ * [problem_to_batch], its "algorithm" being ignored), creating it if it is not
+ * in the cache yet (replacing the oldest problem if the cache is full, see
+ * [BATCH_CACHE_SIZE]). Several threads may look problems up at the same time.
+ * inputs:
+ * - the cache [c],
+ * - the JSON object [json].
+ * output: the problem, or NULL if [json] has no fault tree ("ft").
+ */
+batch batch_cache_get( batch_cache c, cJSON* json );
+
+/*********
+ * Usage *
+ *********/
+
+/* batch_read_line: reads a line of a stream.
+ * inputs:
+ * - the stream [in].
+ * output: the line (without its end of line), or NULL at the end of [in].
+ */
+char* batch_read_line( FILE* in );
+
+/* batch_format_lexer: reads the name of a format ("jsonl", "csv", or "npy",
+ * see [CASE_BATCH_FORMAT]).
+ * inputs:
+ * - the [name] of the format.
+ * output: the format.
+ */
+enum CASE_BATCH_FORMAT batch_format_lexer( char* name );
+
+/* batch_fltt: gives the fault tree of a batch, rebuilding the one of its
+ * model (see [model_fltt]) the first time it is needed. Several threads may
+ * call it at the same time.
+ * inputs:
+ * - the batch [b].
+ * output: the fault tree.
+ */
+fault_tree batch_fltt( batch b );
+
+/* batch_splits: computes the allocations of several budgets from a point (as
+ * splits or sweep requests, see [batch_request]), each one starting from the
+ * closest allocation of the warm-start cache of the batch (if any), or from
+ * the previous budget for sweeps. Computations on the same batch may run
+ * concurrently.
+ * inputs:
+ * - the batch [b],
+ * - the optimisation parameters [params] (NULL for the default ones),
+ * - the point [sigma] (the resources already spent on each wire),
+ * - whether the budgets are a [sweep],
+ * - the number [num] of budgets,
+ * - the [budgets],
+ * - arrays of [num] doubles, filled with the [confidences] and their [bounds]
+ *   (NaN for results that are not certified),
+ * - an array of [num] [b]->n doubles, filled with the [splits] (those of
+ *   budget k from k [b]->n).
+ * output: NULL, or an error message if the batch has no confidence functions
+ * or no optimisation parameters (in which case nothing is filled).
+ */
+char* batch_splits( batch b, optim_params params, double* sigma, bool sweep,
+                    int num, double* budgets, double* confidences,
+                    double* bounds, double* splits );
+
+/* batch_request: answers a request, i.e., a JSON object with a "mode"
+ * ("propagate", "splits", or "sweep", default "splits"), a "point" (as in the
+ * input of the corresponding modes), "resources" to spend (for splits and
+ * sweeps, see [cJSON_to_budgets]), an optional "algorithm" (overriding the
+ * default optimisation parameters, without a trace file, see
+ * [optim_params_trace_file]), and an optional "id" (copied to the
+ * answer). The answer is printed on a single line, as a JSON object with the
+ * "id" and either the "probability" of failure, the "confidence", its "bound"
+ * (for certified results), and the "splits" (an array of the resources to
+ * spend on each wire), or a "sweep" array of such objects (with their
+ * "resources"). In the other formats, the answer is printed as rows (see
+ * [CASE_BATCH_FORMAT]), without the "id". Requests on the same batch may be
+ * answered concurrently.
+ * inputs:
+ * - the batch [b],
+ * - the [request],
+ * - the [format] of the answer,
+ * - the [number] of the request (its line, for rows),
+ * - the stream [out] the answer is printed to.
+ * output: NULL, or an error message if the request is malformed (in which
+ * case nothing is printed).
+ */
+char* batch_request( batch b, cJSON* request, enum CASE_BATCH_FORMAT format,
+                     int number, FILE* out );
+
+/* batch_run: answers the requests of a stream, one per line (JSON Lines),
+ * skipping empty lines. Requests with a fault tree ("ft") are answered on
+ * their own problem (see [batch_cache_get]), the others on the default one.
+ * The random number generator is seeded for each request, by its "seed" field
+ * (if any) or its line number, so that answers do not depend on the number of
+ * threads. With several threads, requests are read by windows of
+ * [BATCH_WINDOW], answered in parallel (see [parallel_steal]), and printed in
+ * the order of the requests as soon as the previous ones are printed. NPY
+ * answers start with a header giving their number of rows: it is rewritten
+ * at the end if [out] is a file, otherwise the answers are kept in memory
+ * until the end.
+ * inputs:
+ * - the default problem [b],
+ * - the cache [c] of the other problems,
+ * - the number of [threads] (see [parallel_threads], a single thread
+ *   answering each request as soon as it is read),
+ * - the [format] of the answers,
+ * - the stream [in] of requests,
+ * - the stream [out] the answers are printed to (and flushed after each
+ *   answer).
+ * output: nothing.
+ */
+void batch_run( batch b, batch_cache c, int threads,
+                enum CASE_BATCH_FORMAT format, FILE* in, FILE* out );
+
+#endif // __CCL_BATCH_H__
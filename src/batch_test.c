@@ -0,0 +1,202 @@
+/********************************************************************
+ * batch_test.c
+ *
+ * Defines a battery of tests for batches of requests.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#define _POSIX_C_SOURCE 200809L // for fmemopen and open_memstream
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <setjmp.h>
+#include <gc.h>
+#include "utils.h"
+#include "parallel.h"
+#include "reader.h"
+#include "batch.h"
+#include "batch_test.h"
+
+// the problem of the tests (only propagations are requested)
+#define BATCH_TEST_PROBLEM \
+  "{\"ft\":{\"type\":\"or\",\"subtree1\":{\"type\":\"wire\",\"index\":0}," \
+  "\"subtree2\":{\"type\":\"and\",\"subtree1\":{\"type\":\"wire\"," \
+  "\"index\":1},\"subtree2\":{\"type\":\"wire\",\"index\":2}}}}"
+
+void batch_test_result( int* res, bool passed, int i, int total ) {
+  printf( "Test %d/%d: ", i, total );
+  if ( passed ) {
+    ++( *res );
+    printf_green();
+    printf( "passed.\n" );
+  } else {
+    printf_bold_red();
+    printf( "FAILED!\n" );
+  }
+  printf_reset();
+}
+
+void batch_test_summary( int res, int total ) {
+  printf( "==========================\n" );
+  printf( "Passed tests: " );
+  if ( res == total )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", res, total );
+  printf_reset();
+  printf( ".\n" );
+  printf( "==========================\n" );
+}
+
+// counts the calls of parallel_steal on each index (each index being only
+// written by the thread it is given to)
+void batch_test_count( int i, int worker, void* arg ) {
+  ( void ) worker;
+  ++( ( int* ) arg )[ i ];
+}
+
+int batch_test_steal() {
+  int counts[ 4 ] = { 0, 1, 7, 1000 };
+  int threads[ 3 ] = { 1, 2, 4 };
+  int res = 0;
+  int total = BATCH_TEST_STEAL_NUMBER;
+  printf( "Starting parallel_steal tests.\n" );
+  printf( "==========================\n" );
+  for ( int i = 0; i < 4; ++i )
+    for ( int j = 0; j < 3; ++j ) {
+      int* calls = GC_MALLOC_ATOMIC( ( counts[ i ] + 1 ) * sizeof( int ) );
+      for ( int k = 0; k < counts[ i ]; ++k )
+        calls[ k ] = 0;
+      parallel_steal( threads[ j ], counts[ i ], batch_test_count, calls );
+      bool passed = true;
+      for ( int k = 0; k < counts[ i ]; ++k )
+        passed = passed && calls[ k ] == 1;
+      batch_test_result( &res, passed, 3 * i + j + 1, total );
+    }
+  batch_test_summary( res, total );
+  return res;
+}
+
+// [num] propagation requests, the one of index [bad] (if any) having a wire
+// out of range in its point
+char* batch_test_requests( int num, int bad ) {
+  int length = 128 * num + 1;
+  char* text = GC_MALLOC_ATOMIC( length * sizeof( char ) );
+  int pos = 0;
+  for ( int k = 0; k < num; ++k )
+    pos += snprintf( text + pos, length - pos,
+                     "{\"id\":%d,\"mode\":\"propagate\",\"point\":["
+                     "{\"index\":0,\"value\":%g},{\"index\":%d,\"value\":%g},"
+                     "{\"index\":2,\"value\":0.5}]}\n",
+                     k, k / 1e3, k == bad ? 99 : 1, 1 - k / 1e3 );
+  return text;
+}
+
+// runs batch_run on the [requests] with [threads] threads in [format],
+// storing whether it raised an error in [failed], and returns the answers
+// (of [size] bytes)
+char* batch_test_run( char* requests, int threads,
+                      enum CASE_BATCH_FORMAT format, size_t* size,
+                      bool* failed ) {
+  problem p = reader_problem( BATCH_TEST_PROBLEM,
+                              strlen( BATCH_TEST_PROBLEM ) );
+  batch b = problem_to_batch( p, NULL, NULL );
+  cJSON_Delete( p->json );
+  char* answers = NULL;
+  FILE* in = fmemopen( requests, strlen( requests ), "r" );
+  FILE* out = open_memstream( &answers, size );
+  if ( in == NULL || out == NULL ) {
+    fprintf( stderr, "batch_test_run: could not open memory streams.\n" );
+    error_exit();
+  }
+  *failed = false;
+  error_handler h;
+  if ( setjmp( h.env ) != 0 )
+    *failed = true;
+  else {
+    error_push( &h );
+    batch_run( b, batch_cache_new( NULL, NULL ), threads, format, in, out );
+    error_pop( &h );
+  }
+  fclose( in );
+  fclose( out );
+  // the answers are copied, so that they are collected like the rest
+  char* res = GC_MALLOC_ATOMIC( *size + 1 );
+  memcpy( res, answers, *size + 1 );
+  free( answers );
+  return res;
+}
+
+int batch_test_order() {
+  enum CASE_BATCH_FORMAT formats[ 3 ] = { BATCH_JSONL, BATCH_CSV,
+                                          BATCH_NPY };
+  char* requests = batch_test_requests( 500, -1 );
+  int res = 0;
+  int total = BATCH_TEST_ORDER_NUMBER;
+  printf( "Starting batch_run order tests.\n" );
+  printf( "==========================\n" );
+  for ( int i = 0; i < 3; ++i ) {
+    size_t size, expected_size;
+    bool failed, expected_failed;
+    char* expected = batch_test_run( requests, 1, formats[ i ],
+                                     &expected_size, &expected_failed );
+    char* answers = batch_test_run( requests, 4, formats[ i ], &size,
+                                    &failed );
+    batch_test_result( &res,
+                       ! failed && ! expected_failed && size > 0 &&
+                       size == expected_size &&
+                       memcmp( answers, expected, size ) == 0,
+                       i + 1, total );
+  }
+  batch_test_summary( res, total );
+  return res;
+}
+
+int batch_test_error() {
+  int threads[ 3 ] = { 1, 2, 4 };
+  // the answers of the requests before the malformed one
+  size_t expected_size;
+  bool expected_failed;
+  char* expected = batch_test_run( batch_test_requests( 3, -1 ), 1,
+                                   BATCH_JSONL, &expected_size,
+                                   &expected_failed );
+  char* requests = batch_test_requests( 20, 3 );
+  int res = 0;
+  int total = BATCH_TEST_ERROR_NUMBER;
+  printf( "Starting batch_run error tests (errors on line 4 expected).\n" );
+  printf( "==========================\n" );
+  for ( int j = 0; j < 3; ++j ) {
+    size_t size;
+    bool failed;
+    char* answers = batch_test_run( requests, threads[ j ], BATCH_JSONL,
+                                    &size, &failed );
+    batch_test_result( &res,
+                       failed && ! expected_failed && size == expected_size &&
+                       memcmp( answers, expected, size ) == 0,
+                       j + 1, total );
+  }
+  batch_test_summary( res, total );
+  return res;
+}
+
+void batch_test() {
+  int total = BATCH_TEST_STEAL_NUMBER + BATCH_TEST_ORDER_NUMBER +
+              BATCH_TEST_ERROR_NUMBER;
+  int n = batch_test_steal();
+  n += batch_test_order();
+  n += batch_test_error();
+  printf( "===================\n" );
+  printf( "Total tests passed: " );
+  if ( n == total )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", n, total );
+  printf_reset();
+  printf( ".\n" );
+  printf( "===================\n" );
+}
@@ -0,0 +1,50 @@
+/********************************************************************
+ * batch_test.h
+ *
+ * Header of batch_test.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_BATCH_TEST_H__
+#define __CCL_BATCH_TEST_H__
+
+/* batch_test_steal: runs a series of tests to check whether parallel_steal
+ * calls its function exactly once on every index, for several numbers of
+ * indices and threads.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define BATCH_TEST_STEAL_NUMBER 12
+// int batch_test_steal();
+
+/* batch_test_order: runs a series of tests to check whether the answers of
+ * batch_run with several threads are those of a single thread, in the order
+ * of the requests (in each format).
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define BATCH_TEST_ORDER_NUMBER 3
+// int batch_test_order();
+
+/* batch_test_error: runs a series of tests to check whether a malformed
+ * request makes batch_run raise an error (see [error_exit]) after printing
+ * the answers of the previous requests, with any number of threads.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define BATCH_TEST_ERROR_NUMBER 3
+// int batch_test_error();
+
+/* batch_test: runs a series of tests to check whether batches of requests
+ * are answered as desired.
+ * inputs: none.
+ * output: none.
+ * side effect: prints the series of tests.
+ */
+void batch_test();
+
+#endif // __CCL_BATCH_TEST_H__
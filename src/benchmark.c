@@ -0,0 +1,471 @@
+/********************************************************************
+ * benchmark.c
+ *
+ * Defines functions to time the main steps of the tool on generated
+ * fault trees, reproducibly, to track performance between builds.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#define _POSIX_C_SOURCE 200809L // for open_memstream and clock_gettime
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+#include <gc.h>
+#include <cjson/cJSON.h>
+#include "utils.h"
+#include "expression.h"
+#include "logic.h"
+#include "proof.h"
+#include "fault_tree.h"
+#include "objective.h"
+#include "optimisation.h"
+#include "reader.h"
+#include "benchmark.h"
+
+// the names of the shapes and of the cases, in the order of their enums
+char* benchmark_shapes[ BENCHMARK_SHAPES_NUMBER ] = {
+  "random", "balanced", "chain"
+};
+char* benchmark_cases[ BENCHMARK_CASES_NUMBER ] = {
+  "parse", "fltt_to_prf", "exp_array_composition", "exp_eval",
+  "exp_derivative", "fltt_propagate_prob", "resource_repartition"
+};
+
+// the algorithms timed by default (the preset of each one)
+#define BENCHMARK_ALGORITHMS_NUMBER 9
+char* benchmark_algorithms[ BENCHMARK_ALGORITHMS_NUMBER ] = {
+  "ga", "gahc", "sa", "sahc", "bb", "cma", "discrete", "nsga", "surrogate"
+};
+
+/*
+ * Creation
+ */
+
+// reads an optional array of positive integers (at least one)
+int* cJSON_to_benchmark_ints( cJSON* json, char* key, int* num ) {
+  cJSON* array = cJSON_GetObjectItemCaseSensitive( json, key );
+  if ( ! cJSON_IsArray( array ) || cJSON_GetArraySize( array ) == 0 ) {
+    fprintf( stderr, "cJSON_to_benchmark_params: \"%s\" should be a "
+             "non-empty array.\n", key );
+    error_exit();
+  }
+  *num = cJSON_GetArraySize( array );
+  int* res = GC_MALLOC_ATOMIC( *num * sizeof( int ) );
+  int i = 0;
+  cJSON* item;
+  cJSON_ArrayForEach( item, array ) {
+    if ( ! cJSON_IsNumber( item ) || item->valueint < 1 ) {
+      fprintf( stderr, "cJSON_to_benchmark_params: \"%s\" should be positive "
+               "integers.\n", key );
+      error_exit();
+    }
+    res[ i++ ] = item->valueint;
+  }
+  return res;
+}
+
+// reads an optional array of names (at least one)
+char** cJSON_to_benchmark_names( cJSON* json, char* key, int* num ) {
+  cJSON* array = cJSON_GetObjectItemCaseSensitive( json, key );
+  if ( ! cJSON_IsArray( array ) || cJSON_GetArraySize( array ) == 0 ) {
+    fprintf( stderr, "cJSON_to_benchmark_params: \"%s\" should be a "
+             "non-empty array.\n", key );
+    error_exit();
+  }
+  *num = cJSON_GetArraySize( array );
+  char** res = GC_MALLOC( *num * sizeof( char* ) );
+  int i = 0;
+  cJSON* item;
+  cJSON_ArrayForEach( item, array ) {
+    if ( ! cJSON_IsString( item ) ) {
+      fprintf( stderr, "cJSON_to_benchmark_params: \"%s\" should be "
+               "strings.\n", key );
+      error_exit();
+    }
+    res[ i++ ] = item->valuestring;
+  }
+  return res;
+}
+
+// the name of the optimisation parameters [json] in the results: the preset
+// or the type they are given by
+char* benchmark_algorithm_name( cJSON* json ) {
+  if ( cJSON_IsString( json ) )
+    return json->valuestring;
+  cJSON* name = cJSON_GetObjectItemCaseSensitive( json, "preset" );
+  if ( ! cJSON_IsString( name ) )
+    name = cJSON_GetObjectItemCaseSensitive( json, "type" );
+  return cJSON_IsString( name ) ? name->valuestring : "unknown";
+}
+
+benchmark_params cJSON_to_benchmark_params( cJSON* json ) {
+  benchmark_params res = GC_MALLOC( sizeof( struct benchmark_params_s ) );
+  if ( json != NULL && ! cJSON_IsObject( json ) ) {
+    fprintf( stderr, "cJSON_to_benchmark_params: the parameters should be a "
+             "JSON object.\n" );
+    error_exit();
+  }
+  if ( cJSON_GetObjectItemCaseSensitive( json, "sizes" ) != NULL )
+    res->sizes = cJSON_to_benchmark_ints( json, "sizes", &res->size_num );
+  else {
+    res->size_num = 2;
+    res->sizes = GC_MALLOC_ATOMIC( res->size_num * sizeof( int ) );
+    res->sizes[ 0 ] = 6;
+    res->sizes[ 1 ] = 12;
+  }
+  res->shape_num = BENCHMARK_SHAPES_NUMBER;
+  char** names = benchmark_shapes;
+  if ( cJSON_GetObjectItemCaseSensitive( json, "shapes" ) != NULL )
+    names = cJSON_to_benchmark_names( json, "shapes", &res->shape_num );
+  res->shapes = GC_MALLOC_ATOMIC( res->shape_num *
+                                  sizeof( enum CASE_BENCHMARK_SHAPE ) );
+  for ( int i = 0; i < res->shape_num; ++i )
+    res->shapes[ i ] = benchmark_shape_lexer( names[ i ] );
+  int case_num = BENCHMARK_CASES_NUMBER;
+  names = benchmark_cases;
+  if ( cJSON_GetObjectItemCaseSensitive( json, "cases" ) != NULL )
+    names = cJSON_to_benchmark_names( json, "cases", &case_num );
+  for ( int c = 0; c < BENCHMARK_CASES_NUMBER; ++c )
+    res->cases[ c ] = false;
+  for ( int i = 0; i < case_num; ++i )
+    res->cases[ benchmark_case_lexer( names[ i ] ) ] = true;
+  res->seed = cJSON_get_int( json, "seed", 1 );
+  res->warmup = cJSON_get_int( json, "warmup", 10 );
+  res->repetitions = cJSON_get_int( json, "repetitions", 100 );
+  res->algorithm_warmup = cJSON_get_int( json, "algorithm_warmup", 1 );
+  res->algorithm_repetitions =
+    cJSON_get_int( json, "algorithm_repetitions", 5 );
+  res->resources = cJSON_get_double( json, "resources", 5 );
+  if ( res->warmup < 0 || res->repetitions < 1 ||
+       res->algorithm_warmup < 0 || res->algorithm_repetitions < 1 ) {
+    fprintf( stderr, "cJSON_to_benchmark_params: \"warmup\" should be "
+             "non-negative and \"repetitions\" positive.\n" );
+    error_exit();
+  }
+  // the algorithms are given as for [cJSON_to_optim_params]
+  cJSON* algorithms = cJSON_GetObjectItemCaseSensitive( json, "algorithms" );
+  if ( algorithms != NULL && ( ! cJSON_IsArray( algorithms ) ||
+                               cJSON_GetArraySize( algorithms ) == 0 ) ) {
+    fprintf( stderr, "cJSON_to_benchmark_params: \"algorithms\" should be a "
+             "non-empty array.\n" );
+    error_exit();
+  }
+  res->algorithm_num = algorithms != NULL ?
+    cJSON_GetArraySize( algorithms ) : BENCHMARK_ALGORITHMS_NUMBER;
+  res->algorithms = GC_MALLOC( res->algorithm_num * sizeof( optim_params ) );
+  res->algorithm_names = GC_MALLOC( res->algorithm_num * sizeof( char* ) );
+  for ( int i = 0; i < res->algorithm_num; ++i ) {
+    if ( algorithms != NULL ) {
+      cJSON* item = cJSON_GetArrayItem( algorithms, i );
+      res->algorithms[ i ] = cJSON_to_optim_params( item );
+      res->algorithm_names[ i ] = benchmark_algorithm_name( item );
+    } else {
+      cJSON* item = cJSON_CreateString( benchmark_algorithms[ i ] );
+      res->algorithms[ i ] = cJSON_to_optim_params( item );
+      res->algorithm_names[ i ] = benchmark_algorithms[ i ];
+      cJSON_Delete( item );
+    }
+  }
+  return res;
+}
+
+// a random number in [0, 1]
+double benchmark_uniform() {
+  return ( double ) rng_rand() / RAND_MAX;
+}
+
+// prints a fault tree of [size] wires, the first one being [*wire], and
+// increments [*wire] by [size] (the recursion of _generate_random_FT in
+// evaluation/generate_experiment_settings.py)
+void benchmark_fltt( FILE* out, int size, enum CASE_BENCHMARK_SHAPE shape,
+                     int* wire ) {
+  if ( size == 1 ) {
+    fprintf( out, "{\"type\":\"wire\",\"index\":%d,\"name\":\"Wire %d\"}",
+             *wire, *wire );
+    ++*wire;
+    return;
+  }
+  char* type = rng_rand() % 2 == 0 ? "and" : "or";
+  int left;
+  switch ( shape ) {
+    case SHAPE_RANDOM:
+      left = size == 2 ? 1 : 1 + rng_rand() % ( size - 1 );
+      break;
+    case SHAPE_BALANCED:
+      left = size / 2;
+      break;
+    case SHAPE_CHAIN:
+      left = 1;
+      break;
+    default:
+      fprintf( stderr, "benchmark_fltt: Unknown shape.\n" );
+      error_exit();
+      break;
+  }
+  fprintf( out, "{\"type\":\"%s\",\"subtree1\":", type );
+  benchmark_fltt( out, left, shape, wire );
+  fprintf( out, ",\"subtree2\":" );
+  benchmark_fltt( out, size - left, shape, wire );
+  fprintf( out, "}" );
+}
+
+char* benchmark_problem( int size, enum CASE_BENCHMARK_SHAPE shape ) {
+  char* text;
+  size_t length;
+  FILE* out = open_memstream( &text, &length );
+  if ( out == NULL ) {
+    fprintf( stderr, "benchmark_problem: could not open memory stream.\n" );
+    error_exit();
+  }
+  int wire = 0;
+  fprintf( out, "{\"ft\":" );
+  benchmark_fltt( out, size, shape, &wire );
+  // the positive confidence function of wire i has index 2 i, the negative
+  // one (constant) 2 i + 1
+  fprintf( out, ",\"conf_funcs\":[" );
+  for ( int i = 0; i < size; ++i )
+    fprintf( out, "%s{\"index\":%d,\"expression\":{\"type\":\"sub\","
+             "\"expression1\":{\"type\":\"const\",\"constant\":1},"
+             "\"expression2\":{\"type\":\"pow\","
+             "\"expression1\":{\"type\":\"const\",\"constant\":0.99},"
+             "\"expression2\":{\"type\":\"add\","
+             "\"expression1\":{\"type\":\"var\",\"index\":%d,"
+             "\"wire_index\":%d},"
+             "\"expression2\":{\"type\":\"const\",\"constant\":1}}}}},"
+             "{\"index\":%d,\"expression\":{\"type\":\"const\","
+             "\"constant\":0}}",
+             i == 0 ? "" : ",", 2 * i, 2 * i, i, 2 * i + 1 );
+  fprintf( out, "],\"point\":[" );
+  for ( int i = 0; i < size; ++i )
+    fprintf( out, "%s{\"index\":%d,\"value\":%.*g}", i == 0 ? "" : ",", i,
+             DBL_DIG, 100 + 200 * benchmark_uniform() );
+  fprintf( out, "]}" );
+  fclose( out );
+  // the text is kept by the collector
+  char* res = GC_MALLOC_ATOMIC( ( length + 1 ) * sizeof( char ) );
+  memcpy( res, text, length + 1 );
+  free( text );
+  return res;
+}
+
+/*
+ * Usage
+ */
+
+// the state of the benchmarks of a problem: its [text], its fault tree [ft]
+// of [n] wires, its confidence functions [cfd_res], its point [sigma] and the
+// corresponding [probabilities] of failure, the proof [p] of [ft] in the
+// logic [log] with its composed [branches], the optimisation [params] with
+// their objective [obj] and [seed], the resources [res] to spend, and the
+// [sink] of computed values (so that no call is optimised away)
+typedef struct benchmark_state_s {
+  char* text;
+  size_t length;
+  int n;
+  fault_tree ft;
+  expression* cfd_res;
+  double* sigma;
+  double* probabilities;
+  logic log;
+  proof p;
+  expression* branches;
+  int branch_num;
+  optim_params params;
+  objective obj;
+  uint64_t seed;
+  double res;
+  double sink;
+} *benchmark_state;
+
+// calls the function of [c] once on the state [s]
+void benchmark_call( benchmark_state s, enum CASE_BENCHMARK c ) {
+  problem pb;
+  struct optim_report_s report;
+  switch ( c ) {
+    case CASE_PARSE:
+      pb = reader_problem( s->text, s->length );
+      cJSON_Delete( pb->json );
+      break;
+    case CASE_PROOF:
+      s->p = fltt_to_prf( s->n, s->ft, s->log );
+      break;
+    case CASE_COMPOSITION:
+      for ( int i = 0; i < s->branch_num; ++i )
+        s->branches[ i ] =
+          exp_array_composition( s->p->conclusion->ccl_pos_cfds[ i ],
+                                 s->cfd_res );
+      break;
+    case CASE_EVAL:
+      for ( int i = 0; i < s->branch_num; ++i )
+        s->sink += exp_eval( s->branches[ i ], s->sigma );
+      break;
+    case CASE_DERIVATIVE:
+      for ( int i = 0; i < s->branch_num; ++i )
+        for ( int j = 0; j < s->n; ++j )
+          exp_derivative( s->branches[ i ], j );
+      break;
+    case CASE_PROPAGATE:
+      s->sink += fltt_propagate_prob( s->ft, s->probabilities );
+      break;
+    case CASE_ALGORITHM:
+      // each call draws the same random numbers
+      rng_seed( s->seed );
+      s->sink += resource_repartition_objective( s->n, s->obj, s->sigma,
+                                                 s->res, s->params,
+                                                 &report )[ 0 ];
+      break;
+    default:
+      fprintf( stderr, "benchmark_call: Unknown case.\n" );
+      error_exit();
+      break;
+  }
+}
+
+// the time elapsed since [start], in seconds
+double benchmark_elapsed( struct timespec* start ) {
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return ( now.tv_sec - start->tv_sec ) +
+         ( now.tv_nsec - start->tv_nsec ) * 1e-9;
+}
+
+int benchmark_compare( const void* x, const void* y ) {
+  double d = *( ( double* ) x ) - *( ( double* ) y );
+  return ( d > 0 ) - ( d < 0 );
+}
+
+// the times of [repetitions] calls of [c] after [warmup] untimed ones, in
+// increasing order
+double* benchmark_time( benchmark_state s, enum CASE_BENCHMARK c, int warmup,
+                        int repetitions ) {
+  for ( int k = 0; k < warmup; ++k )
+    benchmark_call( s, c );
+  double* times = GC_MALLOC_ATOMIC( repetitions * sizeof( double ) );
+  struct timespec start;
+  for ( int k = 0; k < repetitions; ++k ) {
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    benchmark_call( s, c );
+    times[ k ] = benchmark_elapsed( &start );
+  }
+  qsort( times, repetitions, sizeof( double ), benchmark_compare );
+  return times;
+}
+
+// the [q]-th percentile of [num] sorted times (nearest rank)
+double benchmark_percentile( double* times, int num, int q ) {
+  int rank = ( q * num + 99 ) / 100;
+  return times[ rank < 1 ? 0 : rank - 1 ];
+}
+
+// prints the result of [c] (with the name of its [algorithm], if any) on a
+// problem of [size] wires and [shape], after a ",\n" unless it is the [first]
+void benchmark_print( FILE* out, bool first, enum CASE_BENCHMARK c,
+                      char* algorithm, enum CASE_BENCHMARK_SHAPE shape,
+                      int size, int warmup, int repetitions, double* times ) {
+  double total = 0;
+  for ( int k = 0; k < repetitions; ++k )
+    total += times[ k ];
+  fprintf( out, "%s    {\"case\":\"%s\"", first ? "" : ",\n",
+           benchmark_cases[ c ] );
+  if ( algorithm != NULL )
+    fprintf( out, ",\"algorithm\":\"%s\"", algorithm );
+  fprintf( out, ",\"shape\":\"%s\",\"size\":%d,\"warmup\":%d,"
+           "\"repetitions\":%d", benchmark_shapes[ shape ], size, warmup,
+           repetitions );
+  fprintf( out, ",\"min\":%.*g,\"mean\":%.*g,\"p50\":%.*g,\"p90\":%.*g,"
+           "\"p99\":%.*g,\"max\":%.*g",
+           DBL_DIG, times[ 0 ], DBL_DIG, total / repetitions,
+           DBL_DIG, benchmark_percentile( times, repetitions, 50 ),
+           DBL_DIG, benchmark_percentile( times, repetitions, 90 ),
+           DBL_DIG, benchmark_percentile( times, repetitions, 99 ),
+           DBL_DIG, times[ repetitions - 1 ] );
+  // calls faster than the clock have no finite throughput
+  if ( total > 0 )
+    fprintf( out, ",\"throughput\":%.*g}", DBL_DIG, repetitions / total );
+  else
+    fprintf( out, ",\"throughput\":null}" );
+  fflush( out );
+}
+
+void benchmark_run( benchmark_params params, FILE* out ) {
+  fprintf( out, "{\n  \"seed\":%llu,\n  \"results\":[\n",
+           ( unsigned long long ) params->seed );
+  bool first = true;
+  for ( int k = 0; k < params->shape_num; ++k )
+    for ( int l = 0; l < params->size_num; ++l ) {
+      enum CASE_BENCHMARK_SHAPE shape = params->shapes[ k ];
+      int size = params->sizes[ l ];
+      // each problem only depends on the seed, its shape, and its size
+      rng_seed( params->seed );
+      struct benchmark_state_s s;
+      s.text = benchmark_problem( size, shape );
+      s.length = strlen( s.text );
+      problem pb = reader_problem( s.text, s.length );
+      cJSON_Delete( pb->json );
+      s.n = size;
+      s.ft = pb->ft;
+      s.cfd_res = pb->cfd_res;
+      s.sigma = pb->point;
+      s.probabilities = GC_MALLOC_ATOMIC( s.n * sizeof( double ) );
+      for ( int i = 0; i < s.n; ++i )
+        s.probabilities[ i ] = pow( 0.99, s.sigma[ i ] + 1 );
+      s.log = fltt_logic();
+      s.p = fltt_to_prf( s.n, s.ft, s.log );
+      s.branch_num = s.p->conclusion->pos_cfd_num;
+      s.branches = GC_MALLOC( s.branch_num * sizeof( expression ) );
+      benchmark_call( &s, CASE_COMPOSITION );
+      s.seed = params->seed;
+      s.res = params->resources * size;
+      s.sink = 0;
+      // the micro benchmarks, each one on the results of the previous ones
+      for ( int c = 0; c < CASE_ALGORITHM; ++c ) {
+        if ( ! params->cases[ c ] )
+          continue;
+        double* times = benchmark_time( &s, c, params->warmup,
+                                        params->repetitions );
+        benchmark_print( out, first, c, NULL, shape, size, params->warmup,
+                         params->repetitions, times );
+        first = false;
+      }
+      if ( ! params->cases[ CASE_ALGORITHM ] )
+        continue;
+      for ( int a = 0; a < params->algorithm_num; ++a ) {
+        s.params = params->algorithms[ a ];
+        s.obj = optim_objective( s.n, s.p, s.cfd_res, s.params );
+        double* times = benchmark_time( &s, CASE_ALGORITHM,
+                                        params->algorithm_warmup,
+                                        params->algorithm_repetitions );
+        benchmark_print( out, first, CASE_ALGORITHM,
+                         params->algorithm_names[ a ], shape, size,
+                         params->algorithm_warmup,
+                         params->algorithm_repetitions, times );
+        first = false;
+      }
+    }
+  fprintf( out, "%s  ]\n}\n", first ? "" : "\n" );
+}
+
+/*
+ * Printing
+ */
+
+enum CASE_BENCHMARK_SHAPE benchmark_shape_lexer( char* token ) {
+  if      ( strcmp( token, "random" )   == 0 ) return SHAPE_RANDOM;
+  else if ( strcmp( token, "balanced" ) == 0 ) return SHAPE_BALANCED;
+  else if ( strcmp( token, "chain" )    == 0 ) return SHAPE_CHAIN;
+  fprintf( stderr, "benchmark_shape_lexer: Unknown token %s.\n", token );
+  error_exit();
+}
+
+enum CASE_BENCHMARK benchmark_case_lexer( char* token ) {
+  for ( int c = 0; c < BENCHMARK_CASES_NUMBER; ++c )
+    if ( strcmp( token, benchmark_cases[ c ] ) == 0 )
+      return c;
+  fprintf( stderr, "benchmark_case_lexer: Unknown token %s.\n", token );
+  error_exit();
+}
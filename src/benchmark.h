@@ -0,0 +1,142 @@
+/********************************************************************
+ * benchmark.h
+ *
+ * Header of benchmark.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_BENCHMARK_H__
+#define __CCL_BENCHMARK_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <cjson/cJSON.h>
+#include "optimisation.h"
+
+/*********
+ * Types *
+ *********/
+
+/* The shapes of generated fault trees (binary trees of "and" and "or" gates
+ * whose wires are numbered from left to right):
+ * - [SHAPE_RANDOM]: random gates and sizes of subtrees (as in
+ *   evaluation/generate_experiment_settings.py),
+ * - [SHAPE_BALANCED]: random gates, subtrees of the same size (up to one),
+ * - [SHAPE_CHAIN]: random gates, each one with a wire as first subtree.
+ */
+enum CASE_BENCHMARK_SHAPE {
+  SHAPE_RANDOM,
+  SHAPE_BALANCED,
+  SHAPE_CHAIN
+};
+#define BENCHMARK_SHAPES_NUMBER 3
+
+/* The functions timed (micro benchmarks, on the problem of each fault tree):
+ * - [CASE_PARSE]: [reader_problem] on its JSON text,
+ * - [CASE_PROOF]: [fltt_to_prf],
+ * - [CASE_COMPOSITION]: [exp_array_composition] of the branches of the proof
+ *   with the confidence functions,
+ * - [CASE_EVAL]: [exp_eval] of the composed branches at the point,
+ * - [CASE_DERIVATIVE]: [exp_derivative] of the composed branches in each wire,
+ * - [CASE_PROPAGATE]: [fltt_propagate_prob] at the probabilities of failure
+ *   of the point,
+ * and the whole optimisation (macro benchmark, once per algorithm):
+ * - [CASE_ALGORITHM]: [resource_repartition_objective].
+ */
+enum CASE_BENCHMARK {
+  CASE_PARSE,
+  CASE_PROOF,
+  CASE_COMPOSITION,
+  CASE_EVAL,
+  CASE_DERIVATIVE,
+  CASE_PROPAGATE,
+  CASE_ALGORITHM
+};
+#define BENCHMARK_CASES_NUMBER 7
+
+/* The type structure for benchmark parameters:
+ * - [sizes] and [size_num]: the numbers of wires of the fault trees,
+ * - [shapes] and [shape_num]: their shapes,
+ * - [cases]: whether each function is timed (see [CASE_BENCHMARK]),
+ * - [seed]: the seed of the random numbers (of each fault tree, point, and
+ *   optimisation, so that runs are reproducible),
+ * - [warmup] and [repetitions]: the number of untimed and timed calls of
+ *   micro benchmarks,
+ * - [algorithm_warmup] and [algorithm_repetitions]: the same for algorithms,
+ * - [algorithms], [algorithm_names], and [algorithm_num]: the optimisation
+ *   parameters of each algorithm, and their names,
+ * - [resources]: the resources to spend per wire.
+ */
+typedef struct benchmark_params_s {
+  int* sizes;
+  int size_num;
+  enum CASE_BENCHMARK_SHAPE* shapes;
+  int shape_num;
+  bool cases[ BENCHMARK_CASES_NUMBER ];
+  uint64_t seed;
+  int warmup;
+  int repetitions;
+  int algorithm_warmup;
+  int algorithm_repetitions;
+  optim_params* algorithms;
+  char** algorithm_names;
+  int algorithm_num;
+  double resources;
+} *benchmark_params;
+
+/************
+ * Creation *
+ ************/
+
+/* cJSON_to_benchmark_params: reads benchmark parameters from a (possibly
+ * NULL) JSON object, with optional fields "sizes" (default [6, 12]),
+ * "shapes" (default all of them), "cases" (default all of them), "seed"
+ * (default 1), "warmup" and "repetitions" (default 10 and 100),
+ * "algorithm_warmup" and "algorithm_repetitions" (default 1 and 5),
+ * "algorithms" (optimisation parameters or preset names, see
+ * [cJSON_to_optim_params], default the preset of each algorithm), and
+ * "resources" (default 5).
+ * inputs:
+ * - the JSON object [json].
+ * output: the parameters.
+ */
+benchmark_params cJSON_to_benchmark_params( cJSON* json );
+
+/* benchmark_problem: generates the JSON text of a problem: a fault tree, the
+ * confidence functions 1 - 0.99^( x + 1 ) of its wires, and a point drawn
+ * uniformly in [100, 300] (as in evaluation/generate_experiment_settings.py).
+ * The random numbers of the calling thread should be seeded (see
+ * [rng_seed]).
+ * inputs:
+ * - the number of wires [size] (at least 1),
+ * - the [shape] of the fault tree.
+ * output: the text.
+ */
+char* benchmark_problem( int size, enum CASE_BENCHMARK_SHAPE shape );
+
+/*********
+ * Usage *
+ *********/
+
+/* benchmark_run: times the functions of the parameters on the problem of each
+ * size and shape, and prints the results as a JSON object with the "seed" and
+ * the "results" of each function, size, and shape: their number of "warmup"
+ * and timed "repetitions", the "min", "mean", "p50", "p90", "p99", and "max"
+ * times of a call (in seconds), and the "throughput" (calls per second).
+ * inputs:
+ * - the parameters [params],
+ * - the stream [out] the results are printed to.
+ * output: nothing.
+ */
+void benchmark_run( benchmark_params params, FILE* out );
+
+/************
+ * Printing *
+ ************/
+
+enum CASE_BENCHMARK_SHAPE benchmark_shape_lexer( char* token );
+enum CASE_BENCHMARK benchmark_case_lexer( char* token );
+
+#endif // __CCL_BENCHMARK_H__
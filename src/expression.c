@@ -11,6 +11,7 @@
 #include <string.h>
 #include <math.h>
 #include <gc.h>
+#include "utils.h"
 #include "expression.h"
 
 /*
@@ -147,7 +148,7 @@ bool exp_equal( expression e1, expression e2 ) {
       break;
     default:
       fprintf( stderr, "exp_equal: Unknown expression type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -173,7 +174,7 @@ int exp_size( expression e ) {
       break;
     default:
       fprintf( stderr, "exp_size: Unknown expression type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -209,7 +210,61 @@ double exp_eval( expression e, double* sigma ) {
       break;
     default:
       fprintf( stderr, "exp_eval: Unknown expression type." );
-      exit( 1 );
+      error_exit();
+      break;
+  }
+}
+
+void exp_eval_interval( expression e, double* lo, double* hi, double* res ) {
+  double x[ 2 ], y[ 2 ];
+  switch ( e->expression_type ) {
+    case VAR:
+      res[ 0 ] = lo[ e->index ];
+      res[ 1 ] = hi[ e->index ];
+      break;
+    case CONST:
+      res[ 0 ] = e->constant;
+      res[ 1 ] = e->constant;
+      break;
+    case OPP:
+      exp_eval_interval( e->child1, lo, hi, x );
+      res[ 0 ] = - x[ 1 ];
+      res[ 1 ] = - x[ 0 ];
+      break;
+    case LOG:
+      exp_eval_interval( e->child1, lo, hi, x );
+      interval_log( x, res );
+      break;
+    case ADD:
+      exp_eval_interval( e->child1, lo, hi, x );
+      exp_eval_interval( e->child2, lo, hi, y );
+      res[ 0 ] = x[ 0 ] + y[ 0 ];
+      res[ 1 ] = x[ 1 ] + y[ 1 ];
+      break;
+    case SUB:
+      exp_eval_interval( e->child1, lo, hi, x );
+      exp_eval_interval( e->child2, lo, hi, y );
+      res[ 0 ] = x[ 0 ] - y[ 1 ];
+      res[ 1 ] = x[ 1 ] - y[ 0 ];
+      break;
+    case MUL:
+      exp_eval_interval( e->child1, lo, hi, x );
+      exp_eval_interval( e->child2, lo, hi, y );
+      interval_mul( x, y, res );
+      break;
+    case DIV:
+      exp_eval_interval( e->child1, lo, hi, x );
+      exp_eval_interval( e->child2, lo, hi, y );
+      interval_div( x, y, res );
+      break;
+    case POW:
+      exp_eval_interval( e->child1, lo, hi, x );
+      exp_eval_interval( e->child2, lo, hi, y );
+      interval_pow( x, y, res );
+      break;
+    default:
+      fprintf( stderr, "exp_eval_interval: Unknown expression type." );
+      error_exit();
       break;
   }
 }
@@ -250,7 +305,7 @@ expression exp_array_composition( expression e, expression* esub ) {
       break;
     default:
       fprintf( stderr, "exp_array_composition: Unknown expression type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -341,7 +396,7 @@ expression exp_simplification( expression e ) {
       break;
     default:
       fprintf( stderr, "exp_simplification: Unknown expression type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -397,7 +452,7 @@ expression exp_derivative_aux( expression e, int i, int n ) {
       break;
     default:
       fprintf( stderr, "exp_derivative: Unknown expression type." );
-      exit( 1 );
+      error_exit();
       break;
   }
   return res;
@@ -590,11 +645,28 @@ int exp_snprintf( char* buf, int length, expression e ) {
       break;
     default:
       fprintf( stderr, "exp_snprintf: Unknown expression type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
 
+expression exp_wire_var( int index, int wire_index ) {
+  char* name = NULL;
+  int n;
+  if ( index == 2 * wire_index ) {
+    n = snprintf( name, 0, "%d+", wire_index );
+    name = GC_MALLOC( ( n + 1 ) * sizeof( char ) );
+    snprintf( name, n, "%d+", wire_index );
+    return exp_var( wire_index, name );
+  } else if ( index == 2 * wire_index + 1 ) {
+    n = snprintf( name, 0, "%d-", wire_index );
+    name = GC_MALLOC( ( n + 1 ) * sizeof( char ) );
+    snprintf( name, n, "%d-", wire_index );
+    return exp_var( wire_index, name );
+  }
+  return NULL;
+}
+
 enum CASE_EXPRESSION exp_type_lexer( char* token ) {
   if      ( strcmp( token, "var" )   == 0 ) return VAR;
   else if ( strcmp( token, "const" ) == 0 ) return CONST;
@@ -606,7 +678,7 @@ enum CASE_EXPRESSION exp_type_lexer( char* token ) {
   else if ( strcmp( token, "div" )   == 0 ) return DIV;
   else if ( strcmp( token, "pow" )   == 0 ) return POW;
   fprintf( stderr, "exp_type_lexer: Unknown token %s.\n", token );
-  exit( 1 );
+  error_exit();
 }
 
 expression cJSON_to_exp( cJSON* json ) {
@@ -614,7 +686,7 @@ expression cJSON_to_exp( cJSON* json ) {
   if ( json1 == NULL ) {
     fprintf( stderr, "cJSON_to_exp: no \"type\" specified in expression %s\n",
              cJSON_Print( json ) );
-    exit( 1 );
+    error_exit();
   }
   char* type;
   if ( cJSON_IsString( json1 ) )
@@ -622,10 +694,8 @@ expression cJSON_to_exp( cJSON* json ) {
   else {
     fprintf( stderr, "cJSON_to_exp: \"type\" is not a string in expression "
              "%s\n", cJSON_Print( json ) );
-    exit( 1 );
+    error_exit();
   }
-  char* name = NULL;
-  int n;
   enum CASE_EXPRESSION exp_type = exp_type_lexer( type );
   cJSON* json2;
   switch ( exp_type ) {
@@ -634,11 +704,11 @@ expression cJSON_to_exp( cJSON* json ) {
       if ( json1 == NULL ) {
         fprintf( stderr, "cJSON_to_exp: no \"index\" specified in variable "
                  "%s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       } else if ( ! cJSON_IsNumber( json1 ) ) {
         fprintf( stderr, "cJSON_to_exp: \"index\" is not a number in variable "
                  "%s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       }
       json2 = cJSON_GetObjectItemCaseSensitive( json, "name" );
       if ( json2 == NULL ) {
@@ -646,41 +716,29 @@ expression cJSON_to_exp( cJSON* json ) {
         if ( json2 == NULL ) {
           fprintf( stderr, "cJSON_to_exp: no \"name\" or \"wire_index\" "
                    "specified in variable %s\n", cJSON_Print( json ) );
-          exit( 1 );
+          error_exit();
         } else if ( ! cJSON_IsNumber( json2 ) ) {
           fprintf( stderr, "cJSON_to_exp: \"wire_index\" is not a number in "
                    "variable %s\n", cJSON_Print( json ) );
-          exit( 1 );
-        } else if ( json1->valueint == 2 * json2->valueint ) {
-          // fprintf( stderr, "cJSON_to_exp: no \"name\" specified, using "
-          //          "\"wire_index\"\n" );
-          n = snprintf( name, 0, "%d+", json2->valueint );
-          name = GC_MALLOC( ( n + 1 ) * sizeof( char ) );
-          snprintf( name, n, "%d+", json2->valueint );
-          // TODO
-          // make sure this is okay
-          return exp_var( json2->valueint, name );
-          // return exp_var( json1->valueint, name );
-        } else if ( json1->valueint == 2 * json2->valueint + 1 ) {
+          error_exit();
+        } else if ( exp_wire_var( json1->valueint,
+                                  json2->valueint ) != NULL ) {
           // fprintf( stderr, "cJSON_to_exp: no \"name\" specified, using "
           //          "\"wire_index\"\n" );
-          n = snprintf( name, 0, "%d-", json2->valueint );
-          name = GC_MALLOC( ( n + 1 ) * sizeof( char ) );
-          snprintf( name, n, "%d-", json2->valueint );
           // TODO
           // make sure this is okay
-          return exp_var( json2->valueint, name );
+          return exp_wire_var( json1->valueint, json2->valueint );
           // return exp_var( json1->valueint, name );
         } else {
           fprintf( stderr, "cJSON_to_exp: incompatible \"index\" (%d) and "
                    "\"wire_index\" (%d).\n", json1->valueint, json2->valueint );
-          exit( 1 );
+          error_exit();
         }
       }
       fprintf( stderr, "cJSON_to_exp: \"name\" specified in variable.\n" );
       fprintf( stderr, "cJSON_to_exp: I hoped we wouldn't fall in this "
                "case.\n" );
-      exit( 1 );
+      error_exit();
       return exp_var( json1->valueint, json2->valuestring );
       break;
     case CONST:
@@ -688,11 +746,11 @@ expression cJSON_to_exp( cJSON* json ) {
       if ( json1 == NULL ) {
         fprintf( stderr, "cJSON_to_exp: no \"constant\" specified in constant "
                  "%s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       } else if ( ! cJSON_IsNumber( json1 ) ) {
         fprintf( stderr, "cJSON_to_exp: \"constant\" is not a number in "
                  "constant %s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       }
       return exp_const( json1->valuedouble );
       break;
@@ -702,11 +760,11 @@ expression cJSON_to_exp( cJSON* json ) {
       if ( json1 == NULL ) {
         fprintf( stderr, "cJSON_to_exp: no \"expression1\" specified in unary "
                  "expression %s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       } else if ( ! cJSON_IsObject( json1 ) ) {
         fprintf( stderr, "cJSON_to_exp: \"expression1\" is not a JSON object "
                  "in unary expression %s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       }
       return exp_unary( cJSON_to_exp( json1 ), exp_type );
       break;
@@ -719,28 +777,28 @@ expression cJSON_to_exp( cJSON* json ) {
       if ( json1 == NULL ) {
         fprintf( stderr, "cJSON_to_exp: no \"expression1\" specified in binary "
                  "expression %s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       } else if ( ! cJSON_IsObject( json1 ) ) {
         fprintf( stderr, "cJSON_to_exp: \"expression1\" is not a JSON object "
                  "in unary expression %s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       }
       json2 = cJSON_GetObjectItemCaseSensitive( json, "expression2" );
       if ( json2 == NULL ) {
         fprintf( stderr, "cJSON_to_exp: no \"expression2\" specified in binary "
                  "expression %s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       } else if ( ! cJSON_IsObject( json2 ) ) {
         fprintf( stderr, "cJSON_to_exp: \"expression2\" is not a JSON object "
                  "in unary expression %s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       }
       return exp_binary( cJSON_to_exp( json1 ), cJSON_to_exp( json2 ),
                          exp_type );
       break;
     default:
       fprintf( stderr, "cJSON_to_exp: Unknown expression type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
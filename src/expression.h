@@ -65,6 +65,18 @@ expression exp_sub( expression e1, expression e2 );
 expression exp_mul( expression e1, expression e2 );
 expression exp_div( expression e1, expression e2 );
 expression exp_pow( expression e1, expression e2 );
+expression exp_unary( expression e, enum CASE_EXPRESSION s );
+expression exp_binary( expression e1, expression e2, enum CASE_EXPRESSION s );
+
+/* exp_wire_var: creates the variable of a confidence function, i.e., the
+ * amount of resources spent on its wire.
+ * inputs:
+ * - the [index] of the confidence function,
+ * - the index [wire_index] of its wire.
+ * output: the variable [wire_index], or NULL if [index] is neither
+ * 2 [wire_index] nor 2 [wire_index] + 1.
+ */
+expression exp_wire_var( int index, int wire_index );
 
 /****************
  * Manipulation *
@@ -100,6 +112,18 @@ int exp_size( expression e );
  */
 double exp_eval( expression e, double* sigma );
 
+/* exp_eval_interval: computes an interval containing all the values of an
+ * expression when variables range over a box (by interval arithmetic, see
+ * utils.h).
+ * inputs:
+ * - the expression [e] to evaluate,
+ * - arrays [lo] and [hi] of doubles that associate a lower and an upper bound
+ *   to each variable,
+ * - an array [res] of two doubles to store the interval.
+ * output: nothing (stored in [res]).
+ */
+void exp_eval_interval( expression e, double* lo, double* hi, double* res );
+
 // /* exp_composition: composes two expressions.
 //  * inputs:
 //  * - the main expression [e],
@@ -141,6 +165,7 @@ expression exp_derivative( expression e, int i );
 
 void exp_printf( expression e );
 int exp_snprintf( char* buf, int length, expression e );
+enum CASE_EXPRESSION exp_type_lexer( char* token );
 expression cJSON_to_exp( cJSON* json );
 
 /**********
@@ -278,6 +278,80 @@ int expression_test_eval() {
   return res;
 }
 
+int expression_test_eval_interval() {
+  double sigma[ 3 ] = { 0, 1, 2.7 };
+  double lo[ 3 ], hi[ 3 ], corner[ 3 ], itv[ 2 ];
+  int res = 0;
+  bool passed;
+  // testing each basic expression type
+  expression* exps = GC_MALLOC( EXP_CASES * sizeof( expression ) );
+  exps[ 0 ] = exp_var( 0, "a" );
+  exps[ 1 ] = exp_const( 1.57 );
+  exps[ 2 ] = exp_opp( exps[ 0 ] );
+  exps[ 3 ] = exp_add( exp_var( 1, "b" ), exps[ 2 ] );
+  exps[ 4 ] = exp_sub( exp_var( 2, "c" ), exps[ 3 ] );
+  exps[ 5 ] = exp_mul( exps[ 3 ], exps[ 4 ] );
+  exps[ 6 ] = exp_div( exps[ 4 ], exps[ 5 ] );
+  exps[ 7 ] = exp_pow( exps[ 5 ], exps[ 6 ] );
+  exps[ 8 ] = exp_log( exps[ 5 ] );
+  printf( "Strating exp_eval_interval tests.\n" );
+  printf( "==========================\n" );
+  for ( int i = 0; i < EXP_CASES; ++i ) {
+    // a box reduced to a point gives the value at that point
+    printf( "Test %d/%d: ", 2 * i + 1,
+            EXP_TEST_EVAL_INTERVAL_BATTERIES_NUMBER * EXP_CASES );
+    exp_eval_interval( exps[ i ], sigma, sigma, itv );
+    if ( dcompare( itv[ 0 ], exp_eval( exps[ i ], sigma ), 10 ) == 0 &&
+         dcompare( itv[ 1 ], exp_eval( exps[ i ], sigma ), 10 ) == 0 ) {
+      ++res;
+      printf_green();
+      printf( "passed.\n" );
+      printf_reset();
+    } else {
+      printf_bold_red();
+      printf( "FAILED!\n" );
+      printf_reset();
+    }
+    // the interval over a box contains the values at its corners
+    printf( "Test %d/%d: ", 2 * i + 2,
+            EXP_TEST_EVAL_INTERVAL_BATTERIES_NUMBER * EXP_CASES );
+    for ( int j = 0; j < 3; ++j ) {
+      lo[ j ] = sigma[ j ] - 0.1;
+      hi[ j ] = sigma[ j ] + 0.1;
+    }
+    exp_eval_interval( exps[ i ], lo, hi, itv );
+    passed = true;
+    for ( int c = 0; c < 8; ++c ) {
+      for ( int j = 0; j < 3; ++j )
+        corner[ j ] = ( c >> j ) % 2 ? hi[ j ] : lo[ j ];
+      if ( exp_eval( exps[ i ], corner ) < itv[ 0 ] ||
+           exp_eval( exps[ i ], corner ) > itv[ 1 ] )
+        passed = false;
+    }
+    if ( passed ) {
+      ++res;
+      printf_green();
+      printf( "passed.\n" );
+      printf_reset();
+    } else {
+      printf_bold_red();
+      printf( "FAILED!\n" );
+      printf_reset();
+    }
+  }
+  printf( "==========================\n" );
+  printf( "Passed tests: " );
+  if ( res == EXP_TEST_EVAL_INTERVAL_BATTERIES_NUMBER * EXP_CASES )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", res, EXP_TEST_EVAL_INTERVAL_BATTERIES_NUMBER * EXP_CASES );
+  printf_reset();
+  printf( ".\n" );
+  printf( "==========================\n" );
+  return res;
+}
+
 int expression_test_simplification() {
   int res = 0;
   // testing each basic expression type as many times as there are possible
@@ -554,6 +628,7 @@ void expression_test() {
                   EXP_TEST_COPY_BATTERIES_NUMBER +
                   EXP_TEST_SNPRINTF_BATTERIES_NUMBER +
                   EXP_TEST_EVAL_BATTERIES_NUMBER +
+                  EXP_TEST_EVAL_INTERVAL_BATTERIES_NUMBER +
                   EXP_TEST_SIMPLIFICATION_BATTERIES_NUMBER +
                   EXP_TEST_DERIVATIVE_BATTERIES_NUMBER +
                   EXP_TEST_MUL_1_MANY_BATTERIES_NUMBER +
@@ -562,6 +637,7 @@ void expression_test() {
   n += expression_test_copy();
   n += expression_test_snprintf();
   n += expression_test_eval();
+  n += expression_test_eval_interval();
   n += expression_test_simplification();
   n += expression_test_derivative();
   n += expression_test_mul_1_many();
@@ -45,6 +45,15 @@
 #define EXP_TEST_EVAL_BATTERIES_NUMBER 2
 // int expression_test_eval();
 
+/* expression_test_eval_interval: runs a series of tests to check whether
+ * exp_eval_interval returns intervals containing the values of expressions.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define EXP_TEST_EVAL_INTERVAL_BATTERIES_NUMBER 2
+// int expression_test_eval_interval();
+
 /* expression_test_simplification: runs a series of tests to check whether
  * exp_simplification returns the desired result.
  * inputs: none.
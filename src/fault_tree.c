@@ -80,15 +80,37 @@ bool fltt_equal( fault_tree t1, fault_tree t2 ) {
       break;
     case WIRE:
       fprintf( stderr, "fltt_equal: Reached bad case." );
-      exit( 1 );
+      error_exit();
       break;
     default:
       fprintf( stderr, "fltt_equal: Unknown fault tree type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
 
+void fltt_wires( fault_tree t, bool* wires ) {
+  if ( t->fault_tree_type == WIRE ) {
+    wires[ t->index ] = true;
+    return;
+  }
+  for ( int i = 0; i < t->ports; ++i )
+    fltt_wires( t->children[ i ], wires );
+}
+
+fault_tree fltt_rename( fault_tree t, int* names ) {
+  if ( t->fault_tree_type == WIRE )
+    return fltt_wire( names[ t->index ] );
+  fault_tree res = GC_MALLOC( sizeof( struct fault_tree_s ) );
+  res->fault_tree_type = t->fault_tree_type;
+  res->ports = t->ports;
+  res->children = GC_MALLOC( res->ports * sizeof( fault_tree ) );
+  for ( int i = 0; i < res->ports; ++i )
+    res->children[ i ] = fltt_rename( t->children[ i ], names );
+  res->index = t->index;
+  return res;
+}
+
 bool fltt_propagate( fault_tree t, bool* sigma ) {
   switch ( t->fault_tree_type ) {
     case WIRE:
@@ -105,7 +127,7 @@ bool fltt_propagate( fault_tree t, bool* sigma ) {
       break;
     default:
       fprintf( stderr, "fltt_eval: Unknown fault tree type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -128,7 +150,7 @@ double fltt_propagate_prob( fault_tree t, double* sigma ) {
       break;
     default:
       fprintf( stderr, "fltt_eval: Unknown fault tree type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -178,11 +200,26 @@ proof fltt_to_prf( int n, fault_tree t, logic log ) {
       break;
     default:
       fprintf( stderr, "fltt_to_prf: Unknown fault tree type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
 
+logic fltt_logic() {
+  enum TRUTH_VALUE neg_table[ TRUTH_VALUE_CASES ] = { TRUE, UNDET, FALSE };
+  enum TRUTH_VALUE imp_table[ TRUTH_VALUE_CASES * TRUTH_VALUE_CASES ] =
+    { TRUE, TRUE, TRUE, UNDET, UNDET, TRUE, FALSE, UNDET, TRUE };
+  enum TRUTH_VALUE disj_table[ TRUTH_VALUE_CASES * TRUTH_VALUE_CASES ] =
+    { FALSE, UNDET, TRUE, UNDET, UNDET, TRUE, TRUE, TRUE, TRUE };
+  enum TRUTH_VALUE conj_table[ TRUTH_VALUE_CASES * TRUTH_VALUE_CASES ] =
+    { FALSE, FALSE, FALSE, FALSE, UNDET, UNDET, FALSE, UNDET, TRUE };
+  logical_operator neg  = table_to_lo( 1, neg_table );
+  logical_operator imp  = table_to_lo( 2, imp_table );
+  logical_operator disj = table_to_lo( 2, disj_table );
+  logical_operator conj = table_to_lo( 2, conj_table );
+  return los_to_log( neg, imp, disj, conj );
+}
+
 /*
  * Printing
  */
@@ -210,7 +247,7 @@ int fltt_symbol_snprintf( char* buf, int length, enum CASE_FAULT_TREE s ) {
       break;
     default:
       fprintf( stderr, "fltt_snprintf: Unknown fault tree type.\n" );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -269,7 +306,7 @@ enum CASE_FAULT_TREE fltt_type_lexer( char* token ) {
   else if ( strcmp( token, "or" )   == 0 ) return OR;
   else if ( strcmp( token, "pand" ) == 0 ) return PAND;
   fprintf( stderr, "fltt_type_lexer: Unknown token %s.\n", token );
-  exit( 1 );
+  error_exit();
 }
 
 fault_tree cJSON_to_fltt( cJSON* json ) {
@@ -277,7 +314,7 @@ fault_tree cJSON_to_fltt( cJSON* json ) {
   if ( json1 == NULL ) {
     fprintf( stderr, "cJSON_to_fltt: no \"type\" specified in fault tree %s\n",
              cJSON_Print( json ) );
-    exit( 1 );
+    error_exit();
   }
   char* type;
   if ( cJSON_IsString( json1 ) ) {
@@ -285,7 +322,7 @@ fault_tree cJSON_to_fltt( cJSON* json ) {
   } else {
     fprintf( stderr, "cJSON_to_fltt: \"type\" is not a string in fault tree "
              "%s\n", cJSON_Print( json ) );
-    exit( 1 );
+    error_exit();
   }
   enum CASE_FAULT_TREE fltt_type = fltt_type_lexer( type );
   int index;
@@ -296,11 +333,11 @@ fault_tree cJSON_to_fltt( cJSON* json ) {
       if ( json1 == NULL ) {
         fprintf( stderr, "cJSON_to_fltt: no \"index\" specified in wire %s\n",
                  cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       } else if ( ! cJSON_IsNumber( json1 ) ) {
         fprintf( stderr, "cJSON_to_fltt: \"index\" is not a number in wire "
                  "%s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       }
       index = json1->valueint;
       return fltt_wire( index );
@@ -313,29 +350,29 @@ fault_tree cJSON_to_fltt( cJSON* json ) {
         fprintf( stderr, "cJSON_to_fltt: no \"subtree1\" specified in binary "
                  "tree %s\n",
                  cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       } else if ( ! cJSON_IsObject( json1 ) ) {
         fprintf( stderr, "cJSON_to_fltt: \"subtree1\" is not a JSON object in "
                  "fault tree %s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       }
       json2 = cJSON_GetObjectItemCaseSensitive( json, "subtree2" );
       if ( json2 == NULL ) {
         fprintf( stderr, "cJSON_to_fltt: no \"subtree2\" specified in binary "
                  "tree %s\n",
                  cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       } else if ( ! cJSON_IsObject( json2 ) ) {
         fprintf( stderr, "cJSON_to_fltt: \"subtree2\" is not a JSON object in "
                  "fault tree %s\n", cJSON_Print( json ) );
-        exit( 1 );
+        error_exit();
       }
       return fltt_binary( cJSON_to_fltt( json1 ), cJSON_to_fltt( json2 ),
                           fltt_type );
       break;
     default:
       fprintf( stderr, "cJSON_to_exp: Unknown expression type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -69,6 +69,24 @@ fault_tree fltt_copy( fault_tree t );
  */
 bool fltt_equal( fault_tree t1, fault_tree t2 );
 
+/* fltt_wires: marks the wires used in a fault tree.
+ * inputs:
+ * - the fault tree [t],
+ * - an array [wires] of booleans, large enough for all the wires of [t],
+ *   whose cells are set to "true" for the wires of [t] (and left unchanged
+ *   for the others).
+ * output: nothing.
+ */
+void fltt_wires( fault_tree t, bool* wires );
+
+/* fltt_rename: returns a copy of a fault tree with renamed wires.
+ * inputs:
+ * - the fault tree [t],
+ * - an array [names] of the new index of each wire of [t].
+ * output: the renamed copy.
+ */
+fault_tree fltt_rename( fault_tree t, int* names );
+
 /* fltt_propagate: propagates faults in a fault tree given faulty wires.
  * inputs:
  * - the fault tree [t],
@@ -98,6 +116,12 @@ double fltt_propagate_prob( fault_tree t, double* sigma );
  */
 proof fltt_to_prf( int n, fault_tree t, logic log );
 
+/* fltt_logic: creates the logic used to interpret fault trees (the
+ * three-valued logic whose connectors are given by their truth tables).
+ * output: the logic.
+ */
+logic fltt_logic();
+
 /************
  * Printing *
  ************/
@@ -105,6 +129,7 @@ proof fltt_to_prf( int n, fault_tree t, logic log );
 void fltt_printf( fault_tree t );
 int fltt_symbol_snprintf( char* buf, int length, enum CASE_FAULT_TREE s );
 int fltt_snprintf( char* buf, int length, fault_tree t );
+enum CASE_FAULT_TREE fltt_type_lexer( char* token );
 fault_tree cJSON_to_fltt( cJSON* json );
 
 #endif // __CCL_FAULT_TREE_H__
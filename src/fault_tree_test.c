@@ -11,6 +11,8 @@
 #include <gc.h>
 #include "utils.h"
 #include "fault_tree.h"
+#include "reader.h"
+#include "model.h"
 #include "fault_tree_test.h"
 
 int fault_tree_test_equal() {
@@ -121,6 +123,169 @@ int fault_tree_test_copy() {
   return res;
 }
 
+int fault_tree_test_rename() {
+  int res = 0;
+  int names[ 4 ] = { 0, 0, 0, 0 };
+  int back[ 1 ] = { 3 };
+  bool wires[ 4 ];
+  // testing each basic fault tree type
+  fault_tree* fltts = GC_MALLOC( FLTT_CASES * sizeof( fault_tree ) );
+  fltts[ 0 ] = fltt_wire( 3 );
+  fltts[ 1 ] = fltt_and( fltts[ 0 ], fltts[ 0 ] );
+  fltts[ 2 ] = fltt_or( fltts[ 0 ], fltts[ 1 ] );
+  fltts[ 3 ] = fltt_pand( fltts[ 1 ], fltts[ 2 ] );
+  printf( "Strating fltt_rename tests.\n" );
+  printf( "=========================\n" );
+  for ( int i = 0; i < FLTT_CASES; ++i ) {
+    fault_tree renamed = fltt_rename( fltts[ i ], names );
+    printf( "Test %d/%d: ", 2 * i + 1,
+            FLTT_TEST_RENAME_BATTERIES_NUMBER * FLTT_CASES );
+    if ( fltt_equal( fltt_rename( renamed, back ), fltts[ i ] ) ) {
+      ++res;
+      printf_green();
+      printf( "passed.\n" );
+    } else {
+      printf_bold_red();
+      printf( "FAILED!\n" );
+    }
+    printf_reset();
+    printf( "Test %d/%d: ", 2 * i + 2,
+            FLTT_TEST_RENAME_BATTERIES_NUMBER * FLTT_CASES );
+    for ( int j = 0; j < 4; ++j )
+      wires[ j ] = false;
+    fltt_wires( renamed, wires );
+    if ( wires[ 0 ] && ! wires[ 1 ] && ! wires[ 2 ] && ! wires[ 3 ] ) {
+      ++res;
+      printf_green();
+      printf( "passed.\n" );
+    } else {
+      printf_bold_red();
+      printf( "FAILED!\n" );
+    }
+    printf_reset();
+  }
+  printf( "=========================\n" );
+  printf( "Passed tests: " );
+  if ( res == FLTT_TEST_RENAME_BATTERIES_NUMBER * FLTT_CASES )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", res, FLTT_TEST_RENAME_BATTERIES_NUMBER * FLTT_CASES );
+  printf_reset();
+  printf( ".\n" );
+  printf( "=========================\n" );
+  return res;
+}
+
+// fault trees as JSON texts, with their fields in the usual order and in
+// another order, with names and unknown fields
+#define FLTT_TEST_WIRE "{\"type\": \"wire\", \"index\": 3}"
+#define FLTT_TEST_WIRE_OTHER \
+  "{\"name\": \"w \\\"3\\\"\", \"index\": 3, \"type\": \"wire\"}"
+#define FLTT_TEST_AND \
+  "{\"type\": \"and\", \"subtree1\": " FLTT_TEST_WIRE ", \"subtree2\": " \
+  FLTT_TEST_WIRE "}"
+#define FLTT_TEST_AND_OTHER \
+  "{\"subtree2\": " FLTT_TEST_WIRE_OTHER ", \"name\": \"and\", " \
+  "\"subtree1\": " FLTT_TEST_WIRE_OTHER ", \"type\": \"and\"}"
+#define FLTT_TEST_OR \
+  "{\"type\": \"or\", \"subtree1\": " FLTT_TEST_WIRE ", \"subtree2\": " \
+  FLTT_TEST_AND "}"
+#define FLTT_TEST_OR_OTHER \
+  "{\"subtree1\": " FLTT_TEST_WIRE_OTHER ", \"extra\": [ 1e3, { \"a\": [] " \
+  "}, \"]}\" ], \"subtree2\": " FLTT_TEST_AND_OTHER ", \"type\": \"or\"}"
+#define FLTT_TEST_PAND \
+  "{\"type\": \"pand\", \"subtree1\": " FLTT_TEST_AND ", \"subtree2\": " \
+  FLTT_TEST_OR "}"
+#define FLTT_TEST_PAND_OTHER \
+  " {\"type\": \"pand\", \"subtree2\": " FLTT_TEST_OR_OTHER ",\n" \
+  "\"subtree1\": " FLTT_TEST_AND_OTHER "} "
+
+int fault_tree_test_reader() {
+  int res = 0;
+  // testing each basic fault tree type
+  fault_tree* fltts = GC_MALLOC( FLTT_CASES * sizeof( fault_tree ) );
+  fltts[ 0 ] = fltt_wire( 3 );
+  fltts[ 1 ] = fltt_and( fltts[ 0 ], fltts[ 0 ] );
+  fltts[ 2 ] = fltt_or( fltts[ 0 ], fltts[ 1 ] );
+  fltts[ 3 ] = fltt_pand( fltts[ 1 ], fltts[ 2 ] );
+  // array of texts
+  char* texts[ FLTT_CASES ][ FLTT_TEST_READER_BATTERIES_NUMBER ] = {
+    { FLTT_TEST_WIRE, FLTT_TEST_WIRE_OTHER },
+    { FLTT_TEST_AND, FLTT_TEST_AND_OTHER },
+    { FLTT_TEST_OR, FLTT_TEST_OR_OTHER },
+    { FLTT_TEST_PAND, FLTT_TEST_PAND_OTHER }
+  };
+  printf( "Strating reader_fltt tests.\n" );
+  printf( "=========================\n" );
+  for ( int i = 0; i < FLTT_CASES; ++i ) {
+    for ( int j = 0; j < FLTT_TEST_READER_BATTERIES_NUMBER; ++j ) {
+      printf( "Test %d/%d: ", FLTT_TEST_READER_BATTERIES_NUMBER * i + j + 1,
+              FLTT_TEST_READER_BATTERIES_NUMBER * FLTT_CASES );
+      reader r = reader_new( texts[ i ][ j ], strlen( texts[ i ][ j ] ) );
+      if ( fltt_equal( reader_fltt( r ), fltts[ i ] ) ) {
+        ++res;
+        printf_green();
+        printf( "passed.\n" );
+      } else {
+        printf_bold_red();
+        printf( "FAILED!\n" );
+      }
+      printf_reset();
+    }
+  }
+  printf( "=========================\n" );
+  printf( "Passed tests: " );
+  if ( res == FLTT_TEST_READER_BATTERIES_NUMBER * FLTT_CASES )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", res, FLTT_TEST_READER_BATTERIES_NUMBER * FLTT_CASES );
+  printf_reset();
+  printf( ".\n" );
+  printf( "=========================\n" );
+  return res;
+}
+
+int fault_tree_test_model() {
+  int res = 0;
+  // testing each basic fault tree type
+  fault_tree* fltts = GC_MALLOC( FLTT_CASES * sizeof( fault_tree ) );
+  fltts[ 0 ] = fltt_wire( 3 );
+  fltts[ 1 ] = fltt_and( fltts[ 0 ], fltts[ 0 ] );
+  fltts[ 2 ] = fltt_or( fltts[ 0 ], fltts[ 1 ] );
+  fltts[ 3 ] = fltt_pand( fltts[ 1 ], fltts[ 2 ] );
+  // no confidence functions
+  expression* cfd_res = GC_MALLOC( 8 * sizeof( expression ) );
+  printf( "Strating model_fltt tests.\n" );
+  printf( "=========================\n" );
+  for ( int i = 0; i < FLTT_CASES; ++i ) {
+    printf( "Test %d/%d: ", i + 1,
+            FLTT_TEST_MODEL_BATTERIES_NUMBER * FLTT_CASES );
+    model m = model_compile( 4, fltts[ i ], cfd_res, NULL, 0 );
+    if ( fltt_equal( model_fltt( m ), fltts[ i ] ) ) {
+      ++res;
+      printf_green();
+      printf( "passed.\n" );
+    } else {
+      printf_bold_red();
+      printf( "FAILED!\n" );
+    }
+    printf_reset();
+  }
+  printf( "=========================\n" );
+  printf( "Passed tests: " );
+  if ( res == FLTT_TEST_MODEL_BATTERIES_NUMBER * FLTT_CASES )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", res, FLTT_TEST_MODEL_BATTERIES_NUMBER * FLTT_CASES );
+  printf_reset();
+  printf( ".\n" );
+  printf( "=========================\n" );
+  return res;
+}
+
 int fault_tree_test_snprintf() {
   int res = 0;
   char* s;
@@ -309,11 +474,17 @@ int fault_tree_test_prf() {
 void fault_tree_test() {
   int batteries = FLTT_TEST_EQUAL_BATTERIES_NUMBER +
                   FLTT_TEST_COPY_BATTERIES_NUMBER +
+                  FLTT_TEST_RENAME_BATTERIES_NUMBER +
+                  FLTT_TEST_READER_BATTERIES_NUMBER +
+                  FLTT_TEST_MODEL_BATTERIES_NUMBER +
                   FLTT_TEST_SNPRINTF_BATTERIES_NUMBER +
                   FLTT_TEST_PROPAGATE_BATTERIES_NUMBER +
                   FLTT_TEST_PRF_BATTERIES_NUMBER;
   int n = fault_tree_test_equal();
   n += fault_tree_test_copy();
+  n += fault_tree_test_rename();
+  n += fault_tree_test_reader();
+  n += fault_tree_test_model();
   n += fault_tree_test_snprintf();
   n += fault_tree_test_propagate();
   n += fault_tree_test_prf();
@@ -27,6 +27,33 @@
 #define FLTT_TEST_COPY_BATTERIES_NUMBER 2
 // int fault_tree_test_copy();
 
+/* fault_tree_test_rename: runs a series of tests to check whether fltt_rename
+ * and fltt_wires return the desired results.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define FLTT_TEST_RENAME_BATTERIES_NUMBER 2
+// int fault_tree_test_rename();
+
+/* fault_tree_test_reader: runs a series of tests to check whether reader_fltt
+ * returns the desired result.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define FLTT_TEST_READER_BATTERIES_NUMBER 2
+// int fault_tree_test_reader();
+
+/* fault_tree_test_model: runs a series of tests to check whether model_fltt
+ * rebuilds the fault trees of models.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define FLTT_TEST_MODEL_BATTERIES_NUMBER 1
+// int fault_tree_test_model();
+
 /* fault_tree_test_snprintf: runs a series of tests to check whether
  * fltt_snprintf returns the desired result.
  * inputs: none.
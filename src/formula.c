@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <gc.h>
+#include "utils.h"
 #include "formula.h"
 
 /*
@@ -89,7 +90,7 @@ bool fml_equal( formula f1, formula f2 ) {
       break;
     default:
       fprintf( stderr, "fml_equal: Unknown formula type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -110,7 +111,7 @@ bool fml_eval( formula f, bool* sigma ) {
       break;
     default:
       fprintf( stderr, "fml_eval: Unknown formula type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -212,7 +213,7 @@ int fml_snprintf( char* buf, int length, formula f ) {
       break;
     default:
       fprintf( stderr, "fml_snprintf: Unknown formula type." );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
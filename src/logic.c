@@ -44,7 +44,7 @@ logic los_to_log( logical_operator neg, logical_operator imp,
 enum TRUTH_VALUE int_to_truth_value( int n ) {
   if ( n >= TRUTH_VALUE_CASES ) {
     fprintf( stderr, "int_to_truth_value: no corresponding truth value.\n" );
-    exit( 1 );
+    error_exit();
   }
   switch ( n ) {
     case 0:
@@ -58,7 +58,7 @@ enum TRUTH_VALUE int_to_truth_value( int n ) {
       break;
     default:
       fprintf( stderr, "int_to_truth_value: mismatch with TRUTH_VALUE_CASES.\n" );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -76,7 +76,7 @@ int truth_value_to_int( enum TRUTH_VALUE tv ) {
       break;
     default:
       fprintf( stderr, "truth_value_to_int: unknown truth value.\n" );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -159,7 +159,7 @@ void tv_printf( enum TRUTH_VALUE tv ) {
       break;
     default:
       fprintf( stderr, "tv_printf: Unknown truth value.\n" );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -178,7 +178,7 @@ int tv_snprintf( char* buf, int length, enum TRUTH_VALUE tv ) {
     default:
       printf( "tv: %d\n", tv );
       fprintf( stderr, "tv_snprintf: Unknown truth value.\n" );
-      exit( 1 );
+      error_exit();
       break;
   }
 }
@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <float.h>
 #include <string.h>
+#include <math.h>
+#define GC_THREADS
 #include <gc.h>
 #include <cjson/cJSON.h>
 #include "utils.h"
@@ -15,7 +17,20 @@
 #include "logic_test.h"
 #include "proof.h"
 #include "proof_test.h"
+#include "objective.h"
+#include "objective_test.h"
 #include "optimisation.h"
+#include "warm_start.h"
+#include "pareto.h"
+#include "module.h"
+#include "reader.h"
+#include "model.h"
+#include "batch.h"
+#include "batch_test.h"
+#include "astrahl_test.h"
+#include "serve.h"
+#include "robust.h"
+#include "benchmark.h"
 #include "fault_tree.h"
 #include "fault_tree_test.h"
 
@@ -25,9 +40,12 @@
 
 int main( int argc, char** argv )
 {
+  GC_INIT();
   // srand( 0 );
   args a = args_new();
   args_read( a, argc, argv );
+  if ( a->filename_presets != NULL )
+    optim_presets_load( a->filename_presets );
   if ( a->test ) {
     if ( (a->test >> TEST_EXPRESSION_BIT) % 2 )
       expression_test();
@@ -41,130 +59,294 @@ int main( int argc, char** argv )
       fault_tree_test();
     if ( (a->test >> TEST_LOGIC_BIT) % 2 )
       logic_test();
+    if ( (a->test >> TEST_OBJECTIVE_BIT) % 2 )
+      objective_test();
+    if ( (a->test >> TEST_BATCH_BIT) % 2 )
+      batch_test();
+    if ( (a->test >> TEST_ASTRAHL_BIT) % 2 )
+      astrahl_test();
   } else if ( strcmp( a->mode, ARGS_MODE_BENCHMARK_STR ) == 0 ) {
-    fprintf( stderr, "No benchmark implemented.\n" );
-    exit( 1 );
+    // the parameters of the benchmarks are optional
+    cJSON* json = NULL;
+    if ( a->filename != NULL ) {
+      size_t length;
+      char* contents = file_map( a->filename, &length );
+      json = cJSON_ParseWithLength( contents, length );
+      file_unmap( contents, length );
+      if ( json == NULL ) {
+        fprintf( stderr, "Error while parsing: \"%s\"\n", a->filename );
+        exit( 1 );
+      }
+    }
+    benchmark_run( cJSON_to_benchmark_params( json ), stdout );
+    cJSON_Delete( json );
+  } else if ( strcmp( a->mode, ARGS_MODE_BATCH_STR ) == 0 ) {
+    // requests are read from a file or from the standard input, after the
+    // problem when it is not in a file
+    FILE* in = stdin;
+    if ( a->filename_requests != NULL ) {
+      in = fopen( a->filename_requests, "r" );
+      if ( in == NULL ) {
+        fprintf( stderr, "Error while opening: \"%s\"\n",
+                 a->filename_requests );
+        exit( 1 );
+      }
+    }
+    optim_params opt_params = NULL;
+    if ( a->filename_optimisation != NULL )
+      opt_params = filename_to_optim_params( a->filename_optimisation );
+    // the problem of a model is not read, the input (if any) only gives its
+    // uncertain constants and default parameters
+    char* contents;
+    size_t length;
+    problem pb = NULL;
+    if ( a->filename != NULL ) {
+      contents = file_map( a->filename, &length );
+      pb = reader_problem( contents, length );
+    } else if ( a->filename_model == NULL ) {
+      if ( ( contents = batch_read_line( in ) ) == NULL ) {
+        fprintf( stderr, "No problem for the batch.\n" );
+        exit( 1 );
+      }
+      pb = reader_problem( contents, strlen( contents ) );
+    }
+    batch b;
+    if ( a->filename_model != NULL )
+      b = model_to_batch( model_load( a->filename_model ), pb, opt_params,
+                          a->filename_cache );
+    else
+      b = problem_to_batch( pb, opt_params, a->filename_cache );
+    if ( pb != NULL )
+      cJSON_Delete( pb->json );
+    // requests with their own problem share the default parameters
+    batch_run( b, batch_cache_new( b->params, a->filename_cache ), a->threads,
+               a->format == NULL ? BATCH_JSONL :
+               batch_format_lexer( a->format ), in, stdout );
+    if ( b->params != NULL )
+      trace_close( b->params->trace );
+    if ( in != stdin )
+      fclose( in );
+  } else if ( strcmp( a->mode, ARGS_MODE_SERVE_STR ) == 0 ) {
+    if ( a->socket == NULL ) {
+      fprintf( stderr, "No socket path specified.\n" );
+      exit( 1 );
+    }
+    optim_params opt_params = NULL;
+    if ( a->filename_optimisation != NULL )
+      opt_params = filename_to_optim_params( a->filename_optimisation );
+    serve_run( serve_new( opt_params, a->filename_cache, a->threads ),
+               a->socket );
   } else if ( a->mode != NULL ) {
-    FILE* f = fopen( a->filename, "r" );
-    if ( f == NULL ) {
-      fprintf( stderr, "Error while opening: \"%s\"\n", a->filename );
+    if ( a->filename == NULL ) {
+      fprintf( stderr, "No filename specified.\n" );
+      exit( 1 );
+    }
+    // the input is mapped, and its fault tree, confidence functions and base
+    // point are read without building a JSON document
+    size_t length;
+    char* contents = file_map( a->filename, &length );
+    problem pb = reader_problem( contents, length );
+    cJSON* json = pb->json;
+    // the fault tree and confidence functions of a model replace those of the
+    // input, whose point is extended to all the wires of the model
+    model m = NULL;
+    double* point = pb->point;
+    if ( a->filename_model != NULL &&
+         strcmp( a->mode, ARGS_MODE_COMPILE_STR ) != 0 ) {
+      m = model_load( a->filename_model );
+      if ( pb->point_num > m->n ) {
+        fprintf( stderr, "The point of \"%s\" has wires not in the model.\n",
+                 a->filename );
+        exit( 1 );
+      }
+      point = GC_MALLOC_ATOMIC( m->n * sizeof( double ) );
+      for ( int i = 0; i < m->n; ++i )
+        point[ i ] = i < pb->point_num ? pb->point[ i ] : 0;
+    }
+    if ( pb->ft == NULL && m == NULL ) {
+      fprintf( stderr, "No fault tree (\"ft\") in \"%s\"\n", a->filename );
       exit( 1 );
     }
-    fseek( f, 0, SEEK_END );
-    int n = ftell( f );
-    char* contents = GC_MALLOC( ( n + 1 ) * sizeof( char ) );
-    fseek( f, 0, SEEK_SET );
-    fread( contents, 1, n, f );
-    fclose( f );
-    contents[ n ] = '\0';
-    if ( strcmp( a->mode, ARGS_MODE_PROPAGATE_STR ) == 0 ) {
-      cJSON* json = cJSON_Parse( contents );
-      // reading the fault tree
-      fault_tree ft =
-        cJSON_to_fltt( cJSON_GetObjectItemCaseSensitive( json, "ft" ) );
-      // reading the base point
-      cJSON* point = cJSON_GetObjectItemCaseSensitive( json, "point" );
-      cJSON* coord;
-      int n = -1;
-      cJSON_ArrayForEach( coord, point ) {
-        int m = cJSON_GetObjectItemCaseSensitive( coord, "index" )->valueint;
-        if ( n < m ) n = m;
+    if ( strcmp( a->mode, ARGS_MODE_COMPILE_STR ) == 0 ) {
+      if ( a->filename_model == NULL ) {
+        fprintf( stderr, "No model filename specified.\n" );
+        exit( 1 );
       }
-      double* sigma = GC_MALLOC( n * sizeof( double ) );
-      cJSON_ArrayForEach( coord, point ) {
-        sigma[ cJSON_GetObjectItemCaseSensitive( coord, "index" )->valueint ] =
-          cJSON_GetObjectItemCaseSensitive( coord, "value" )->valuedouble;
+      batch b = problem_to_batch( pb, NULL, NULL );
+      if ( b->cfd_res == NULL ) {
+        fprintf( stderr, "No confidence functions (\"conf_funcs\") in "
+                 "\"%s\"\n", a->filename );
+        exit( 1 );
       }
+      proof p = fltt_to_prf( b->n, b->ft, b->log );
+      model_write( model_compile( b->n, b->ft, b->cfd_res,
+                                  obj_from_proof( b->n, p, b->cfd_res ),
+                                  reader_key( pb ) ),
+                   a->filename_model );
+      cJSON_Delete( json );
+    } else if ( strcmp( a->mode, ARGS_MODE_PROPAGATE_STR ) == 0 ) {
+      fault_tree ft = m != NULL ? model_fltt( m ) : pb->ft;
+      double* sigma = point;
       cJSON_Delete( json );
       // computing the result
       double res = fltt_propagate_prob( ft, sigma );
       printf( "%.*f\n", DBL_DIG, res );
-    } else if ( strcmp( a->mode, ARGS_MODE_SPLITS_STR ) == 0 ) {
-      cJSON* json = cJSON_Parse( contents );
-      // reading the fault tree
-      fault_tree ft =
-        cJSON_to_fltt( cJSON_GetObjectItemCaseSensitive( json, "ft" ) );
-      // reading the confidence functions
-      cJSON* cfd_funcs = cJSON_GetObjectItemCaseSensitive( json, "conf_funcs" );
-      cJSON* coord;
-      int n = -1;
-      cJSON_ArrayForEach( coord, cfd_funcs ) {
-        int m = cJSON_GetObjectItemCaseSensitive( coord, "index" )->valueint;
-        if ( n < m ) n = m;
-      }
-      expression* cfd_res = GC_MALLOC( ( n + 1 ) * sizeof( expression ) );
-      cJSON_ArrayForEach( coord, cfd_funcs ) {
-        cfd_res[ cJSON_GetObjectItemCaseSensitive( coord, "index" )->valueint ] =
-          cJSON_to_exp( cJSON_GetObjectItemCaseSensitive( coord, "expression" ) );
+    } else if ( strcmp( a->mode, ARGS_MODE_SPLITS_STR ) == 0 ||
+                strcmp( a->mode, ARGS_MODE_SWEEP_STR ) == 0 ||
+                strcmp( a->mode, ARGS_MODE_PARETO_STR ) == 0 ) {
+      // sweeps compute allocations for several budgets, each one starting from
+      // the previous one, Pareto fronts trade confidence against costs
+      bool sweep = strcmp( a->mode, ARGS_MODE_SWEEP_STR ) == 0;
+      bool pareto = strcmp( a->mode, ARGS_MODE_PARETO_STR ) == 0;
+      // the fault tree and confidence functions of models are only rebuilt
+      // when they are needed (see below)
+      fault_tree ft = m != NULL ? NULL : pb->ft;
+      expression* cfd_res = m != NULL ? NULL : pb->cfd_res;
+      // reading the uncertain constants of the confidence functions
+      uncertainty u = cJSON_to_uncertainty(
+        cJSON_GetObjectItemCaseSensitive( json, "uncertainty" ),
+        m != NULL ? 2 * m->n : pb->cfd_num );
+      // the wires are those of the base point (or of the model)
+      int n = ( m != NULL ? m->n : pb->point_num ) - 1;
+      double* sigma = point;
+      // reading the total resource allowance (several of them for sweeps)
+      int budget_num = 1;
+      double* budgets;
+      if ( sweep )
+        budgets = cJSON_to_budgets(
+          cJSON_GetObjectItemCaseSensitive( json, "resources" ), &budget_num );
+      else {
+        budgets = GC_MALLOC_ATOMIC( sizeof( double ) );
+        budgets[ 0 ] =
+          cJSON_GetObjectItemCaseSensitive( json, "resources" )->valuedouble;
       }
-      // reading the base point
-      cJSON* point = cJSON_GetObjectItemCaseSensitive( json, "point" );
-      n = -1;
-      cJSON_ArrayForEach( coord, point ) {
-        int m = cJSON_GetObjectItemCaseSensitive( coord, "index" )->valueint;
-        if ( n < m ) n = m;
-      }
-      double* sigma = GC_MALLOC( ( n + 1 ) * sizeof( double ) );
-      cJSON_ArrayForEach( coord, point ) {
-        sigma[ cJSON_GetObjectItemCaseSensitive( coord, "index" )->valueint ] =
-          cJSON_GetObjectItemCaseSensitive( coord, "value" )->valuedouble;
-      }
-      // reading the total resource allowance
-      double res =
-        cJSON_GetObjectItemCaseSensitive( json, "resources" )->valuedouble;
+      // the problem is identified in the cache by its fault tree and
+      // confidence functions
+      uint64_t key = 0;
+      if ( a->filename_cache )
+        key = m != NULL ? m->key : reader_key( pb );
+      costs cs = NULL;
+      if ( pareto )
+        cs = cJSON_to_costs( cJSON_GetObjectItemCaseSensitive( json, "costs" ),
+                             n + 1 );
+      // defining the optimisation parameters, from the input when they are
+      // not in a file of their own
+      cJSON* algorithm = cJSON_GetObjectItemCaseSensitive( json, "algorithm" );
+      optim_params opt_params;
+      if ( a->filename_optimisation == NULL && algorithm != NULL )
+        opt_params = cJSON_to_optim_params( algorithm );
+      else
+        opt_params = filename_to_optim_params( a->filename_optimisation );
+      opt_params->uncertainty = u;
       cJSON_Delete( json );
       // defining the base logic
-      enum TRUTH_VALUE neg_table[ TRUTH_VALUE_CASES ] = { TRUE, UNDET, FALSE };
-      enum TRUTH_VALUE imp_table[ TRUTH_VALUE_CASES * TRUTH_VALUE_CASES ] =
-        { TRUE, TRUE, TRUE, UNDET, UNDET, TRUE, FALSE, UNDET, TRUE };
-      enum TRUTH_VALUE disj_table[ TRUTH_VALUE_CASES * TRUTH_VALUE_CASES ] =
-        { FALSE, UNDET, TRUE, UNDET, UNDET, TRUE, TRUE, TRUE, TRUE };
-      enum TRUTH_VALUE conj_table[ TRUTH_VALUE_CASES * TRUTH_VALUE_CASES ] =
-        { FALSE, FALSE, FALSE, FALSE, UNDET, UNDET, FALSE, UNDET, TRUE };
-      logical_operator neg  = table_to_lo( 1, neg_table );
-      logical_operator imp  = table_to_lo( 2, imp_table );
-      logical_operator disj = table_to_lo( 2, disj_table );
-      logical_operator conj = table_to_lo( 2, conj_table );
-      logic log = los_to_log( neg, imp, disj, conj );
-      // defining the optimisation parameters
-      gradient_ascent_params ga_params =
-        GC_MALLOC( sizeof( struct gradient_ascent_params_s ) );
-      ga_params->step_coef = res / 100;
-      hill_climbing_params hc_params =
-        GC_MALLOC( sizeof( struct hill_climbing_params_s ) );
-      hc_params->step_size = res / 100;
-      hc_params->iters = 100;
-      optim_params opt_params =
-        filename_to_optim_params( a->filename_optimisation );
-      // selecting the algorithm
-      // opt_params->opt_algo_type = GRAD_ASC;
-      // opt_params->opt_algo_type = GRAD_ASC_HILL_CLIMB;
-      // opt_params->opt_algo_type = SIM_ANNEAL;
-      opt_params->opt_algo_type = SIM_ANNEAL_HILL_CLIMB;
-      opt_params->ga_params = ga_params;
-      opt_params->hc_params = hc_params;
-      opt_params->sa_params = sa_params_from_hyperparams_simple;
-      // computing the result
-      double* result = resource_repartition( n + 1,
-                                             fltt_to_prf( n + 1, ft, log ),
-                                             cfd_res, sigma, res, opt_params );
-      double total_allowance_spent = 0;
-      for ( int i = 0; i <= n; ++i ) {
-        if ( result[ i ] < 0 ) {
-          fprintf( stderr, "Negative split (%d coordinate): %f.\n",
-                   i, result[ i ] );
+      logic log = fltt_logic();
+      // fault trees decomposed into modules are never compiled as a whole,
+      // models come with their objective (but robust objectives need the
+      // proof)
+      proof p = NULL;
+      objective obj = NULL;
+      if ( m != NULL &&
+           ( opt_params->robust != NULL || opt_params->modules != NULL ) ) {
+        ft = model_fltt( m );
+        cfd_res = model_cfd_res( m );
+      }
+      if ( m != NULL && opt_params->robust == NULL )
+        obj = m->obj;
+      else if ( pareto || opt_params->modules == NULL )
+        p = fltt_to_prf( n + 1, ft, log );
+      // starting from the closest allocation already computed, if any (sweeps
+      // keep their allocations in memory when there is no cache file)
+      warm_start ws = NULL;
+      if ( a->filename_cache )
+        ws = ws_load( a->filename_cache, key, n + 1 );
+      else if ( sweep )
+        ws = ws_load( NULL, key, n + 1 );
+      if ( sweep ) {
+        printf( "resources,confidence" );
+        for ( int i = 0; i <= n; ++i )
+          printf( ",%d", i );
+        printf( "\n" );
+      }
+      // Pareto fronts are printed as CSV, one row per allocation
+      if ( pareto ) {
+        if ( opt_params->opt_algo_type != NSGA_II ) {
+          fprintf( stderr, "The pareto mode needs the \"nsga\" algorithm.\n" );
           exit( 1 );
         }
-        total_allowance_spent += result[ i ];
+        if ( ws )
+          opt_params->start = ws_seed( ws, sigma, budgets[ 0 ] );
+        if ( obj == NULL )
+          obj = optim_objective( n + 1, p, cfd_res, opt_params );
+        pareto_front front =
+          pareto_nsga( n + 1, obj, cs, sigma, budgets[ 0 ], opt_params->start,
+                       opt_params->nsga_params );
+        printf( "confidence" );
+        for ( int c = 0; c < cs->num; ++c )
+          printf( ",%s", cs->names[ c ] );
+        for ( int i = 0; i <= n; ++i )
+          printf( ",%d", i );
+        printf( "\n" );
+        for ( int k = 0; k < front->size; ++k ) {
+          printf( "%.*f", DBL_DIG, front->confidences[ k ] );
+          for ( int c = 0; c < cs->num; ++c )
+            printf( ",%.*f", DBL_DIG, front->costs[ k * cs->num + c ] );
+          for ( int i = 0; i <= n; ++i )
+            printf( ",%.*f", DBL_DIG, front->allocations[ k * ( n + 1 ) + i ] );
+          printf( "\n" );
+        }
+      }
+      for ( int b = 0; ! pareto && b < budget_num; ++b ) {
+        double res = budgets[ b ];
+        if ( ws )
+          opt_params->start = ws_seed( ws, sigma, res );
+        // computing the result
+        optim_report report = GC_MALLOC( sizeof( struct optim_report_s ) );
+        double* result;
+        if ( opt_params->modules != NULL )
+          result = module_repartition( n + 1, ft, log, cfd_res, sigma, res,
+                                       opt_params, report );
+        else if ( obj != NULL )
+          result = resource_repartition_objective( n + 1, obj, sigma, res,
+                                                   opt_params, report );
+        else
+          result = resource_repartition( n + 1, p, cfd_res, sigma, res,
+                                         opt_params, report );
+        double total_allowance_spent = 0;
+        for ( int i = 0; i <= n; ++i ) {
+          if ( result[ i ] < 0 ) {
+            fprintf( stderr, "Negative split (%d coordinate): %f.\n",
+                     i, result[ i ] );
+            exit( 1 );
+          }
+          total_allowance_spent += result[ i ];
+        }
+        // if ( dcompare( total_allowance_spent, res, n+1 ) ) {
+        //   fprintf( stderr, "Spent allowance difference from specified: %f "
+        //            "(instead of %f).\n", total_allowance_spent, res );
+        //   exit( 1 );
+        // }
+        if ( ws )
+          ws_store( ws, sigma, res, result );
+        // sweeps print one CSV row per budget
+        if ( sweep ) {
+          printf( "%.*f,%.*f", DBL_DIG, res, DBL_DIG, report->confidence );
+          for ( int i = 0; i <= n; ++i )
+            printf( ",%.*f", DBL_DIG, result[ i ] );
+          printf( "\n" );
+          continue;
+        }
+        // certified results come with their optimality gap, on a comment line
+        // before the split
+        if ( isfinite( report->bound ) )
+          printf( "# confidence=%.*f bound=%.*f gap=%.*e\n",
+                  DBL_DIG, report->confidence, DBL_DIG, report->bound,
+                  DBL_DIG, report->bound - report->confidence );
+        for ( int i = 0; i <= n; ++i )
+          printf( "%d=%.*f ", i, DBL_DIG, result[ i ] );
+        printf( "\n" );
       }
-      // if ( dcompare( total_allowance_spent, res, n+1 ) ) {
-      //   fprintf( stderr, "Spent allowance difference from specified: %f "
-      //            "(instead of %f).\n", total_allowance_spent, res );
-      //   exit( 1 );
-      // }
-      for ( int i = 0; i <= n; ++i )
-        printf( "%d=%.*f ", i, DBL_DIG, result[ i ] );
-      printf( "\n" );
+      trace_close( opt_params->trace );
     } else {
       fprintf( stderr, "Unknown mode (%s).\n", a->mode );
       exit( 1 );
@@ -0,0 +1,366 @@
+/********************************************************************
+ * model.c
+ *
+ * Defines functions to compile fault trees and their objectives to
+ * binary files, and to load them back without parsing.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <gc.h>
+#include "utils.h"
+#include "expression.h"
+#include "fault_tree.h"
+#include "objective.h"
+#include "model.h"
+
+// the sections of model files, in order (see [model_header])
+#define MODEL_SECTIONS 11
+
+/*
+ * Creation
+ */
+
+// the number of gates of [t]
+int model_gate_num( fault_tree t ) {
+  int res = 1;
+  for ( int i = 0; i < t->ports; ++i )
+    res += model_gate_num( t->children[ i ] );
+  return res;
+}
+
+// flattens [t] in [m] after the [pos] gates already there (children first),
+// flagging its wires, and returns the position of its root
+int model_flatten( model m, fault_tree t, int* pos ) {
+  int args[ 2 ] = { -1, -1 };
+  if ( t->fault_tree_type == WIRE ) {
+    args[ 0 ] = t->index;
+    m->wires[ t->index ] |= MODEL_WIRE_IN_TREE;
+  } else
+    for ( int i = 0; i < t->ports; ++i )
+      args[ i ] = model_flatten( m, t->children[ i ], pos );
+  m->gate_types[ *pos ] = t->fault_tree_type;
+  m->gate_args[ 2 * *pos ] = args[ 0 ];
+  m->gate_args[ 2 * *pos + 1 ] = args[ 1 ];
+  return ( *pos )++;
+}
+
+model model_compile( int n, fault_tree ft, expression* cfd_res, objective obj,
+                     uint64_t key ) {
+  model m = GC_MALLOC( sizeof( struct model_s ) );
+  m->key = key;
+  m->n = n;
+  m->gate_num = model_gate_num( ft );
+  m->gate_types = GC_MALLOC_ATOMIC( m->gate_num * sizeof( int ) );
+  m->gate_args = GC_MALLOC_ATOMIC( 2 * m->gate_num * sizeof( int ) );
+  m->wires = GC_MALLOC_ATOMIC( n * sizeof( int ) );
+  for ( int i = 0; i < n; ++i )
+    m->wires[ i ] = 0;
+  int pos = 0;
+  model_flatten( m, ft, &pos );
+  // missing confidence functions are compiled as constants
+  expression* cfds = GC_MALLOC( 2 * n * sizeof( expression ) );
+  for ( int i = 0; i < 2 * n; ++i ) {
+    cfds[ i ] = cfd_res[ i ] != NULL ? cfd_res[ i ] : exp_const( 0 );
+    if ( cfd_res[ i ] != NULL )
+      m->wires[ i / 2 ] |= i % 2 == 0 ? MODEL_WIRE_POSITIVE :
+                                        MODEL_WIRE_NEGATIVE;
+  }
+  m->cfds = obj_compile( n, 2 * n, cfds );
+  m->cfds->branches = NULL;
+  m->obj = obj;
+  m->contents = NULL;
+  m->length = 0;
+  return m;
+}
+
+// the sizes of the sections of the model of [h] (see [model_header])
+void model_sizes( model_header* h, size_t* sizes ) {
+  sizes[ 0 ] = h->gate_num * sizeof( int );
+  sizes[ 1 ] = 2 * h->gate_num * sizeof( int );
+  sizes[ 2 ] = h->n * sizeof( int );
+  sizes[ 3 ] = ( h->branch_num + 1 ) * sizeof( int );
+  sizes[ 4 ] = h->code_len * sizeof( int );
+  sizes[ 5 ] = h->code_len * sizeof( int );
+  sizes[ 6 ] = h->const_num * sizeof( double );
+  sizes[ 7 ] = ( 2 * h->n + 1 ) * sizeof( int );
+  sizes[ 8 ] = h->cfd_code_len * sizeof( int );
+  sizes[ 9 ] = h->cfd_code_len * sizeof( int );
+  sizes[ 10 ] = h->cfd_const_num * sizeof( double );
+}
+
+// rounds [size] up to a multiple of 8 bytes
+size_t model_align( size_t size ) {
+  return ( size + 7 ) / 8 * 8;
+}
+
+void model_write( model m, char* filename ) {
+  model_header h;
+  memset( &h, 0, sizeof( h ) );
+  memcpy( h.magic, MODEL_MAGIC, sizeof( h.magic ) );
+  h.version = MODEL_VERSION;
+  h.endian = MODEL_ENDIAN;
+  h.int_size = sizeof( int );
+  h.double_size = sizeof( double );
+  h.key = m->key;
+  h.n = m->n;
+  h.gate_num = m->gate_num;
+  h.branch_num = m->obj->branch_num;
+  h.code_len = m->obj->code_len;
+  h.max_len = m->obj->max_len;
+  h.const_num = m->obj->const_num;
+  h.cfd_code_len = m->cfds->code_len;
+  h.cfd_const_num = m->cfds->const_num;
+  size_t sizes[ MODEL_SECTIONS ];
+  model_sizes( &h, sizes );
+  h.size = sizeof( h );
+  for ( int s = 0; s < MODEL_SECTIONS; ++s )
+    h.size += model_align( sizes[ s ] );
+  void* sections[ MODEL_SECTIONS ] = {
+    m->gate_types, m->gate_args, m->wires,
+    m->obj->branch_start, m->obj->ops, m->obj->args, m->obj->constants,
+    m->cfds->branch_start, m->cfds->ops, m->cfds->args, m->cfds->constants
+  };
+  FILE* f = fopen( filename, "wb" );
+  if ( f == NULL ) {
+    fprintf( stderr, "Error while opening: \"%s\"\n", filename );
+    error_exit();
+  }
+  char padding[ 8 ] = { 0 };
+  bool ok = fwrite( &h, sizeof( h ), 1, f ) == 1;
+  for ( int s = 0; ok && s < MODEL_SECTIONS; ++s )
+    ok = fwrite( sections[ s ], 1, sizes[ s ], f ) == sizes[ s ] &&
+         fwrite( padding, 1, model_align( sizes[ s ] ) - sizes[ s ], f ) ==
+           model_align( sizes[ s ] ) - sizes[ s ];
+  if ( fclose( f ) != 0 || ! ok ) {
+    fprintf( stderr, "Error while writing: \"%s\"\n", filename );
+    error_exit();
+  }
+}
+
+// an objective whose arrays are the sections [s] to [s] + 3 of [sections]
+objective model_objective( int n, int branch_num, int code_len, int max_len,
+                           int const_num, char** sections, int s ) {
+  objective o = GC_MALLOC( sizeof( struct objective_s ) );
+  o->n = n;
+  o->branch_num = branch_num;
+  o->branch_start = ( int* ) sections[ s ];
+  o->code_len = code_len;
+  o->max_len = max_len;
+  o->ops = ( int* ) sections[ s + 1 ];
+  o->args = ( int* ) sections[ s + 2 ];
+  o->const_num = const_num;
+  o->constants = ( double* ) sections[ s + 3 ];
+  o->branches = NULL;
+  o->scenario_num = 0;
+  o->scenarios = NULL;
+  o->robust = OBJ_EXPECTED;
+  return o;
+}
+
+// whether the [h]->gate_num gates of types [types] and arguments [args] form
+// a fault tree on [h]->n wires, each gate coming after its children
+bool model_valid_gates( model_header* h, int* types, int* args ) {
+  for ( int g = 0; g < h->gate_num; ++g ) {
+    if ( types[ g ] == WIRE ) {
+      if ( args[ 2 * g ] < 0 || args[ 2 * g ] >= h->n ||
+           args[ 2 * g + 1 ] != -1 )
+        return false;
+    } else if ( types[ g ] == AND || types[ g ] == OR || types[ g ] == PAND ) {
+      for ( int i = 0; i < 2; ++i )
+        if ( args[ 2 * g + i ] < 0 || args[ 2 * g + i ] >= g )
+          return false;
+    } else
+      return false;
+  }
+  return true;
+}
+
+// whether the [branch_num] branches of [starts], [ops], and [args] (see
+// [objective_s]) are non-empty, at most [max_len] long, end at [code_len], and
+// only use the [n] variables, the [const_num] constants, and the instructions
+// before each one of their branch
+bool model_valid_code( int n, int branch_num, int code_len, int max_len,
+                       int const_num, int* starts, int* ops, int* args ) {
+  if ( starts[ 0 ] != 0 || starts[ branch_num ] != code_len )
+    return false;
+  for ( int b = 0; b < branch_num; ++b ) {
+    int len = starts[ b + 1 ] - starts[ b ];
+    if ( len < 1 || len > max_len )
+      return false;
+    for ( int k = 0; k < len; ++k ) {
+      int arg = args[ starts[ b ] + k ];
+      switch ( ops[ starts[ b ] + k ] ) {
+        case OBJ_VAR:
+          if ( arg < 0 || arg >= n )
+            return false;
+          break;
+        case OBJ_CONST:
+          if ( arg < 0 || arg >= const_num )
+            return false;
+          break;
+        case OBJ_OPP:
+        case OBJ_LOG:
+          if ( k == 0 )
+            return false;
+          break;
+        case OBJ_ADD:
+        case OBJ_SUB:
+        case OBJ_MUL:
+        case OBJ_DIV:
+        case OBJ_POW:
+          if ( k == 0 || arg < 0 || arg >= k )
+            return false;
+          break;
+        default:
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+model model_load( char* filename ) {
+  size_t length;
+  char* contents = file_map( filename, &length );
+  model_header h;
+  if ( length < sizeof( h ) ) {
+    fprintf( stderr, "model_load: \"%s\" is not a model.\n", filename );
+    error_exit();
+  }
+  memcpy( &h, contents, sizeof( h ) );
+  if ( memcmp( h.magic, MODEL_MAGIC, sizeof( h.magic ) ) != 0 ) {
+    fprintf( stderr, "model_load: \"%s\" is not a model.\n", filename );
+    error_exit();
+  }
+  if ( h.version != MODEL_VERSION || h.endian != MODEL_ENDIAN ||
+       h.int_size != sizeof( int ) || h.double_size != sizeof( double ) ) {
+    fprintf( stderr, "model_load: \"%s\" has version %u for another machine "
+             "(expected version %d).\n", filename, h.version, MODEL_VERSION );
+    error_exit();
+  }
+  if ( h.size != length || h.n < 0 || h.gate_num < 1 || h.branch_num < 0 ||
+       h.code_len < 0 || h.max_len < 0 || h.const_num < 0 ||
+       h.cfd_code_len < 0 ||
+       h.cfd_const_num < 0 ) {
+    fprintf( stderr, "model_load: \"%s\" is truncated or corrupted.\n",
+             filename );
+    error_exit();
+  }
+  size_t sizes[ MODEL_SECTIONS ];
+  model_sizes( &h, sizes );
+  char* sections[ MODEL_SECTIONS ];
+  size_t offset = sizeof( h );
+  for ( int s = 0; s < MODEL_SECTIONS; ++s ) {
+    sections[ s ] = contents + offset;
+    offset += model_align( sizes[ s ] );
+  }
+  // the arrays are checked in one pass, so that they are used without checks
+  if ( offset != length ||
+       ! model_valid_gates( &h, ( int* ) sections[ 0 ],
+                            ( int* ) sections[ 1 ] ) ||
+       ! model_valid_code( h.n, h.branch_num, h.code_len, h.max_len,
+                           h.const_num, ( int* ) sections[ 3 ],
+                           ( int* ) sections[ 4 ], ( int* ) sections[ 5 ] ) ||
+       ! model_valid_code( h.n, 2 * h.n, h.cfd_code_len, h.cfd_code_len,
+                           h.cfd_const_num, ( int* ) sections[ 7 ],
+                           ( int* ) sections[ 8 ], ( int* ) sections[ 9 ] ) ) {
+    fprintf( stderr, "model_load: \"%s\" is truncated or corrupted.\n",
+             filename );
+    error_exit();
+  }
+  model m = GC_MALLOC( sizeof( struct model_s ) );
+  m->key = h.key;
+  m->n = h.n;
+  m->gate_num = h.gate_num;
+  m->gate_types = ( int* ) sections[ 0 ];
+  m->gate_args = ( int* ) sections[ 1 ];
+  m->wires = ( int* ) sections[ 2 ];
+  m->obj = model_objective( h.n, h.branch_num, h.code_len, h.max_len,
+                            h.const_num, sections, 3 );
+  // the longest confidence function is only needed to evaluate them
+  int* starts = ( int* ) sections[ 7 ];
+  int max_len = 0;
+  for ( int i = 0; i < 2 * h.n; ++i )
+    if ( starts[ i + 1 ] - starts[ i ] > max_len )
+      max_len = starts[ i + 1 ] - starts[ i ];
+  m->cfds = model_objective( h.n, 2 * h.n, h.cfd_code_len, max_len,
+                             h.cfd_const_num, sections, 7 );
+  m->contents = contents;
+  m->length = length;
+  return m;
+}
+
+/*
+ * Usage
+ */
+
+fault_tree model_fltt( model m ) {
+  fault_tree* gates = GC_MALLOC( m->gate_num * sizeof( fault_tree ) );
+  for ( int g = 0; g < m->gate_num; ++g ) {
+    int* args = m->gate_args + 2 * g;
+    if ( m->gate_types[ g ] == WIRE )
+      gates[ g ] = fltt_wire( args[ 0 ] );
+    else
+      gates[ g ] = fltt_binary( gates[ args[ 0 ] ], gates[ args[ 1 ] ],
+                                m->gate_types[ g ] );
+  }
+  return gates[ m->gate_num - 1 ];
+}
+
+// the expression types of the instructions of objectives
+enum CASE_EXPRESSION model_exp_types[ EXP_CASES ] = {
+  [ OBJ_VAR ] = VAR,
+  [ OBJ_CONST ] = CONST,
+  [ OBJ_OPP ] = OPP,
+  [ OBJ_ADD ] = ADD,
+  [ OBJ_SUB ] = SUB,
+  [ OBJ_MUL ] = MUL,
+  [ OBJ_DIV ] = DIV,
+  [ OBJ_POW ] = POW,
+  [ OBJ_LOG ] = LOG
+};
+
+expression* model_cfd_res( model m ) {
+  objective o = m->cfds;
+  expression* res = GC_MALLOC( 2 * m->n * sizeof( expression ) );
+  // the expression of each instruction of the current branch
+  expression* code = GC_MALLOC( ( o->max_len + 1 ) * sizeof( expression ) );
+  for ( int i = 0; i < 2 * m->n; ++i ) {
+    res[ i ] = NULL;
+    if ( ! ( m->wires[ i / 2 ] & ( i % 2 == 0 ? MODEL_WIRE_POSITIVE :
+                                                MODEL_WIRE_NEGATIVE ) ) )
+      continue;
+    int start = o->branch_start[ i ];
+    int len = o->branch_start[ i + 1 ] - start;
+    for ( int k = 0; k < len; ++k ) {
+      int arg = o->args[ start + k ];
+      switch ( o->ops[ start + k ] ) {
+        case OBJ_VAR:
+          // variables are named after their wire
+          code[ k ] = exp_wire_var( i, arg );
+          if ( code[ k ] == NULL )
+            code[ k ] = exp_wire_var( 2 * arg, arg );
+          break;
+        case OBJ_CONST:
+          code[ k ] = exp_const( o->constants[ arg ] );
+          break;
+        case OBJ_OPP:
+        case OBJ_LOG:
+          code[ k ] = exp_unary( code[ k - 1 ],
+                                 model_exp_types[ o->ops[ start + k ] ] );
+          break;
+        default:
+          code[ k ] = exp_binary( code[ arg ], code[ k - 1 ],
+                                  model_exp_types[ o->ops[ start + k ] ] );
+          break;
+      }
+    }
+    res[ i ] = code[ len - 1 ];
+  }
+  return res;
+}
@@ -0,0 +1,154 @@
+/********************************************************************
+ * model.h
+ *
+ * Header of model.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_MODEL_H__
+#define __CCL_MODEL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "expression.h"
+#include "fault_tree.h"
+#include "objective.h"
+
+/*********
+ * Types *
+ *********/
+
+// the first bytes of model files, and the version of their format
+#define MODEL_MAGIC "ASTRAHLM"
+#define MODEL_VERSION 1
+
+// the flags of the wires of models
+#define MODEL_WIRE_IN_TREE  1 // the wire appears in the fault tree
+#define MODEL_WIRE_POSITIVE 2 // the wire has a positive confidence function
+#define MODEL_WIRE_NEGATIVE 4 // the wire has a negative confidence function
+
+/* The header of model files (72 bytes), followed by their sections (in this
+ * order, each one starting at a multiple of 8 bytes):
+ * - the [gate_num] types of the gates of the fault tree (see
+ *   [CASE_FAULT_TREE]), each gate coming after its children, and the root
+ *   last,
+ * - their 2 [gate_num] arguments (the index and -1 for wires, the positions of
+ *   the children for the other gates),
+ * - the flags of the [n] wires (see [MODEL_WIRE_IN_TREE]),
+ * - the [branch_num] + 1 starts of the branches, the [code_len] instructions
+ *   and their arguments, and the [const_num] constants of the objective (see
+ *   [objective_s]),
+ * - the 2 [n] + 1 starts, the [cfd_code_len] instructions and their
+ *   arguments, and the [cfd_const_num] constants of the confidence functions,
+ *   compiled in the same way (the one of index i being branch i, a constant 0
+ *   if the wire has no such function).
+ * Integers are stored as ints and reals as doubles of the machine writing the
+ * file, which is only loaded by machines with the same [endian] (the value
+ * [MODEL_ENDIAN]), [int_size], and [double_size]. The [key] identifies the
+ * problem in warm-start caches (see [reader_key]), and the [size] is the size
+ * of the whole file.
+ */
+#define MODEL_ENDIAN 0x01020304
+typedef struct model_header_s {
+  char magic[ 8 ];
+  uint32_t version;
+  uint32_t endian;
+  uint32_t int_size;
+  uint32_t double_size;
+  uint64_t key;
+  int32_t n;
+  int32_t gate_num;
+  int32_t branch_num;
+  int32_t code_len;
+  int32_t max_len;
+  int32_t const_num;
+  int32_t cfd_code_len;
+  int32_t cfd_const_num;
+  uint64_t size;
+} model_header;
+
+/* The type structure for models, i.e., fault trees with their confidence
+ * functions and objective compiled once (see [model_compile]), and written to
+ * files that are later mapped in memory and used in place (see [model_load]):
+ * - [key]: the key of the problem (see [model_header]),
+ * - [n]: the number of wires,
+ * - [gate_num], [gate_types], and [gate_args]: the fault tree, as flat arrays
+ *   (see [model_header]),
+ * - [wires]: the flags of the wires,
+ * - [obj]: the objective, i.e., the confidence in the proof of the fault tree
+ *   (see [obj_from_proof], without the expressions of its branches),
+ * - [cfds]: the confidence functions, compiled as the branches of an
+ *   objective,
+ * - [contents] and [length]: the mapped file (NULL and 0 for models compiled
+ *   in memory).
+ */
+typedef struct model_s {
+  uint64_t key;
+  int n;
+  int gate_num;
+  int* gate_types;
+  int* gate_args;
+  int* wires;
+  objective obj;
+  objective cfds;
+  char* contents;
+  size_t length;
+} *model;
+
+/************
+ * Creation *
+ ************/
+
+/* model_compile: compiles a problem into a model.
+ * inputs:
+ * - the number [n] of wires,
+ * - the fault tree [ft],
+ * - an array [cfd_res] of 2 [n] confidence functions (see [problem_to_batch],
+ *   NULL for missing ones),
+ * - the objective [obj] of [ft] (see [obj_from_proof]),
+ * - the [key] of the problem (see [reader_key]).
+ * output: the model.
+ */
+model model_compile( int n, fault_tree ft, expression* cfd_res, objective obj,
+                     uint64_t key );
+
+/* model_write: writes a model to a file (see [model_header]).
+ * inputs:
+ * - the model [m],
+ * - the [filename] of the file (replaced if it exists).
+ * output: nothing.
+ */
+void model_write( model m, char* filename );
+
+/* model_load: loads a model from a file, mapping it in memory (read-only, so
+ * that processes loading the same file share it) and using its arrays in
+ * place, without copying them. Files of another format (or version), and
+ * files whose arrays are inconsistent (e.g., gates whose children or wires
+ * are out of range, or instructions whose arguments are), are rejected.
+ * inputs:
+ * - the [filename] of the file.
+ * output: the model.
+ */
+model model_load( char* filename );
+
+/*********
+ * Usage *
+ *********/
+
+/* model_fltt: rebuilds the fault tree of a model.
+ * inputs:
+ * - the model [m].
+ * output: the fault tree.
+ */
+fault_tree model_fltt( model m );
+
+/* model_cfd_res: rebuilds the confidence functions of a model.
+ * inputs:
+ * - the model [m].
+ * output: an array of 2 [m]->n expressions, the confidence functions of wire i
+ * being at 2 i and 2 i + 1 (NULL for missing ones).
+ */
+expression* model_cfd_res( model m );
+
+#endif // __CCL_MODEL_H__
@@ -0,0 +1,279 @@
+/********************************************************************
+ * module.c
+ *
+ * Defines functions to decompose fault trees into modules optimised
+ * separately.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <gc.h>
+#include "utils.h"
+#include "expression.h"
+#include "logic.h"
+#include "proof.h"
+#include "fault_tree.h"
+#include "objective.h"
+#include "optimisation.h"
+#include "parallel.h"
+#include "trace.h"
+#include "module.h"
+
+/*
+ * Creation
+ */
+
+// the wires of [t], as an array of [n] booleans
+bool* module_wires( int n, fault_tree t ) {
+  bool* wires = GC_MALLOC_ATOMIC( n * sizeof( bool ) );
+  for ( int i = 0; i < n; ++i )
+    wires[ i ] = false;
+  fltt_wires( t, wires );
+  return wires;
+}
+
+module module_decompose( int n, fault_tree t ) {
+  module m = GC_MALLOC( sizeof( struct module_s ) );
+  bool* wires = module_wires( n, t );
+  m->num = 0;
+  for ( int i = 0; i < n; ++i )
+    m->num += wires[ i ];
+  if ( t->fault_tree_type != WIRE ) {
+    bool* left = module_wires( n, t->children[ 0 ] );
+    bool* right = module_wires( n, t->children[ 1 ] );
+    bool disjoint = true;
+    for ( int i = 0; disjoint && i < n; ++i )
+      disjoint = ! ( left[ i ] && right[ i ] );
+    if ( disjoint ) {
+      m->gate = t->fault_tree_type;
+      m->left = module_decompose( n, t->children[ 0 ] );
+      m->right = module_decompose( n, t->children[ 1 ] );
+      return m;
+    }
+  }
+  // the wires of a module are renamed in increasing order
+  int* names = GC_MALLOC_ATOMIC( n * sizeof( int ) );
+  m->gate = WIRE;
+  m->wires = GC_MALLOC_ATOMIC( m->num * sizeof( int ) );
+  for ( int i = 0, k = 0; i < n; ++i )
+    if ( wires[ i ] ) {
+      names[ i ] = k;
+      m->wires[ k++ ] = i;
+    }
+  m->tree = fltt_rename( t, names );
+  return m;
+}
+
+/*
+ * Optimisation
+ */
+
+// the number of modules of [m], stored in [leaves] (if it is not NULL)
+int module_leaves( module m, module* leaves ) {
+  if ( m->gate == WIRE ) {
+    if ( leaves != NULL )
+      leaves[ 0 ] = m;
+    return 1;
+  }
+  int k = module_leaves( m->left, leaves );
+  return k + module_leaves( m->right, leaves == NULL ? NULL : leaves + k );
+}
+
+// the confidence functions of the wires of [m] (the positive and negative
+// ones of wire i being at 2 i and 2 i + 1, see [fltt_to_prf]), whose variables
+// are renamed as the wires of [m], using [vars] (of size [n]) as a buffer
+expression* module_cfd_res( int n, module m, expression* cfd_res,
+                            expression* vars ) {
+  expression* res = GC_MALLOC( 2 * m->num * sizeof( expression ) );
+  for ( int i = 0; i < n; ++i )
+    vars[ i ] = NULL;
+  for ( int k = 0; k < m->num; ++k ) {
+    char* name = GC_MALLOC_ATOMIC( ( int_length( k ) + 1 ) * sizeof( char ) );
+    snprintf( name, int_length( k ) + 1, "%d", k );
+    vars[ m->wires[ k ] ] = exp_var( k, name );
+  }
+  for ( int k = 0; k < m->num; ++k )
+    for ( int s = 0; s < 2; ++s )
+      res[ 2 * k + s ] =
+        exp_array_composition( cfd_res[ 2 * m->wires[ k ] + s ], vars );
+  return res;
+}
+
+// the confidence of [gate] when its sides have confidences [a] and [b] (see
+// [prf_conj_i] and [prf_disj_i])
+double module_gate( enum CASE_FAULT_TREE gate, double a, double b ) {
+  if ( gate == OR )
+    return a * b;
+  return a + b - a * b;
+}
+
+// the state shared by the threads computing the budget-response curves: the
+// modules, the index of the first job of each one (and the total number of
+// jobs after the last one), the distance between budgets, and the
+// optimisation parameters
+typedef struct module_job_s {
+  module* leaves;
+  int* first;
+  double step;
+  optim_params params;
+} *module_job;
+
+// computes the point [i] of the curve of a module
+void module_solve( int i, int worker, void* arg ) {
+  ( void ) worker;
+  module_job job = arg;
+  int l = 0;
+  while ( job->first[ l + 1 ] <= i )
+    ++l;
+  module m = job->leaves[ l ];
+  int j = i - job->first[ l ];
+  double b = fmax( m->lo + j * job->step, 0 );
+  double* alloc = m->allocations + j * m->num;
+  if ( b <= 0 || m->num == 1 ) {
+    // there is nothing to optimise
+    double* point = GC_MALLOC_ATOMIC( m->num * sizeof( double ) );
+    for ( int k = 0; k < m->num; ++k ) {
+      alloc[ k ] = k == 0 ? b : 0;
+      point[ k ] = m->sigma[ k ] + alloc[ k ];
+    }
+    m->curve[ j ] = obj_eval( m->obj, point, obj_work_new( m->obj ) );
+    return;
+  }
+  // each job has its own trace, so that threads do not share their clocks
+  optim_params params = GC_MALLOC( sizeof( struct optim_params_s ) );
+  *params = *job->params;
+  params->trace = trace_new();
+  optim_report report = GC_MALLOC( sizeof( struct optim_report_s ) );
+  double* result = resource_repartition( m->num, m->p, m->cfd_res, m->sigma,
+                                         b, params, report );
+  for ( int k = 0; k < m->num; ++k )
+    alloc[ k ] = result[ k ];
+  m->curve[ j ] = report->confidence;
+}
+
+// computes the curves of the gates of [m] from the curves of its modules, up
+// to the budget [res]
+void module_combine( module m, double res, double step ) {
+  if ( m->gate == WIRE )
+    return;
+  module l = m->left, r = m->right;
+  module_combine( l, res, step );
+  module_combine( r, res, step );
+  m->lo = l->lo + r->lo;
+  m->len = l->len + r->len - 1;
+  if ( step > 0 && m->len > lround( ( res - m->lo ) / step ) + 1 )
+    m->len = lround( ( res - m->lo ) / step ) + 1;
+  if ( m->len < 1 )
+    m->len = 1;
+  m->curve = GC_MALLOC_ATOMIC( m->len * sizeof( double ) );
+  m->splits = GC_MALLOC_ATOMIC( m->len * sizeof( int ) );
+  for ( int t = 0; t < m->len; ++t ) {
+    m->splits[ t ] = -1;
+    for ( int j = t - r->len + 1 > 0 ? t - r->len + 1 : 0;
+          j < l->len && j <= t; ++j ) {
+      double c = module_gate( m->gate, l->curve[ j ], r->curve[ t - j ] );
+      if ( m->splits[ t ] < 0 || c > m->curve[ t ] ) {
+        m->curve[ t ] = c;
+        m->splits[ t ] = j;
+      }
+    }
+  }
+}
+
+// gives the budget [t] of the curve of [m] to its modules, and stores their
+// allocations in [result]
+void module_assign( module m, int t, double step, double* result ) {
+  if ( m->gate != WIRE ) {
+    module_assign( m->left, m->splits[ t ], step, result );
+    module_assign( m->right, t - m->splits[ t ], step, result );
+    return;
+  }
+  m->budget = m->lo + t * step;
+  for ( int k = 0; k < m->num; ++k )
+    result[ m->wires[ k ] ] = m->allocations[ t * m->num + k ];
+}
+
+double* module_repartition( int n, fault_tree t, logic log,
+                            expression* cfd_res, double* sigma, double res,
+                            optim_params params, optim_report report ) {
+  module root = module_decompose( n, t );
+  // a fault tree without modules is optimised as a whole
+  if ( root->gate == WIRE )
+    return resource_repartition( n, fltt_to_prf( n, t, log ), cfd_res, sigma,
+                                 res, params, report );
+  if ( params->robust != NULL ) {
+    fprintf( stderr, "Modules cannot be optimised robustly.\n" );
+    error_exit();
+  }
+  module_params mp = params->modules;
+  int num = module_leaves( root, NULL );
+  module* leaves = GC_MALLOC( num * sizeof( module ) );
+  module_leaves( root, leaves );
+  expression* vars = GC_MALLOC( n * sizeof( expression ) );
+  for ( int l = 0; l < num; ++l ) {
+    module m = leaves[ l ];
+    m->cfd_res = module_cfd_res( n, m, cfd_res, vars );
+    m->sigma = GC_MALLOC_ATOMIC( m->num * sizeof( double ) );
+    for ( int k = 0; k < m->num; ++k )
+      m->sigma[ k ] = sigma[ m->wires[ k ] ];
+    m->p = fltt_to_prf( m->num, m->tree, log );
+    m->obj = obj_from_proof( m->num, m->p, m->cfd_res );
+    m->lo = 0;
+    m->len = mp->steps + 1;
+  }
+  // modules start from balanced allocations, and are optimised on a single
+  // thread each since they are optimised in parallel
+  module_job job = GC_MALLOC( sizeof( struct module_job_s ) );
+  job->leaves = leaves;
+  job->first = GC_MALLOC_ATOMIC( ( num + 1 ) * sizeof( int ) );
+  job->step = res / mp->steps;
+  job->params = GC_MALLOC( sizeof( struct optim_params_s ) );
+  *job->params = *params;
+  job->params->start = NULL;
+  job->params->modules = NULL;
+  job->params->bb_params = GC_MALLOC( sizeof( struct branch_bound_params_s ) );
+  *job->params->bb_params = *params->bb_params;
+  job->params->bb_params->threads = 1;
+  double* result = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  for ( int i = 0; i < n; ++i )
+    result[ i ] = 0;
+  int best;
+  for ( int round = 0; ; ++round ) {
+    job->first[ 0 ] = 0;
+    for ( int l = 0; l < num; ++l ) {
+      module m = leaves[ l ];
+      m->curve = GC_MALLOC_ATOMIC( m->len * sizeof( double ) );
+      m->allocations =
+        GC_MALLOC_ATOMIC( m->len * m->num * sizeof( double ) );
+      job->first[ l + 1 ] = job->first[ l ] + m->len;
+    }
+    parallel_for( mp->threads, job->first[ num ], module_solve, job );
+    module_combine( root, res, job->step );
+    best = job->step > 0 ? lround( ( res - root->lo ) / job->step ) : 0;
+    if ( best > root->len - 1 )
+      best = root->len - 1;
+    if ( best < 0 )
+      best = 0;
+    module_assign( root, best, job->step, result );
+    if ( round == mp->refine || job->step <= 0 )
+      break;
+    // the next round looks around the budgets of this one, more closely
+    double next = job->step / ( mp->steps / 2 );
+    for ( int l = 0; l < num; ++l ) {
+      module m = leaves[ l ];
+      m->lo = fmax( m->budget - job->step, 0 );
+      m->len = lround( ( fmin( m->budget + job->step, res ) - m->lo ) /
+                       next ) + 1;
+    }
+    job->step = next;
+  }
+  if ( report != NULL ) {
+    report->confidence = root->curve[ best ];
+    report->bound = INFINITY;
+  }
+  return result;
+}
@@ -0,0 +1,111 @@
+/********************************************************************
+ * module.h
+ *
+ * Header of module.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_MODULE_H__
+#define __CCL_MODULE_H__
+
+#include "expression.h"
+#include "logic.h"
+#include "proof.h"
+#include "fault_tree.h"
+#include "objective.h"
+#include "optimisation.h"
+
+/*********
+ * Types *
+ *********/
+
+/* The type structure for decompositions of fault trees into modules, i.e.,
+ * subtrees joined by gates whose two sides have no wire in common. The
+ * confidence of such a gate only depends on the best confidences of its sides
+ * (their product for "or", and their probabilistic sum for "and" and "pand"),
+ * so the best allocation of a budget spends the best allocation of a part of
+ * it on each side, and modules can be optimised separately:
+ * - [gate]: the gate joining [left] and [right], or WIRE for a module (which
+ *   is optimised as a whole),
+ * - [left] and [right]: the decompositions of the sides of the gate,
+ * - [tree] (modules only): the fault tree of the module, whose wires are
+ *   renamed from 0 to [num] - 1,
+ * - [num]: the number of wires,
+ * - [wires] (modules only): the index of each renamed wire in the original
+ *   fault tree,
+ * - [p], [cfd_res], [sigma], and [obj] (modules only, set by
+ *   [module_repartition]): the proof of [tree], the confidence functions and
+ *   resources already spent of its wires, and its objective,
+ * - [lo], [len], and [curve]: the budget-response curve, i.e., the best
+ *   confidence [curve][ j ] found for the budget [lo] + j step, for j from 0 to
+ *   [len] - 1,
+ * - [allocations] (modules only): the allocation ([num] resources) found for
+ *   each budget of the curve,
+ * - [splits] (gates only): the index of the budget of [left] for each budget
+ *   of the curve (the rest going to [right]),
+ * - [budget] (modules only): the budget chosen for the module.
+ */
+typedef struct module_s {
+  enum CASE_FAULT_TREE gate;
+  struct module_s* left;
+  struct module_s* right;
+  fault_tree tree;
+  int num;
+  int* wires;
+  proof p;
+  expression* cfd_res;
+  double* sigma;
+  objective obj;
+  double lo;
+  int len;
+  double* curve;
+  double* allocations;
+  int* splits;
+  double budget;
+} *module;
+
+/************
+ * Creation *
+ ************/
+
+/* module_decompose: decomposes a fault tree into modules, splitting it at
+ * every gate whose sides have no wire in common, starting from its root.
+ * inputs:
+ * - the number [n] of wires (larger than the indices of the wires of [t]),
+ * - the fault tree [t].
+ * output: the decomposition (a single module if [t] cannot be split).
+ */
+module module_decompose( int n, fault_tree t );
+
+/****************
+ * Optimisation *
+ ****************/
+
+/* module_repartition: gives the most effective resource repartition to
+ * increase confidence in a fault tree by decomposing it into modules: the
+ * budget-response curves of the modules are computed in parallel (with the
+ * algorithm of [params], on the module alone), then the budget is shared
+ * between modules by dynamic programming over the gates joining them, and
+ * the curves are refined around the chosen budgets (see [module_params]).
+ * Fault trees that cannot be decomposed are optimised as a whole by
+ * [resource_repartition]. Otherwise, the starting allocation and the trace
+ * of [params] are not used, and robust optimisation is not supported.
+ * inputs:
+ * - the number [n] of wires,
+ * - the fault tree [t],
+ * - the logic [log] (see [fltt_to_prf]),
+ * - an array of expressions [cfd_res] describing the confidence reached by
+ *   spending some amount of resources on each wire,
+ * - an array [sigma] of size [n] of the resources already spent,
+ * - a double [res] representing the amount of resources to be spent,
+ * - optimisation parameters [params] (whose [modules] are not NULL),
+ * - a [report] to fill (or NULL).
+ * output: a vector of size [n] of doubles describing the amount of resources
+ * to be spent on each wire.
+ */
+double* module_repartition( int n, fault_tree t, logic log,
+                            expression* cfd_res, double* sigma, double res,
+                            optim_params params, optim_report report );
+
+#endif // __CCL_MODULE_H__
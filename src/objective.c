@@ -0,0 +1,780 @@
+/********************************************************************
+ * objective.c
+ *
+ * Defines functions to compile and evaluate the confidence in a proof.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <gc.h>
+#include "utils.h"
+#include "expression.h"
+#include "proof.h"
+#include "objective.h"
+
+/*
+ * Creation
+ */
+
+// counts the instructions and constants needed to compile an expression
+void obj_compile_size( expression e, int* len, int* consts ) {
+  ( *len )++;
+  if ( e->expression_type == CONST )
+    ( *consts )++;
+  if ( e->child1 != NULL )
+    obj_compile_size( e->child1, len, consts );
+  if ( e->child2 != NULL )
+    obj_compile_size( e->child2, len, consts );
+}
+
+// compiles [e] at position [pos] (relative to [base]) in the code of [o], and
+// returns the position following the compiled code
+int obj_compile_aux( objective o, expression e, int base, int pos ) {
+  int first;
+  switch ( e->expression_type ) {
+    case VAR:
+      o->ops[ base + pos ] = OBJ_VAR;
+      o->args[ base + pos ] = e->index;
+      if ( e->index >= o->n ) {
+        fprintf( stderr, "obj_compile: variable %d out of range (%d).\n",
+                 e->index, o->n );
+        error_exit();
+      }
+      return pos + 1;
+      break;
+    case CONST:
+      o->ops[ base + pos ] = OBJ_CONST;
+      o->args[ base + pos ] = o->const_num;
+      o->constants[ o->const_num++ ] = e->constant;
+      return pos + 1;
+      break;
+    case OPP:
+    case LOG:
+      pos = obj_compile_aux( o, e->child1, base, pos );
+      o->ops[ base + pos ] = e->expression_type == OPP ? OBJ_OPP : OBJ_LOG;
+      o->args[ base + pos ] = 0;
+      return pos + 1;
+      break;
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case POW:
+      pos = obj_compile_aux( o, e->child1, base, pos );
+      first = pos - 1;
+      pos = obj_compile_aux( o, e->child2, base, pos );
+      switch ( e->expression_type ) {
+        case ADD: o->ops[ base + pos ] = OBJ_ADD; break;
+        case SUB: o->ops[ base + pos ] = OBJ_SUB; break;
+        case MUL: o->ops[ base + pos ] = OBJ_MUL; break;
+        case DIV: o->ops[ base + pos ] = OBJ_DIV; break;
+        default:  o->ops[ base + pos ] = OBJ_POW; break;
+      }
+      o->args[ base + pos ] = first;
+      return pos + 1;
+      break;
+    default:
+      fprintf( stderr, "obj_compile: Unknown expression type." );
+      error_exit();
+      break;
+  }
+}
+
+objective obj_compile( int n, int branch_num, expression* branches ) {
+  objective res = GC_MALLOC( sizeof( struct objective_s ) );
+  res->n = n;
+  res->branch_num = branch_num;
+  res->branches = branches;
+  res->branch_start = GC_MALLOC( ( branch_num + 1 ) * sizeof( int ) );
+  int len = 0, consts = 0;
+  res->max_len = 0;
+  for ( int b = 0; b < branch_num; ++b ) {
+    res->branch_start[ b ] = len;
+    obj_compile_size( branches[ b ], &len, &consts );
+    if ( len - res->branch_start[ b ] > res->max_len )
+      res->max_len = len - res->branch_start[ b ];
+  }
+  res->branch_start[ branch_num ] = len;
+  res->code_len = len;
+  res->ops = GC_MALLOC_ATOMIC( len * sizeof( int ) );
+  res->args = GC_MALLOC_ATOMIC( len * sizeof( int ) );
+  res->constants = GC_MALLOC_ATOMIC( ( consts + 1 ) * sizeof( double ) );
+  res->const_num = 0;
+  for ( int b = 0; b < branch_num; ++b )
+    obj_compile_aux( res, branches[ b ], res->branch_start[ b ], 0 );
+  res->scenario_num = 0;
+  res->scenarios = NULL;
+  res->robust = OBJ_EXPECTED;
+  return res;
+}
+
+objective obj_from_proof( int n, proof p, expression* cfd_res ) {
+  expression* branches = GC_MALLOC( p->conclusion->pos_cfd_num *
+                                    sizeof( expression ) );
+  for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
+    branches[ i ] = exp_array_composition( p->conclusion->ccl_pos_cfds[ i ],
+                                           cfd_res );
+  return obj_compile( n, p->conclusion->pos_cfd_num, branches );
+}
+
+void obj_set_scenarios( objective o, int num, double* scenarios,
+                        enum CASE_OBJ_ROBUST robust ) {
+  o->scenario_num = num;
+  o->scenarios = scenarios;
+  o->robust = robust;
+}
+
+// the buffer holds the values of all instructions, the adjoints of the
+// instructions of one branch (or the upper bounds of their intervals, whose
+// lower bounds overwrite the values), the intervals of their adjoints, the
+// values of all branches, and the intervals of the gradient and the
+// breakpoints used by [obj_bound_branch_hyperplane], then for robust
+// objectives, the values of the instructions of one branch in all scenarios,
+// a value per scenario, and a gradient
+double* obj_work_new( objective o ) {
+  return GC_MALLOC_ATOMIC( ( o->code_len + 3 * o->max_len + o->branch_num +
+                             4 * o->n +
+                             o->scenario_num * ( o->max_len + 1 ) +
+                             ( o->scenario_num > 0 ? o->n : 0 ) ) *
+                           sizeof( double ) );
+}
+
+// the part of the buffer [work] reserved for robust objectives
+double* obj_work_robust( objective o, double* work ) {
+  return work + o->code_len + 3 * o->max_len + o->branch_num + 4 * o->n;
+}
+
+// the constants of scenario [s] of [o] (its constants if it is deterministic)
+double* obj_constants( objective o, int s ) {
+  if ( o->scenario_num == 0 )
+    return o->constants;
+  return o->scenarios + s * o->const_num;
+}
+
+// aggregates the values [vals] of the scenarios of [o], storing the index of
+// the worst one in [worst] (if not NULL)
+double obj_aggregate( objective o, double* vals, int* worst ) {
+  double res = 0;
+  int w = 0;
+  for ( int s = 0; s < o->scenario_num; ++s ) {
+    res += vals[ s ];
+    if ( vals[ s ] < vals[ w ] )
+      w = s;
+  }
+  if ( worst != NULL )
+    *worst = w;
+  return o->robust == OBJ_WORST ? vals[ w ] : res / o->scenario_num;
+}
+
+/*
+ * Evaluation
+ */
+
+// evaluates branch [b] with [constants], storing the value of each instruction
+// in [vals] (relative to the start of the branch)
+double obj_forward( objective o, double* constants, int b, double* sigma,
+                    double* vals ) {
+  int start = o->branch_start[ b ];
+  int len = o->branch_start[ b + 1 ] - start;
+  int* ops = o->ops + start;
+  int* args = o->args + start;
+  for ( int i = 0; i < len; ++i ) {
+    switch ( ops[ i ] ) {
+      case OBJ_VAR:
+        vals[ i ] = sigma[ args[ i ] ];
+        break;
+      case OBJ_CONST:
+        vals[ i ] = constants[ args[ i ] ];
+        break;
+      case OBJ_OPP:
+        vals[ i ] = - vals[ i - 1 ];
+        break;
+      case OBJ_LOG:
+        vals[ i ] = log( vals[ i - 1 ] );
+        break;
+      case OBJ_ADD:
+        vals[ i ] = vals[ args[ i ] ] + vals[ i - 1 ];
+        break;
+      case OBJ_SUB:
+        vals[ i ] = vals[ args[ i ] ] - vals[ i - 1 ];
+        break;
+      case OBJ_MUL:
+        vals[ i ] = vals[ args[ i ] ] * vals[ i - 1 ];
+        break;
+      case OBJ_DIV:
+        vals[ i ] = vals[ args[ i ] ] / vals[ i - 1 ];
+        break;
+      case OBJ_POW:
+        vals[ i ] = pow( vals[ args[ i ] ], vals[ i - 1 ] );
+        break;
+      default:
+        fprintf( stderr, "obj_forward: Unknown instruction." );
+        error_exit();
+        break;
+    }
+  }
+  return vals[ len - 1 ];
+}
+
+// evaluates branch [b] in all the scenarios of [o] at once, storing the value
+// of instruction [i] in scenario [s] in [vals] at position
+// [i] * [o]->scenario_num + [s] (relative to the start of the branch), and
+// returns the values of the branch
+double* obj_forward_batch( objective o, int b, double* sigma, double* vals ) {
+  int start = o->branch_start[ b ];
+  int len = o->branch_start[ b + 1 ] - start;
+  int* ops = o->ops + start;
+  int* args = o->args + start;
+  int num = o->scenario_num;
+  double *v, *x, *y;
+  for ( int i = 0; i < len; ++i ) {
+    v = vals + i * num;
+    if ( ops[ i ] == OBJ_VAR ) {
+      for ( int s = 0; s < num; ++s )
+        v[ s ] = sigma[ args[ i ] ];
+      continue;
+    }
+    if ( ops[ i ] == OBJ_CONST ) {
+      for ( int s = 0; s < num; ++s )
+        v[ s ] = o->scenarios[ s * o->const_num + args[ i ] ];
+      continue;
+    }
+    y = vals + ( i - 1 ) * num;
+    x = vals + args[ i ] * num;
+    switch ( ops[ i ] ) {
+      case OBJ_OPP:
+        for ( int s = 0; s < num; ++s )
+          v[ s ] = - y[ s ];
+        break;
+      case OBJ_LOG:
+        for ( int s = 0; s < num; ++s )
+          v[ s ] = log( y[ s ] );
+        break;
+      case OBJ_ADD:
+        for ( int s = 0; s < num; ++s )
+          v[ s ] = x[ s ] + y[ s ];
+        break;
+      case OBJ_SUB:
+        for ( int s = 0; s < num; ++s )
+          v[ s ] = x[ s ] - y[ s ];
+        break;
+      case OBJ_MUL:
+        for ( int s = 0; s < num; ++s )
+          v[ s ] = x[ s ] * y[ s ];
+        break;
+      case OBJ_DIV:
+        for ( int s = 0; s < num; ++s )
+          v[ s ] = x[ s ] / y[ s ];
+        break;
+      case OBJ_POW:
+        for ( int s = 0; s < num; ++s )
+          v[ s ] = pow( x[ s ], y[ s ] );
+        break;
+      default:
+        fprintf( stderr, "obj_forward_batch: Unknown instruction." );
+        error_exit();
+        break;
+    }
+  }
+  return vals + ( len - 1 ) * num;
+}
+
+// accumulates [seed] times the gradient of branch [b] into [grad], using the
+// values [vals] computed by [obj_forward] and the buffer [adj]
+void obj_backward( objective o, int b, double seed, double* vals, double* adj,
+                   double* grad ) {
+  int start = o->branch_start[ b ];
+  int len = o->branch_start[ b + 1 ] - start;
+  int* ops = o->ops + start;
+  int* args = o->args + start;
+  double a, x, y;
+  for ( int i = 0; i < len; ++i )
+    adj[ i ] = 0;
+  adj[ len - 1 ] = seed;
+  for ( int i = len - 1; i >= 0; --i ) {
+    a = adj[ i ];
+    if ( a == 0 )
+      continue;
+    switch ( ops[ i ] ) {
+      case OBJ_VAR:
+        grad[ args[ i ] ] += a;
+        break;
+      case OBJ_CONST:
+        break;
+      case OBJ_OPP:
+        adj[ i - 1 ] -= a;
+        break;
+      case OBJ_LOG:
+        adj[ i - 1 ] += a / vals[ i - 1 ];
+        break;
+      case OBJ_ADD:
+        adj[ args[ i ] ] += a;
+        adj[ i - 1 ] += a;
+        break;
+      case OBJ_SUB:
+        adj[ args[ i ] ] += a;
+        adj[ i - 1 ] -= a;
+        break;
+      case OBJ_MUL:
+        adj[ args[ i ] ] += a * vals[ i - 1 ];
+        adj[ i - 1 ] += a * vals[ args[ i ] ];
+        break;
+      case OBJ_DIV:
+        y = vals[ i - 1 ];
+        adj[ args[ i ] ] += a / y;
+        adj[ i - 1 ] -= a * vals[ args[ i ] ] / ( y * y );
+        break;
+      case OBJ_POW:
+        x = vals[ args[ i ] ];
+        y = vals[ i - 1 ];
+        adj[ args[ i ] ] += a * y * pow( x, y - 1 );
+        if ( x > 0 )
+          adj[ i - 1 ] += a * log( x ) * vals[ i ];
+        break;
+      default:
+        fprintf( stderr, "obj_backward: Unknown instruction." );
+        error_exit();
+        break;
+    }
+  }
+}
+
+double obj_eval_branch( objective o, int b, double* sigma, double* work ) {
+  if ( o->scenario_num > 0 )
+    return obj_aggregate( o, obj_forward_batch( o, b, sigma,
+                                                obj_work_robust( o, work ) ),
+                          NULL );
+  return obj_forward( o, o->constants, b, sigma, work + o->branch_start[ b ] );
+}
+
+// evaluates a robust objective, storing the maximum of the branches in each
+// scenario after the values of the instructions
+double obj_eval_robust( objective o, double* sigma, double* work ) {
+  int num = o->scenario_num;
+  double* vals = obj_work_robust( o, work );
+  double* maxima = vals + num * o->max_len;
+  for ( int b = 0; b < o->branch_num; ++b ) {
+    double* branch = obj_forward_batch( o, b, sigma, vals );
+    for ( int s = 0; s < num; ++s )
+      if ( b == 0 || branch[ s ] > maxima[ s ] )
+        maxima[ s ] = branch[ s ];
+  }
+  return obj_aggregate( o, maxima, NULL );
+}
+
+double obj_eval( objective o, double* sigma, double* work ) {
+  if ( o->scenario_num > 0 )
+    return obj_eval_robust( o, sigma, work );
+  double best = obj_eval_branch( o, 0, sigma, work );
+  for ( int b = 1; b < o->branch_num; ++b ) {
+    double cur = obj_eval_branch( o, b, sigma, work );
+    if ( cur > best )
+      best = cur;
+  }
+  return best;
+}
+
+double obj_eval_above( objective o, double* sigma, double threshold, int* hint,
+                       double* work ) {
+  if ( o->scenario_num > 0 )
+    return obj_eval_robust( o, sigma, work );
+  int first = hint != NULL ? *hint : 0;
+  double best = obj_eval_branch( o, first, sigma, work );
+  if ( best > threshold )
+    return best;
+  for ( int b = 0; b < o->branch_num; ++b ) {
+    if ( b == first )
+      continue;
+    double cur = obj_eval_branch( o, b, sigma, work );
+    if ( cur > threshold ) {
+      if ( hint != NULL )
+        *hint = b;
+      return cur;
+    }
+    if ( cur > best )
+      best = cur;
+  }
+  return best;
+}
+
+// [obj_eval_smooth] with [constants]
+double obj_eval_smooth_scenario( objective o, double* constants, double temp,
+                                 double* sigma, double* grad, double* max,
+                                 double* work ) {
+  double* adj = work + o->code_len;
+  double* branch_vals = adj + 3 * o->max_len;
+  int best = 0;
+  // forward pass over all branches
+  for ( int b = 0; b < o->branch_num; ++b ) {
+    branch_vals[ b ] = obj_forward( o, constants, b, sigma,
+                                    work + o->branch_start[ b ] );
+    if ( branch_vals[ b ] > branch_vals[ best ] )
+      best = b;
+  }
+  double m = branch_vals[ best ];
+  if ( max != NULL )
+    *max = m;
+  if ( grad != NULL )
+    for ( int i = 0; i < o->n; ++i )
+      grad[ i ] = 0;
+  if ( temp <= 0 ) {
+    if ( grad != NULL )
+      obj_backward( o, best, 1, work + o->branch_start[ best ], adj, grad );
+    return m;
+  }
+  // shifting by the maximum avoids overflows
+  double z = 0;
+  for ( int b = 0; b < o->branch_num; ++b )
+    z += exp( ( branch_vals[ b ] - m ) / temp );
+  // backward pass over the branches with a non-negligible weight
+  if ( grad != NULL )
+    for ( int b = 0; b < o->branch_num; ++b ) {
+      double weight = exp( ( branch_vals[ b ] - m ) / temp ) / z;
+      if ( weight > 1e-16 )
+        obj_backward( o, b, weight, work + o->branch_start[ b ], adj, grad );
+    }
+  return m + temp * log( z );
+}
+
+double obj_eval_smooth( objective o, double temp, double* sigma, double* grad,
+                        double* max, double* work ) {
+  int num = o->scenario_num;
+  if ( num == 0 )
+    return obj_eval_smooth_scenario( o, o->constants, temp, sigma, grad, max,
+                                     work );
+  double* vals = obj_work_robust( o, work ) + num * o->max_len;
+  double* g = vals + num;
+  double* maxima = obj_work_robust( o, work );
+  double m;
+  int worst;
+  // the values (and maxima) of all scenarios, with the average gradient
+  if ( grad != NULL )
+    for ( int i = 0; i < o->n; ++i )
+      grad[ i ] = 0;
+  for ( int s = 0; s < num; ++s ) {
+    vals[ s ] = obj_eval_smooth_scenario( o, obj_constants( o, s ), temp,
+                                          sigma,
+                                          o->robust == OBJ_EXPECTED ? g : NULL,
+                                          &m, work );
+    maxima[ s ] = m;
+    if ( grad != NULL && o->robust == OBJ_EXPECTED )
+      for ( int i = 0; i < o->n; ++i )
+        grad[ i ] += g[ i ] / num;
+  }
+  double res = obj_aggregate( o, vals, &worst );
+  if ( max != NULL )
+    *max = obj_aggregate( o, maxima, NULL );
+  // the gradient of the worst scenario
+  if ( grad != NULL && o->robust == OBJ_WORST )
+    obj_eval_smooth_scenario( o, obj_constants( o, worst ), temp, sigma, grad,
+                              NULL, work );
+  return res;
+}
+
+/*
+ * Bounds
+ */
+
+// computes the interval of each instruction of branch [b] with [constants] over
+// the box [lo,hi], stored in [lows] and [highs] (relative to the start of the
+// branch)
+void obj_interval_forward( objective o, double* constants, int b, double* lo,
+                           double* hi, double* lows, double* highs ) {
+  int start = o->branch_start[ b ];
+  int len = o->branch_start[ b + 1 ] - start;
+  int* ops = o->ops + start;
+  int* args = o->args + start;
+  double x[ 2 ], y[ 2 ], r[ 2 ];
+  for ( int i = 0; i < len; ++i ) {
+    switch ( ops[ i ] ) {
+      case OBJ_VAR:
+        lows[ i ] = lo[ args[ i ] ];
+        highs[ i ] = hi[ args[ i ] ];
+        break;
+      case OBJ_CONST:
+        lows[ i ] = constants[ args[ i ] ];
+        highs[ i ] = constants[ args[ i ] ];
+        break;
+      case OBJ_OPP:
+        r[ 0 ] = - highs[ i - 1 ];
+        highs[ i ] = - lows[ i - 1 ];
+        lows[ i ] = r[ 0 ];
+        break;
+      case OBJ_LOG:
+        x[ 0 ] = lows[ i - 1 ];
+        x[ 1 ] = highs[ i - 1 ];
+        interval_log( x, r );
+        lows[ i ] = r[ 0 ];
+        highs[ i ] = r[ 1 ];
+        break;
+      case OBJ_ADD:
+        lows[ i ] = lows[ args[ i ] ] + lows[ i - 1 ];
+        highs[ i ] = highs[ args[ i ] ] + highs[ i - 1 ];
+        break;
+      case OBJ_SUB:
+        r[ 0 ] = lows[ args[ i ] ] - highs[ i - 1 ];
+        highs[ i ] = highs[ args[ i ] ] - lows[ i - 1 ];
+        lows[ i ] = r[ 0 ];
+        break;
+      case OBJ_MUL:
+      case OBJ_DIV:
+      case OBJ_POW:
+        x[ 0 ] = lows[ args[ i ] ];
+        x[ 1 ] = highs[ args[ i ] ];
+        y[ 0 ] = lows[ i - 1 ];
+        y[ 1 ] = highs[ i - 1 ];
+        if ( ops[ i ] == OBJ_MUL )
+          interval_mul( x, y, r );
+        else if ( ops[ i ] == OBJ_DIV )
+          interval_div( x, y, r );
+        else
+          interval_pow( x, y, r );
+        lows[ i ] = r[ 0 ];
+        highs[ i ] = r[ 1 ];
+        break;
+      default:
+        fprintf( stderr, "obj_interval_forward: Unknown instruction." );
+        error_exit();
+        break;
+    }
+  }
+}
+
+// adds the interval [a] to the interval [i] of [lows] and [highs]
+void obj_interval_acc( double* lows, double* highs, int i, double* a ) {
+  lows[ i ] += a[ 0 ];
+  highs[ i ] += a[ 1 ];
+}
+
+// computes intervals [gl,gu] containing the gradient of branch [b] over the box
+// on which [obj_interval_forward] computed [lows] and [highs], by a backward
+// pass on intervals of adjoints (stored in [adj_lows] and [adj_highs])
+void obj_interval_backward( objective o, int b, double* lows, double* highs,
+                            double* adj_lows, double* adj_highs, double* gl,
+                            double* gu ) {
+  int start = o->branch_start[ b ];
+  int len = o->branch_start[ b + 1 ] - start;
+  int* ops = o->ops + start;
+  int* args = o->args + start;
+  double a[ 2 ], x[ 2 ], y[ 2 ], r[ 2 ], t[ 2 ];
+  for ( int i = 0; i < o->n; ++i ) {
+    gl[ i ] = 0;
+    gu[ i ] = 0;
+  }
+  for ( int i = 0; i < len; ++i ) {
+    adj_lows[ i ] = 0;
+    adj_highs[ i ] = 0;
+  }
+  adj_lows[ len - 1 ] = 1;
+  adj_highs[ len - 1 ] = 1;
+  for ( int i = len - 1; i >= 0; --i ) {
+    a[ 0 ] = adj_lows[ i ];
+    a[ 1 ] = adj_highs[ i ];
+    if ( a[ 0 ] == 0 && a[ 1 ] == 0 )
+      continue;
+    if ( ops[ i ] != OBJ_VAR && ops[ i ] != OBJ_CONST ) {
+      y[ 0 ] = lows[ i - 1 ];
+      y[ 1 ] = highs[ i - 1 ];
+    }
+    if ( ops[ i ] >= OBJ_ADD && ops[ i ] <= OBJ_POW ) {
+      x[ 0 ] = lows[ args[ i ] ];
+      x[ 1 ] = highs[ args[ i ] ];
+    }
+    switch ( ops[ i ] ) {
+      case OBJ_VAR:
+        gl[ args[ i ] ] += a[ 0 ];
+        gu[ args[ i ] ] += a[ 1 ];
+        break;
+      case OBJ_CONST:
+        break;
+      case OBJ_OPP:
+        r[ 0 ] = - a[ 1 ];
+        r[ 1 ] = - a[ 0 ];
+        obj_interval_acc( adj_lows, adj_highs, i - 1, r );
+        break;
+      case OBJ_LOG:
+        interval_div( a, y, r );
+        obj_interval_acc( adj_lows, adj_highs, i - 1, r );
+        break;
+      case OBJ_ADD:
+        obj_interval_acc( adj_lows, adj_highs, args[ i ], a );
+        obj_interval_acc( adj_lows, adj_highs, i - 1, a );
+        break;
+      case OBJ_SUB:
+        obj_interval_acc( adj_lows, adj_highs, args[ i ], a );
+        r[ 0 ] = - a[ 1 ];
+        r[ 1 ] = - a[ 0 ];
+        obj_interval_acc( adj_lows, adj_highs, i - 1, r );
+        break;
+      case OBJ_MUL:
+        interval_mul( a, y, r );
+        obj_interval_acc( adj_lows, adj_highs, args[ i ], r );
+        interval_mul( a, x, r );
+        obj_interval_acc( adj_lows, adj_highs, i - 1, r );
+        break;
+      case OBJ_DIV:
+        // d(x/y)/dx = 1/y and d(x/y)/dy = - x/y^2
+        interval_div( a, y, r );
+        obj_interval_acc( adj_lows, adj_highs, args[ i ], r );
+        interval_mul( y, y, t );
+        interval_div( x, t, t );
+        interval_mul( a, t, r );
+        t[ 0 ] = - r[ 1 ];
+        t[ 1 ] = - r[ 0 ];
+        obj_interval_acc( adj_lows, adj_highs, i - 1, t );
+        break;
+      case OBJ_POW:
+        // d(x^y)/dx = y x^(y-1) and d(x^y)/dy = log(x) x^y
+        t[ 0 ] = y[ 0 ] - 1;
+        t[ 1 ] = y[ 1 ] - 1;
+        interval_pow( x, t, t );
+        interval_mul( y, t, t );
+        interval_mul( a, t, r );
+        obj_interval_acc( adj_lows, adj_highs, args[ i ], r );
+        interval_log( x, t );
+        r[ 0 ] = lows[ i ];
+        r[ 1 ] = highs[ i ];
+        interval_mul( t, r, t );
+        interval_mul( a, t, r );
+        obj_interval_acc( adj_lows, adj_highs, i - 1, r );
+        break;
+      default:
+        fprintf( stderr, "obj_interval_backward: Unknown instruction." );
+        error_exit();
+        break;
+    }
+  }
+}
+
+double obj_bound_branch( objective o, int b, double* lo, double* hi,
+                         double* work ) {
+  int len = o->branch_start[ b + 1 ] - o->branch_start[ b ];
+  // the interval of instruction [i] is stored in [lows][i] and [highs][i]
+  double* lows = work;
+  double* highs = work + o->code_len;
+  double bound = - INFINITY;
+  for ( int s = 0; s == 0 || s < o->scenario_num; ++s ) {
+    obj_interval_forward( o, obj_constants( o, s ), b, lo, hi, lows, highs );
+    if ( highs[ len - 1 ] > bound )
+      bound = highs[ len - 1 ];
+  }
+  return bound;
+}
+
+// compares breakpoints by their first coordinate
+int obj_breakpoint_compare( const void* x, const void* y ) {
+  double d = *( ( double* ) x ) - *( ( double* ) y );
+  return ( d > 0 ) - ( d < 0 );
+}
+
+// [obj_bound_branch_hyperplane] with [constants]
+double obj_bound_branch_hyperplane_scenario( objective o, double* constants,
+                                             int b, double* lo, double* hi,
+                                             double* c, double* work ) {
+  int n = o->n;
+  int len = o->branch_start[ b + 1 ] - o->branch_start[ b ];
+  double fc = obj_forward( o, constants, b, c, work + o->branch_start[ b ] );
+  double* lows = work;
+  double* highs = work + o->code_len;
+  double* adj_lows = highs + o->max_len;
+  double* adj_highs = adj_lows + o->max_len;
+  double* gl = adj_highs + o->max_len + o->branch_num;
+  double* gu = gl + n;
+  double* breakpoints = gu + n;
+  obj_interval_forward( o, constants, b, lo, hi, lows, highs );
+  double natural = highs[ len - 1 ];
+  obj_interval_backward( o, b, lows, highs, adj_lows, adj_highs, gl, gu );
+  // by the mean value theorem, f(x) = f(c) + g.(x-c) for some g in [gl,gu],
+  // and since the coordinates of x-c sum to 0, g.(x-c) = (g-l).(x-c) for any
+  // l, so that f(x) - f(c) <= sum_i max( (gu_i-l) dhi_i, (l-gl_i) dlo_i ) with
+  // dlo = c-lo and dhi = hi-c: this is a convex piecewise linear function of l,
+  // whose slope goes from - sum_i dhi_i to sum_i dlo_i, and increases by
+  // dlo_i + dhi_i at l_i = ( gu_i dhi_i + gl_i dlo_i ) / ( dlo_i + dhi_i )
+  double slope = 0, l = 0, bound = 0;
+  int m = 0;
+  for ( int i = 0; i < n; ++i ) {
+    double dlo = c[ i ] - lo[ i ], dhi = hi[ i ] - c[ i ];
+    if ( ! isfinite( gl[ i ] ) || ! isfinite( gu[ i ] ) )
+      return natural;
+    slope -= dhi;
+    if ( dlo + dhi > 0 ) {
+      breakpoints[ 2 * m ] = ( gu[ i ] * dhi + gl[ i ] * dlo ) / ( dlo + dhi );
+      breakpoints[ 2 * m + 1 ] = dlo + dhi;
+      ++m;
+    }
+  }
+  qsort( breakpoints, m, 2 * sizeof( double ), obj_breakpoint_compare );
+  for ( int k = 0; k < m; ++k ) {
+    l = breakpoints[ 2 * k ];
+    slope += breakpoints[ 2 * k + 1 ];
+    if ( slope >= 0 )
+      break;
+  }
+  for ( int i = 0; i < n; ++i ) {
+    double up = ( gu[ i ] - l ) * ( hi[ i ] - c[ i ] );
+    double down = ( l - gl[ i ] ) * ( c[ i ] - lo[ i ] );
+    bound += up > down ? up : down;
+  }
+  bound += fc;
+  return bound < natural ? bound : natural;
+}
+
+double obj_bound_branch_hyperplane( objective o, int b, double* lo, double* hi,
+                                    double* c, double* work ) {
+  double bound = - INFINITY;
+  for ( int s = 0; s == 0 || s < o->scenario_num; ++s ) {
+    double cur = obj_bound_branch_hyperplane_scenario( o, obj_constants( o, s ),
+                                                       b, lo, hi, c, work );
+    if ( cur > bound )
+      bound = cur;
+  }
+  return bound;
+}
+
+double obj_bound_hyperplane( objective o, double* lo, double* hi, double* c,
+                             double* work ) {
+  int num = o->scenario_num;
+  double* maxima = obj_work_robust( o, work ) + num * o->max_len;
+  double bound = - INFINITY;
+  for ( int s = 0; s == 0 || s < num; ++s ) {
+    bound = - INFINITY;
+    for ( int b = 0; b < o->branch_num; ++b ) {
+      double cur = obj_bound_branch_hyperplane_scenario( o,
+                                                         obj_constants( o, s ),
+                                                         b, lo, hi, c, work );
+      if ( cur > bound )
+        bound = cur;
+    }
+    if ( num > 0 )
+      maxima[ s ] = bound;
+  }
+  return num > 0 ? obj_aggregate( o, maxima, NULL ) : bound;
+}
+
+void obj_bound( objective o, double* lo, double* hi, double* bounds,
+                double* work ) {
+  for ( int b = 0; b < o->branch_num; ++b )
+    bounds[ b ] = obj_bound_branch( o, b, lo, hi, work );
+}
+
+double obj_eval_bounded( objective o, double* sigma, double* bounds, int* hint,
+                         double* work ) {
+  if ( o->scenario_num > 0 )
+    return obj_eval_robust( o, sigma, work );
+  int first = hint != NULL ? *hint : 0;
+  double best = obj_eval_branch( o, first, sigma, work );
+  for ( int b = 0; b < o->branch_num; ++b ) {
+    if ( b == first || bounds[ b ] <= best )
+      continue;
+    double cur = obj_eval_branch( o, b, sigma, work );
+    if ( cur > best ) {
+      best = cur;
+      if ( hint != NULL )
+        *hint = b;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,272 @@
+/********************************************************************
+ * objective.h
+ *
+ * Header of objective.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_OBJECTIVE_H__
+#define __CCL_OBJECTIVE_H__
+
+#include "expression.h"
+#include "proof.h"
+
+/*********
+ * Types *
+ *********/
+
+/* Instructions of compiled expressions (one per expression case). */
+enum CASE_OBJ_OP {
+  OBJ_VAR,
+  OBJ_CONST,
+  OBJ_OPP,
+  OBJ_ADD,
+  OBJ_SUB,
+  OBJ_MUL,
+  OBJ_DIV,
+  OBJ_POW,
+  OBJ_LOG
+};
+
+/* Different possible aggregations of the scenarios of robust objectives:
+ * - expected: the average over the scenarios,
+ * - worst: the minimum over the scenarios.
+ */
+enum CASE_OBJ_ROBUST {
+  OBJ_EXPECTED,
+  OBJ_WORST
+};
+
+/* The type structure for objectives, i.e., the positive confidence expressions
+ * of a proof (its "branches", whose maximum is the confidence), compiled to
+ * postfix code:
+ * - [n]: the number of variables (numbered from 0 to [n]-1),
+ * - [branch_num]: the number of branches,
+ * - [branch_start]: an array of size [branch_num]+1, the code of branch [b]
+ *   being between positions [branch_start][b] and [branch_start][b+1],
+ * - [code_len]: the total length of the code,
+ * - [max_len]: the length of the code of the longest branch,
+ * - [ops]: the instructions,
+ * - [args]: their arguments, relative to the start of the branch:
+ *   - for variables, the index of the variable,
+ *   - for constants, the index of the constant in [constants],
+ *   - for unary operators, nothing (the operand is the previous instruction),
+ *   - for binary operators, the position of the first operand (the second one
+ *     is the previous instruction),
+ * - [const_num]: the number of constants,
+ * - [constants]: the constants,
+ * - [branches]: the (uncompiled) expressions of the branches,
+ * - [scenario_num]: the number of scenarios of robust objectives (0 for
+ *   deterministic ones), i.e., of alternative values of the constants, the
+ *   objective being the aggregation of its value in each scenario,
+ * - [scenarios]: the constants of each scenario (constant [c] of scenario [s]
+ *   being at position [s] * [const_num] + [c]),
+ * - [robust]: the aggregation of the scenarios.
+ * Evaluation stores the value of each instruction, so that gradients can be
+ * computed by a single backward pass.
+ */
+typedef struct objective_s {
+  int n;
+  int branch_num;
+  int* branch_start;
+  int code_len;
+  int max_len;
+  int* ops;
+  int* args;
+  int const_num;
+  double* constants;
+  expression* branches;
+  int scenario_num;
+  double* scenarios;
+  enum CASE_OBJ_ROBUST robust;
+} *objective;
+
+/************
+ * Creation *
+ ************/
+
+/* obj_compile: compiles expressions into an objective.
+ * inputs:
+ * - the number [n] of variables,
+ * - the number [branch_num] of expressions,
+ * - the array [branches] of expressions.
+ * output: the objective.
+ */
+objective obj_compile( int n, int branch_num, expression* branches );
+
+/* obj_from_proof: compiles the confidence in a proof as a function of the
+ * resources spent on its hypotheses.
+ * inputs:
+ * - the number [n] of hypotheses,
+ * - the proof [p],
+ * - an array [cfd_res] of expressions describing the confidence reached by
+ *   spending some amount of resources on the hypotheses.
+ * output: the objective.
+ */
+objective obj_from_proof( int n, proof p, expression* cfd_res );
+
+/* obj_set_scenarios: makes an objective robust (before allocating buffers for
+ * its evaluation).
+ * inputs:
+ * - the objective [o],
+ * - the number [num] of scenarios,
+ * - an array [scenarios] of [num] * [o]->const_num constants (see the type
+ *   structure of objectives),
+ * - the aggregation [robust] of the scenarios.
+ * output: nothing.
+ */
+void obj_set_scenarios( objective o, int num, double* scenarios,
+                        enum CASE_OBJ_ROBUST robust );
+
+/* obj_work_new: allocates a buffer for the evaluation of an objective (each
+ * thread evaluating an objective needs its own).
+ * inputs:
+ * - the objective [o].
+ * output: the buffer.
+ */
+double* obj_work_new( objective o );
+
+/**************
+ * Evaluation *
+ **************/
+
+/* Robust objectives are evaluated on all their scenarios at once (instruction
+ * by instruction), and aggregated. Their gradients are the average of the
+ * gradients of the scenarios (expected confidence) or the gradient of the worst
+ * scenario (worst-case confidence), their branches the aggregations of the
+ * branches, and their bounds the maxima of the bounds of the scenarios.
+ * Evaluations stopping early or skipping branches evaluate them fully.
+ */
+
+/* obj_eval_branch: evaluates a branch of an objective.
+ * inputs:
+ * - the objective [o],
+ * - the index [b] of the branch,
+ * - an array [sigma] of doubles that associates a value to each variable,
+ * - a buffer [work] (see [obj_work_new]).
+ * output: the value of the branch.
+ */
+double obj_eval_branch( objective o, int b, double* sigma, double* work );
+
+/* obj_eval: evaluates an objective, i.e., the maximum of its branches.
+ * inputs:
+ * - the objective [o],
+ * - an array [sigma] of doubles that associates a value to each variable,
+ * - a buffer [work] (see [obj_work_new]).
+ * output: the value of the objective.
+ */
+double obj_eval( objective o, double* sigma, double* work );
+
+/* obj_eval_above: tests whether an objective is above some threshold, stopping
+ * at the first branch above it.
+ * inputs:
+ * - the objective [o],
+ * - an array [sigma] of doubles that associates a value to each variable,
+ * - the [threshold],
+ * - a pointer [hint] to the index of the branch to evaluate first, updated to
+ *   the branch above the threshold if there is one (or NULL),
+ * - a buffer [work] (see [obj_work_new]).
+ * output: the value of a branch above [threshold] if there is one, the value
+ * of the objective otherwise.
+ */
+double obj_eval_above( objective o, double* sigma, double threshold, int* hint,
+                       double* work );
+
+/* obj_eval_smooth: evaluates the log-sum-exp smoothing of an objective,
+ *   temp * log( sum_b exp( branch_b / temp ) ),
+ * and its gradient in a single forward and backward pass. The smoothing is
+ * above the maximum of the branches by at most temp * log( branch_num ), and
+ * its gradient is the average of the gradients of the branches weighted by
+ * their softmax.
+ * inputs:
+ * - the objective [o],
+ * - the temperature [temp] (0 means no smoothing, i.e., the maximum and the
+ *   gradient of a maximal branch),
+ * - an array [sigma] of doubles that associates a value to each variable,
+ * - an array [grad] of size [o]->n to store the gradient (or NULL if it is not
+ *   needed),
+ * - a pointer [max] to store the maximum of the branches (or NULL),
+ * - a buffer [work] (see [obj_work_new]).
+ * output: the value of the smoothed objective.
+ */
+double obj_eval_smooth( objective o, double temp, double* sigma, double* grad,
+                        double* max, double* work );
+
+/**********
+ * Bounds *
+ **********/
+
+/* obj_bound_branch: computes an upper bound of a branch of an objective over a
+ * box, by interval arithmetic.
+ * inputs:
+ * - the objective [o],
+ * - the index [b] of the branch,
+ * - arrays [lo] and [hi] of doubles representing the bounds of the box,
+ * - a buffer [work] (see [obj_work_new]).
+ * output: the upper bound (possibly infinite).
+ */
+double obj_bound_branch( objective o, int b, double* lo, double* hi,
+                         double* work );
+
+/* obj_bound_branch_hyperplane: computes an upper bound of a branch of an
+ * objective over the intersection of a box with a hyperplane of normal
+ * (1,...,1), i.e., on which coordinates sum to a constant. It is the minimum of
+ * the bound of [obj_bound_branch] and of a mean value bound using intervals of
+ * the gradient over the box, which gets much tighter on small boxes.
+ * inputs:
+ * - the objective [o],
+ * - the index [b] of the branch,
+ * - arrays [lo] and [hi] of doubles representing the bounds of the box,
+ * - an array [c] of doubles representing a point of the intersection,
+ * - a buffer [work] (see [obj_work_new]).
+ * output: the upper bound (possibly infinite).
+ */
+double obj_bound_branch_hyperplane( objective o, int b, double* lo, double* hi,
+                                    double* c, double* work );
+
+/* obj_bound_hyperplane: computes an upper bound of an objective over the
+ * intersection of a box with a hyperplane of normal (1,...,1), i.e., the
+ * maximum of the bounds of [obj_bound_branch_hyperplane] over the branches
+ * (aggregated over the scenarios for robust objectives, which is tighter than
+ * the maximum of the bounds of their branches).
+ * inputs:
+ * - the objective [o],
+ * - arrays [lo] and [hi] of doubles representing the bounds of the box,
+ * - an array [c] of doubles representing a point of the intersection,
+ * - a buffer [work] (see [obj_work_new]).
+ * output: the upper bound (possibly infinite).
+ */
+double obj_bound_hyperplane( objective o, double* lo, double* hi, double* c,
+                             double* work );
+
+/* obj_bound: computes upper bounds of all the branches of an objective over a
+ * box (see [obj_bound_branch]).
+ * inputs:
+ * - the objective [o],
+ * - arrays [lo] and [hi] of doubles representing the bounds of the box,
+ * - an array [bounds] of size [o]->branch_num to store the bounds,
+ * - a buffer [work] (see [obj_work_new]).
+ * output: nothing (stored in [bounds]).
+ */
+void obj_bound( objective o, double* lo, double* hi, double* bounds,
+                double* work );
+
+/* obj_eval_bounded: evaluates an objective at a point of a box, skipping the
+ * branches whose upper bound over the box cannot beat the best branch found so
+ * far.
+ * inputs:
+ * - the objective [o],
+ * - an array [sigma] of doubles that associates a value to each variable,
+ *   which should be in the box,
+ * - an array [bounds] of upper bounds of the branches over the box (see
+ *   [obj_bound]),
+ * - a pointer [hint] to the index of the branch to evaluate first, updated to
+ *   the maximal branch (or NULL),
+ * - a buffer [work] (see [obj_work_new]).
+ * output: the value of the objective.
+ */
+double obj_eval_bounded( objective o, double* sigma, double* bounds, int* hint,
+                         double* work );
+
+#endif // __CCL_OBJECTIVE_H__
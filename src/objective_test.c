@@ -0,0 +1,283 @@
+/********************************************************************
+ * objective_test.c
+ *
+ * Defines a battery of tests for objectives.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#include <stdio.h>
+#include <math.h>
+#include <gc.h>
+#include "utils.h"
+#include "expression.h"
+#include "objective.h"
+#include "objective_test.h"
+
+// one expression per expression type (the same as in expression_test_eval)
+expression* objective_test_expressions() {
+  expression* exps = GC_MALLOC( EXP_CASES * sizeof( expression ) );
+  exps[ 0 ] = exp_var( 0, "a" );
+  exps[ 1 ] = exp_const( 1.57 );
+  exps[ 2 ] = exp_opp( exps[ 0 ] );
+  exps[ 3 ] = exp_add( exp_var( 1, "b" ), exps[ 2 ] );
+  exps[ 4 ] = exp_sub( exp_var( 2, "c" ), exps[ 3 ] );
+  exps[ 5 ] = exp_mul( exps[ 3 ], exps[ 4 ] );
+  exps[ 6 ] = exp_div( exps[ 4 ], exps[ 5 ] );
+  exps[ 7 ] = exp_pow( exps[ 5 ], exps[ 6 ] );
+  exps[ 8 ] = exp_log( exps[ 5 ] );
+  return exps;
+}
+
+void objective_test_result( int* res, bool passed, int i, int total ) {
+  printf( "Test %d/%d: ", i, total );
+  if ( passed ) {
+    ++( *res );
+    printf_green();
+    printf( "passed.\n" );
+  } else {
+    printf_bold_red();
+    printf( "FAILED!\n" );
+  }
+  printf_reset();
+}
+
+void objective_test_summary( int res, int total ) {
+  printf( "==========================\n" );
+  printf( "Passed tests: " );
+  if ( res == total )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", res, total );
+  printf_reset();
+  printf( ".\n" );
+  printf( "==========================\n" );
+}
+
+int objective_test_eval() {
+  double sigma[ 2 ][ 3 ] = { { 0, 1, 2.7 }, { 1.9, -1, -3.3 } };
+  int res = 0;
+  int total = OBJ_TEST_EVAL_BATTERIES_NUMBER * EXP_CASES;
+  expression* exps = objective_test_expressions();
+  printf( "Strating obj_eval tests.\n" );
+  printf( "==========================\n" );
+  for ( int i = 0; i < EXP_CASES; ++i ) {
+    objective o = obj_compile( 3, 1, exps + i );
+    double* work = obj_work_new( o );
+    for ( int j = 0; j < 2; ++j )
+      objective_test_result( &res,
+                             dcompare( obj_eval( o, sigma[ j ], work ),
+                                       exp_eval( exps[ i ], sigma[ j ] ),
+                                       10 ) == 0,
+                             2 * i + j + 1, total );
+  }
+  objective_test_summary( res, total );
+  return res;
+}
+
+int objective_test_gradient() {
+  double sigma[ 3 ] = { 0, 1, 2.7 };
+  double grad[ 3 ];
+  int vars[ 2 ] = { 0, 2 };
+  int res = 0;
+  int total = OBJ_TEST_GRADIENT_BATTERIES_NUMBER * EXP_CASES;
+  expression* exps = objective_test_expressions();
+  printf( "Strating obj_eval_smooth gradient tests.\n" );
+  printf( "==========================\n" );
+  for ( int i = 0; i < EXP_CASES; ++i ) {
+    objective o = obj_compile( 3, 1, exps + i );
+    double* work = obj_work_new( o );
+    obj_eval_smooth( o, 0, sigma, grad, NULL, work );
+    for ( int j = 0; j < 2; ++j ) {
+      double expected =
+        exp_eval( exp_derivative( exps[ i ], vars[ j ] ), sigma );
+      objective_test_result( &res,
+                             dcompare( grad[ vars[ j ] ], expected, 10 ) == 0,
+                             2 * i + j + 1, total );
+    }
+  }
+  objective_test_summary( res, total );
+  return res;
+}
+
+int objective_test_smooth() {
+  double sigma[ 3 ] = { 0, 1, 2.7 };
+  double temp = 0.1;
+  int res = 0;
+  int total = OBJ_TEST_SMOOTH_BATTERIES_NUMBER * EXP_CASES;
+  expression* exps = objective_test_expressions();
+  printf( "Strating obj_eval_smooth tests.\n" );
+  printf( "==========================\n" );
+  for ( int i = 0; i < EXP_CASES; ++i ) {
+    expression* branches = GC_MALLOC( 2 * sizeof( expression ) );
+    branches[ 0 ] = exps[ i ];
+    branches[ 1 ] = exp_const( 0.5 );
+    objective o = obj_compile( 3, 2, branches );
+    double* work = obj_work_new( o );
+    double max;
+    double smooth = obj_eval_smooth( o, temp, sigma, NULL, &max, work );
+    objective_test_result( &res,
+                           dcompare( max, obj_eval( o, sigma, work ),
+                                     10 ) == 0 &&
+                           smooth >= max &&
+                           smooth <= max + temp * log( 2 ),
+                           i + 1, total );
+  }
+  objective_test_summary( res, total );
+  return res;
+}
+
+int objective_test_above() {
+  double sigma[ 3 ] = { 0, 1, 2.7 };
+  int res = 0;
+  int total = OBJ_TEST_ABOVE_BATTERIES_NUMBER * EXP_CASES;
+  expression* exps = objective_test_expressions();
+  printf( "Strating obj_eval_above tests.\n" );
+  printf( "==========================\n" );
+  for ( int i = 0; i < EXP_CASES; ++i ) {
+    expression* branches = GC_MALLOC( 2 * sizeof( expression ) );
+    branches[ 0 ] = exp_const( 0.5 );
+    branches[ 1 ] = exps[ i ];
+    objective o = obj_compile( 3, 2, branches );
+    double* work = obj_work_new( o );
+    double max = obj_eval( o, sigma, work );
+    int hint = 0;
+    // nothing above the maximum: the maximum is returned
+    objective_test_result( &res,
+                           dcompare( obj_eval_above( o, sigma, max, &hint,
+                                                     work ),
+                                     max, 10 ) == 0,
+                           2 * i + 1, total );
+    // something above a lower threshold: some branch above it is returned
+    double cur = obj_eval_above( o, sigma, max - 1, &hint, work );
+    objective_test_result( &res,
+                           cur > max - 1 &&
+                           dcompare( cur, obj_eval_branch( o, hint, sigma,
+                                                           work ),
+                                     10 ) == 0,
+                           2 * i + 2, total );
+  }
+  objective_test_summary( res, total );
+  return res;
+}
+
+int objective_test_bound() {
+  double sigma[ 3 ] = { 0, 1, 2.7 };
+  double lo[ 3 ], hi[ 3 ], corner[ 3 ], bounds[ 2 ];
+  int res = 0;
+  int total = OBJ_TEST_BOUND_BATTERIES_NUMBER * EXP_CASES;
+  expression* exps = objective_test_expressions();
+  for ( int j = 0; j < 3; ++j ) {
+    lo[ j ] = sigma[ j ] - 0.1;
+    hi[ j ] = sigma[ j ] + 0.1;
+  }
+  printf( "Strating obj_bound tests.\n" );
+  printf( "==========================\n" );
+  for ( int i = 0; i < EXP_CASES; ++i ) {
+    expression* branches = GC_MALLOC( 2 * sizeof( expression ) );
+    branches[ 0 ] = exp_const( 0.5 );
+    branches[ 1 ] = exps[ i ];
+    objective o = obj_compile( 3, 2, branches );
+    double* work = obj_work_new( o );
+    // the bound holds at the centre and at the corners of the box
+    double bound = obj_bound_branch( o, 1, lo, hi, work );
+    bool passed = bound >= obj_eval_branch( o, 1, sigma, work );
+    for ( int c = 0; c < 8; ++c ) {
+      for ( int j = 0; j < 3; ++j )
+        corner[ j ] = ( c >> j ) % 2 ? hi[ j ] : lo[ j ];
+      passed = passed && bound >= obj_eval_branch( o, 1, corner, work );
+    }
+    objective_test_result( &res, passed, 2 * i + 1, total );
+    // skipping branches does not change the maximum
+    int hint = 0;
+    obj_bound( o, lo, hi, bounds, work );
+    objective_test_result( &res,
+                           dcompare( obj_eval_bounded( o, sigma, bounds, &hint,
+                                                       work ),
+                                     obj_eval( o, sigma, work ), 10 ) == 0,
+                           2 * i + 2, total );
+  }
+  objective_test_summary( res, total );
+  return res;
+}
+
+// the branches of the objective of [objective_test_robust] for expression [e]
+// shifted by [c]
+expression* objective_test_robust_branches( expression e, double c ) {
+  expression* branches = GC_MALLOC( 2 * sizeof( expression ) );
+  branches[ 0 ] = exp_const( 0.5 );
+  branches[ 1 ] = exp_add( e, exp_const( c ) );
+  return branches;
+}
+
+int objective_test_robust() {
+  double sigma[ 3 ] = { 0, 1, 2.7 };
+  int num = 4;
+  double vals[ 4 ];
+  int res = 0;
+  int total = OBJ_TEST_ROBUST_BATTERIES_NUMBER * EXP_CASES;
+  expression* exps = objective_test_expressions();
+  printf( "Strating obj_set_scenarios tests.\n" );
+  printf( "==========================\n" );
+  for ( int i = 0; i < EXP_CASES; ++i ) {
+    // scenario [s] shifts the second branch by s / 4
+    objective o = obj_compile( 3, 2, objective_test_robust_branches( exps[ i ],
+                                                                     0 ) );
+    double* scenarios = GC_MALLOC_ATOMIC( num * o->const_num *
+                                          sizeof( double ) );
+    for ( int s = 0; s < num; ++s ) {
+      objective os =
+        obj_compile( 3, 2, objective_test_robust_branches( exps[ i ],
+                                                           s / 4.0 ) );
+      vals[ s ] = obj_eval( os, sigma, obj_work_new( os ) );
+      for ( int c = 0; c < o->const_num; ++c )
+        scenarios[ s * o->const_num + c ] = os->constants[ c ];
+    }
+    double expected = 0, worst = vals[ 0 ];
+    for ( int s = 0; s < num; ++s ) {
+      expected += vals[ s ] / num;
+      worst = fmin( worst, vals[ s ] );
+    }
+    // the expected and worst-case confidences aggregate the scenarios
+    obj_set_scenarios( o, num, scenarios, OBJ_EXPECTED );
+    double value = obj_eval( o, sigma, obj_work_new( o ) );
+    objective_test_result( &res,
+                           ( isnan( value ) && isnan( expected ) ) ||
+                           dcompare( value, expected, 10 ) == 0,
+                           2 * i + 1, total );
+    o->robust = OBJ_WORST;
+    value = obj_eval( o, sigma, obj_work_new( o ) );
+    objective_test_result( &res,
+                           ( isnan( value ) && isnan( worst ) ) ||
+                           dcompare( value, worst, 10 ) == 0,
+                           2 * i + 2, total );
+  }
+  objective_test_summary( res, total );
+  return res;
+}
+
+void objective_test() {
+  int batteries = OBJ_TEST_EVAL_BATTERIES_NUMBER +
+                  OBJ_TEST_GRADIENT_BATTERIES_NUMBER +
+                  OBJ_TEST_SMOOTH_BATTERIES_NUMBER +
+                  OBJ_TEST_ABOVE_BATTERIES_NUMBER +
+                  OBJ_TEST_BOUND_BATTERIES_NUMBER +
+                  OBJ_TEST_ROBUST_BATTERIES_NUMBER;
+  int n = objective_test_eval();
+  n += objective_test_gradient();
+  n += objective_test_smooth();
+  n += objective_test_above();
+  n += objective_test_bound();
+  n += objective_test_robust();
+  printf( "===================\n" );
+  printf( "Total tests passed: " );
+  if ( n == batteries * EXP_CASES )
+    printf_bold_green();
+  else
+    printf_bold_red();
+  printf( "%d/%d", n, batteries * EXP_CASES );
+  printf_reset();
+  printf( ".\n" );
+  printf( "===================\n" );
+}
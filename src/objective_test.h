@@ -0,0 +1,75 @@
+/********************************************************************
+ * objective_test.h
+ *
+ * Header of objective_test.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_OBJECTIVE_TEST_H__
+#define __CCL_OBJECTIVE_TEST_H__
+
+/* objective_test_eval: runs a series of tests to check whether obj_eval
+ * returns the same result as exp_eval.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define OBJ_TEST_EVAL_BATTERIES_NUMBER 2
+// int objective_test_eval();
+
+/* objective_test_gradient: runs a series of tests to check whether the
+ * gradient computed by obj_eval_smooth matches exp_derivative.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define OBJ_TEST_GRADIENT_BATTERIES_NUMBER 2
+// int objective_test_gradient();
+
+/* objective_test_smooth: runs a series of tests to check whether
+ * obj_eval_smooth stays within its bounds around the maximum.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define OBJ_TEST_SMOOTH_BATTERIES_NUMBER 1
+// int objective_test_smooth();
+
+/* objective_test_above: runs a series of tests to check whether
+ * obj_eval_above agrees with obj_eval.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define OBJ_TEST_ABOVE_BATTERIES_NUMBER 2
+// int objective_test_above();
+
+/* objective_test_bound: runs a series of tests to check whether the bounds
+ * computed by obj_bound_branch hold and whether obj_eval_bounded agrees with
+ * obj_eval.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define OBJ_TEST_BOUND_BATTERIES_NUMBER 2
+// int objective_test_bound();
+
+/* objective_test_robust: runs a series of tests to check whether robust
+ * objectives aggregate the objectives of their scenarios.
+ * inputs: none.
+ * output: number of passed tests.
+ * side effect: prints the series of tests.
+ */
+#define OBJ_TEST_ROBUST_BATTERIES_NUMBER 2
+// int objective_test_robust();
+
+/* objective_test: runs a series of tests to check whether functions on
+ * objectives return the desired results.
+ * inputs: none.
+ * output: none.
+ * side effect: prints the series of tests.
+ */
+void objective_test();
+
+#endif // __CCL_OBJECTIVE_TEST_H__
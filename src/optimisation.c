@@ -7,48 +7,129 @@
  ********************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
 #include <float.h>
 #include <math.h>
 #include <gc.h>
+#include <pthread.h>
 #include "utils.h"
 #include "expression.h"
 #include "formula.h"
 #include "sequent.h"
 #include "proof.h"
+#include "objective.h"
+#include "parallel.h"
 #include "optimisation.h"
+#include "pareto.h"
+#include "trace.h"
+#include "robust.h"
 #include <stdio.h>
 
 /*
- * Algorithms
+ * Creation
  */
 
-// sa_params_from_hyperparams_simple
+gradient_ascent_params ga_params_new() {
+  gradient_ascent_params res =
+    GC_MALLOC( sizeof( struct gradient_ascent_params_s ) );
+  res->step_coef = 0;
+  res->step_rule = GA_STEP_ARMIJO;
+  res->max_iters = 1000;
+  res->armijo = 1e-4;
+  res->backtrack = 0.5;
+  res->beta1 = 0.9;
+  res->beta2 = 0.999;
+  res->stop_error = 1e-12;
+  res->patience = 10;
+  res->smoothing = 0;
+  res->smoothing_decay = 0.1;
+  res->smoothing_min = 1e-6;
+  return res;
+}
+
+hill_climbing_params hc_params_new() {
+  hill_climbing_params res =
+    GC_MALLOC( sizeof( struct hill_climbing_params_s ) );
+  res->step_size = 0;
+  res->iters = 100;
+  res->strategy = HC_ADAPTIVE;
+  res->adapt = 1.5;
+  return res;
+}
+
+branch_bound_params bb_params_new() {
+  branch_bound_params res = GC_MALLOC( sizeof( struct branch_bound_params_s ) );
+  res->max_nodes = 100000;
+  res->gap = 1e-6;
+  res->threads = 0;
+  return res;
+}
+
+cma_es_params cma_params_new() {
+  cma_es_params res = GC_MALLOC( sizeof( struct cma_es_params_s ) );
+  res->max_evals = 10000;
+  res->step = 0;
+  res->population = 0;
+  res->stop_error = 1e-12;
+  res->threads = 1;
+  return res;
+}
 
-simulated_annealing_params sa_params_from_hyperparams_simple;
+discrete_params discrete_params_new() {
+  discrete_params res = GC_MALLOC( sizeof( struct discrete_params_s ) );
+  res->unit = 1;
+  res->max_moves = 1000;
+  return res;
+}
+
+nsga_params nsga_params_new() {
+  nsga_params res = GC_MALLOC( sizeof( struct nsga_params_s ) );
+  res->population = 100;
+  res->generations = 200;
+  res->mutation = 0.5;
+  res->threads = 1;
+  return res;
+}
+
+surrogate_params surrogate_params_new() {
+  surrogate_params res = GC_MALLOC( sizeof( struct surrogate_params_s ) );
+  res->model = SURROGATE_RBF;
+  res->max_evals = 200;
+  res->samples = 0;
+  res->candidates = 1000;
+  res->step = 0;
+  res->stop_error = 1e-6;
+  return res;
+}
+
+module_params module_params_new() {
+  module_params res = GC_MALLOC( sizeof( struct module_params_s ) );
+  res->steps = 16;
+  res->refine = 2;
+  res->threads = 0;
+  return res;
+}
 
-double sa_params_from_hyperparams_simple_t_max;
-double sa_params_from_hyperparams_simple_ratio0;
-double sa_params_from_hyperparams_simple_delta_factor;
-double* sa_params_from_hyperparams_simple_starting_point;
+// sa_params_simple
 
-double* sa_params_from_hyperparams_simple_init
-  ( int n, double* sigma, double all ) {
+double* sa_params_simple_init( int n, double* sigma, double all ) {
   double* init = GC_MALLOC( n * sizeof( double ) );
   for ( int i = 0; i < n; ++i )
     init[ i ] = sigma[ i ] + all / n;
   return init;
 }
 
-double sa_params_from_hyperparams_simple_temp ( int k ) {
-  return log( 2 ) * sa_params_from_hyperparams_simple_t_max / log( k + 1 );
+double sa_params_simple_temp( simulated_annealing_params params, int k ) {
+  return log( 2 ) * params->t_max / log( k + 1 );
 }
 
-double sa_params_from_hyperparams_simple_energy ( double cfd ) {
+double sa_params_simple_energy( double cfd ) {
   return - cfd;
 }
 
-double sa_params_from_hyperparams_simple_prob
-  ( double energy_old, double energy_new, double temp ) {
+double sa_params_simple_prob( double energy_old, double energy_new,
+                              double temp ) {
   if ( energy_new <= energy_old )
     return 1;
   return exp( ( energy_old - energy_new ) / temp );
@@ -57,114 +138,497 @@ double sa_params_from_hyperparams_simple_prob
 // we take a Gaussian in an orthonormal basis B of H_0 and add it to the current
 // point.
 // H_0 = { (x_1,...,x_n) | sum x_i = 0 }
-// B = (v_0,...,v_{n-1}), with (v_i)_j =
-// - 1 / sqrt((i+1) + (i+1)^2) if j < i+1,
-// - - (i+1) / sqrt((i+1) + (i+1)^2) if j = i+1,
-// - 0 if j > i+1.
-double* sa_params_from_hyperparams_simple_neighbour ( int n, double* point ) {
+// B = (v_0,...,v_{n-2}) (see [hyperplane_from_basis])
+double* sa_params_simple_neighbour( simulated_annealing_params params, int n,
+                                    double* sigma, double* point ) {
   bool reject = true;
   double x, y;
-  double* coefs = GC_MALLOC( ( n - 1 ) * sizeof( double ) );
+  // the normals are drawn by pairs, hence one more coefficient (unused when
+  // n - 1 is odd)
+  double* coefs = GC_MALLOC_ATOMIC( n * sizeof( double ) );
   double* new = GC_MALLOC( n * sizeof( double ) );
 
-  double* lambdas = GC_MALLOC( ( n - 2 ) * sizeof( double ) );
-  for ( int i = 0; i < n - 1; ++i )
-    lambdas[ i ] = 1 / sqrt( ( i + 1 ) + ( i + 1 ) * ( i + 1 ) );
-
   while ( reject ) {
     for ( int i = 0; i < n; ++i ) {
       new[ i ] = point[ i ];
     }
-    for ( int i = 0; i < ( n - 1 ) / 2; ++i ) {
-      x = ( double ) rand() / RAND_MAX;
-      y = ( double ) rand() / RAND_MAX;
-      box_muller( x, y, coefs + ( 2 * i ) );
-    }
-    if ( n % 2 == 0 ) {
-      x = ( double ) rand() / RAND_MAX;
-      y = ( double ) rand() / RAND_MAX;
-      box_muller( x, y, coefs + n - 3 ); // overwrites the penultimate value,
-                                         // but who cares?
-    }
-    for ( int i = 0; i < n - 1; ++i ) {
-      for ( int j = 0; j < i + 1; ++j ) {
-        new[ j ] +=
-          sa_params_from_hyperparams_simple_delta_factor *
-          lambdas[ i ] * coefs[ i ];
-      }
-      new[ i + 1 ] -=
-        sa_params_from_hyperparams_simple_delta_factor *
-        ( i + 1 ) * lambdas[ i ] * coefs[ i ];
+    for ( int i = 0; i < n - 1; i += 2 ) {
+      x = ( double ) rng_rand() / RAND_MAX;
+      y = ( double ) rng_rand() / RAND_MAX;
+      box_muller( x, y, coefs + i );
     }
+    for ( int i = 0; i < n - 1; ++i )
+      coefs[ i ] *= params->step;
+    hyperplane_from_basis( n, coefs, new );
     reject = false;
     for ( int i = 0; i < n; ++i )
-      if ( new[ i ] < sa_params_from_hyperparams_simple_starting_point[ i ] ) {
+      if ( new[ i ] < sigma[ i ] ) {
         reject = true;
       }
   }
   return new;
 }
 
-void sa_params_from_hyperparams_simple_set( int max_step, double p_init, int k0,
-                                            int n, double* sigma ) {
-  sa_params_from_hyperparams_simple_delta_factor = sqrt( M_PI / max_step );
-  sa_params_from_hyperparams_simple_ratio0 = k0 / max_step;
-  sa_params_from_hyperparams_simple_t_max = - 1 / log( 1 - p_init );
-  sa_params_from_hyperparams_simple_starting_point =
-    GC_MALLOC( n * sizeof( double ) );
-  for ( int i = 0; i < n; ++i )
-    sa_params_from_hyperparams_simple_starting_point[ i ] = sigma[ i ];
-  sa_params_from_hyperparams_simple =
+simulated_annealing_params sa_params_simple( int max_step, double p_init,
+                                             int k0 ) {
+  simulated_annealing_params res =
     GC_MALLOC( sizeof( struct simulated_annealing_params_s ) );
-  sa_params_from_hyperparams_simple->max_step = max_step;
-  sa_params_from_hyperparams_simple->init =
-    sa_params_from_hyperparams_simple_init;
-  sa_params_from_hyperparams_simple->temp =
-    sa_params_from_hyperparams_simple_temp;
-  sa_params_from_hyperparams_simple->energy =
-    sa_params_from_hyperparams_simple_energy;
-  sa_params_from_hyperparams_simple->prob =
-    sa_params_from_hyperparams_simple_prob;
-  sa_params_from_hyperparams_simple->neighbour =
-    sa_params_from_hyperparams_simple_neighbour;
-}
-
-void sa_params_from_hyperparams_simple_set_with_lambda(
+  res->max_step = max_step;
+  res->k0 = k0;
+  res->t_max = - 1 / log( 1 - p_init );
+  res->step = sqrt( M_PI / max_step );
+  res->schedule = SA_SCHEDULE_LOG;
+  res->reheat = 0;
+  res->calibrate = 0;
+  res->accept = 0.8;
+  res->function_constant = 0;
+  res->init = sa_params_simple_init;
+  res->temp = sa_params_simple_temp;
+  res->energy = sa_params_simple_energy;
+  res->prob = sa_params_simple_prob;
+  res->neighbour = sa_params_simple_neighbour;
+  return res;
+}
+
+simulated_annealing_params sa_params_simple_with_lambda(
   int max_step, double p_init, int k0, int n, double* sigma, double lambda,
   double function_constant ) {
-  sa_params_from_hyperparams_simple_delta_factor =
-    lambda * sqrt( M_PI / max_step );
-  sa_params_from_hyperparams_simple_ratio0 = k0 / max_step;
-  sa_params_from_hyperparams_simple_starting_point =
-    GC_MALLOC( n * sizeof( double ) );
-  for ( int i = 0; i < n; ++i )
-    sa_params_from_hyperparams_simple_starting_point[ i ] = sigma[ i ];
-  sa_params_from_hyperparams_simple_t_max = 0;
+  simulated_annealing_params res = sa_params_simple( max_step, p_init, k0 );
+  res->step = lambda * sqrt( M_PI / max_step );
+  res->t_max = log( function_constant ) * res->step / log( p_init );
+  // without a point, the sum is computed by each optimisation
+  if ( sigma == NULL ) {
+    res->function_constant = function_constant;
+    return res;
+  }
+  double sum = 0;
   for ( int i = 0; i < n; ++i )
-    sa_params_from_hyperparams_simple_t_max +=
-      pow( function_constant,
-           sa_params_from_hyperparams_simple_starting_point[ i ] + 1 );
-  sa_params_from_hyperparams_simple_t_max *=
-    log( function_constant ) * sa_params_from_hyperparams_simple_delta_factor /
-    log( p_init );
-  sa_params_from_hyperparams_simple =
-    GC_MALLOC( sizeof( struct simulated_annealing_params_s ) );
-  sa_params_from_hyperparams_simple->max_step = max_step;
-  sa_params_from_hyperparams_simple->init =
-    sa_params_from_hyperparams_simple_init;
-  sa_params_from_hyperparams_simple->temp =
-    sa_params_from_hyperparams_simple_temp;
-  sa_params_from_hyperparams_simple->energy =
-    sa_params_from_hyperparams_simple_energy;
-  sa_params_from_hyperparams_simple->prob =
-    sa_params_from_hyperparams_simple_prob;
-  sa_params_from_hyperparams_simple->neighbour =
-    sa_params_from_hyperparams_simple_neighbour;
+    sum += pow( function_constant, sigma[ i ] + 1 );
+  res->t_max = sum * res->t_max;
+  return res;
+}
+
+/*
+ * cJSON_get_double: reads an optional number in a JSON object.
+ * inputs:
+ * - the JSON object [json] (possibly NULL),
+ * - the [key] of the number,
+ * - the value [def] to return if there is no such number.
+ * output: the number.
+ */
+double cJSON_get_double( cJSON* json, char* key, double def ) {
+  cJSON* item = cJSON_GetObjectItemCaseSensitive( json, key );
+  if ( item == NULL )
+    return def;
+  if ( ! cJSON_IsNumber( item ) ) {
+    fprintf( stderr, "cJSON_get_double: \"%s\" is not a number.\n", key );
+    error_exit();
+  }
+  return item->valuedouble;
+}
+
+/*
+ * cJSON_get_int: reads an optional integer in a JSON object (see
+ * [cJSON_get_double]).
+ */
+int cJSON_get_int( cJSON* json, char* key, int def ) {
+  cJSON* item = cJSON_GetObjectItemCaseSensitive( json, key );
+  if ( item == NULL )
+    return def;
+  if ( ! cJSON_IsNumber( item ) ) {
+    fprintf( stderr, "cJSON_get_int: \"%s\" is not a number.\n", key );
+    error_exit();
+  }
+  return item->valueint;
+}
+
+/*
+ * cJSON_to_ga_params: reads gradient ascent parameters from a (possibly NULL)
+ * JSON object, using default values for missing fields.
+ */
+gradient_ascent_params cJSON_to_ga_params( cJSON* json ) {
+  gradient_ascent_params res = ga_params_new();
+  res->step_coef = cJSON_get_double( json, "step_coef", res->step_coef );
+  res->max_iters = cJSON_get_int( json, "max_iters", res->max_iters );
+  res->armijo = cJSON_get_double( json, "armijo", res->armijo );
+  res->backtrack = cJSON_get_double( json, "backtrack", res->backtrack );
+  res->beta1 = cJSON_get_double( json, "beta1", res->beta1 );
+  res->beta2 = cJSON_get_double( json, "beta2", res->beta2 );
+  res->stop_error = cJSON_get_double( json, "stop_error", res->stop_error );
+  res->patience = cJSON_get_int( json, "patience", res->patience );
+  res->smoothing = cJSON_get_double( json, "smoothing", res->smoothing );
+  res->smoothing_decay = cJSON_get_double( json, "smoothing_decay",
+                                           res->smoothing_decay );
+  res->smoothing_min = cJSON_get_double( json, "smoothing_min",
+                                         res->smoothing_min );
+  cJSON* rule = cJSON_GetObjectItemCaseSensitive( json, "step_rule" );
+  if ( rule != NULL ) {
+    if ( cJSON_IsString( rule ) && strcmp( rule->valuestring, "armijo" ) == 0 )
+      res->step_rule = GA_STEP_ARMIJO;
+    else if ( cJSON_IsString( rule ) &&
+              strcmp( rule->valuestring, "adam" ) == 0 )
+      res->step_rule = GA_STEP_ADAM;
+    else {
+      fprintf( stderr, "Unknown gradient ascent step rule.\n" );
+      error_exit();
+    }
+  }
+  if ( res->backtrack <= 0 || res->backtrack >= 1 ) {
+    fprintf( stderr, "Gradient ascent \"backtrack\" should be in (0,1).\n" );
+    error_exit();
+  }
+  if ( res->smoothing_decay <= 0 || res->smoothing_decay >= 1 ) {
+    fprintf( stderr, "Gradient ascent \"smoothing_decay\" should be in "
+             "(0,1).\n" );
+    error_exit();
+  }
+  return res;
+}
+
+/*
+ * cJSON_to_hc_params: reads hill climbing parameters from a (possibly NULL)
+ * JSON object, using default values for missing fields.
+ */
+hill_climbing_params cJSON_to_hc_params( cJSON* json ) {
+  hill_climbing_params res = hc_params_new();
+  res->step_size = cJSON_get_double( json, "step_size", res->step_size );
+  res->iters = cJSON_get_int( json, "iters", res->iters );
+  res->adapt = cJSON_get_double( json, "adapt", res->adapt );
+  cJSON* strategy = cJSON_GetObjectItemCaseSensitive( json, "strategy" );
+  if ( strategy != NULL ) {
+    if ( cJSON_IsString( strategy ) &&
+         strcmp( strategy->valuestring, "random" ) == 0 )
+      res->strategy = HC_RANDOM;
+    else if ( cJSON_IsString( strategy ) &&
+              strcmp( strategy->valuestring, "adaptive" ) == 0 )
+      res->strategy = HC_ADAPTIVE;
+    else if ( cJSON_IsString( strategy ) &&
+              strcmp( strategy->valuestring, "pair" ) == 0 )
+      res->strategy = HC_PAIR;
+    else {
+      fprintf( stderr, "Unknown hill climbing strategy.\n" );
+      error_exit();
+    }
+  }
+  if ( res->adapt <= 1 ) {
+    fprintf( stderr, "Hill climbing \"adapt\" should be above 1.\n" );
+    error_exit();
+  }
+  return res;
+}
+
+/*
+ * cJSON_to_bb_params: reads branch and bound parameters from a (possibly NULL)
+ * JSON object, using default values for missing fields.
+ */
+branch_bound_params cJSON_to_bb_params( cJSON* json ) {
+  branch_bound_params res = bb_params_new();
+  res->max_nodes = cJSON_get_int( json, "max_nodes", res->max_nodes );
+  res->gap = cJSON_get_double( json, "gap", res->gap );
+  res->threads = cJSON_get_int( json, "threads", res->threads );
+  if ( res->gap < 0 ) {
+    fprintf( stderr, "Branch and bound \"gap\" should be non-negative.\n" );
+    error_exit();
+  }
+  return res;
+}
+
+/*
+ * cJSON_to_cma_params: reads CMA-ES parameters from a (possibly NULL) JSON
+ * object, using default values for missing fields.
+ */
+cma_es_params cJSON_to_cma_params( cJSON* json ) {
+  cma_es_params res = cma_params_new();
+  res->max_evals = cJSON_get_int( json, "max_evals", res->max_evals );
+  res->step = cJSON_get_double( json, "step", res->step );
+  res->population = cJSON_get_int( json, "population", res->population );
+  res->stop_error = cJSON_get_double( json, "stop_error", res->stop_error );
+  res->threads = cJSON_get_int( json, "threads", res->threads );
+  if ( res->population != 0 && res->population < 2 ) {
+    fprintf( stderr, "CMA-ES \"population\" should be at least 2.\n" );
+    error_exit();
+  }
+  return res;
+}
+
+/*
+ * cJSON_to_sa_params: reads simulated annealing parameters from a JSON object.
+ * With "lambda", the step and initial temperature are hand-tuned from
+ * "lambda", "p_init", "function_constant" and the optional "point" (see
+ * [sa_params_simple_with_lambda], the starting point of each optimisation
+ * being used without it), otherwise they are calibrated.
+ */
+simulated_annealing_params cJSON_to_sa_params( cJSON* json ) {
+  simulated_annealing_params res;
+  int max_step = cJSON_get_int( json, "max_step", 10000 );
+  int k0 = cJSON_get_int( json, "k0", 0 );
+  if ( max_step < 1 || k0 < 0 || k0 > max_step ) {
+    fprintf( stderr, "Simulated annealing needs 0 <= k0 <= max_step and "
+             "max_step >= 1.\n" );
+    error_exit();
+  }
+  if ( cJSON_GetObjectItemCaseSensitive( json, "lambda" ) != NULL ) {
+    cJSON* point = cJSON_GetObjectItemCaseSensitive( json, "point" );
+    if ( cJSON_GetObjectItemCaseSensitive( json, "p_init" ) == NULL ||
+         cJSON_GetObjectItemCaseSensitive( json, "function_constant" ) ==
+         NULL || ( point != NULL && ! cJSON_IsArray( point ) ) ) {
+      fprintf( stderr, "Simulated annealing \"lambda\" needs \"p_init\" "
+               "and \"function_constant\" (and \"point\" should be an "
+               "array).\n" );
+      error_exit();
+    }
+    int n = -1;
+    cJSON* coord;
+    cJSON_ArrayForEach( coord, point ) {
+      cJSON* index = cJSON_GetObjectItemCaseSensitive( coord, "index" );
+      if ( ! cJSON_IsNumber( index ) || index->valueint < 0 ||
+           ! cJSON_IsNumber(
+             cJSON_GetObjectItemCaseSensitive( coord, "value" ) ) ) {
+        fprintf( stderr, "Simulated annealing \"point\" entries need a "
+                 "non-negative \"index\" and a \"value\".\n" );
+        error_exit();
+      }
+      if ( n < index->valueint ) n = index->valueint;
+    }
+    double* sigma = point == NULL ? NULL :
+                    GC_MALLOC( ( n + 1 ) * sizeof( double ) );
+    cJSON_ArrayForEach( coord, point ) {
+      sigma[ cJSON_GetObjectItemCaseSensitive( coord, "index" )->valueint ] =
+        cJSON_GetObjectItemCaseSensitive( coord, "value" )->valuedouble;
+    }
+    res = sa_params_simple_with_lambda(
+      max_step, cJSON_get_double( json, "p_init", 0 ), k0, n + 1, sigma,
+      cJSON_get_double( json, "lambda", 0 ),
+      cJSON_get_double( json, "function_constant", 0 ) );
+  } else {
+    res = sa_params_simple( max_step, 0.5, k0 );
+    res->step = 0;
+    res->calibrate = 100;
+  }
+  res->step = cJSON_get_double( json, "step", res->step );
+  res->reheat = cJSON_get_int( json, "reheat", res->reheat );
+  res->calibrate = cJSON_get_int( json, "calibrate", res->calibrate );
+  res->accept = cJSON_get_double( json, "accept", res->accept );
+  cJSON* schedule = cJSON_GetObjectItemCaseSensitive( json, "schedule" );
+  if ( schedule != NULL ) {
+    if ( cJSON_IsString( schedule ) &&
+         strcmp( schedule->valuestring, "log" ) == 0 )
+      res->schedule = SA_SCHEDULE_LOG;
+    else if ( cJSON_IsString( schedule ) &&
+              strcmp( schedule->valuestring, "adaptive" ) == 0 )
+      res->schedule = SA_SCHEDULE_ADAPTIVE;
+    else {
+      fprintf( stderr, "Unknown simulated annealing schedule.\n" );
+      error_exit();
+    }
+  }
+  if ( res->accept <= 0 || res->accept >= 1 ) {
+    fprintf( stderr, "Simulated annealing \"accept\" should be in ]0,1[.\n" );
+    error_exit();
+  }
+  // the target acceptance rate of the adaptive schedule is spread over the
+  // max_step - k0 steps before the final descent
+  if ( res->schedule == SA_SCHEDULE_ADAPTIVE && res->k0 >= res->max_step ) {
+    fprintf( stderr, "Simulated annealing with the \"adaptive\" schedule "
+             "needs k0 < max_step.\n" );
+    error_exit();
+  }
+  return res;
+}
+
+/*
+ * cJSON_to_discrete_params: reads discrete allocation parameters from a
+ * (possibly NULL) JSON object, using default values for missing fields.
+ */
+discrete_params cJSON_to_discrete_params( cJSON* json ) {
+  discrete_params res = discrete_params_new();
+  res->unit = cJSON_get_double( json, "unit", res->unit );
+  res->max_moves = cJSON_get_int( json, "max_moves", res->max_moves );
+  if ( res->unit <= 0 ) {
+    fprintf( stderr, "Discrete allocation \"unit\" should be positive.\n" );
+    error_exit();
+  }
+  return res;
+}
+
+/*
+ * cJSON_to_nsga_params: reads NSGA-II parameters from a (possibly NULL) JSON
+ * object, using default values for missing fields.
+ */
+nsga_params cJSON_to_nsga_params( cJSON* json ) {
+  nsga_params res = nsga_params_new();
+  res->population = cJSON_get_int( json, "population", res->population );
+  res->generations = cJSON_get_int( json, "generations", res->generations );
+  res->mutation = cJSON_get_double( json, "mutation", res->mutation );
+  res->threads = cJSON_get_int( json, "threads", res->threads );
+  if ( res->population < 2 ) {
+    fprintf( stderr, "NSGA-II \"population\" should be at least 2.\n" );
+    error_exit();
+  }
+  return res;
+}
+
+/*
+ * cJSON_to_surrogate_params: reads surrogate-assisted optimisation parameters
+ * from a (possibly NULL) JSON object, using default values for missing fields.
+ */
+surrogate_params cJSON_to_surrogate_params( cJSON* json ) {
+  surrogate_params res = surrogate_params_new();
+  res->max_evals = cJSON_get_int( json, "max_evals", res->max_evals );
+  res->samples = cJSON_get_int( json, "samples", res->samples );
+  res->candidates = cJSON_get_int( json, "candidates", res->candidates );
+  res->step = cJSON_get_double( json, "step", res->step );
+  res->stop_error = cJSON_get_double( json, "stop_error", res->stop_error );
+  cJSON* model = cJSON_GetObjectItemCaseSensitive( json, "model" );
+  if ( model != NULL ) {
+    if ( cJSON_IsString( model ) &&
+         strcmp( model->valuestring, "rbf" ) == 0 )
+      res->model = SURROGATE_RBF;
+    else if ( cJSON_IsString( model ) &&
+              strcmp( model->valuestring, "quadratic" ) == 0 )
+      res->model = SURROGATE_QUADRATIC;
+    else {
+      fprintf( stderr, "Unknown surrogate model.\n" );
+      error_exit();
+    }
+  }
+  if ( res->max_evals < 1 || res->candidates < 1 ) {
+    fprintf( stderr, "Surrogate \"max_evals\" and \"candidates\" should be "
+             "positive.\n" );
+    error_exit();
+  }
+  return res;
+}
+
+/*
+ * cJSON_to_module_params: reads module decomposition parameters from a
+ * (possibly NULL) JSON object, using default values for missing fields (NULL
+ * for no decomposition).
+ */
+module_params cJSON_to_module_params( cJSON* json ) {
+  if ( json == NULL )
+    return NULL;
+  module_params res = module_params_new();
+  res->steps = cJSON_get_int( json, "steps", res->steps );
+  res->refine = cJSON_get_int( json, "refine", res->refine );
+  res->threads = cJSON_get_int( json, "threads", res->threads );
+  if ( res->steps < 2 || res->refine < 0 ) {
+    fprintf( stderr, "Module \"steps\" should be at least 2 and \"refine\" "
+             "non-negative.\n" );
+    error_exit();
+  }
+  return res;
+}
+
+/*
+ * Presets
+ */
+
+// the names and parameters of the built-in presets
+char* optim_presets_names[ OPTIM_PRESETS_NUMBER ] = {
+  "ga", "gahc", "sa", "sahc", "bb", "cma", "discrete", "nsga", "surrogate",
+  "sa_lambda"
+};
+char* optim_presets_texts[ OPTIM_PRESETS_NUMBER ] = {
+  "{\"type\":\"ga\"}",
+  "{\"type\":\"gahc\"}",
+  "{\"type\":\"sa\",\"sa\":{}}",
+  "{\"type\":\"sahc\",\"sa\":{}}",
+  "{\"type\":\"bb\"}",
+  "{\"type\":\"cma\"}",
+  "{\"type\":\"discrete\"}",
+  "{\"type\":\"nsga\"}",
+  "{\"type\":\"surrogate\"}",
+  "{\"type\":\"sa\",\"sa\":{\"max_step\":20000,\"p_init\":0.0001,"
+  "\"lambda\":35,\"function_constant\":0.99}}"
+};
+
+// the presets loaded by [optim_presets_load] (NULL if there are none)
+cJSON* optim_presets_loaded = NULL;
+
+void optim_presets_load( char* filename ) {
+  size_t length;
+  char* contents = file_map( filename, &length );
+  cJSON* json = cJSON_ParseWithLength( contents, length );
+  file_unmap( contents, length );
+  if ( ! cJSON_IsObject( json ) ) {
+    fprintf( stderr, "optim_presets_load: \"%s\" should be a JSON object.\n",
+             filename );
+    error_exit();
+  }
+  cJSON_Delete( optim_presets_loaded );
+  optim_presets_loaded = json;
+}
+
+// a copy of the parameters of the preset [name] (to delete with
+// [cJSON_Delete]), or NULL if there is no such preset
+cJSON* optim_preset( char* name ) {
+  cJSON* json = cJSON_GetObjectItemCaseSensitive( optim_presets_loaded, name );
+  if ( json != NULL )
+    return cJSON_Duplicate( json, true );
+  for ( int i = 0; i < OPTIM_PRESETS_NUMBER; ++i )
+    if ( strcmp( name, optim_presets_names[ i ] ) == 0 )
+      return cJSON_Parse( optim_presets_texts[ i ] );
+  return NULL;
+}
+
+// overrides the fields of [json] by those of [fields] (except "preset"),
+// field by field for objects
+void optim_preset_override( cJSON* json, cJSON* fields ) {
+  cJSON* field;
+  cJSON_ArrayForEach( field, fields ) {
+    if ( strcmp( field->string, "preset" ) == 0 )
+      continue;
+    cJSON* old = cJSON_GetObjectItemCaseSensitive( json, field->string );
+    if ( cJSON_IsObject( old ) && cJSON_IsObject( field ) )
+      optim_preset_override( old, field );
+    else if ( old != NULL )
+      cJSON_ReplaceItemInObjectCaseSensitive( json, field->string,
+                                              cJSON_Duplicate( field, true ) );
+    else
+      cJSON_AddItemToObject( json, field->string,
+                             cJSON_Duplicate( field, true ) );
+  }
 }
 
 optim_params cJSON_to_optim_params( cJSON* json ) {
+  // parameters given by a preset are read from a copy of the preset
+  cJSON* preset = NULL;
+  cJSON* name = cJSON_IsString( json ) ? json :
+                cJSON_GetObjectItemCaseSensitive( json, "preset" );
+  if ( name != NULL ) {
+    if ( ! cJSON_IsString( name ) ||
+         ( preset = optim_preset( name->valuestring ) ) == NULL ) {
+      fprintf( stderr, "Unknown optimisation preset (%s).\n",
+               cJSON_IsString( name ) ? name->valuestring : "not a string" );
+      error_exit();
+    }
+    if ( cJSON_IsObject( json ) )
+      optim_preset_override( preset, json );
+    json = preset;
+  }
+  cJSON* type = cJSON_GetObjectItemCaseSensitive( json, "type" );
+  if ( ! cJSON_IsString( type ) ) {
+    fprintf( stderr, "No optimisation algorithm (\"type\").\n" );
+    error_exit();
+  }
   optim_params opt_params = GC_MALLOC( sizeof( struct optim_params_s ) );
-  char* s = cJSON_GetObjectItemCaseSensitive( json, "type" )->valuestring;
+  opt_params->ga_params = ga_params_new();
+  opt_params->hc_params = hc_params_new();
+  opt_params->bb_params = bb_params_new();
+  opt_params->cma_params = cma_params_new();
+  opt_params->discrete_params = discrete_params_new();
+  opt_params->nsga_params = nsga_params_new();
+  opt_params->surrogate_params = surrogate_params_new();
+  opt_params->start = NULL;
+  opt_params->robust = cJSON_to_robust_params(
+    cJSON_GetObjectItemCaseSensitive( json, "robust" ) );
+  opt_params->uncertainty = NULL;
+  opt_params->modules = cJSON_to_module_params(
+    cJSON_GetObjectItemCaseSensitive( json, "modules" ) );
+  opt_params->trace =
+    cJSON_to_trace( cJSON_GetObjectItemCaseSensitive( json, "trace" ) );
+  char* s = type->valuestring;
 
   if ( strcmp( s, "ga" ) == 0 ) {
     opt_params->opt_algo_type = GRAD_ASC;
@@ -174,9 +638,19 @@ optim_params cJSON_to_optim_params( cJSON* json ) {
     opt_params->opt_algo_type = SIM_ANNEAL;
   } else if ( strcmp( s, "sahc" ) == 0 ) {
     opt_params->opt_algo_type = SIM_ANNEAL_HILL_CLIMB;
+  } else if ( strcmp( s, "bb" ) == 0 ) {
+    opt_params->opt_algo_type = BRANCH_BOUND;
+  } else if ( strcmp( s, "cma" ) == 0 ) {
+    opt_params->opt_algo_type = CMA_ES;
+  } else if ( strcmp( s, "discrete" ) == 0 ) {
+    opt_params->opt_algo_type = DISCRETE;
+  } else if ( strcmp( s, "nsga" ) == 0 ) {
+    opt_params->opt_algo_type = NSGA_II;
+  } else if ( strcmp( s, "surrogate" ) == 0 ) {
+    opt_params->opt_algo_type = SURROGATE;
   } else {
     fprintf( stderr, "Unknown optimisation algorithm (%s).\n", s );
-    exit( 1 );
+    error_exit();
   }
 
   if ( opt_params->opt_algo_type == SIM_ANNEAL ||
@@ -184,152 +658,130 @@ optim_params cJSON_to_optim_params( cJSON* json ) {
     cJSON* json_sa = cJSON_GetObjectItemCaseSensitive( json, "sa" );
     if ( json_sa == NULL ) {
       fprintf( stderr, "No simulated annealing arguments provided.\n" );
-      exit( 1 );
-    }
-    int max_step =
-      cJSON_GetObjectItemCaseSensitive( json_sa, "max_step" )->valueint;
-    double p_init =
-      cJSON_GetObjectItemCaseSensitive( json_sa, "p_init" )->valuedouble;
-    int k0 = 0;
-    if ( cJSON_GetObjectItemCaseSensitive( json_sa, "k0" ) != NULL )
-      k0 = cJSON_GetObjectItemCaseSensitive( json_sa, "k0" )->valueint;
-    double lambda =
-      cJSON_GetObjectItemCaseSensitive( json_sa, "lambda" )->valuedouble;
-    double function_constant =
-      cJSON_GetObjectItemCaseSensitive( json_sa,
-                                        "function_constant" )->valuedouble;
-    int n = -1;
-    cJSON* point = cJSON_GetObjectItemCaseSensitive( json_sa, "point" );
-    cJSON* coord;
-    cJSON_ArrayForEach( coord, point ) {
-      int m = cJSON_GetObjectItemCaseSensitive( coord, "index" )->valueint;
-      if ( n < m ) n = m;
-    }
-    double* sigma = GC_MALLOC( n * sizeof( double ) );
-    cJSON_ArrayForEach( coord, point ) {
-      sigma[ cJSON_GetObjectItemCaseSensitive( coord, "index" )->valueint ] =
-        cJSON_GetObjectItemCaseSensitive( coord, "value" )->valuedouble;
+      error_exit();
     }
-    sa_params_from_hyperparams_simple_set_with_lambda( max_step, p_init, k0,
-                                                       n+1, sigma, lambda,
-                                                       function_constant );
-    opt_params->sa_params = sa_params_from_hyperparams_simple;
+    opt_params->sa_params = cJSON_to_sa_params( json_sa );
 
   } else if ( opt_params->opt_algo_type == GRAD_ASC ||
-              opt_params->opt_algo_type == GRAD_ASC_HILL_CLIMB ) {
-    fprintf( stderr, "Not implemented yet.\n" );
-    exit( 1 );
+              opt_params->opt_algo_type == GRAD_ASC_HILL_CLIMB ||
+              opt_params->opt_algo_type == BRANCH_BOUND ) {
+    opt_params->ga_params =
+      cJSON_to_ga_params( cJSON_GetObjectItemCaseSensitive( json, "ga" ) );
+    if ( opt_params->opt_algo_type == BRANCH_BOUND )
+      opt_params->bb_params =
+        cJSON_to_bb_params( cJSON_GetObjectItemCaseSensitive( json, "bb" ) );
+
+  } else if ( opt_params->opt_algo_type == CMA_ES ) {
+    opt_params->cma_params =
+      cJSON_to_cma_params( cJSON_GetObjectItemCaseSensitive( json, "cma" ) );
+
+  } else if ( opt_params->opt_algo_type == DISCRETE ) {
+    opt_params->discrete_params =
+      cJSON_to_discrete_params(
+        cJSON_GetObjectItemCaseSensitive( json, "discrete" ) );
+
+  } else if ( opt_params->opt_algo_type == NSGA_II ) {
+    opt_params->nsga_params =
+      cJSON_to_nsga_params( cJSON_GetObjectItemCaseSensitive( json, "nsga" ) );
+
+  } else if ( opt_params->opt_algo_type == SURROGATE ) {
+    opt_params->surrogate_params =
+      cJSON_to_surrogate_params(
+        cJSON_GetObjectItemCaseSensitive( json, "surrogate" ) );
 
   } else {
     fprintf( stderr, "Unknown optimisation algorithm (coded %d).\n",
              opt_params->opt_algo_type );
-    exit( 1 );
+    error_exit();
 
   }
 
   if ( opt_params->opt_algo_type == GRAD_ASC_HILL_CLIMB ||
-       opt_params->opt_algo_type == SIM_ANNEAL_HILL_CLIMB ) {
-    // may be useful in the future?
-    // cJSON* json_hc = cJSON_GetObjectItemCaseSensitive( json, "hc" );
-    // if ( json_hc == NULL ) {
-    //   fprintf( stderr, "No simulated annealing arguments provided.\n" );
-    //   exit( 1 );
-    // }
-    // int step_size =
-    //   cJSON_GetObjectItemCaseSensitive( json_sa, "step_size" )->valueint;
-    // int iters =
-    //   cJSON_GetObjectItemCaseSensitive( json_sa, "iters" )->valueint;
-  }
+       opt_params->opt_algo_type == SIM_ANNEAL_HILL_CLIMB )
+    opt_params->hc_params =
+      cJSON_to_hc_params( cJSON_GetObjectItemCaseSensitive( json, "hc" ) );
 
+  cJSON_Delete( preset );
   return opt_params;
 }
 
+bool optim_params_trace_file( cJSON* json ) {
+  cJSON* trace = cJSON_GetObjectItemCaseSensitive( json, "trace" );
+  return cJSON_GetObjectItemCaseSensitive( trace, "file" ) != NULL;
+}
+
 optim_params filename_to_optim_params( char* filename ) {
   if ( filename == NULL ) {
     fprintf( stderr, "No optimisation parameters provided.\n" );
-    exit( 1 );
+    error_exit();
   }
-  FILE* f_opt = fopen( filename, "r" );
-  if ( f_opt == NULL ) {
-    fprintf( stderr, "Error while opening: \"%s\"\n",
-             filename );
-    exit( 1 );
-  }
-  fseek( f_opt, 0, SEEK_END );
-  int n = ftell( f_opt );
-  char* contents = GC_MALLOC( ( n + 1 ) * sizeof( char ) );
-  fseek( f_opt, 0, SEEK_SET );
-  fread( contents, 1, n, f_opt );
-  fclose( f_opt );
-  contents[ n ] = '\0';
-  cJSON* json = cJSON_Parse( contents );
+  size_t length;
+  char* contents = file_map( filename, &length );
+  cJSON* json = cJSON_ParseWithLength( contents, length );
+  file_unmap( contents, length );
   optim_params opt_params = cJSON_to_optim_params( json );
   cJSON_Delete( json );
   return opt_params;
 }
 
-/*
- * Algorithms
- */
-
-/*
- * best_vector_res_aux: uses precomputed derivatives.
- * inputs:
- * - [n]: the dimension of the ambient space,
- * - [pos_cfd_num]: the number of positive confidence expressions in the
- *   conclusion of the proof,
- * - [exp_res]: an array of [pos_cfd_num] expressions mapping resources to
- *   confidence in the total proof (its variables are 0 to [n]-1),
- * - [derivatives]: a 2-dimensional array of size [pos_cfd_num] * [n]
- *   representing the partial derivatives of [exp_res],
- * - [sigma]: a vector of size [n] of doubles representing resources.
- * output: a vector of doubles of size [n] representing the direction.
- */
-double* best_vector_res_aux( int n, int pos_cfd_num, expression* exp_res,
-                             expression** derivatives, double* sigma ) {
-  int max_ind = 0; // value stored in [exp_is_max] if the expression is maximal
-  int max_size = 0;
-  double val_max = 0;
-  int* exp_is_max = GC_MALLOC( pos_cfd_num * sizeof( expression ) );
-  // this loop puts in exp_max all expressions that are maximal at sigma
-  for ( int i = 0; i < pos_cfd_num; ++i ) {
-    int cur_size = max_size;
-    if ( cur_size < exp_size( exp_res[ i ] ) )
-      cur_size = exp_size( exp_res[ i ] );
-    double val_cur = exp_eval( exp_res[ i ], sigma );
-    int c = dcompare( val_cur, val_max, cur_size );
-    if ( c == 0 ) {
-      max_size = cur_size;
-      exp_is_max[ i ] = max_ind;
-      val_max = val_cur;
-    } else if ( c > 0 ) {
-      max_size = exp_size( exp_res[ i ] );
-      exp_is_max[ i ] = ++max_ind;
-      val_max = val_cur;
-    } else {
-      exp_is_max[ i ] = -1;
-    }
-  }
-  double* best_direction = GC_MALLOC( n * sizeof( double ) );
-  for ( int i = 0; i < n; ++i ) best_direction[ i ] = 0;
-  double best_norm = 0;
-  double* cur_direction  = GC_MALLOC( n * sizeof( double ) );
-  for ( int i = 0; i < pos_cfd_num; ++i ) {
-    if ( exp_is_max[ i ] == max_ind ) {
-      for ( int j = 0; j < n; ++j ) {
-        cur_direction[ j ] = exp_eval( derivatives[ i ][ j ], sigma );
-      }
-      double cur_norm = square_norm( n, cur_direction );
-      if ( cur_norm > best_norm ) {
-        best_norm = cur_norm;
-        best_direction = cur_direction;
-        cur_direction = GC_MALLOC( n * sizeof( double ) );
+double* cJSON_to_budgets( cJSON* json, int* num ) {
+  double* budgets;
+  if ( cJSON_IsNumber( json ) ) {
+    *num = 1;
+    budgets = GC_MALLOC_ATOMIC( sizeof( double ) );
+    budgets[ 0 ] = json->valuedouble;
+  } else if ( cJSON_IsArray( json ) ) {
+    *num = cJSON_GetArraySize( json );
+    budgets = GC_MALLOC_ATOMIC( *num * sizeof( double ) );
+    cJSON* item;
+    int i = 0;
+    cJSON_ArrayForEach( item, json ) {
+      if ( !cJSON_IsNumber( item ) ) {
+        fprintf( stderr, "cJSON_to_budgets: budgets should be numbers.\n" );
+        error_exit();
       }
+      budgets[ i++ ] = item->valuedouble;
+    }
+  } else if ( cJSON_IsObject( json ) ) {
+    cJSON* from = cJSON_GetObjectItemCaseSensitive( json, "from" );
+    cJSON* to = cJSON_GetObjectItemCaseSensitive( json, "to" );
+    cJSON* steps = cJSON_GetObjectItemCaseSensitive( json, "steps" );
+    if ( !cJSON_IsNumber( from ) || !cJSON_IsNumber( to ) ||
+         !cJSON_IsNumber( steps ) || steps->valueint < 1 ) {
+      fprintf( stderr, "cJSON_to_budgets: ranges need \"from\", \"to\", and "
+               "a positive number of \"steps\".\n" );
+      error_exit();
     }
+    *num = steps->valueint;
+    budgets = GC_MALLOC_ATOMIC( *num * sizeof( double ) );
+    for ( int i = 0; i < *num; ++i )
+      budgets[ i ] = *num == 1 ? from->valuedouble :
+        from->valuedouble +
+        ( to->valuedouble - from->valuedouble ) * i / ( *num - 1 );
+  } else {
+    fprintf( stderr, "cJSON_to_budgets: no budget specified.\n" );
+    error_exit();
   }
-  return best_direction;
+  if ( *num == 0 ) {
+    fprintf( stderr, "cJSON_to_budgets: no budget specified.\n" );
+    error_exit();
+  }
+  // increasing order, so that each allocation can start from the previous one
+  // (insertion sort, sweeps are short)
+  for ( int i = 1; i < *num; ++i ) {
+    double b = budgets[ i ];
+    int j = i;
+    for ( ; j > 0 && budgets[ j - 1 ] > b; --j )
+      budgets[ j ] = budgets[ j - 1 ];
+    budgets[ j ] = b;
+  }
+  return budgets;
 }
 
+/*
+ * Algorithms
+ */
+
 double* best_vector_res( int n, proof p, expression* cfd_res,
                          double* sigma ) {
   expression* exp_res = GC_MALLOC( p->conclusion->pos_cfd_num *
@@ -378,209 +830,420 @@ double* best_vector_res( int n, proof p, expression* cfd_res,
   return best_direction;
 }
 
-double* resource_repartition_ga( int n, proof p, expression* cfd_res,
-                                 double* sigma, double res,
+// projected gradient ascent on the feasible set
+// { x | x_i >= sigma_i, x_1 + ... + x_n = sigma_1 + ... + sigma_n + res },
+// starting from [start] (or the balanced point), with either Armijo
+// backtracking or Adam steps, on the confidence or on its log-sum-exp smoothing
+// with a temperature that decreases every time the ascent stalls
+double* resource_repartition_ga( int n, objective obj,
+                                 double* sigma, double res, double* start,
+                                 trace tr,
                                  gradient_ascent_params params ) {
-  int iters = 0;
-  expression* exp_res = GC_MALLOC( p->conclusion->pos_cfd_num *
-                                   sizeof( expression ) );
-  for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
-    exp_res[ i ] = exp_array_composition( p->conclusion->ccl_pos_cfds[ i ],
-                                          cfd_res );
-  expression** derivatives = GC_MALLOC( p->conclusion->pos_cfd_num *
-                                        sizeof( expression* ) );
-  for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i ) {
-    derivatives[ i ] = GC_MALLOC( n * sizeof( expression ) );
-    for ( int j = 0; j < n; ++j )
-      derivatives[ i ][ j ] =
-        exp_simplification( exp_derivative( exp_res[ i ], j ) );
-  }
-  double* cur_sigma = GC_MALLOC( n * sizeof( double ) );
+  double* work = obj_work_new( obj );
+  double total_res = res;
   for ( int i = 0; i < n; ++i )
-    cur_sigma[ i ] = sigma[ i ];
-  double total_res = l1_norm( n, sigma ) + res;
-  double alpha, norm_dsigma;
-  double norm_cur_sigma = l1_norm( n, cur_sigma );
-  double* dsigma;
-  bool stop = false;
-  while ( !stop ) {
-    iters++;
-    dsigma = best_vector_res_aux( n, p->conclusion->pos_cfd_num, exp_res,
-                                  derivatives, cur_sigma );
-    alpha = params->step_coef;
-    norm_dsigma = l1_norm( n, dsigma );
-    if ( norm_cur_sigma + alpha > total_res ) {
-      alpha = total_res - norm_cur_sigma;
-      if ( alpha < 0 ) {
-        alpha = 0;
+    total_res += sigma[ i ];
+  double step = params->step_coef > 0 ? params->step_coef : res / 100;
+  double temp = params->smoothing;
+  double* cur_sigma = GC_MALLOC( n * sizeof( double ) );
+  double* next_sigma = GC_MALLOC( n * sizeof( double ) );
+  double* best_sigma = GC_MALLOC( n * sizeof( double ) );
+  double* dsigma = GC_MALLOC( n * sizeof( double ) );
+  double* moment1 = GC_MALLOC( n * sizeof( double ) );
+  double* moment2 = GC_MALLOC( n * sizeof( double ) );
+  double* swap;
+  for ( int i = 0; i < n; ++i ) {
+    cur_sigma[ i ] = sigma[ i ] + ( start ? start[ i ] : res / n );
+    best_sigma[ i ] = cur_sigma[ i ];
+    moment1[ i ] = 0;
+    moment2[ i ] = 0;
+  }
+  double best_val, cur_max;
+  double cur_val = obj_eval_smooth( obj, temp, cur_sigma, dsigma, &best_val,
+                                    work );
+  double next_val, norm_dsigma, increase;
+  double pow_beta1 = 1, pow_beta2 = 1;
+  int stalled = 0;
+  trace_start( tr, n, sigma );
+  // with nothing to spend, the balanced point is the only feasible one
+  int max_iters = res > 0 ? params->max_iters : 0;
+  for ( int iters = 0; iters < max_iters; ++iters ) {
+    if ( trace_due( tr, iters ) && trace_stop( tr, best_val ) )
+      break;
+    if ( stalled >= params->patience ) {
+      if ( temp <= 0 )
+        break;
+      // anneal the smoothing and restart from the current point
+      temp *= params->smoothing_decay;
+      if ( temp < params->smoothing_min )
+        temp = 0;
+      stalled = 0;
+      step = params->step_coef > 0 ? params->step_coef : res / 100;
+      pow_beta1 = 1;
+      pow_beta2 = 1;
+      for ( int i = 0; i < n; ++i ) {
+        moment1[ i ] = 0;
+        moment2[ i ] = 0;
       }
-      stop = true;
+      cur_val = obj_eval_smooth( obj, temp, cur_sigma, dsigma, NULL, work );
     }
+    // only the component of the gradient along feasible directions matters
+    project_tangent( n, dsigma, cur_sigma, sigma );
+    norm_dsigma = sqrt( square_norm( n, dsigma ) );
     if ( norm_dsigma == 0 ) {
-      printf( "sigma = ( " );
-      for ( int i = 0; i < n; ++i )
-        printf( "%f ", sigma[ i ] );
-      printf( ")\n" );
-      printf( "cur_sigma = ( " );
-      for ( int i = 0; i < n; ++i )
-        printf( "%f ", cur_sigma[ i ] );
-      printf( ")\n" );
-      for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
-        for ( int j = 0; j < n; ++j ) {
-          printf( "derivative[ %d ][ %d ] = ", i, j );
-          exp_printf( derivatives[ i ][ j ] );
-          printf( "\n" );
-          printf( "eval = %f\n", exp_eval( derivatives[ i ][ j ], cur_sigma ) );
+      stalled = params->patience; // stationary point
+      continue;
+    }
+    if ( params->step_rule == GA_STEP_ARMIJO ) {
+      // backtrack until the Armijo condition holds along the projection arc
+      bool accepted = false;
+      while ( step > DBL_EPSILON * total_res ) {
+        for ( int i = 0; i < n; ++i )
+          next_sigma[ i ] = cur_sigma[ i ] + step * dsigma[ i ] / norm_dsigma;
+        project_simplex( n, next_sigma, sigma, total_res );
+        increase = 0;
+        for ( int i = 0; i < n; ++i )
+          increase += dsigma[ i ] * ( next_sigma[ i ] - cur_sigma[ i ] );
+        next_val = obj_eval_smooth( obj, temp, next_sigma, NULL, NULL, work );
+        if ( increase > 0 && next_val >= cur_val + params->armijo * increase ) {
+          accepted = true;
+          break;
         }
-      printf( "Division by 0.\n" );
-      printf( "dsigma = " );
+        step *= params->backtrack;
+      }
+      if ( ! accepted ) {
+        stalled = params->patience; // no ascent direction left
+        step = params->step_coef > 0 ? params->step_coef : res / 100;
+        continue;
+      }
+      step /= params->backtrack;
+      if ( step > res )
+        step = res;
+    } else {
+      pow_beta1 *= params->beta1;
+      pow_beta2 *= params->beta2;
+      for ( int i = 0; i < n; ++i ) {
+        moment1[ i ] = params->beta1 * moment1[ i ] +
+                       ( 1 - params->beta1 ) * dsigma[ i ];
+        moment2[ i ] = params->beta2 * moment2[ i ] +
+                       ( 1 - params->beta2 ) * dsigma[ i ] * dsigma[ i ];
+        next_sigma[ i ] = cur_sigma[ i ] + step *
+          ( moment1[ i ] / ( 1 - pow_beta1 ) ) /
+          ( sqrt( moment2[ i ] / ( 1 - pow_beta2 ) ) + DBL_EPSILON );
+      }
+      project_simplex( n, next_sigma, sigma, total_res );
+      next_val = obj_eval_smooth( obj, temp, next_sigma, NULL, NULL, work );
+      // overshooting: anneal the step so that the iterates settle
+      if ( next_val <= cur_val )
+        step *= params->backtrack;
+    }
+    if ( next_val > cur_val + params->stop_error )
+      stalled = 0;
+    else
+      stalled++;
+    swap = cur_sigma;
+    cur_sigma = next_sigma;
+    next_sigma = swap;
+    cur_val = obj_eval_smooth( obj, temp, cur_sigma, dsigma, &cur_max, work );
+    if ( cur_max > best_val ) {
+      best_val = cur_max;
       for ( int i = 0; i < n; ++i )
-        printf( "%f ", dsigma[ i ] );
-      printf( "\n" );
-      exit( 1 );
+        best_sigma[ i ] = cur_sigma[ i ];
+      if ( trace_improved( tr, best_val, best_sigma ) )
+        break;
     }
-    for ( int i = 0; i < n; ++i ) {
-      cur_sigma[ i ] += alpha * dsigma[ i ] / norm_dsigma;
-      norm_cur_sigma += alpha * dsigma[ i ] / norm_dsigma;
+  }
+  for ( int i = 0; i < n; ++i )
+    best_sigma[ i ] -= sigma[ i ];
+  return best_sigma;
+}
+
+// hill climbing from [point] (modified in place) on the feasible set
+// { x | x_i >= sigma_i, x_1 + ... + x_n = constant }, without allocating in
+// the main loop; returns the confidence at the final point
+// warning: we use < on doubles (rather than dcompare) here for hill climbing to
+// work better
+double hill_climbing( objective obj, double* sigma, double res, double* point,
+                      hill_climbing_params params ) {
+  int n = obj->n;
+  double* work = obj_work_new( obj );
+  // dir: the delta between current point and next point to test
+  double* dir = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  // test: the next point to test
+  double* test = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  double x, y, l2_norm, r, cur, old_i, old_j;
+  int i, j, hint = 0;
+  bool success;
+  double step = params->step_size > 0 ? params->step_size : res / 100;
+  double shrink = pow( params->adapt, -0.25 );
+  double best = obj_eval( obj, point, work );
+  if ( n < 2 )
+    return best;
+  for ( int iters = 0; iters < params->iters; ++iters ) {
+    // adaptive steps this small cannot improve anything anymore
+    if ( step <= DBL_EPSILON * res )
+      break;
+    if ( params->strategy == HC_PAIR ) {
+      // move a random amount of resources from [j] to [i]
+      i = rng_rand() % n;
+      j = rng_rand() % ( n - 1 );
+      if ( j >= i )
+        ++j;
+      r = step * ( ( double ) rng_rand() + 1 ) /
+        ( ( double ) RAND_MAX + 1 );
+      if ( r > point[ j ] - sigma[ j ] )
+        r = point[ j ] - sigma[ j ];
+      old_i = point[ i ];
+      old_j = point[ j ];
+      point[ i ] += r;
+      point[ j ] -= r;
+      cur = obj_eval_above( obj, point, best, &hint, work );
+      success = r > 0 && cur > best;
+      if ( success )
+        best = cur;
+      else {
+        point[ i ] = old_i;
+        point[ j ] = old_j;
+      }
+    } else {
+      // pick a random direction on S^(n-2) = random direction for n-1 vectors
+      // and stay on the hyperplane r_1 + ... + r_n = res
+      for ( i = 0; i < n / 2; ++i ) {
+        x = ( double ) rng_rand() / RAND_MAX;
+        y = ( double ) rng_rand() / RAND_MAX;
+        box_muller( x, y, dir + 2 * i );
+      }
+      if ( n % 2 == 1 ) {
+        x = ( double ) rng_rand() / RAND_MAX;
+        y = ( double ) rng_rand() / RAND_MAX;
+        box_muller( x, y, dir + n - 2 ); // overwrites the penultimate value,
+                                         // but who cares?
+      }
+      dir[ n - 1 ] = 0;
+      for ( i = 0; i < n - 1; ++i )
+        dir[ n - 1 ] -= dir[ i ];
+      l2_norm = sqrt( square_norm( n, dir ) );
+      // pick a random radius
+      r = pow( ( double ) rng_rand() / RAND_MAX, 1.0 / ( n - 1 ) );
+      r *= step / l2_norm;
+      // rescale the point if it goes outside the bounds (the total amount of
+      // resource allocated to a component is below the initial amount)
+      for ( i = 0; i < n; ++i )
+        if ( point[ i ] + dir[ i ] * r < sigma[ i ] )
+          r = ( sigma[ i ] - point[ i ] ) / dir[ i ];
+      for ( i = 0; i < n; ++i )
+        test[ i ] = point[ i ] + dir[ i ] * r;
+      // make the new point the new known best if it's better
+      cur = obj_eval_above( obj, test, best, &hint, work );
+      success = cur > best;
+      if ( success ) {
+        best = cur;
+        for ( i = 0; i < n; ++i )
+          point[ i ] = test[ i ];
+      }
     }
-    if ( iters % 1000000 == 0 ) {
-      fprintf( stderr, "Too many iterations in resource_repartition_ga.\n" );
-      exit( 1 );
+    if ( params->strategy != HC_RANDOM ) {
+      step *= success ? params->adapt : shrink;
+      if ( step > res )
+        step = res;
     }
   }
-  for ( int i = 0; i < n; ++i )
-    cur_sigma[ i ] -= sigma[ i ];
-  return cur_sigma;
+  return best;
 }
 
-double* resource_repartition_gahc( int n, proof p, expression* cfd_res,
-                                   double* sigma, double res,
+double* resource_repartition_gahc( int n, objective obj,
+                                   double* sigma, double res, double* start,
+                                   trace tr,
                                    gradient_ascent_params ga_params,
                                    hill_climbing_params hc_params ) {
-  // warning: we use < on doubles (rather than dcompare) here for hill climbing
-  // to work better
-  expression* exp_res = GC_MALLOC( p->conclusion->pos_cfd_num *
-                                   sizeof( expression ) );
-  for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
-    exp_res[ i ] = exp_array_composition( p->conclusion->ccl_pos_cfds[ i ],
-                                          cfd_res );
-  double* res_all = resource_repartition_ga( n, p, cfd_res, sigma, res,
-                                             ga_params );
+  double* res_all = resource_repartition_ga( n, obj, sigma, res,
+                                             start, tr, ga_params );
   for ( int i = 0; i < n; ++i )
     res_all[ i ] += sigma[ i ];
-  double x, y, l2_norm, r, best = 0;
-  // dir: the delta between current point and next point to test
-  // is chosen by choosing a direction uniformly for the first n-1 components
-  // and staying on the hyperplane r_1 + ... + r_n = res
-  double* dir = GC_MALLOC( n * sizeof( double ) );
-  // test: the next point to test
-  double* test = GC_MALLOC( n * sizeof( double ) );
-  // best_res would be used if we sometimes chose worse solutions
-  // (e.g., in simulated annealing)
-  for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
-    if ( best < exp_eval( exp_res[ i ], res_all ) )
-      best = exp_eval( exp_res[ i ], res_all );
-  // starting hill climbing
-  for ( int iters = 0; iters < hc_params->iters; ++iters ) {
-    // pick a random direction on S^(n-2) = random direction for n-1 vectors
-    for ( int i = 0; i < n / 2; ++i ) {
-      x = ( double ) rand() / RAND_MAX;
-      y = ( double ) rand() / RAND_MAX;
-      box_muller( x, y, dir + 2 * i );
-    }
-    if ( n % 2 == 1 ) {
-      x = ( double ) rand() / RAND_MAX;
-      y = ( double ) rand() / RAND_MAX;
-      box_muller( x, y, dir + n - 2 ); // overwrites the penultimate value,
-                                       // but who cares?
-    }
-    dir[ n - 1 ] = 0;
-    for ( int i = 0; i < n - 1; ++i ) {
-      dir[ n - 1 ] -= dir[ i ];
-    }
-    for ( int i = 0; i < n; ++i )
-      l2_norm += dir[ i ] * dir[ i ];
-    l2_norm = sqrt( l2_norm );
-    // pick a random radius
-    r = pow( ( double ) rand() / RAND_MAX, 1 / ( n - 1 ) );
-    r *= hc_params->step_size / l2_norm;
-    // rescale the point if it goes outside the bounds (the total amount of
-    // resource allocated to a component is below the initial amount)
-    for ( int i = 0; i < n; ++i )
-      if ( res_all[ i ] + dir[ i ] * r < sigma[ i ] )
-        r = ( sigma[ i ] - res_all[ i ] ) / dir[ i ];
-    // scale the direction and compute a new point
-    for ( int i = 0; i < n; ++i ) {
-      dir[ i ] *= r;
-      test[ i ] = res_all[ i ] + dir[ i ];
-    }
-    // evaluate the new point and make it the new known best if it's better
-    for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
-      if ( exp_eval( exp_res[ i ], test ) > best ) {
-        best = exp_eval( exp_res[ i ], test );
-        for ( int j = 0; j < n; ++j )
-          res_all[ j ] = test[ j ];
-        break;
-      }
-  }
+  hill_climbing( obj, sigma, res, res_all, hc_params );
+  for ( int i = 0; i < n; ++i )
+    res_all[ i ] -= sigma[ i ];
   return res_all;
 }
 
-double* resource_repartition_sa( int n, proof p, expression* cfd_res,
-                                 double* sigma, double res,
+// Lam's target acceptance rate after a fraction [f] of the steps
+double sa_lam_target( double f ) {
+  if ( f < 0.15 )
+    return 0.44 + 0.56 * pow( 560, - f / 0.15 );
+  if ( f < 0.65 )
+    return 0.44;
+  return 0.44 * pow( 440, - ( f - 0.65 ) / 0.35 );
+}
+
+double* resource_repartition_sa( int n, objective obj,
+                                 double* sigma, double res, double* start,
+                                 trace tr,
                                  simulated_annealing_params sa_params ) {
   // warning: we use < on doubles (rather than dcompare) here for optimisation
   // to work better
   double* neighbour = GC_MALLOC( n * sizeof( double ) );
-  double temp, energy, energy_new, energy_old, energy_best;
+  double temp, dist, energy_new, energy_old, energy_best, cfd_new, cfd_best;
 
   // defining initial point
-  double* point = ( * sa_params->init ) ( n, sigma, res );
+  double* point;
+  if ( start ) {
+    point = GC_MALLOC( n * sizeof( double ) );
+    for ( int i = 0; i < n; ++i )
+      point[ i ] = sigma[ i ] + start[ i ];
+  } else
+    point = ( * sa_params->init ) ( n, sigma, res );
+  // local copy of the parameters, whose step and initial temperature may be
+  // calibrated
+  struct simulated_annealing_params_s params_local = * sa_params;
+  simulated_annealing_params params = &params_local;
+  if ( params->step <= 0 )
+    params->step = res * sqrt( M_PI / params->max_step );
+  if ( params->function_constant > 0 ) {
+    double sum = 0;
+    for ( int i = 0; i < n; ++i )
+      sum += pow( params->function_constant, sigma[ i ] + 1 );
+    params->t_max = sum * params->t_max;
+  }
   double* best = GC_MALLOC( n * sizeof( double ) );
   for ( int i = 0; i < n; ++i )
     best[ i ] = point[ i ];
 
-  // expressions mapping resources to confidence
-  expression* exp_res = GC_MALLOC( p->conclusion->pos_cfd_num *
-                                   sizeof( expression ) );
-  for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
-    exp_res[ i ] = exp_array_composition( p->conclusion->ccl_pos_cfds[ i ],
-                                          cfd_res );
+  // objective mapping resources to confidence
+  double* work = obj_work_new( obj );
 
-  // computing energy of initial point
-  energy_old = ( * sa_params->energy ) ( exp_eval( exp_res[ 0 ], point ) );
-  for ( int i = 1; i < p->conclusion->pos_cfd_num; ++i ) {
-    energy = ( * sa_params->energy ) ( exp_eval( exp_res[ i ], point ) );
-    if ( energy_old < energy )
-      energy_old = energy;
+  // upper bounds of the branches over a box [lo,hi] around the current point
+  // (recentred whenever a neighbour leaves it), so that only the branches that
+  // may be maximal get evaluated (useless with a single branch)
+  bool use_bounds = obj->branch_num > 1;
+  double* bounds = GC_MALLOC_ATOMIC( obj->branch_num * sizeof( double ) );
+  double* lo = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  double* hi = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  for ( int i = 0; i < n; ++i ) {
+    lo[ i ] = INFINITY;
+    hi[ i ] = - INFINITY;
   }
+  double radius = 0;
+  int hint = 0;
+  bool inside;
+
+  // computing energy of initial point
+  cfd_best = obj_eval( obj, point, work );
+  energy_old = ( * params->energy ) ( cfd_best );
   energy_best = energy_old;
+  trace_start( tr, n, sigma );
+  int accepted = 0;
+
+  // with nothing to spend, the starting point is the only feasible one, and
+  // neighbours cannot be picked
+  int max_step = res > 0 ? params->max_step : 0;
+
+  // calibration: the initial temperature is such that the average move
+  // increasing energy from the initial point is accepted with probability
+  // [accept]
+  if ( max_step > 0 && params->calibrate > 0 ) {
+    double uphill = 0;
+    int uphill_num = 0;
+    for ( int j = 0; j < params->calibrate; ++j ) {
+      neighbour = ( * params->neighbour ) ( params, n, sigma, point );
+      energy_new = ( * params->energy ) ( obj_eval( obj, neighbour, work ) );
+      if ( energy_new > energy_old ) {
+        uphill += energy_new - energy_old;
+        uphill_num++;
+      }
+    }
+    if ( uphill_num > 0 )
+      params->t_max = - uphill / uphill_num / log( params->accept );
+  }
+
+  // state of the schedules: the step [kt] in the schedule (restarted by
+  // reheating), the step of the last improvement, and for the adaptive
+  // schedule, the temperature and the moving average of acceptance
+  int kt = 0;
+  int improved = 0;
+  double t_adapt = params->t_max;
+  double acceptance = 1;
+  double cooling = pow( 1e-6, 4.0 / max_step );
+  bool move;
 
   // main loop
-  for ( int k = 0; k < sa_params->max_step; ++k ) {
+  for ( int k = 0; k < max_step; ++k ) {
     // compute temperature
-    temp = ( * sa_params->temp ) ( k+1 );
+    if ( k >= max_step - params->k0 )
+      temp = 0;
+    else if ( params->schedule == SA_SCHEDULE_ADAPTIVE )
+      temp = t_adapt;
+    else
+      temp = ( * params->temp ) ( params, kt + 1 );
     // pick a neighbour
-    neighbour = ( * sa_params->neighbour ) ( n, point );
-    energy_new =
-      ( * sa_params->energy ) ( exp_eval( exp_res[ 0 ], neighbour ) );
-    for ( int i = 1; i < p->conclusion->pos_cfd_num; ++i ) {
-      energy = ( * sa_params->energy ) ( exp_eval( exp_res[ i ], point ) );
-      if ( energy < energy_new )
-        energy = energy_new;
-    }
+    neighbour = ( * params->neighbour ) ( params, n, sigma, point );
+    if ( use_bounds ) {
+      inside = true;
+      for ( int i = 0; i < n; ++i )
+        if ( neighbour[ i ] < lo[ i ] || neighbour[ i ] > hi[ i ] )
+          inside = false;
+      if ( ! inside ) {
+        // the box is twice as large as the largest move seen so far
+        dist = 0;
+        for ( int i = 0; i < n; ++i )
+          if ( fabs( neighbour[ i ] - point[ i ] ) > dist )
+            dist = fabs( neighbour[ i ] - point[ i ] );
+        if ( 2 * dist > radius )
+          radius = 2 * dist;
+        for ( int i = 0; i < n; ++i ) {
+          lo[ i ] = point[ i ] - radius;
+          hi[ i ] = point[ i ] + radius;
+        }
+        obj_bound( obj, lo, hi, bounds, work );
+      }
+      cfd_new = obj_eval_bounded( obj, neighbour, bounds, &hint, work );
+    } else
+      cfd_new = obj_eval( obj, neighbour, work );
+    energy_new = ( * params->energy ) ( cfd_new );
     // replace current point by neighbour probabilistically
-    if ( ( * sa_params->prob ) ( energy_old, energy_new, temp ) >=
-         ( double ) rand() / RAND_MAX ) {
+    move = ( * params->prob ) ( energy_old, energy_new, temp ) >=
+           ( double ) rng_rand() / RAND_MAX;
+    if ( move ) {
       for ( int i = 0; i < n; ++i )
         point[ i ] = neighbour[ i ];
       energy_old = energy_new;
+      accepted++;
       if ( energy_old < energy_best ) {
         for ( int i = 0; i < n; ++i )
           best[ i ] = point[ i ];
         energy_best = energy_old;
+        cfd_best = cfd_new;
+        improved = k;
+        if ( trace_improved( tr, cfd_best, best ) )
+          break;
       }
     }
+    // adapt the temperature to the target acceptance rate
+    if ( params->schedule == SA_SCHEDULE_ADAPTIVE ) {
+      acceptance = 0.99 * acceptance + ( move ? 0.01 : 0 );
+      if ( acceptance > sa_lam_target( ( double ) kt /
+                                       ( max_step - params->k0 ) ) )
+        t_adapt *= cooling;
+      else
+        t_adapt /= cooling;
+    }
+    kt++;
+    // reheat: restart the schedule from the best point
+    if ( params->reheat > 0 && k - improved >= params->reheat ) {
+      for ( int i = 0; i < n; ++i )
+        point[ i ] = best[ i ];
+      energy_old = energy_best;
+      kt = 0;
+      t_adapt = params->t_max;
+      acceptance = 1;
+      improved = k;
+    }
+    if ( trace_due( tr, k + 1 ) ) {
+      trace_record( tr, k + 1, energy_old, temp,
+                    ( double ) accepted / tr->every, energy_best );
+      accepted = 0;
+      if ( trace_stop( tr, cfd_best ) )
+        break;
+    }
   }
 
   for ( int i = 0; i < n; ++i )
@@ -589,104 +1252,1031 @@ double* resource_repartition_sa( int n, proof p, expression* cfd_res,
   return best;
 }
 
-double* resource_repartition_sahc( int n, proof p, expression* cfd_res,
-                                   double* sigma, double res,
+double* resource_repartition_sahc( int n, objective obj,
+                                   double* sigma, double res, double* start,
+                                   trace tr,
                                    simulated_annealing_params sa_params,
                                    hill_climbing_params hc_params ) {
-  // warning: we use < on doubles (rather than dcompare) here for hill climbing
-  // to work better
-  expression* exp_res = GC_MALLOC( p->conclusion->pos_cfd_num *
-                                   sizeof( expression ) );
-  for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
-    exp_res[ i ] = exp_array_composition( p->conclusion->ccl_pos_cfds[ i ],
-                                          cfd_res );
-  double* res_all = resource_repartition_sa( n, p, cfd_res, sigma, res,
-                                             sa_params );
+  double* res_all = resource_repartition_sa( n, obj, sigma, res,
+                                             start, tr, sa_params );
   for ( int i = 0; i < n; ++i )
     res_all[ i ] += sigma[ i ];
-  double x, y, l2_norm, r, best = 0;
-  // dir: the delta between current point and next point to test
-  // is chosen by choosing a direction uniformly for the first n-1 components
-  // and staying on the hyperplane r_1 + ... + r_n = res
-  double* dir = GC_MALLOC( n * sizeof( double ) );
-  // test: the next point to test
-  double* test = GC_MALLOC( n * sizeof( double ) );
-  // best_res would be used if we sometimes chose worse solutions
-  // (e.g., in simulated annealing)
-  for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
-    if ( best < exp_eval( exp_res[ i ], res_all ) )
-      best = exp_eval( exp_res[ i ], res_all );
-  // starting hill climbing
-  for ( int iters = 0; iters < hc_params->iters; ++iters ) {
-    // pick a random direction on S^(n-2) = random direction for n-1 vectors
-    for ( int i = 0; i < n / 2; ++i ) {
-      x = ( double ) rand() / RAND_MAX;
-      y = ( double ) rand() / RAND_MAX;
-      box_muller( x, y, dir + 2 * i );
-    }
-    if ( n % 2 == 1 ) {
-      x = ( double ) rand() / RAND_MAX;
-      y = ( double ) rand() / RAND_MAX;
-      box_muller( x, y, dir + n - 2 ); // overwrites the penultimate value,
-                                       // but who cares?
-    }
-    dir[ n - 1 ] = 0;
-    for ( int i = 0; i < n - 1; ++i ) {
-      dir[ n - 1 ] -= dir[ i ];
+  hill_climbing( obj, sigma, res, res_all, hc_params );
+  for ( int i = 0; i < n; ++i )
+    res_all[ i ] -= sigma[ i ];
+  return res_all;
+}
+
+// branch and bound
+
+// a box [lo,hi] of allocations, with an upper bound [ub] of the confidence
+// reached in it
+typedef struct bb_node_s {
+  double ub;
+  double* lo;
+  double* hi;
+} *bb_node;
+
+// the state shared by the threads exploring boxes: the parameters, a heap of
+// boxes to split (by decreasing upper bound), the best allocation known, and
+// the largest upper bound of the boxes discarded
+typedef struct bb_state_s {
+  objective obj;
+  double* sigma;
+  double total;
+  branch_bound_params params;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  bb_node* heap;
+  int heap_size;
+  int heap_capacity;
+  int busy;
+  int nodes;
+  bool stop;
+  double best;
+  double* best_point;
+  double discarded;
+} *bb_state;
+
+void bb_heap_push( bb_state st, bb_node node ) {
+  if ( st->heap_size == st->heap_capacity ) {
+    st->heap_capacity *= 2;
+    bb_node* heap = GC_MALLOC( st->heap_capacity * sizeof( bb_node ) );
+    for ( int i = 0; i < st->heap_size; ++i )
+      heap[ i ] = st->heap[ i ];
+    st->heap = heap;
+  }
+  int i = st->heap_size++;
+  while ( i > 0 && st->heap[ ( i - 1 ) / 2 ]->ub < node->ub ) {
+    st->heap[ i ] = st->heap[ ( i - 1 ) / 2 ];
+    i = ( i - 1 ) / 2;
+  }
+  st->heap[ i ] = node;
+}
+
+bb_node bb_heap_pop( bb_state st ) {
+  bb_node res = st->heap[ 0 ];
+  bb_node last = st->heap[ --st->heap_size ];
+  int i = 0, child;
+  while ( ( child = 2 * i + 1 ) < st->heap_size ) {
+    if ( child + 1 < st->heap_size &&
+         st->heap[ child + 1 ]->ub > st->heap[ child ]->ub )
+      ++child;
+    if ( st->heap[ child ]->ub <= last->ub )
+      break;
+    st->heap[ i ] = st->heap[ child ];
+    i = child;
+  }
+  st->heap[ i ] = last;
+  return res;
+}
+
+// shrinks the box [lo,hi] to the smallest box containing its intersection
+// with the hyperplane x_1 + ... + x_n = total, returns false if it is empty
+bool bb_tighten( int n, double* lo, double* hi, double total ) {
+  double sum_lo = 0, sum_hi = 0, l, h;
+  for ( int i = 0; i < n; ++i ) {
+    sum_lo += lo[ i ];
+    sum_hi += hi[ i ];
+  }
+  if ( sum_lo > total || sum_hi < total )
+    return false;
+  for ( int i = 0; i < n; ++i ) {
+    h = total - ( sum_lo - lo[ i ] );
+    l = total - ( sum_hi - hi[ i ] );
+    if ( h < hi[ i ] )
+      hi[ i ] = h;
+    if ( l > lo[ i ] )
+      lo[ i ] = l;
+    if ( lo[ i ] > hi[ i ] )
+      lo[ i ] = hi[ i ];
+  }
+  return true;
+}
+
+// computes the upper bound of a tightened box, and the confidence at a
+// feasible [point] of the box (that it stores)
+double bb_bound( objective obj, bb_node node, double total, double* point,
+                 double* work ) {
+  int n = obj->n;
+  double sum_lo = 0, sum_hi = 0, t = 0;
+  for ( int i = 0; i < n; ++i ) {
+    sum_lo += node->lo[ i ];
+    sum_hi += node->hi[ i ];
+  }
+  if ( sum_hi > sum_lo )
+    t = ( total - sum_lo ) / ( sum_hi - sum_lo );
+  for ( int i = 0; i < n; ++i )
+    point[ i ] = node->lo[ i ] + t * ( node->hi[ i ] - node->lo[ i ] );
+  double val = obj_eval( obj, point, work );
+  node->ub = obj_bound_hyperplane( obj, node->lo, node->hi, point, work );
+  // the value at a point of the box is a bound too, despite rounding
+  if ( val > node->ub )
+    node->ub = val;
+  return val;
+}
+
+// records a box (to split if it may contain a better allocation than the best
+// known one) and the allocation found in it (locked by the caller)
+void bb_record( bb_state st, bb_node node, double val, double* point ) {
+  int n = st->obj->n;
+  if ( val > st->best ) {
+    st->best = val;
+    for ( int i = 0; i < n; ++i )
+      st->best_point[ i ] = point[ i ];
+  }
+  if ( node->ub > st->best + st->params->gap )
+    bb_heap_push( st, node );
+  else if ( node->ub > st->discarded )
+    st->discarded = node->ub;
+}
+
+// the loop of each thread: pick the box with the largest upper bound, split
+// it in two along its widest dimension, and record both halves
+void bb_worker( int worker, void* arg ) {
+  bb_state st = arg;
+  int n = st->obj->n;
+  double* work = obj_work_new( st->obj );
+  double* points[ 2 ];
+  double vals[ 2 ];
+  bb_node children[ 2 ];
+  for ( int c = 0; c < 2; ++c )
+    points[ c ] = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  ( void ) worker;
+  pthread_mutex_lock( &st->lock );
+  while ( true ) {
+    // wait for boxes to split, unless no thread can produce any more
+    while ( st->heap_size == 0 && st->busy > 0 && ! st->stop )
+      pthread_cond_wait( &st->cond, &st->lock );
+    if ( st->stop || st->heap_size == 0 )
+      break;
+    bb_node node = bb_heap_pop( st );
+    if ( node->ub <= st->best + st->params->gap ) {
+      if ( node->ub > st->discarded )
+        st->discarded = node->ub;
+      continue;
+    }
+    if ( st->nodes >= st->params->max_nodes ) {
+      bb_heap_push( st, node );
+      st->stop = true;
+      break;
     }
+    st->nodes++;
+    st->busy++;
+    pthread_mutex_unlock( &st->lock );
+    // on errors (see [error_exit]), the other threads stop instead of waiting
+    // for the children of the box
+    error_handler h;
+    if ( setjmp( h.env ) != 0 ) {
+      pthread_mutex_lock( &st->lock );
+      st->busy--;
+      st->stop = true;
+      pthread_cond_broadcast( &st->cond );
+      pthread_mutex_unlock( &st->lock );
+      error_exit();
+    }
+    error_push( &h );
+    int k = 0;
+    for ( int i = 1; i < n; ++i )
+      if ( node->hi[ i ] - node->lo[ i ] > node->hi[ k ] - node->lo[ k ] )
+        k = i;
+    double mid = ( node->lo[ k ] + node->hi[ k ] ) / 2;
+    for ( int c = 0; c < 2; ++c ) {
+      children[ c ] = GC_MALLOC( sizeof( struct bb_node_s ) );
+      children[ c ]->lo = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+      children[ c ]->hi = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+      for ( int i = 0; i < n; ++i ) {
+        children[ c ]->lo[ i ] = node->lo[ i ];
+        children[ c ]->hi[ i ] = node->hi[ i ];
+      }
+      if ( c == 0 )
+        children[ c ]->hi[ k ] = mid;
+      else
+        children[ c ]->lo[ k ] = mid;
+      if ( bb_tighten( n, children[ c ]->lo, children[ c ]->hi, st->total ) )
+        vals[ c ] = bb_bound( st->obj, children[ c ], st->total, points[ c ],
+                              work );
+      else
+        children[ c ] = NULL;
+    }
+    error_pop( &h );
+    pthread_mutex_lock( &st->lock );
+    for ( int c = 0; c < 2; ++c )
+      if ( children[ c ] != NULL )
+        bb_record( st, children[ c ], vals[ c ], points[ c ] );
+    st->busy--;
+    pthread_cond_broadcast( &st->cond );
+  }
+  pthread_cond_broadcast( &st->cond );
+  pthread_mutex_unlock( &st->lock );
+}
+
+// branch and bound on the feasible set
+// { x | x_i >= sigma_i, x_1 + ... + x_n = sigma_1 + ... + sigma_n + res },
+// with upper bounds computed by interval arithmetic on boxes, and lower bounds
+// given by gradient ascent and by a feasible point of each box
+double* resource_repartition_bb( int n, objective obj,
+                                 double* sigma, double res, double* start,
+                                 trace tr,
+                                 gradient_ascent_params ga_params,
+                                 branch_bound_params bb_params,
+                                 optim_report report ) {
+  bb_state st = GC_MALLOC( sizeof( struct bb_state_s ) );
+  st->obj = obj;
+  st->sigma = sigma;
+  st->params = bb_params;
+  st->total = res;
+  for ( int i = 0; i < n; ++i )
+    st->total += sigma[ i ];
+  pthread_mutex_init( &st->lock, NULL );
+  pthread_cond_init( &st->cond, NULL );
+  st->heap_capacity = 64;
+  st->heap = GC_MALLOC( st->heap_capacity * sizeof( bb_node ) );
+  st->heap_size = 0;
+  st->busy = 0;
+  st->nodes = 0;
+  st->stop = false;
+  st->discarded = - INFINITY;
+  double* work = obj_work_new( st->obj );
+  // the result of gradient ascent is the first allocation known
+  st->best_point = resource_repartition_ga( n, obj, sigma, res,
+                                            start, tr, ga_params );
+  for ( int i = 0; i < n; ++i )
+    st->best_point[ i ] += sigma[ i ];
+  st->best = obj_eval( st->obj, st->best_point, work );
+  // the root box
+  bb_node root = GC_MALLOC( sizeof( struct bb_node_s ) );
+  root->lo = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  root->hi = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  for ( int i = 0; i < n; ++i ) {
+    root->lo[ i ] = sigma[ i ];
+    root->hi[ i ] = sigma[ i ] + res;
+  }
+  double* point = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  bb_tighten( n, root->lo, root->hi, st->total );
+  bb_record( st, root, bb_bound( st->obj, root, st->total, point, work ),
+             point );
+  parallel_run( bb_params->threads, bb_worker, st );
+  pthread_mutex_destroy( &st->lock );
+  pthread_cond_destroy( &st->cond );
+  if ( report != NULL ) {
+    // the optimum is in a box left to split, in a discarded box, or found
+    report->confidence = st->best;
+    report->bound = st->best;
+    if ( st->discarded > report->bound )
+      report->bound = st->discarded;
+    for ( int i = 0; i < st->heap_size; ++i )
+      if ( st->heap[ i ]->ub > report->bound )
+        report->bound = st->heap[ i ]->ub;
+  }
+  for ( int i = 0; i < n; ++i )
+    st->best_point[ i ] -= sigma[ i ];
+  return st->best_point;
+}
+
+// CMA-ES
+
+// the samples of a generation to evaluate in parallel, with a buffer for each
+// thread
+typedef struct cma_generation_s {
+  objective obj;
+  double** points;
+  double* values;
+  double** works;
+} *cma_generation;
+
+void cma_eval( int k, int worker, void* arg ) {
+  cma_generation gen = arg;
+  gen->values[ k ] =
+    obj_eval( gen->obj, gen->points[ k ], gen->works[ worker ] );
+}
+
+// CMA-ES in the coordinates y of the basis of H_0 (see [hyperplane_from_basis])
+// of the points x = x0 + B y, where x0 is [start] (or the balanced point),
+// with samples below [sigma] repaired by projection (and the repaired samples
+// used for the updates)
+double* resource_repartition_cma( int n, objective obj,
+                                  double* sigma, double res, double* start,
+                                  trace tr,
+                                  cma_es_params params ) {
+  int dim = n - 1;
+  double total = res;
+  for ( int i = 0; i < n; ++i )
+    total += sigma[ i ];
+  double* x0 = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  double* best = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  for ( int i = 0; i < n; ++i ) {
+    x0[ i ] = sigma[ i ] + ( start ? start[ i ] : res / n );
+    best[ i ] = x0[ i ];
+  }
+  double* work = obj_work_new( obj );
+  double best_val = obj_eval( obj, best, work );
+  trace_start( tr, n, sigma );
+  if ( dim == 0 || res <= 0 ) {
     for ( int i = 0; i < n; ++i )
-      l2_norm += dir[ i ] * dir[ i ];
-    l2_norm = sqrt( l2_norm );
-    // pick a random radius
-    r = pow( ( double ) rand() / RAND_MAX, 1 / ( n - 1 ) );
-    r *= hc_params->step_size / l2_norm;
-    // rescale the point if it goes outside the bounds (the total amount of
-    // resource allocated to a component is below the initial amount)
+      best[ i ] -= sigma[ i ];
+    return best;
+  }
+
+  // strategy parameters (default values of Hansen's tutorial)
+  int lambda = params->population > 0 ? params->population :
+                                         4 + ( int ) ( 3 * log( dim ) );
+  int mu = lambda / 2;
+  double* weights = GC_MALLOC_ATOMIC( mu * sizeof( double ) );
+  double sum_w = 0, sum_w2 = 0;
+  for ( int i = 0; i < mu; ++i ) {
+    weights[ i ] = log( mu + 0.5 ) - log( i + 1 );
+    sum_w += weights[ i ];
+  }
+  for ( int i = 0; i < mu; ++i ) {
+    weights[ i ] /= sum_w;
+    sum_w2 += weights[ i ] * weights[ i ];
+  }
+  double mueff = 1 / sum_w2;
+  double cc = ( 4 + mueff / dim ) / ( dim + 4 + 2 * mueff / dim );
+  double cs = ( mueff + 2 ) / ( dim + mueff + 5 );
+  double c1 = 2 / ( ( dim + 1.3 ) * ( dim + 1.3 ) + mueff );
+  double cmu = 2 * ( mueff - 2 + 1 / mueff ) /
+               ( ( dim + 2 ) * ( dim + 2 ) + mueff );
+  if ( cmu > 1 - c1 )
+    cmu = 1 - c1;
+  double damps = 1 + cs +
+    2 * fmax( 0, sqrt( ( mueff - 1 ) / ( dim + 1 ) ) - 1 );
+  double chi = sqrt( dim ) * ( 1 - 1.0 / ( 4 * dim ) +
+                               1.0 / ( 21 * dim * dim ) );
+
+  // state: mean, step, evolution paths, covariance C = B diag( d^2 ) B^T
+  double step = params->step > 0 ? params->step : res / n;
+  double* mean = GC_MALLOC_ATOMIC( dim * sizeof( double ) );
+  double* mean_step = GC_MALLOC_ATOMIC( dim * sizeof( double ) );
+  double* ps = GC_MALLOC_ATOMIC( dim * sizeof( double ) );
+  double* pc = GC_MALLOC_ATOMIC( dim * sizeof( double ) );
+  double* cov = GC_MALLOC_ATOMIC( dim * dim * sizeof( double ) );
+  double* eig = GC_MALLOC_ATOMIC( dim * dim * sizeof( double ) );
+  double* basis = GC_MALLOC_ATOMIC( dim * dim * sizeof( double ) );
+  double* d = GC_MALLOC_ATOMIC( dim * sizeof( double ) );
+  double* z = GC_MALLOC_ATOMIC( ( dim + 1 ) * sizeof( double ) );
+  double* tmp = GC_MALLOC_ATOMIC( dim * sizeof( double ) );
+  for ( int i = 0; i < dim; ++i ) {
+    mean[ i ] = 0;
+    ps[ i ] = 0;
+    pc[ i ] = 0;
+    d[ i ] = 1;
+    for ( int j = 0; j < dim; ++j ) {
+      cov[ i * dim + j ] = i == j;
+      basis[ i * dim + j ] = i == j;
+    }
+  }
+  // samples (the y are normalised: x = x0 + B ( mean + step y ))
+  cma_generation gen = GC_MALLOC( sizeof( struct cma_generation_s ) );
+  gen->obj = obj;
+  gen->points = GC_MALLOC( lambda * sizeof( double* ) );
+  gen->values = GC_MALLOC_ATOMIC( lambda * sizeof( double ) );
+  int threads = parallel_threads( params->threads );
+  gen->works = GC_MALLOC( threads * sizeof( double* ) );
+  for ( int i = 0; i < threads; ++i )
+    gen->works[ i ] = obj_work_new( obj );
+  double** ys = GC_MALLOC( lambda * sizeof( double* ) );
+  for ( int k = 0; k < lambda; ++k ) {
+    gen->points[ k ] = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+    ys[ k ] = GC_MALLOC_ATOMIC( dim * sizeof( double ) );
+  }
+  int* order = GC_MALLOC_ATOMIC( lambda * sizeof( int ) );
+  int evals = 0, eigen_gen = 0;
+  double x, y, norm_ps, hsig, max_d;
+
+  for ( int g = 1; evals + lambda <= params->max_evals; ++g ) {
+    // sample the generation
+    for ( int k = 0; k < lambda; ++k ) {
+      for ( int i = 0; i < dim; i += 2 ) {
+        x = ( ( double ) rng_rand() + 1 ) / ( ( double ) RAND_MAX + 1 );
+        y = ( double ) rng_rand() / RAND_MAX;
+        box_muller( x, y, z + i );
+      }
+      for ( int i = 0; i < dim; ++i ) {
+        ys[ k ][ i ] = 0;
+        for ( int j = 0; j < dim; ++j )
+          ys[ k ][ i ] += basis[ i * dim + j ] * d[ j ] * z[ j ];
+        tmp[ i ] = mean[ i ] + step * ys[ k ][ i ];
+      }
+      for ( int i = 0; i < n; ++i )
+        gen->points[ k ][ i ] = x0[ i ];
+      hyperplane_from_basis( n, tmp, gen->points[ k ] );
+      // repair
+      project_simplex( n, gen->points[ k ], sigma, total );
+      for ( int i = 0; i < n; ++i )
+        gen->points[ k ][ i ] -= x0[ i ];
+      hyperplane_to_basis( n, gen->points[ k ], tmp );
+      for ( int i = 0; i < n; ++i )
+        gen->points[ k ][ i ] += x0[ i ];
+      for ( int i = 0; i < dim; ++i )
+        ys[ k ][ i ] = ( tmp[ i ] - mean[ i ] ) / step;
+    }
+    parallel_for( threads, lambda, cma_eval, gen );
+    evals += lambda;
+    // sort the samples by decreasing confidence
+    for ( int k = 0; k < lambda; ++k ) {
+      int j = k;
+      while ( j > 0 && gen->values[ order[ j - 1 ] ] < gen->values[ k ] ) {
+        order[ j ] = order[ j - 1 ];
+        --j;
+      }
+      order[ j ] = k;
+    }
+    if ( gen->values[ order[ 0 ] ] > best_val ) {
+      best_val = gen->values[ order[ 0 ] ];
+      for ( int i = 0; i < n; ++i )
+        best[ i ] = gen->points[ order[ 0 ] ][ i ];
+      if ( trace_improved( tr, best_val, best ) )
+        break;
+    }
+    if ( trace_due( tr, g ) && trace_stop( tr, best_val ) )
+      break;
+    // move the mean
+    for ( int i = 0; i < dim; ++i ) {
+      mean_step[ i ] = 0;
+      for ( int k = 0; k < mu; ++k )
+        mean_step[ i ] += weights[ k ] * ys[ order[ k ] ][ i ];
+      mean[ i ] += step * mean_step[ i ];
+    }
+    // update the evolution paths (with C^(-1/2) = B diag( 1/d ) B^T)
+    for ( int j = 0; j < dim; ++j ) {
+      tmp[ j ] = 0;
+      for ( int i = 0; i < dim; ++i )
+        tmp[ j ] += basis[ i * dim + j ] * mean_step[ i ];
+      tmp[ j ] = d[ j ] > 0 ? tmp[ j ] / d[ j ] : 0;
+    }
+    norm_ps = 0;
+    for ( int i = 0; i < dim; ++i ) {
+      double c = 0;
+      for ( int j = 0; j < dim; ++j )
+        c += basis[ i * dim + j ] * tmp[ j ];
+      ps[ i ] = ( 1 - cs ) * ps[ i ] + sqrt( cs * ( 2 - cs ) * mueff ) * c;
+      norm_ps += ps[ i ] * ps[ i ];
+    }
+    norm_ps = sqrt( norm_ps );
+    hsig = norm_ps / sqrt( 1 - pow( 1 - cs, 2 * g ) ) / chi <
+           1.4 + 2.0 / ( dim + 1 );
+    for ( int i = 0; i < dim; ++i )
+      pc[ i ] = ( 1 - cc ) * pc[ i ] +
+                hsig * sqrt( cc * ( 2 - cc ) * mueff ) * mean_step[ i ];
+    // update the covariance (rank-one and rank-mu updates)
+    for ( int i = 0; i < dim; ++i )
+      for ( int j = 0; j <= i; ++j ) {
+        double rank_mu = 0;
+        for ( int k = 0; k < mu; ++k )
+          rank_mu += weights[ k ] * ys[ order[ k ] ][ i ] *
+                     ys[ order[ k ] ][ j ];
+        cov[ i * dim + j ] =
+          ( 1 - c1 - cmu ) * cov[ i * dim + j ] +
+          c1 * ( pc[ i ] * pc[ j ] +
+                 ( 1 - hsig ) * cc * ( 2 - cc ) * cov[ i * dim + j ] ) +
+          cmu * rank_mu;
+        cov[ j * dim + i ] = cov[ i * dim + j ];
+      }
+    // adapt the step
+    step *= exp( ( cs / damps ) * ( norm_ps / chi - 1 ) );
+    // decompose the covariance (not at every generation, as it is cubic)
+    if ( g - eigen_gen > lambda / ( c1 + cmu ) / dim / 10 ) {
+      eigen_gen = g;
+      for ( int i = 0; i < dim * dim; ++i )
+        eig[ i ] = cov[ i ];
+      eigen_symmetric( dim, eig, d, basis );
+      for ( int i = 0; i < dim; ++i )
+        d[ i ] = d[ i ] > 0 ? sqrt( d[ i ] ) : 0;
+    }
+    max_d = 0;
+    for ( int i = 0; i < dim; ++i )
+      if ( d[ i ] > max_d )
+        max_d = d[ i ];
+    if ( step * max_d < params->stop_error * res )
+      break;
+  }
+
+  for ( int i = 0; i < n; ++i )
+    best[ i ] -= sigma[ i ];
+  return best;
+}
+
+// surrogate-assisted optimisation
+
+// the features of the quadratic model at [u] (of size [dim]): 1, the u_i, and
+// the u_i u_j for i <= j
+void surrogate_features( int dim, double* u, double* feat ) {
+  int t = 0;
+  feat[ t++ ] = 1;
+  for ( int i = 0; i < dim; ++i )
+    feat[ t++ ] = u[ i ];
+  for ( int i = 0; i < dim; ++i )
+    for ( int j = i; j < dim; ++j )
+      feat[ t++ ] = u[ i ] * u[ j ];
+}
+
+// the distance between [u] and [v] (of size [dim])
+double surrogate_dist( int dim, double* u, double* v ) {
+  double d = 0;
+  for ( int i = 0; i < dim; ++i )
+    d += ( u[ i ] - v[ i ] ) * ( u[ i ] - v[ i ] );
+  return sqrt( d );
+}
+
+// the cubic radial function of the distance between [u] and [v]
+double surrogate_radial( int dim, double* u, double* v ) {
+  double d = surrogate_dist( dim, u, v );
+  return d * d * d;
+}
+
+// fits the model on the [m] points [us] (row-major, of size [dim]) with values
+// [vals], storing its coefficients in [coefs] (the weights of the radial
+// functions then the linear tail for RBF, the weights of the features for
+// quadratic models), using [a] as buffer for the matrix of the system, returns
+// false if the system is singular
+bool surrogate_fit( enum CASE_SURROGATE_MODEL model, int dim, int m,
+                    double* us, double* vals, double* coefs, double* a,
+                    double* feat ) {
+  if ( model == SURROGATE_RBF ) {
+    int size = m + dim + 1;
+    for ( int i = 0; i < size * size; ++i )
+      a[ i ] = 0;
+    for ( int k = 0; k < m; ++k ) {
+      for ( int l = 0; l < m; ++l )
+        a[ k * size + l ] = surrogate_radial( dim, us + k * dim,
+                                              us + l * dim );
+      a[ k * size + m ] = 1;
+      a[ m * size + k ] = 1;
+      for ( int i = 0; i < dim; ++i ) {
+        a[ k * size + m + 1 + i ] = us[ k * dim + i ];
+        a[ ( m + 1 + i ) * size + k ] = us[ k * dim + i ];
+      }
+      coefs[ k ] = vals[ k ];
+    }
+    for ( int i = m; i < size; ++i )
+      coefs[ i ] = 0;
+    return linear_solve( size, a, coefs );
+  }
+  // normal equations, with a small ridge in case of too few points
+  int terms = 1 + dim + dim * ( dim + 1 ) / 2;
+  for ( int i = 0; i < terms * terms; ++i )
+    a[ i ] = 0;
+  for ( int i = 0; i < terms; ++i )
+    coefs[ i ] = 0;
+  for ( int k = 0; k < m; ++k ) {
+    surrogate_features( dim, us + k * dim, feat );
+    for ( int i = 0; i < terms; ++i ) {
+      for ( int j = 0; j < terms; ++j )
+        a[ i * terms + j ] += feat[ i ] * feat[ j ];
+      coefs[ i ] += feat[ i ] * vals[ k ];
+    }
+  }
+  double trace = 0;
+  for ( int i = 0; i < terms; ++i )
+    trace += a[ i * terms + i ];
+  for ( int i = 0; i < terms; ++i )
+    a[ i * terms + i ] += 1e-10 * trace / terms;
+  return linear_solve( terms, a, coefs );
+}
+
+// the value at [u] of the model fitted by [surrogate_fit]
+double surrogate_predict( enum CASE_SURROGATE_MODEL model, int dim, int m,
+                          double* us, double* coefs, double* u,
+                          double* feat ) {
+  double val = 0;
+  if ( model == SURROGATE_RBF ) {
+    for ( int k = 0; k < m; ++k )
+      val += coefs[ k ] * surrogate_radial( dim, u, us + k * dim );
+    val += coefs[ m ];
+    for ( int i = 0; i < dim; ++i )
+      val += coefs[ m + 1 + i ] * u[ i ];
+    return val;
+  }
+  int terms = 1 + dim + dim * ( dim + 1 ) / 2;
+  surrogate_features( dim, u, feat );
+  for ( int i = 0; i < terms; ++i )
+    val += coefs[ i ] * feat[ i ];
+  return val;
+}
+
+// surrogate-assisted optimisation in the coordinates u of the basis of H_0
+// (see [hyperplane_from_basis]) of the points x = x0 + res B u, where x0 is
+// [start] (or the balanced point), candidates below [sigma] being repaired by
+// projection; the candidate evaluated is the best one for a score weighting
+// the predicted confidence against the distance to the evaluated points, with
+// weights cycling from exploration to exploitation (stochastic RBF method of
+// Regis and Shoemaker)
+double* resource_repartition_surrogate( int n, objective obj,
+                                        double* sigma, double res,
+                                        double* start, trace tr,
+                                        surrogate_params params ) {
+  int dim = n - 1;
+  double total = res;
+  for ( int i = 0; i < n; ++i )
+    total += sigma[ i ];
+  double* x0 = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  double* best = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  for ( int i = 0; i < n; ++i ) {
+    x0[ i ] = sigma[ i ] + ( start ? start[ i ] : res / n );
+    best[ i ] = x0[ i ];
+  }
+  double* work = obj_work_new( obj );
+  double best_val = obj_eval( obj, best, work );
+  trace_start( tr, n, sigma );
+  if ( dim == 0 || res <= 0 ) {
+    for ( int i = 0; i < n; ++i )
+      best[ i ] -= sigma[ i ];
+    return best;
+  }
+
+  bool rbf = params->model == SURROGATE_RBF;
+  int terms = 1 + dim + dim * ( dim + 1 ) / 2;
+  int max_evals = params->max_evals;
+  int samples = params->samples > 0 ? params->samples :
+                rbf ? 2 * ( dim + 1 ) : terms + dim + 1;
+  if ( samples > max_evals )
+    samples = max_evals;
+  int size = rbf ? max_evals + dim + 1 : terms;
+  double* us = GC_MALLOC_ATOMIC( max_evals * dim * sizeof( double ) );
+  double* vals = GC_MALLOC_ATOMIC( max_evals * sizeof( double ) );
+  double* coefs = GC_MALLOC_ATOMIC( size * sizeof( double ) );
+  double* a = GC_MALLOC_ATOMIC( size * size * sizeof( double ) );
+  double* feat = GC_MALLOC_ATOMIC( terms * sizeof( double ) );
+  int cand_num = params->candidates;
+  double* cand_x = GC_MALLOC_ATOMIC( cand_num * n * sizeof( double ) );
+  double* cand_u = GC_MALLOC_ATOMIC( cand_num * dim * sizeof( double ) );
+  double* preds = GC_MALLOC_ATOMIC( cand_num * sizeof( double ) );
+  double* dists = GC_MALLOC_ATOMIC( cand_num * sizeof( double ) );
+  double* x = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  double* dx = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  double* z = GC_MALLOC_ATOMIC( ( dim + 1 ) * sizeof( double ) );
+  double weights[ 4 ] = { 0.3, 0.5, 0.8, 0.95 };
+  double step = ( params->step > 0 ? params->step : res / n ) / res;
+  double val, r, g, score, best_score, pmin, pmax, dmin, dmax;
+  int best_k = 0, successes = 0, failures = 0, chosen;
+  bool fitted;
+
+  for ( int m = 0; m < max_evals; ++m ) {
+    if ( m < samples ) {
+      // initial design: the starting point, then uniformly random allocations
+      r = 0;
+      for ( int i = 0; i < n; ++i ) {
+        x[ i ] = m == 0 ? 0 :
+          - log( ( ( double ) rng_rand() + 1 ) /
+                 ( ( double ) RAND_MAX + 1 ) );
+        r += x[ i ];
+      }
+      for ( int i = 0; i < n; ++i )
+        x[ i ] = m == 0 ? x0[ i ] : sigma[ i ] + res * x[ i ] / r;
+    } else {
+      fitted = surrogate_fit( params->model, dim, m, us, vals, coefs, a,
+                              feat );
+      // candidates: perturbations of the best point and random allocations
+      for ( int c = 0; c < cand_num; ++c ) {
+        double* xc = cand_x + c * n;
+        double* uc = cand_u + c * dim;
+        if ( c % 10 == 9 ) {
+          r = 0;
+          for ( int i = 0; i < n; ++i ) {
+            xc[ i ] = - log( ( ( double ) rng_rand() + 1 ) /
+                             ( ( double ) RAND_MAX + 1 ) );
+            r += xc[ i ];
+          }
+          for ( int i = 0; i < n; ++i )
+            xc[ i ] = sigma[ i ] + res * xc[ i ] / r;
+        } else {
+          for ( int i = 0; i < dim; i += 2 ) {
+            r = ( ( double ) rng_rand() + 1 ) /
+                ( ( double ) RAND_MAX + 1 );
+            g = ( double ) rng_rand() / RAND_MAX;
+            box_muller( r, g, z + i );
+          }
+          for ( int i = 0; i < dim; ++i )
+            z[ i ] = res * ( us[ best_k * dim + i ] + step * z[ i ] );
+          for ( int i = 0; i < n; ++i )
+            xc[ i ] = x0[ i ];
+          hyperplane_from_basis( n, z, xc );
+          project_simplex( n, xc, sigma, total );
+        }
+        for ( int i = 0; i < n; ++i )
+          dx[ i ] = ( xc[ i ] - x0[ i ] ) / res;
+        hyperplane_to_basis( n, dx, uc );
+        dists[ c ] = INFINITY;
+        for ( int k = 0; k < m; ++k ) {
+          r = surrogate_dist( dim, uc, us + k * dim );
+          if ( r < dists[ c ] )
+            dists[ c ] = r;
+        }
+        preds[ c ] = fitted ? surrogate_predict( params->model, dim, m, us,
+                                                 coefs, uc, feat ) : 0;
+      }
+      // score the candidates that are not already evaluated
+      pmin = INFINITY;
+      pmax = - INFINITY;
+      dmin = INFINITY;
+      dmax = - INFINITY;
+      for ( int c = 0; c < cand_num; ++c )
+        if ( dists[ c ] > 1e-3 * step ) {
+          pmin = fmin( pmin, preds[ c ] );
+          pmax = fmax( pmax, preds[ c ] );
+          dmin = fmin( dmin, dists[ c ] );
+          dmax = fmax( dmax, dists[ c ] );
+        }
+      chosen = -1;
+      best_score = INFINITY;
+      g = weights[ ( m - samples ) % 4 ];
+      for ( int c = 0; c < cand_num; ++c )
+        if ( dists[ c ] > 1e-3 * step ) {
+          score = ( pmax > pmin ? g * ( pmax - preds[ c ] ) /
+                                  ( pmax - pmin ) : 0 ) +
+                  ( dmax > dmin ? ( 1 - g ) * ( dmax - dists[ c ] ) /
+                                  ( dmax - dmin ) : 0 );
+          if ( score < best_score ) {
+            best_score = score;
+            chosen = c;
+          }
+        }
+      if ( chosen < 0 ) {
+        // all candidates were already evaluated
+        step /= 2;
+        if ( step < params->stop_error )
+          break;
+        --m;
+        continue;
+      }
+      for ( int i = 0; i < n; ++i )
+        x[ i ] = cand_x[ chosen * n + i ];
+    }
+    // evaluate the confidence at the new point
+    val = obj_eval( obj, x, work );
+    for ( int i = 0; i < n; ++i )
+      dx[ i ] = ( x[ i ] - x0[ i ] ) / res;
+    hyperplane_to_basis( n, dx, us + m * dim );
+    vals[ m ] = val;
+    if ( m >= samples ) {
+      // adapt the size of perturbations
+      if ( val > best_val ) {
+        successes++;
+        failures = 0;
+      } else {
+        failures++;
+        successes = 0;
+      }
+      if ( successes >= 3 ) {
+        step = fmin( 2 * step, 1 );
+        successes = 0;
+      } else if ( failures >= ( dim > 5 ? dim : 5 ) ) {
+        step /= 2;
+        failures = 0;
+      }
+    }
+    if ( val > best_val || m == 0 ) {
+      best_k = m;
+      if ( val > best_val ) {
+        best_val = val;
+        for ( int i = 0; i < n; ++i )
+          best[ i ] = x[ i ];
+        if ( trace_improved( tr, best_val, best ) )
+          break;
+      }
+    }
+    if ( trace_due( tr, m + 1 ) && trace_stop( tr, best_val ) )
+      break;
+    if ( m >= samples && step < params->stop_error )
+      break;
+  }
+
+  for ( int i = 0; i < n; ++i )
+    best[ i ] -= sigma[ i ];
+  return best;
+}
+
+// restores the heap property of the max-heap [heap] of [size] hypotheses
+// ordered by [gains] at position [i] (when its gain decreased)
+void discrete_sift_down( int* heap, int size, double* gains, int i ) {
+  int last = heap[ i ], child;
+  while ( ( child = 2 * i + 1 ) < size ) {
+    if ( child + 1 < size &&
+         gains[ heap[ child + 1 ] ] > gains[ heap[ child ] ] )
+      ++child;
+    if ( gains[ heap[ child ] ] <= gains[ last ] )
+      break;
+    heap[ i ] = heap[ child ];
+    i = child;
+  }
+  heap[ i ] = last;
+}
+
+// allocation of whole units of resources: each unit goes where it increases
+// confidence the most, gains being kept in a priority queue and only
+// recomputed when they reach its top (which is exact as long as gains can only
+// decrease, e.g., for concave confidences), then single units are moved from
+// one hypothesis to another while it increases confidence, and what is left
+// (less than a unit) goes where it increases confidence the most
+double* resource_repartition_discrete( int n, objective obj,
+                                       double* sigma, double res,
+                                       double* start,
+                                       discrete_params params ) {
+  double* work = obj_work_new( obj );
+  double unit = params->unit;
+  int units = ( int ) floor( res / unit + 1e-9 );
+  double left = res - units * unit > 0 ? res - units * unit : 0;
+  double* point = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  int* counts = GC_MALLOC_ATOMIC( n * sizeof( int ) );
+  int placed = 0;
+  // the units of the starting allocation (if it fits)
+  for ( int i = 0; i < n; ++i ) {
+    counts[ i ] = start ? ( int ) floor( start[ i ] / unit ) : 0;
+    placed += counts[ i ];
+  }
+  if ( placed > units ) {
     for ( int i = 0; i < n; ++i )
-      if ( res_all[ i ] + dir[ i ] * r < sigma[ i ] )
-        r = ( sigma[ i ] - res_all[ i ] ) / dir[ i ];
-    // scale the direction and compute a new point
+      counts[ i ] = 0;
+    placed = 0;
+  }
+  for ( int i = 0; i < n; ++i )
+    point[ i ] = sigma[ i ] + counts[ i ] * unit;
+  double cur = obj_eval( obj, point, work );
+  double val;
+
+  // greedy allocation, [stamp] recording when each gain was computed
+  double* gains = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  int* stamp = GC_MALLOC_ATOMIC( n * sizeof( int ) );
+  int* heap = GC_MALLOC_ATOMIC( n * sizeof( int ) );
+  for ( int i = 0; i < n && placed < units; ++i ) {
+    point[ i ] += unit;
+    gains[ i ] = obj_eval( obj, point, work ) - cur;
+    point[ i ] -= unit;
+    stamp[ i ] = placed;
+    heap[ i ] = i;
+  }
+  if ( placed < units )
+    for ( int i = n / 2 - 1; i >= 0; --i )
+      discrete_sift_down( heap, n, gains, i );
+  while ( placed < units ) {
+    int i = heap[ 0 ];
+    if ( stamp[ i ] == placed ) {
+      point[ i ] += unit;
+      counts[ i ]++;
+      cur += gains[ i ];
+      placed++;
+    }
+    // the gain of [i] is either outdated or changed by the new unit
+    point[ i ] += unit;
+    gains[ i ] = obj_eval( obj, point, work ) - cur;
+    point[ i ] -= unit;
+    stamp[ i ] = placed;
+    discrete_sift_down( heap, n, gains, 0 );
+  }
+  cur = obj_eval( obj, point, work );
+
+  // local search: the best move of a single unit, while it improves
+  for ( int moves = 0; moves < params->max_moves; ++moves ) {
+    int best_from = -1, best_to = -1;
+    double best_val = cur;
     for ( int i = 0; i < n; ++i ) {
-      dir[ i ] *= r;
-      test[ i ] = res_all[ i ] + dir[ i ];
-    }
-    // evaluate the new point and make it the new known best if it's better
-    for ( int i = 0; i < p->conclusion->pos_cfd_num; ++i )
-      if ( exp_eval( exp_res[ i ], test ) > best ) {
-        best = exp_eval( exp_res[ i ], test );
-        for ( int j = 0; j < n; ++j )
-          res_all[ j ] = test[ j ];
-        break;
+      if ( counts[ i ] == 0 )
+        continue;
+      point[ i ] -= unit;
+      for ( int j = 0; j < n; ++j ) {
+        if ( j == i )
+          continue;
+        point[ j ] += unit;
+        val = obj_eval( obj, point, work );
+        point[ j ] -= unit;
+        if ( val > best_val ) {
+          best_val = val;
+          best_from = i;
+          best_to = j;
+        }
       }
+      point[ i ] += unit;
+    }
+    if ( best_from < 0 )
+      break;
+    point[ best_from ] -= unit;
+    counts[ best_from ]--;
+    point[ best_to ] += unit;
+    counts[ best_to ]++;
+    cur = best_val;
+  }
+
+  // what is left of the resources
+  int best_i = -1;
+  if ( left > 0 ) {
+    double best_val = - INFINITY;
+    for ( int i = 0; i < n; ++i ) {
+      point[ i ] += left;
+      val = obj_eval( obj, point, work );
+      point[ i ] -= left;
+      if ( val > best_val ) {
+        best_val = val;
+        best_i = i;
+      }
+    }
   }
+
   for ( int i = 0; i < n; ++i )
-    res_all[ i ] -= sigma[ i ];
-  return res_all;
+    point[ i ] = counts[ i ] * unit + ( i == best_i ? left : 0 );
+  return point;
 }
 
-double* resource_repartition( int n, proof p, expression* cfd_res,
-                              double* sigma, double res, optim_params params ) {
+// NSGA-II without costs, i.e., a genetic algorithm maximising confidence (the
+// most confident allocation of the front)
+double* resource_repartition_nsga( int n, objective obj,
+                                   double* sigma, double res, double* start,
+                                   nsga_params params ) {
+  pareto_front front = pareto_nsga( n, obj, cJSON_to_costs( NULL, n ),
+                                    sigma, res, start, params );
+  double* best = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  for ( int i = 0; i < n; ++i )
+    best[ i ] = front->allocations[ ( front->size - 1 ) * n + i ];
+  return best;
+}
+
+objective optim_objective( int n, proof p, expression* cfd_res,
+                           optim_params params ) {
+  if ( params->robust == NULL )
+    return obj_from_proof( n, p, cfd_res );
+  if ( params->uncertainty == NULL ) {
+    fprintf( stderr, "Robust optimisation needs uncertain constants.\n" );
+    error_exit();
+  }
+  return robust_objective( n, p, cfd_res, params->uncertainty,
+                           params->robust );
+}
+
+double* resource_repartition_objective( int n, objective obj, double* sigma,
+                                        double res, optim_params params,
+                                        optim_report report ) {
+  double* result;
   switch ( params->opt_algo_type ) {
     case GRAD_ASC:
-      return resource_repartition_ga( n, p, cfd_res, sigma, res,
-                                      params->ga_params );
+      result = resource_repartition_ga( n, obj, sigma, res,
+                                        params->start, params->trace,
+                                        params->ga_params );
       break;
     case GRAD_ASC_HILL_CLIMB:
-      return resource_repartition_gahc( n, p, cfd_res, sigma, res,
-                                        params->ga_params, params->hc_params );
+      result = resource_repartition_gahc( n, obj, sigma, res,
+                                          params->start, params->trace,
+                                          params->ga_params,
+                                          params->hc_params );
       break;
     case SIM_ANNEAL:
-      return resource_repartition_sa( n, p, cfd_res, sigma, res,
-                                      params->sa_params );
+      result = resource_repartition_sa( n, obj, sigma, res,
+                                        params->start, params->trace,
+                                        params->sa_params );
       break;
     case SIM_ANNEAL_HILL_CLIMB:
-      return resource_repartition_sahc( n, p, cfd_res, sigma, res,
-                                        params->sa_params, params->hc_params );
+      result = resource_repartition_sahc( n, obj, sigma, res,
+                                          params->start, params->trace,
+                                          params->sa_params,
+                                          params->hc_params );
+      break;
+    case CMA_ES:
+      result = resource_repartition_cma( n, obj, sigma, res,
+                                         params->start, params->trace,
+                                         params->cma_params );
+      break;
+    case DISCRETE:
+      result = resource_repartition_discrete( n, obj, sigma, res,
+                                              params->start,
+                                              params->discrete_params );
+      break;
+    case NSGA_II:
+      result = resource_repartition_nsga( n, obj, sigma, res,
+                                          params->start, params->nsga_params );
+      break;
+    case SURROGATE:
+      result = resource_repartition_surrogate( n, obj, sigma, res,
+                                               params->start, params->trace,
+                                               params->surrogate_params );
+      break;
+    case BRANCH_BOUND:
+      // the report is filled directly, with the bound
+      return resource_repartition_bb( n, obj, sigma, res,
+                                      params->start, params->trace,
+                                      params->ga_params,
+                                      params->bb_params,
+                                      report );
       break;
     default:
       fprintf( stderr,
                "resource_repartition: Unknown optimisation algorithm.\n" );
-      exit( 1 );
+      error_exit();
       break;
   }
+  if ( report != NULL ) {
+    double* point = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+    for ( int i = 0; i < n; ++i )
+      point[ i ] = sigma[ i ] + result[ i ];
+    report->confidence = obj_eval( obj, point, obj_work_new( obj ) );
+    report->bound = INFINITY;
+  }
+  return result;
+}
+
+double* resource_repartition( int n, proof p, expression* cfd_res,
+                              double* sigma, double res, optim_params params,
+                              optim_report report ) {
+  return resource_repartition_objective( n, optim_objective( n, p, cfd_res,
+                                                             params ),
+                                         sigma, res, params, report );
 }
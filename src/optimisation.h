@@ -11,68 +11,168 @@
 
 #include <string.h>
 #include <cjson/cJSON.h>
+#include "trace.h"
+#include "robust.h"
 
 /*********
  * Types *
  *********/
 
-#define OPT_ALGO_CASES 1
+#define OPT_ALGO_CASES 9
 
 /* Different possible cases for the optimisation algorithm:
  * - gradient ascent
  * - gradient ascent followed by hill climbing
  * - simulated annealing
  * - simulated annealing followed by hill climbing
+ * - branch and bound
+ * - CMA-ES (covariance matrix adaptation evolution strategy)
+ * - discrete allocation of whole units of resources (e.g., tests)
+ * - NSGA-II (non-dominated sorting genetic algorithm)
+ * - surrogate-assisted optimisation (on a cheap model of the confidence)
  */
 enum CASE_OPT_ALGO {
   GRAD_ASC,
   GRAD_ASC_HILL_CLIMB,
   SIM_ANNEAL,
-  SIM_ANNEAL_HILL_CLIMB
+  SIM_ANNEAL_HILL_CLIMB,
+  BRANCH_BOUND,
+  CMA_ES,
+  DISCRETE,
+  NSGA_II,
+  SURROGATE
   // more algorithms...?
 };
 
+/* Different possible step rules for gradient ascent:
+ * - Armijo: backtracking line search along the projected gradient,
+ * - Adam: adaptive moment estimation (per-coordinate step sizes).
+ */
+enum CASE_GA_STEP {
+  GA_STEP_ARMIJO,
+  GA_STEP_ADAM
+};
+
 /* The type structure of parameters for gradient ascent:
- * - [step_coef]: multiplicative coefficient of the size of a step of
- *   gradient ascent,
- * - [stop_error]: error under which we believe to have found the maximum,
+ * - [step_coef]: initial size of a step (in resources), 0 means "1/100th of
+ *   the resources to spend",
+ * - [step_rule]: how the size of steps is adapted,
+ * - [max_iters]: maximum number of iterations,
+ * - [armijo]: the sufficient increase coefficient of the Armijo condition,
+ * - [backtrack]: the factor by which steps shrink when backtracking (and by
+ *   whose inverse they grow after a successful step),
+ * - [beta1], [beta2]: the moment decay rates for Adam,
+ * - [stop_error]: improvement of confidence under which an iteration does not
+ *   count as progress,
+ * - [patience]: the number of consecutive iterations without progress after
+ *   which we believe to have found the maximum,
+ * - [smoothing]: if positive, the initial temperature of the log-sum-exp
+ *   smoothing of the maximum over the branches of the proof (which avoids
+ *   zig-zagging around points where the maximal branch changes),
+ * - [smoothing_decay]: the factor by which the temperature decreases every
+ *   time the ascent stops progressing at the current temperature,
+ * - [smoothing_min]: the temperature under which we switch to the exact
+ *   maximum.
  */
 typedef struct gradient_ascent_params_s {
   double step_coef;
-  // double stop_error;
+  enum CASE_GA_STEP step_rule;
+  int max_iters;
+  double armijo;
+  double backtrack;
+  double beta1;
+  double beta2;
+  double stop_error;
+  int patience;
+  double smoothing;
+  double smoothing_decay;
+  double smoothing_min;
 } *gradient_ascent_params;
 
+/* Different possible moves for hill climbing:
+ * - random: a step of fixed size in a uniformly random feasible direction,
+ * - adaptive: the same with the size of steps adapted by the 1/5th success
+ *   rule,
+ * - pair: moving an amount of resources (whose size is adapted the same way)
+ *   from one hypothesis to another one.
+ */
+enum CASE_HC_STRATEGY {
+  HC_RANDOM,
+  HC_ADAPTIVE,
+  HC_PAIR
+};
+
 /* The type structure of parameters for hill climbing:
- * - [step_size]: size of a hill climbing step,
- * - [iters]: maximum number of hill climbing iterations.
+ * - [step_size]: (initial) size of a hill climbing step, 0 means "1/100th of
+ *   the resources to spend",
+ * - [iters]: maximum number of hill climbing iterations,
+ * - [strategy]: the moves tried,
+ * - [adapt]: for adaptive steps, the factor by which the step grows after a
+ *   success (it shrinks by the fourth root of [adapt] after a failure, so that
+ *   it is stable when 1/5th of the moves succeed).
  */
 typedef struct hill_climbing_params_s {
   double step_size;
   int iters;
+  enum CASE_HC_STRATEGY strategy;
+  double adapt;
 } *hill_climbing_params;
 
+/* Different possible cooling schedules for simulated annealing:
+ * - log: the temperature [t_max] log( 2 ) / log( k + 1 ) at step k,
+ * - adaptive: starting from [t_max], the temperature is slightly lowered after
+ *   each step while the (exponential moving) average of acceptance is above a
+ *   target rate, and raised otherwise, the target being Lam's modified
+ *   schedule (from 1 down to 0.44 during the first 15% of steps, 0.44 until 65%
+ *   of the steps, then down to 0).
+ */
+enum CASE_SA_SCHEDULE {
+  SA_SCHEDULE_LOG,
+  SA_SCHEDULE_ADAPTIVE
+};
+
 /* The type structure of parameters for simulated annealing:
  * - [max_step]: the total number of steps,
+ * - [k0]: the number of final steps with temperature zero,
+ * - [t_max]: the initial temperature,
+ * - [step]: the standard deviation of moves (in resources), 0 means
+ *   "res sqrt( pi / max_step )", with res the resources to spend,
+ * - [schedule]: the cooling schedule,
+ * - [reheat]: the number of steps without improvement after which the
+ *   schedule restarts from the best point (0 for never),
+ * - [calibrate]: the number of moves sampled from the initial point to
+ *   estimate the initial temperature (0 for no calibration),
+ * - [accept]: the probability with which the average move increasing energy
+ *   is accepted at the estimated initial temperature,
+ * - [function_constant]: 0, or the constant of the confidence functions of
+ *   hand-tuned initial temperatures computed at the starting point of each
+ *   optimisation (see [sa_params_simple_with_lambda]), [t_max] then being
+ *   the factor of the sum over the wires of function_constant^( x + 1 ),
  * - [init]: generates the initial point, based on a given point and the amount
  *   of confidence to spend,
- * - [temp]: a function that returns a temperature based on the current step
- *   and total number of steps,
+ * - [temp]: a function that returns a temperature based on the current step,
  * - [energy]: maps confidence value (to maximise) to energy (to minimise),
  * - [prob]: the probability to go from a point to another, based on their
  *   energies,
- * - [neighbour]: generates a neighbour around a given point.
+ * - [neighbour]: generates a neighbour around a given point, above the
+ *   resources already spent.
  */
 typedef struct simulated_annealing_params_s {
   int max_step;
+  int k0;
+  double t_max;
+  double step;
+  enum CASE_SA_SCHEDULE schedule;
+  int reheat;
+  int calibrate;
+  double accept;
+  double function_constant;
   double* ( * init ) ( int n, double* point, double all );
-  double ( * temp ) ( int k );
+  double ( * temp ) ( struct simulated_annealing_params_s* params, int k );
   double ( * energy ) ( double cfd );
   double ( * prob ) ( double energy_old, double energy_new, double temp );
-  double* ( * neighbour ) ( int n, double* point );
-  // could add:
-  // - energy taking point and confidence functions as input
-  // - resarting
-  // - control of neighbourhood size
+  double* ( * neighbour ) ( struct simulated_annealing_params_s* params,
+                            int n, double* sigma, double* point );
   // two possible strategies for initial point:
   // - random
   // - balanced: each coordinate gets 1/n of allowance (from current point)
@@ -81,26 +181,224 @@ typedef struct simulated_annealing_params_s {
   //   violate constraints
 } *simulated_annealing_params;
 
+/* The type structure of parameters for branch and bound (which starts from
+ * the result of gradient ascent):
+ * - [max_nodes]: the maximum number of boxes split,
+ * - [gap]: boxes whose upper bound is less than [gap] above the best known
+ *   confidence are not split,
+ * - [threads]: the number of threads exploring boxes, 0 means "one per
+ *   processor".
+ */
+typedef struct branch_bound_params_s {
+  int max_nodes;
+  double gap;
+  int threads;
+} *branch_bound_params;
+
+/* The type structure of parameters for CMA-ES (which searches the hyperplane of
+ * allocations spending all resources, repairing samples that fall below the
+ * starting point by projection):
+ * - [max_evals]: the maximum number of evaluations of the confidence,
+ * - [step]: the initial step size (in resources), 0 means "the resources to
+ *   spend divided by the number of hypotheses",
+ * - [population]: the number of samples per generation, 0 means
+ *   4 + 3 log( n - 1 ),
+ * - [stop_error]: the search stops when steps are below [stop_error] times
+ *   the resources to spend,
+ * - [threads]: the number of threads evaluating each generation, 0 means "one
+ *   per processor".
+ */
+typedef struct cma_es_params_s {
+  int max_evals;
+  double step;
+  int population;
+  double stop_error;
+  int threads;
+} *cma_es_params;
+
+/* The type structure of parameters for discrete allocation (greedy allocation
+ * of whole units of resources followed by moves of single units from one
+ * hypothesis to another):
+ * - [unit]: the amount of resources of a unit (e.g., the cost of a test),
+ * - [max_moves]: the maximum number of moves of single units.
+ */
+typedef struct discrete_params_s {
+  double unit;
+  int max_moves;
+} *discrete_params;
+
+/* The type structure of parameters for NSGA-II (which evolves allocations
+ * spending all resources by blending pairs of allocations and moving resources
+ * from one hypothesis to another):
+ * - [population]: the number of allocations per generation,
+ * - [generations]: the number of generations,
+ * - [mutation]: the probability that a new allocation moves resources,
+ * - [threads]: the number of threads evaluating each generation, 0 means "one
+ *   per processor".
+ */
+typedef struct nsga_params_s {
+  int population;
+  int generations;
+  double mutation;
+  int threads;
+} *nsga_params;
+
+/* Different possible models for surrogate-assisted optimisation:
+ * - RBF: interpolation by cubic radial basis functions with a linear tail,
+ * - quadratic: least-squares fit of a quadratic polynomial.
+ */
+enum CASE_SURROGATE_MODEL {
+  SURROGATE_RBF,
+  SURROGATE_QUADRATIC
+};
+
+/* The type structure of parameters for surrogate-assisted optimisation (which
+ * fits a model of the confidence on the allocations evaluated so far, and
+ * evaluates the candidate allocation that best trades the value predicted by
+ * the model against the distance to the allocations already evaluated):
+ * - [model]: the model,
+ * - [max_evals]: the maximum number of evaluations of the confidence,
+ * - [samples]: the number of evaluations before the first fit (the starting
+ *   allocation, then random ones), 0 means "just enough for the model",
+ * - [candidates]: the number of candidates (perturbations of the best
+ *   allocation, and a tenth of random ones) scored by the model per
+ *   evaluation,
+ * - [step]: the initial size of perturbations (in resources), 0 means "the
+ *   resources to spend divided by the number of hypotheses", doubled after 3
+ *   consecutive improvements and halved after max( 5, n - 1 ) consecutive
+ *   failures,
+ * - [stop_error]: the search stops when perturbations are below [stop_error]
+ *   times the resources to spend.
+ */
+typedef struct surrogate_params_s {
+  enum CASE_SURROGATE_MODEL model;
+  int max_evals;
+  int samples;
+  int candidates;
+  double step;
+  double stop_error;
+} *surrogate_params;
+
+/* The type structure of parameters for the decomposition of fault trees into
+ * modules (see module.h), whose budget-response curves are computed
+ * separately:
+ * - [steps]: the number of budgets (evenly spaced, besides 0) on which the
+ *   curves are first computed, the budget of each module being a multiple of
+ *   the resources to spend divided by [steps],
+ * - [refine]: the number of refinement rounds, each one computing the curves
+ *   again on [steps] + 1 budgets around the budgets of the previous round,
+ *   [steps] / 2 times closer to each other,
+ * - [threads]: the number of threads computing the curves, 0 means "one per
+ *   processor".
+ */
+typedef struct module_params_s {
+  int steps;
+  int refine;
+  int threads;
+} *module_params;
+
 /* The type structure for optimisation algorithms:
  * - the type of the algorithm [opt_algo_type],
- * - all necessary parameters for the different algorithms.
+ * - all necessary parameters for the different algorithms,
+ * - the allocation [start] (resources spent on each hypothesis) to start from,
+ *   NULL meaning the balanced one (not read from JSON, see [ws_seed]),
+ * - the [trace] of the optimisation (used by gradient ascent, simulated
+ *   annealing, CMA-ES, and surrogate-assisted optimisation),
+ * - the parameters [robust] of robust optimisation (NULL to optimise the
+ *   confidence for the nominal constants of the confidence functions),
+ * - the [uncertainty] of these constants (not read from JSON, see
+ *   [cJSON_to_uncertainty]),
+ * - the parameters [modules] of the decomposition of fault trees into modules
+ *   (NULL to optimise the whole fault tree at once, see [module_repartition]).
  */
 typedef struct optim_params_s {
   enum CASE_OPT_ALGO opt_algo_type;
   gradient_ascent_params ga_params;
   hill_climbing_params hc_params;
   simulated_annealing_params sa_params;
+  branch_bound_params bb_params;
+  cma_es_params cma_params;
+  discrete_params discrete_params;
+  nsga_params nsga_params;
+  surrogate_params surrogate_params;
+  double* start;
+  trace trace;
+  robust_params robust;
+  uncertainty uncertainty;
+  module_params modules;
 } *optim_params;
 
+/* The type structure for reports on the result of optimisation:
+ * - [confidence]: the confidence reached,
+ * - [bound]: an upper bound of the optimal confidence (INFINITY if the
+ *   algorithm does not compute any), so that the allocation is optimal up to
+ *   [bound] - [confidence] (and floating-point rounding).
+ */
+typedef struct optim_report_s {
+  double confidence;
+  double bound;
+} *optim_report;
+
 /************
  * Creation *
  ************/
 
-/* sa_params_from_hyperparams_simple: creates simulated annealing parameters
- * from hyperparameters, according to the following strategy:
+/* ga_params_new: creates gradient ascent parameters with default values
+ * (Armijo steps starting at 1/100th of the resources, at most 1000
+ * iterations).
+ * output: the parameters.
+ */
+gradient_ascent_params ga_params_new();
+
+/* hc_params_new: creates hill climbing parameters with default values (100
+ * iterations of adaptive steps starting at 1/100th of the resources).
+ * output: the parameters.
+ */
+hill_climbing_params hc_params_new();
+
+/* bb_params_new: creates branch and bound parameters with default values (at
+ * most 100000 boxes, a gap of 1e-6, one thread per processor).
+ * output: the parameters.
+ */
+branch_bound_params bb_params_new();
+
+/* cma_params_new: creates CMA-ES parameters with default values (at most 10000
+ * evaluations on a single thread).
+ * output: the parameters.
+ */
+cma_es_params cma_params_new();
+
+/* discrete_params_new: creates discrete allocation parameters with default
+ * values (units of 1, at most 1000 moves).
+ * output: the parameters.
+ */
+discrete_params discrete_params_new();
+
+/* nsga_params_new: creates NSGA-II parameters with default values (100
+ * allocations per generation, 200 generations, a mutation probability of 0.5,
+ * a single thread).
+ * output: the parameters.
+ */
+nsga_params nsga_params_new();
+
+/* surrogate_params_new: creates surrogate-assisted optimisation parameters
+ * with default values (an RBF model, at most 200 evaluations, 1000 candidates
+ * per evaluation, stopping at perturbations of 1e-6 times the resources).
+ * output: the parameters.
+ */
+surrogate_params surrogate_params_new();
+
+/* module_params_new: creates module decomposition parameters with default
+ * values (16 budgets, 2 refinement rounds, one thread per processor).
+ * output: the parameters.
+ */
+module_params module_params_new();
+
+/* sa_params_simple: creates simulated annealing parameters from
+ * hyperparameters, according to the following strategy:
  * - [init] implements the "balanced" strategy,
- * - [temp] decreases linearly until it reaches zero, and stays at zero for some
- *   time,
+ * - [temp] decreases logarithmically, and stays at zero for the last [k0]
+ *   steps,
  * - [energy] (to minimise) is the opposite of confidence (to maximise),
  * - [prob] is the usual function (as in Metropolis-Hastings),
  * - [neighbour] is a Gaussian around the current point,
@@ -117,23 +415,88 @@ typedef struct optim_params_s {
  * - [max_step]: the number of steps
  * - [p_init]: a lower bound on probability of transitioning at the start of the
  *   algorithm,
- * - [k0]: the number of steps with temperature zero,
- * - [n]: the size of sigma,
- * - [sigma]: the starting point.
- * side effect: initialises constants used in
- * [sa_params_from_hyperparams_simple].
- */
-void sa_params_from_hyperparams_simple_set( int max_step, double p_init, int k0,
-                                            int n, double* sigma );
-void sa_params_from_hyperparams_simple_set_with_lambda(
+ * - [k0]: the number of steps with temperature zero.
+ * output: the parameters (with a step of sqrt( pi / max_step )).
+ */
+simulated_annealing_params sa_params_simple( int max_step, double p_init,
+                                             int k0 );
+
+/* sa_params_simple_with_lambda: same as [sa_params_simple], with a step of
+ * [lambda] sqrt( pi / max_step ) and an initial temperature computed for
+ * confidence functions of the form 1 - [function_constant]^( x + 1 ) at the
+ * point [sigma] of size [n] (or, if [sigma] is NULL, at the starting point of
+ * each optimisation).
+ */
+simulated_annealing_params sa_params_simple_with_lambda(
   int max_step, double p_init, int k0, int n, double* sigma, double lambda,
   double function_constant );
 
-extern simulated_annealing_params sa_params_from_hyperparams_simple;
+/* The built-in presets, i.e., named optimisation parameters, one per algorithm
+ * (with its default parameters, see below), and "sa_lambda", simulated
+ * annealing with a hand-tuned step and initial temperature.
+ */
+#define OPTIM_PRESETS_NUMBER 10
 
+/* cJSON_to_optim_params: reads optimisation parameters from JSON. The "type"
+ * field selects the algorithm ("ga", "gahc", "sa", "sahc", "bb", "cma",
+ * "discrete", "nsga", or "surrogate"), whose parameters are read from the
+ * "ga", "sa", "hc", "bb", "cma", "discrete", "nsga", and "surrogate" objects.
+ * Fields of "ga", "hc", "bb", "cma", "discrete", "nsga", and "surrogate" are
+ * optional and default to the values of [ga_params_new], [hc_params_new],
+ * [bb_params_new], [cma_params_new], [discrete_params_new], [nsga_params_new],
+ * and [surrogate_params_new]. Parameters may also be the name of a preset
+ * (see [OPTIM_PRESETS_NUMBER] and [optim_presets_load]), or an object with the
+ * "preset" they start from and fields overriding those of the preset (fields
+ * of objects, e.g., "sa", being overridden one by one).
+ * inputs:
+ * - the JSON object (or string) [json].
+ * output: the parameters.
+ */
 optim_params cJSON_to_optim_params( cJSON* json );
+
+/* optim_params_trace_file: tests whether optimisation parameters ask for a
+ * trace file (see [cJSON_to_trace]), which is opened when they are read.
+ * inputs:
+ * - the JSON object [json] (see [cJSON_to_optim_params]).
+ * output: true iff [json] itself has a "trace" with a "file" (those of
+ * presets, set by whoever loaded them, are not checked).
+ */
+bool optim_params_trace_file( cJSON* json );
 optim_params filename_to_optim_params( char* filename );
 
+/* optim_presets_load: loads named optimisation parameters (presets), which
+ * replace the built-in ones of the same name (should be called before any
+ * parameters are read, e.g., by [cJSON_to_optim_params]).
+ * inputs:
+ * - the [filename] of a JSON object mapping names to parameters (see
+ *   [cJSON_to_optim_params]).
+ * output: nothing.
+ */
+void optim_presets_load( char* filename );
+
+/* cJSON_to_budgets: reads the budgets of a sweep from JSON, either a single
+ * number, an array of numbers, or an object with fields "from", "to", and
+ * "steps" (the number of budgets, evenly spaced from "from" to "to").
+ * inputs:
+ * - the JSON object [json],
+ * - a pointer [num] to store the number of budgets.
+ * output: the budgets, in increasing order.
+ */
+double* cJSON_to_budgets( cJSON* json, int* num );
+
+/* cJSON_get_double: reads an optional number in a JSON object.
+ * inputs:
+ * - the JSON object [json] (possibly NULL),
+ * - the [key] of the number,
+ * - the value [def] to return if there is no such number.
+ * output: the number.
+ */
+double cJSON_get_double( cJSON* json, char* key, double def );
+
+/* cJSON_get_int: same as [cJSON_get_double], for integers.
+ */
+int cJSON_get_int( cJSON* json, char* key, int def );
+
 /**************
  * Algorithms *
  **************/
@@ -165,6 +528,29 @@ optim_params filename_to_optim_params( char* filename );
  */
 double* best_vector_res( int n, proof p, expression* cfd_res, double* sigma );
 
+/* optim_objective: compiles the objective of an optimisation, i.e., the
+ * confidence in a proof as a function of the resources spent on its
+ * hypotheses, or its expectation or worst case over scenarios of the uncertain
+ * constants of the confidence functions for robust optimisation.
+ * inputs:
+ * - the number [n] of hypotheses,
+ * - the proof [p],
+ * - an array of expressions [cfd_res] describing the confidence reached by
+ *   spending some amount of resources on the hypotheses,
+ * - optimisation parameters [params].
+ * output: the objective.
+ */
+objective optim_objective( int n, proof p, expression* cfd_res,
+                           optim_params params );
+
+/* resource_repartition_objective: same as [resource_repartition], for an
+ * objective already compiled by [optim_objective] (with the same [params]),
+ * so that problems sharing a proof are only compiled once.
+ */
+double* resource_repartition_objective( int n, objective obj, double* sigma,
+                                        double res, optim_params params,
+                                        optim_report report );
+
 /* resource_repartition: gives the most effective resource repartition to
  * increase confidence in a proof.
  * inputs:
@@ -176,11 +562,13 @@ double* best_vector_res( int n, proof p, expression* cfd_res, double* sigma );
  * - the point at which we want to compute the gradient (as an array
  *   [sigma] of doubles of size [n] representing resources),
  * - a double [res] representing the amount of resources to be spent,
- * - optimisation parameters [params].
+ * - optimisation parameters [params],
+ * - a [report] to fill (or NULL).
  * output: a vector of size [n] of doubles describing the mount of resources to
  * be spent on each hypothesis.
  */
 double* resource_repartition( int n, proof p, expression* cfd_res,
-                              double* sigma, double res, optim_params params );
+                              double* sigma, double res, optim_params params,
+                              optim_report report );
 
 #endif // __CCL_OPTIMISATION_H__
@@ -0,0 +1,221 @@
+/********************************************************************
+ * parallel.c
+ *
+ * Defines functions to run computations on several threads.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#define _DEFAULT_SOURCE // for sysconf( _SC_NPROCESSORS_ONLN )
+#define GC_THREADS      // so that the collector knows about our threads
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <gc.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include "utils.h"
+#include "parallel.h"
+
+int parallel_threads( int threads ) {
+  if ( threads > 0 )
+    return threads;
+  long procs = sysconf( _SC_NPROCESSORS_ONLN );
+  return procs > 0 ? ( int ) procs : 1;
+}
+
+// the argument of a thread: its index, the function to run, and whether it
+// failed
+typedef struct parallel_job_s {
+  int worker;
+  void ( * f ) ( int worker, void* arg );
+  void* arg;
+  bool failed;
+} *parallel_job;
+
+// runs the function of a job, errors (see [error_exit]) ending the thread
+// instead of the process
+void* parallel_start( void* arg ) {
+  parallel_job job = arg;
+  error_handler h;
+  if ( setjmp( h.env ) != 0 ) {
+    job->failed = true;
+    return NULL;
+  }
+  error_push( &h );
+  ( * job->f ) ( job->worker, job->arg );
+  error_pop( &h );
+  return NULL;
+}
+
+void parallel_run( int threads, void ( * f ) ( int worker, void* arg ),
+                   void* arg ) {
+  threads = parallel_threads( threads );
+  pthread_t* ids = GC_MALLOC( threads * sizeof( pthread_t ) );
+  parallel_job* jobs = GC_MALLOC( threads * sizeof( parallel_job ) );
+  int created = 1;
+  bool failed = false;
+  for ( int i = 0; i < threads; ++i ) {
+    jobs[ i ] = GC_MALLOC( sizeof( struct parallel_job_s ) );
+    jobs[ i ]->worker = i;
+    jobs[ i ]->f = f;
+    jobs[ i ]->arg = arg;
+    jobs[ i ]->failed = false;
+  }
+  for ( ; created < threads; ++created )
+    if ( pthread_create( ids + created, NULL, parallel_start,
+                         jobs[ created ] ) != 0 ) {
+      fprintf( stderr, "parallel_run: could not create thread %d.\n",
+               created );
+      failed = true;
+      break;
+    }
+  // the threads already created are waited for before any error returns
+  parallel_start( jobs[ 0 ] );
+  for ( int i = 1; i < created; ++i )
+    pthread_join( ids[ i ], NULL );
+  for ( int i = 0; i < created; ++i )
+    failed = failed || jobs[ i ]->failed;
+  // the messages of errors are already printed
+  if ( failed )
+    error_exit();
+}
+
+// the state shared by the threads of [parallel_for]: the next index to run
+typedef struct parallel_range_s {
+  pthread_mutex_t lock;
+  int next;
+  int count;
+  void ( * f ) ( int i, int worker, void* arg );
+  void* arg;
+} *parallel_range;
+
+void parallel_range_worker( int worker, void* arg ) {
+  parallel_range range = arg;
+  int i;
+  while ( true ) {
+    pthread_mutex_lock( &range->lock );
+    i = range->next++;
+    pthread_mutex_unlock( &range->lock );
+    if ( i >= range->count )
+      break;
+    ( * range->f ) ( i, worker, range->arg );
+  }
+}
+
+void parallel_for( int threads, int count,
+                   void ( * f ) ( int i, int worker, void* arg ), void* arg ) {
+  threads = parallel_threads( threads );
+  if ( threads > count )
+    threads = count;
+  if ( threads <= 1 ) {
+    for ( int i = 0; i < count; ++i )
+      ( * f ) ( i, 0, arg );
+    return;
+  }
+  parallel_range range = GC_MALLOC( sizeof( struct parallel_range_s ) );
+  pthread_mutex_init( &range->lock, NULL );
+  range->next = 0;
+  range->count = count;
+  range->f = f;
+  range->arg = arg;
+  parallel_run( threads, parallel_range_worker, range );
+  pthread_mutex_destroy( &range->lock );
+}
+
+// the slice of the range left to a thread of [parallel_steal]: from [next] to
+// [end] - 1
+typedef struct parallel_slice_s {
+  pthread_mutex_t lock;
+  int next;
+  int end;
+} parallel_slice;
+
+// the state shared by the threads of [parallel_steal]
+typedef struct parallel_pool_s {
+  int threads;
+  parallel_slice* slices;
+  void ( * f ) ( int i, int worker, void* arg );
+  void* arg;
+} *parallel_pool;
+
+// the number of indices left in [slice]
+int parallel_left( parallel_slice* slice ) {
+  pthread_mutex_lock( &slice->lock );
+  int left = slice->end - slice->next;
+  pthread_mutex_unlock( &slice->lock );
+  return left;
+}
+
+// the next index of the slice of [worker], stealing half of the largest other
+// slice when it is empty (-1 when all slices are empty)
+int parallel_take( parallel_pool pool, int worker ) {
+  parallel_slice* own = pool->slices + worker;
+  while ( true ) {
+    pthread_mutex_lock( &own->lock );
+    if ( own->next < own->end ) {
+      int i = own->next++;
+      pthread_mutex_unlock( &own->lock );
+      return i;
+    }
+    pthread_mutex_unlock( &own->lock );
+    int victim = -1, most = 0;
+    for ( int k = 0; k < pool->threads; ++k ) {
+      int left = k == worker ? 0 : parallel_left( pool->slices + k );
+      if ( left > most ) {
+        victim = k;
+        most = left;
+      }
+    }
+    if ( victim < 0 )
+      return -1;
+    // a single lock is held at a time, the stolen indices belong to no slice
+    // until they are given to [worker]
+    parallel_slice* other = pool->slices + victim;
+    pthread_mutex_lock( &other->lock );
+    int left = other->end - other->next;
+    int end = other->end;
+    other->end -= ( left + 1 ) / 2;
+    pthread_mutex_unlock( &other->lock );
+    if ( left <= 0 )
+      continue;
+    pthread_mutex_lock( &own->lock );
+    own->next = end - ( left + 1 ) / 2;
+    own->end = end;
+    pthread_mutex_unlock( &own->lock );
+  }
+}
+
+void parallel_steal_worker( int worker, void* arg ) {
+  parallel_pool pool = arg;
+  int i;
+  while ( ( i = parallel_take( pool, worker ) ) >= 0 )
+    ( * pool->f ) ( i, worker, pool->arg );
+}
+
+void parallel_steal( int threads, int count,
+                     void ( * f ) ( int i, int worker, void* arg ),
+                     void* arg ) {
+  threads = parallel_threads( threads );
+  if ( threads > count )
+    threads = count;
+  if ( threads <= 1 ) {
+    for ( int i = 0; i < count; ++i )
+      ( * f ) ( i, 0, arg );
+    return;
+  }
+  parallel_pool pool = GC_MALLOC( sizeof( struct parallel_pool_s ) );
+  pool->threads = threads;
+  pool->slices = GC_MALLOC_ATOMIC( threads * sizeof( parallel_slice ) );
+  for ( int k = 0; k < threads; ++k ) {
+    pthread_mutex_init( &pool->slices[ k ].lock, NULL );
+    pool->slices[ k ].next = ( long ) count * k / threads;
+    pool->slices[ k ].end = ( long ) count * ( k + 1 ) / threads;
+  }
+  pool->f = f;
+  pool->arg = arg;
+  parallel_run( threads, parallel_steal_worker, pool );
+  for ( int k = 0; k < threads; ++k )
+    pthread_mutex_destroy( &pool->slices[ k ].lock );
+}
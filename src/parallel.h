@@ -0,0 +1,63 @@
+/********************************************************************
+ * parallel.h
+ *
+ * Header of parallel.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_PARALLEL_H__
+#define __CCL_PARALLEL_H__
+
+/* parallel_threads: computes the number of threads to use.
+ * inputs:
+ * - the number of [threads] asked for (0 or less means "one per processor").
+ * output: the number of threads.
+ */
+int parallel_threads( int threads );
+
+/* parallel_run: runs a function on several threads (the calling thread being
+ * one of them) and waits for all of them to return.
+ * inputs:
+ * - the number of [threads] (see [parallel_threads]),
+ * - the function [f], called with the index of the thread (from 0 to the
+ *   number of threads - 1) and [arg],
+ * - the argument [arg] shared by all threads.
+ * output: nothing. An error in a thread (see [error_exit]) only ends this
+ * thread, and is raised again in the calling thread once all threads have
+ * returned.
+ */
+void parallel_run( int threads, void ( * f ) ( int worker, void* arg ),
+                   void* arg );
+
+/* parallel_for: calls a function on every index of a range, distributing the
+ * indices over several threads (sequentially with a single thread or index).
+ * inputs:
+ * - the number of [threads] (see [parallel_threads]),
+ * - the number [count] of indices (from 0 to [count]-1),
+ * - the function [f], called with the index, the index of the thread running
+ *   it, and [arg],
+ * - the argument [arg] shared by all calls.
+ * output: nothing.
+ */
+void parallel_for( int threads, int count,
+                   void ( * f ) ( int i, int worker, void* arg ), void* arg );
+
+/* parallel_steal: calls a function on every index of a range, like
+ * [parallel_for], but each thread starts with its own slice of the range and,
+ * once it is done, steals the second half of what is left of the largest
+ * slice, so that threads rarely wait for each other and take neighbouring
+ * indices.
+ * inputs:
+ * - the number of [threads] (see [parallel_threads]),
+ * - the number [count] of indices (from 0 to [count]-1),
+ * - the function [f], called with the index, the index of the thread running
+ *   it, and [arg],
+ * - the argument [arg] shared by all calls.
+ * output: nothing.
+ */
+void parallel_steal( int threads, int count,
+                     void ( * f ) ( int i, int worker, void* arg ),
+                     void* arg );
+
+#endif // __CCL_PARALLEL_H__
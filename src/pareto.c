@@ -0,0 +1,342 @@
+/********************************************************************
+ * pareto.c
+ *
+ * Defines functions to trade the confidence in a proof against costs.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <gc.h>
+#include <cjson/cJSON.h>
+#include "utils.h"
+#include "expression.h"
+#include "proof.h"
+#include "objective.h"
+#include "parallel.h"
+#include "optimisation.h"
+#include "pareto.h"
+
+/*
+ * Creation
+ */
+
+costs cJSON_to_costs( cJSON* json, int n ) {
+  costs cs = GC_MALLOC( sizeof( struct costs_s ) );
+  cs->num = cJSON_GetArraySize( json );
+  cs->names = GC_MALLOC( cs->num * sizeof( char* ) );
+  cs->exps = GC_MALLOC( cs->num * sizeof( expression ) );
+  cJSON* json_cost;
+  cJSON* coord;
+  int c = 0;
+  cJSON_ArrayForEach( json_cost, json ) {
+    cJSON* name = cJSON_GetObjectItemCaseSensitive( json_cost, "name" );
+    if ( ! cJSON_IsString( name ) ) {
+      fprintf( stderr, "cJSON_to_costs: no \"name\" specified in cost %d.\n",
+               c );
+      error_exit();
+    }
+    // the name outlives [json]
+    cs->names[ c ] = GC_MALLOC_ATOMIC( strlen( name->valuestring ) + 1 );
+    strcpy( cs->names[ c ], name->valuestring );
+    cs->exps[ c ] = exp_const( 0 );
+    cJSON* funcs = cJSON_GetObjectItemCaseSensitive( json_cost, "funcs" );
+    cJSON_ArrayForEach( coord, funcs ) {
+      cJSON* index = cJSON_GetObjectItemCaseSensitive( coord, "index" );
+      if ( ! cJSON_IsNumber( index ) ) {
+        fprintf( stderr, "cJSON_to_costs: no \"index\" specified in a "
+                 "function of cost \"%s\".\n", cs->names[ c ] );
+        error_exit();
+      }
+      int i = index->valueint;
+      if ( i < 0 || i >= n ) {
+        fprintf( stderr, "cJSON_to_costs: unknown hypothesis (%d) in cost "
+                 "\"%s\".\n", i, cs->names[ c ] );
+        error_exit();
+      }
+      cs->exps[ c ] = exp_add( cs->exps[ c ], cJSON_to_exp(
+        cJSON_GetObjectItemCaseSensitive( coord, "expression" ) ) );
+    }
+    ++c;
+  }
+  return cs;
+}
+
+/*
+ * Algorithms
+ */
+
+// the allocations of a population (first [size] parents, then [size]
+// children) with their values (the confidence then the opposites of the costs,
+// so that all values are maximised), the position of the first member to
+// evaluate, and buffers for each thread
+typedef struct nsga_population_s {
+  int n;
+  int m;
+  int size;
+  int offset;
+  objective obj;
+  objective* cost_objs;
+  double* sigma;
+  double* points;
+  double* values;
+  int* rank;
+  double* crowd;
+  double** xs;
+  double** works;
+  double*** cost_works;
+} *nsga_population;
+
+void nsga_eval( int k, int worker, void* arg ) {
+  nsga_population pop = arg;
+  k += pop->offset;
+  double* d = pop->points + k * pop->n;
+  double* x = pop->xs[ worker ];
+  for ( int i = 0; i < pop->n; ++i )
+    x[ i ] = pop->sigma[ i ] + d[ i ];
+  pop->values[ k * pop->m ] = obj_eval( pop->obj, x, pop->works[ worker ] );
+  for ( int c = 0; c < pop->m - 1; ++c )
+    pop->values[ k * pop->m + 1 + c ] =
+      - obj_eval( pop->cost_objs[ c ], d, pop->cost_works[ worker ][ c ] );
+}
+
+// whether member [a] dominates member [b], i.e., is at least as good in all
+// values and better in one
+bool nsga_dominates( nsga_population pop, int a, int b ) {
+  bool better = false;
+  for ( int c = 0; c < pop->m; ++c ) {
+    double va = pop->values[ a * pop->m + c ];
+    double vb = pop->values[ b * pop->m + c ];
+    if ( va < vb )
+      return false;
+    if ( va > vb )
+      better = true;
+  }
+  return better;
+}
+
+// whether member [a] should be preferred to member [b] (lower rank, or same
+// rank and larger crowding distance)
+bool nsga_better( nsga_population pop, int a, int b ) {
+  return pop->rank[ a ] < pop->rank[ b ] ||
+    ( pop->rank[ a ] == pop->rank[ b ] && pop->crowd[ a ] > pop->crowd[ b ] );
+}
+
+// computes the ranks (fast non-dominated sorting) and crowding distances of
+// the first [count] members of [pop], and sorts their indices in [order] from
+// best to worst
+void nsga_sort( nsga_population pop, int count, int* order ) {
+  int* dominated = GC_MALLOC_ATOMIC( count * count * sizeof( int ) );
+  int* dominated_num = GC_MALLOC_ATOMIC( count * sizeof( int ) );
+  int* dominating_num = GC_MALLOC_ATOMIC( count * sizeof( int ) );
+  int* front = GC_MALLOC_ATOMIC( count * sizeof( int ) );
+  for ( int a = 0; a < count; ++a ) {
+    dominated_num[ a ] = 0;
+    dominating_num[ a ] = 0;
+    pop->crowd[ a ] = 0;
+  }
+  for ( int a = 0; a < count; ++a )
+    for ( int b = a + 1; b < count; ++b ) {
+      if ( nsga_dominates( pop, a, b ) ) {
+        dominated[ a * count + dominated_num[ a ]++ ] = b;
+        dominating_num[ b ]++;
+      } else if ( nsga_dominates( pop, b, a ) ) {
+        dominated[ b * count + dominated_num[ b ]++ ] = a;
+        dominating_num[ a ]++;
+      }
+    }
+  int front_size = 0, sorted = 0;
+  for ( int a = 0; a < count; ++a )
+    if ( dominating_num[ a ] == 0 )
+      front[ front_size++ ] = a;
+  for ( int r = 0; front_size > 0; ++r ) {
+    // crowding distance of the front: for each value, the distance between
+    // the neighbours of a member (infinite at the extremities)
+    for ( int c = 0; c < pop->m; ++c ) {
+      for ( int k = 1; k < front_size; ++k ) {
+        int a = front[ k ], l = k;
+        double v = pop->values[ a * pop->m + c ];
+        for ( ; l > 0 && pop->values[ front[ l - 1 ] * pop->m + c ] > v; --l )
+          front[ l ] = front[ l - 1 ];
+        front[ l ] = a;
+      }
+      double lo = pop->values[ front[ 0 ] * pop->m + c ];
+      double hi = pop->values[ front[ front_size - 1 ] * pop->m + c ];
+      pop->crowd[ front[ 0 ] ] = INFINITY;
+      pop->crowd[ front[ front_size - 1 ] ] = INFINITY;
+      if ( hi > lo )
+        for ( int k = 1; k < front_size - 1; ++k )
+          pop->crowd[ front[ k ] ] +=
+            ( pop->values[ front[ k + 1 ] * pop->m + c ] -
+              pop->values[ front[ k - 1 ] * pop->m + c ] ) / ( hi - lo );
+    }
+    for ( int k = 0; k < front_size; ++k ) {
+      pop->rank[ front[ k ] ] = r;
+      order[ sorted++ ] = front[ k ];
+    }
+    // the next front, in the place of the current one in [order]
+    int next_size = 0;
+    for ( int k = sorted - front_size; k < sorted; ++k ) {
+      int a = order[ k ];
+      for ( int l = 0; l < dominated_num[ a ]; ++l )
+        if ( --dominating_num[ dominated[ a * count + l ] ] == 0 )
+          front[ next_size++ ] = dominated[ a * count + l ];
+    }
+    front_size = next_size;
+  }
+  // within fronts, by decreasing crowding distance
+  for ( int k = 1; k < count; ++k ) {
+    int a = order[ k ], l = k;
+    for ( ; l > 0 && nsga_better( pop, a, order[ l - 1 ] ); --l )
+      order[ l ] = order[ l - 1 ];
+    order[ l ] = a;
+  }
+}
+
+// the better of two random parents
+int nsga_tournament( nsga_population pop ) {
+  int a = rng_rand() % pop->size;
+  int b = rng_rand() % pop->size;
+  return nsga_better( pop, b, a ) ? b : a;
+}
+
+pareto_front pareto_nsga( int n, objective obj, costs cs, double* sigma,
+                          double res, double* start, nsga_params params ) {
+  int threads = parallel_threads( params->threads );
+  nsga_population pop = GC_MALLOC( sizeof( struct nsga_population_s ) );
+  pop->n = n;
+  pop->m = 1 + cs->num;
+  pop->size = params->population + params->population % 2;
+  pop->obj = obj;
+  pop->cost_objs = GC_MALLOC( cs->num * sizeof( objective ) );
+  for ( int c = 0; c < cs->num; ++c )
+    pop->cost_objs[ c ] = obj_compile( n, 1, cs->exps + c );
+  pop->sigma = sigma;
+  int size = pop->size;
+  pop->points = GC_MALLOC_ATOMIC( 2 * size * n * sizeof( double ) );
+  pop->values = GC_MALLOC_ATOMIC( 2 * size * pop->m * sizeof( double ) );
+  pop->rank = GC_MALLOC_ATOMIC( 2 * size * sizeof( int ) );
+  pop->crowd = GC_MALLOC_ATOMIC( 2 * size * sizeof( double ) );
+  pop->xs = GC_MALLOC( threads * sizeof( double* ) );
+  pop->works = GC_MALLOC( threads * sizeof( double* ) );
+  pop->cost_works = GC_MALLOC( threads * sizeof( double** ) );
+  for ( int w = 0; w < threads; ++w ) {
+    pop->xs[ w ] = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+    pop->works[ w ] = obj_work_new( pop->obj );
+    pop->cost_works[ w ] = GC_MALLOC( cs->num * sizeof( double* ) );
+    for ( int c = 0; c < cs->num; ++c )
+      pop->cost_works[ w ][ c ] = obj_work_new( pop->cost_objs[ c ] );
+  }
+  double* new_points = GC_MALLOC_ATOMIC( size * n * sizeof( double ) );
+  double* new_values = GC_MALLOC_ATOMIC( size * pop->m * sizeof( double ) );
+  int* order = GC_MALLOC_ATOMIC( 2 * size * sizeof( int ) );
+
+  // initial population: the starting (or balanced) allocation, the
+  // allocations spending everything on a single hypothesis, and uniformly
+  // random allocations
+  double* d;
+  double sum;
+  for ( int k = 0; k < size; ++k ) {
+    d = pop->points + k * n;
+    if ( k == 0 )
+      for ( int i = 0; i < n; ++i )
+        d[ i ] = start ? start[ i ] : res / n;
+    else if ( k <= n && size > n + 1 )
+      for ( int i = 0; i < n; ++i )
+        d[ i ] = i == k - 1 ? res : 0;
+    else {
+      sum = 0;
+      for ( int i = 0; i < n; ++i ) {
+        d[ i ] = - log( ( rng_rand() + 1.0 ) / ( RAND_MAX + 1.0 ) );
+        sum += d[ i ];
+      }
+      for ( int i = 0; i < n; ++i )
+        d[ i ] *= res / sum;
+    }
+  }
+  pop->offset = 0;
+  parallel_for( threads, size, nsga_eval, pop );
+  nsga_sort( pop, size, order );
+
+  for ( int g = 0; g < params->generations; ++g ) {
+    // children: blends of pairs of parents, moving resources from one
+    // hypothesis to another with probability [mutation]
+    for ( int k = size; k < 2 * size; k += 2 ) {
+      double* a = pop->points + nsga_tournament( pop ) * n;
+      double* b = pop->points + nsga_tournament( pop ) * n;
+      double* c1 = pop->points + k * n;
+      double* c2 = c1 + n;
+      double alpha = ( double ) rng_rand() / RAND_MAX;
+      for ( int i = 0; i < n; ++i ) {
+        c1[ i ] = alpha * a[ i ] + ( 1 - alpha ) * b[ i ];
+        c2[ i ] = ( 1 - alpha ) * a[ i ] + alpha * b[ i ];
+      }
+      for ( d = c1; n > 1 && d <= c2; d += n ) {
+        if ( ( double ) rng_rand() / RAND_MAX >= params->mutation )
+          continue;
+        int i = rng_rand() % n;
+        int j = rng_rand() % ( n - 1 );
+        if ( j >= i )
+          ++j;
+        double moved = d[ i ] * rng_rand() / RAND_MAX;
+        d[ i ] -= moved;
+        d[ j ] += moved;
+      }
+    }
+    pop->offset = size;
+    parallel_for( threads, size, nsga_eval, pop );
+    // the new parents: the best half of parents and children
+    nsga_sort( pop, 2 * size, order );
+    for ( int k = 0; k < size; ++k ) {
+      for ( int i = 0; i < n; ++i )
+        new_points[ k * n + i ] = pop->points[ order[ k ] * n + i ];
+      for ( int c = 0; c < pop->m; ++c )
+        new_values[ k * pop->m + c ] = pop->values[ order[ k ] * pop->m + c ];
+    }
+    for ( int k = 0; k < size * n; ++k )
+      pop->points[ k ] = new_points[ k ];
+    for ( int k = 0; k < size * pop->m; ++k )
+      pop->values[ k ] = new_values[ k ];
+    nsga_sort( pop, size, order );
+  }
+
+  // the front: distinct parents of rank 0, by increasing confidence
+  pareto_front front = GC_MALLOC( sizeof( struct pareto_front_s ) );
+  front->n = n;
+  front->cost_num = cs->num;
+  front->size = 0;
+  int* members = GC_MALLOC_ATOMIC( size * sizeof( int ) );
+  for ( int k = 0; k < size; ++k ) {
+    if ( pop->rank[ k ] != 0 )
+      continue;
+    bool copy = false;
+    for ( int l = 0; l < front->size && ! copy; ++l ) {
+      copy = true;
+      for ( int i = 0; i < n && copy; ++i )
+        copy = pop->points[ k * n + i ] == pop->points[ members[ l ] * n + i ];
+    }
+    if ( copy )
+      continue;
+    int l = front->size++;
+    for ( ; l > 0 && pop->values[ members[ l - 1 ] * pop->m ] >
+                     pop->values[ k * pop->m ]; --l )
+      members[ l ] = members[ l - 1 ];
+    members[ l ] = k;
+  }
+  front->allocations = GC_MALLOC_ATOMIC( front->size * n * sizeof( double ) );
+  front->confidences = GC_MALLOC_ATOMIC( front->size * sizeof( double ) );
+  front->costs = GC_MALLOC_ATOMIC( front->size * cs->num * sizeof( double ) );
+  for ( int l = 0; l < front->size; ++l ) {
+    int k = members[ l ];
+    for ( int i = 0; i < n; ++i )
+      front->allocations[ l * n + i ] = pop->points[ k * n + i ];
+    front->confidences[ l ] = pop->values[ k * pop->m ];
+    for ( int c = 0; c < cs->num; ++c )
+      front->costs[ l * cs->num + c ] = - pop->values[ k * pop->m + 1 + c ];
+  }
+  return front;
+}
@@ -0,0 +1,94 @@
+/********************************************************************
+ * pareto.h
+ *
+ * Header of pareto.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_PARETO_H__
+#define __CCL_PARETO_H__
+
+#include <cjson/cJSON.h>
+#include "expression.h"
+#include "proof.h"
+#include "optimisation.h"
+
+/*********
+ * Types *
+ *********/
+
+/* The type structure for costs of allocations, to be minimised while
+ * confidence is maximised:
+ * - [num]: the number of costs,
+ * - [names]: their names,
+ * - [exps]: their expressions, whose variables are the resources spent on
+ *   each hypothesis (not counting the resources already spent).
+ */
+typedef struct costs_s {
+  int num;
+  char** names;
+  expression* exps;
+} *costs;
+
+/* The type structure for Pareto fronts of allocations, i.e., allocations such
+ * that no other one has both a higher confidence and lower costs, stored in
+ * flat arrays:
+ * - [size]: the number of allocations,
+ * - [n]: the number of hypotheses,
+ * - [cost_num]: the number of costs,
+ * - [allocations]: the allocations (the resources spent on hypothesis [i] by
+ *   allocation [k] being at position [k] * [n] + [i]), by increasing
+ *   confidence,
+ * - [confidences]: their confidences,
+ * - [costs]: their costs (cost [c] of allocation [k] being at position
+ *   [k] * [cost_num] + [c]).
+ */
+typedef struct pareto_front_s {
+  int size;
+  int n;
+  int cost_num;
+  double* allocations;
+  double* confidences;
+  double* costs;
+} *pareto_front;
+
+/************
+ * Creation *
+ ************/
+
+/* cJSON_to_costs: reads costs from JSON, i.e., an array of objects with a
+ * "name" and an array "funcs" of objects with an "index" (of a hypothesis) and
+ * an "expression" (the cost of spending resources on this hypothesis, missing
+ * hypotheses costing nothing), the cost of an allocation being the sum of the
+ * costs of its hypotheses.
+ * inputs:
+ * - the JSON array [json] (or NULL for no cost),
+ * - the number [n] of hypotheses.
+ * output: the costs.
+ */
+costs cJSON_to_costs( cJSON* json, int n );
+
+/**************
+ * Algorithms *
+ **************/
+
+/* pareto_nsga: approximates the Pareto front of the allocations of some
+ * resources maximising the confidence in a proof and minimising some costs,
+ * by NSGA-II (a genetic algorithm selecting allocations by non-domination and
+ * crowding distance).
+ * inputs:
+ * - the number [n] of hypotheses,
+ * - the objective [obj] (see [optim_objective]),
+ * - the costs [cs],
+ * - an array [sigma] of doubles of size [n] representing the resources
+ *   already spent,
+ * - a double [res] representing the amount of resources to be spent,
+ * - an allocation [start] to put in the initial population (or NULL),
+ * - NSGA-II parameters [params].
+ * output: the Pareto front.
+ */
+pareto_front pareto_nsga( int n, objective obj, costs cs, double* sigma,
+                          double res, double* start, nsga_params params );
+
+#endif // __CCL_PARETO_H__
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <gc.h>
+#include "utils.h"
 #include "proof.h"
 
 /*
@@ -65,7 +66,7 @@ proof prf_ternary( proof p1, proof p2, proof p3, sequent conclusion ) {
 proof prf_impl_i( proof p, logic log, int i ) {
   if ( i >= p->conclusion->hyp_num ) {
     fprintf( stderr, "prf_impl_i: Not enough hypotheses.\n" );
-    exit( 1 );
+    error_exit();
   }
   // forming the hypotheses of the conclusion sequent
   formula* hyp_fmls = GC_MALLOC( ( p->conclusion->hyp_num - 1 ) *
@@ -188,23 +189,23 @@ proof prf_conj_i( proof l, proof r, logic log ) {
   ( void ) log;
   if ( l->conclusion->hyp_num != r->conclusion->hyp_num ) {
     fprintf( stderr, "prf_conj_i: Different number of hypotheses in contexts.\n" );
-    exit( 1 );
+    error_exit();
   }
   for ( int i = 0; i < l->conclusion->hyp_num; ++i ) {
     if ( ! fml_equal( l->conclusion->hyp_fmls[ i ],
                       r->conclusion->hyp_fmls[ i ] ) ) {
       fprintf( stderr, "prf_conj_i: Different formulas in contexts.\n" );
-      exit( 1 );
+      error_exit();
     }
     if ( ! exp_equal( l->conclusion->hyp_pos_cfds[ i ],
                       r->conclusion->hyp_pos_cfds[ i ] ) ) {
       fprintf( stderr, "prf_conj_i: Different positive confidences in contexts.\n" );
-      exit( 1 );
+      error_exit();
     }
     if ( ! exp_equal( l->conclusion->hyp_neg_cfds[ i ],
                       r->conclusion->hyp_neg_cfds[ i ] ) ) {
       fprintf( stderr, "prf_conj_i: Different negative confidences in contexts.\n" );
-      exit( 1 );
+      error_exit();
     }
   }
   // forming the conclusion formula of the conclusion sequent
@@ -234,23 +235,23 @@ proof prf_disj_i( proof l, proof r, logic log ) {
   ( void ) log;
   if ( l->conclusion->hyp_num != r->conclusion->hyp_num ) {
     fprintf( stderr, "prf_disj_i: Different number of hypotheses in contexts.\n" );
-    exit( 1 );
+    error_exit();
   }
   for ( int i = 0; i < l->conclusion->hyp_num; ++i ) {
     if ( ! fml_equal( l->conclusion->hyp_fmls[ i ],
                       r->conclusion->hyp_fmls[ i ] ) ) {
       fprintf( stderr, "prf_disj_i: Different formulas in contexts.\n" );
-      exit( 1 );
+      error_exit();
     }
     if ( ! exp_equal( l->conclusion->hyp_pos_cfds[ i ],
                       r->conclusion->hyp_pos_cfds[ i ] ) ) {
       fprintf( stderr, "prf_disj_i: Different positive confidences in contexts.\n" );
-      exit( 1 );
+      error_exit();
     }
     if ( ! exp_equal( l->conclusion->hyp_neg_cfds[ i ],
                       r->conclusion->hyp_neg_cfds[ i ] ) ) {
       fprintf( stderr, "prf_disj_i: Different negative confidences in contexts.\n" );
-      exit( 1 );
+      error_exit();
     }
   }
   // forming the conclusion formula of the conclusion sequent
@@ -279,34 +280,34 @@ proof prf_disj_i( proof l, proof r, logic log ) {
 proof prf_acc( int n, proof* ps ) {
   if ( n < 2 ) {
     fprintf( stderr, "prf_acc: Needs at least two proofs.\n" );
-    exit( 1 );
+    error_exit();
   }
   sequent s = ps[ 0 ]->conclusion;
   for ( int i = 0; i < n; ++i ) {
     if ( ps[ i ]->conclusion->hyp_num != s->hyp_num ) {
       fprintf( stderr, "prf_acc: Different number of hypotheses in contexts.\n" );
-      exit( 1 );
+      error_exit();
     }
     for ( int j = 0; j < s->hyp_num; ++j ) {
       if ( ! fml_equal( ps[ i ]->conclusion->hyp_fmls[ j ],
                         s->hyp_fmls[ j ] ) ) {
         fprintf( stderr, "prf_acc: Different formulas in contexts.\n" );
-        exit( 1 );
+        error_exit();
       }
       if ( ! exp_equal( ps[ i ]->conclusion->hyp_pos_cfds[ j ],
                         s->hyp_pos_cfds[ j ] ) ) {
         fprintf( stderr, "prf_acc: Different positive confidences in contexts.\n" );
-        exit( 1 );
+        error_exit();
       }
       if ( ! exp_equal( ps[ i ]->conclusion->hyp_neg_cfds[ j ],
                         s->hyp_neg_cfds[ j ] ) ) {
         fprintf( stderr, "prf_acc: Different negative confidences in contexts.\n" );
-        exit( 1 );
+        error_exit();
       }
     }
     if ( ! fml_equal( ps[ i ]->conclusion->ccl_fml, s->ccl_fml ) ) {
       fprintf( stderr, "prf_acc: Different conclusion formulas.\n" );
-      exit( 1 );
+      error_exit();
     }
   }
   // computing number of positive confidences for conclusion formula
@@ -417,7 +418,7 @@ int prf_snprintf( char* buf, int length, proof p ) {
       break;
     default:
       fprintf( stderr, "prf_snprintf: Unknown proof type.\n" );
-      exit( 1 );
+      error_exit();
       break;
   }
   return total;
@@ -0,0 +1,395 @@
+/********************************************************************
+ * reader.c
+ *
+ * Defines functions to read fault trees, expressions, and problems
+ * from JSON texts without building JSON documents.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <gc.h>
+#include <cjson/cJSON.h>
+#include "utils.h"
+#include "expression.h"
+#include "fault_tree.h"
+#include "warm_start.h"
+#include "reader.h"
+
+/*
+ * Creation
+ */
+
+reader reader_new( char* text, size_t length ) {
+  reader r = GC_MALLOC( sizeof( struct reader_s ) );
+  r->start = text;
+  r->end = text + length;
+  r->pos = text;
+  return r;
+}
+
+/*
+ * Tokens
+ */
+
+// stops with an error about the current position of [r]
+void reader_error( reader r, char* what ) {
+  fprintf( stderr, "reader: %s at byte %ld.\n", what,
+           ( long ) ( r->pos - r->start ) );
+  error_exit();
+}
+
+// skips the white spaces of [r]
+void reader_ws( reader r ) {
+  while ( r->pos < r->end && ( *r->pos == ' ' || *r->pos == '\n' ||
+                               *r->pos == '\r' || *r->pos == '\t' ) )
+    ++r->pos;
+}
+
+// skips the white spaces of [r] and the character [c]
+void reader_expect( reader r, char c ) {
+  reader_ws( r );
+  if ( r->pos == r->end || *r->pos != c ) {
+    char what[ 16 ];
+    snprintf( what, 16, "expected '%c'", c );
+    reader_error( r, what );
+  }
+  ++r->pos;
+}
+
+// reads a string, whose contents (escape sequences included) are returned
+// without copy, and whose length is stored in [length]
+char* reader_string( reader r, int* length ) {
+  reader_expect( r, '"' );
+  char* s = r->pos;
+  while ( r->pos < r->end && *r->pos != '"' )
+    r->pos += *r->pos == '\\' ? 2 : 1;
+  if ( r->pos >= r->end )
+    reader_error( r, "unterminated string" );
+  *length = r->pos - s;
+  ++r->pos;
+  return s;
+}
+
+// whether the string [s] of length [length] is [word]
+bool reader_is( char* s, int length, char* word ) {
+  return ( int ) strlen( word ) == length && strncmp( s, word, length ) == 0;
+}
+
+// reads a number (copied to a buffer, since the text may not be terminated)
+double reader_number( reader r ) {
+  reader_ws( r );
+  char buf[ 64 ];
+  int k = 0;
+  while ( r->pos < r->end && k < 63 &&
+          strchr( "+-.0123456789eE", *r->pos ) != NULL && *r->pos != '\0' )
+    buf[ k++ ] = *r->pos++;
+  buf[ k ] = '\0';
+  char* e;
+  double x = strtod( buf, &e );
+  if ( k == 0 || *e != '\0' )
+    reader_error( r, "expected a number" );
+  return x;
+}
+
+// skips a value, whatever it is
+void reader_skip( reader r ) {
+  reader_ws( r );
+  int depth = 0;
+  do {
+    if ( r->pos >= r->end )
+      reader_error( r, "unexpected end" );
+    if ( *r->pos == '"' ) {
+      int length;
+      reader_string( r, &length );
+      continue;
+    }
+    if ( *r->pos == '{' || *r->pos == '[' )
+      ++depth;
+    else if ( *r->pos == '}' || *r->pos == ']' )
+      --depth;
+    else if ( depth == 0 ) {
+      // a literal or a number, up to the next delimiter
+      while ( r->pos < r->end && strchr( ",}] \n\r\t", *r->pos ) == NULL )
+        ++r->pos;
+      return;
+    }
+    ++r->pos;
+    reader_ws( r );
+  } while ( depth > 0 );
+}
+
+// reads the separator before the next member or element, i.e., a ',' unless
+// it is the [first] one (which is then unset)
+void reader_separator( reader r, bool* first ) {
+  if ( *first ) {
+    if ( r->pos < r->end && *r->pos == ',' )
+      reader_error( r, "unexpected ','" );
+    *first = false;
+  } else
+    reader_expect( r, ',' );
+}
+
+// reads the key of the next member of an object (whose '{' is read), and
+// returns whether there is one (reading the '}' otherwise), [first] being set
+// before the first member
+bool reader_member( reader r, bool* first, char** key, int* length ) {
+  reader_ws( r );
+  if ( r->pos < r->end && *r->pos == '}' ) {
+    ++r->pos;
+    return false;
+  }
+  reader_separator( r, first );
+  *key = reader_string( r, length );
+  reader_expect( r, ':' );
+  return true;
+}
+
+// returns whether there is a next element in an array (whose '[' is read),
+// reading the ']' otherwise, [first] being set before the first element
+bool reader_element( reader r, bool* first ) {
+  reader_ws( r );
+  if ( r->pos < r->end && *r->pos == ']' ) {
+    ++r->pos;
+    return false;
+  }
+  reader_separator( r, first );
+  return true;
+}
+
+// copies a type (at most [size] - 1 characters) to [buf] for the lexers
+char* reader_type( char* type, int length, char* buf, int size ) {
+  if ( type == NULL ) {
+    buf[ 0 ] = '\0';
+    return buf;
+  }
+  if ( length > size - 1 )
+    length = size - 1;
+  memcpy( buf, type, length );
+  buf[ length ] = '\0';
+  return buf;
+}
+
+/*
+ * Reading
+ */
+
+fault_tree reader_fltt( reader r ) {
+  reader_expect( r, '{' );
+  char* type = NULL;
+  int type_length = 0, index = 0;
+  bool has_index = false;
+  fault_tree t1 = NULL, t2 = NULL;
+  char* key;
+  int length;
+  bool first = true;
+  while ( reader_member( r, &first, &key, &length ) ) {
+    if ( reader_is( key, length, "type" ) )
+      type = reader_string( r, &type_length );
+    else if ( reader_is( key, length, "index" ) ) {
+      index = ( int ) reader_number( r );
+      has_index = true;
+    } else if ( reader_is( key, length, "subtree1" ) )
+      t1 = reader_fltt( r );
+    else if ( reader_is( key, length, "subtree2" ) )
+      t2 = reader_fltt( r );
+    else
+      reader_skip( r );
+  }
+  if ( type == NULL )
+    reader_error( r, "no \"type\" in fault tree" );
+  char buf[ 16 ];
+  enum CASE_FAULT_TREE fltt_type =
+    fltt_type_lexer( reader_type( type, type_length, buf, 16 ) );
+  if ( fltt_type == WIRE ) {
+    if ( ! has_index )
+      reader_error( r, "no \"index\" in wire" );
+    return fltt_wire( index );
+  }
+  if ( t1 == NULL || t2 == NULL )
+    reader_error( r, "no \"subtree1\" or \"subtree2\" in binary tree" );
+  return fltt_binary( t1, t2, fltt_type );
+}
+
+expression reader_exp( reader r ) {
+  reader_expect( r, '{' );
+  char* type = NULL;
+  int type_length = 0, index = 0, wire_index = 0;
+  bool has_index = false, has_wire_index = false, has_name = false;
+  bool has_constant = false;
+  double constant = 0;
+  expression e1 = NULL, e2 = NULL;
+  char* key;
+  int length;
+  bool first = true;
+  while ( reader_member( r, &first, &key, &length ) ) {
+    if ( reader_is( key, length, "type" ) )
+      type = reader_string( r, &type_length );
+    else if ( reader_is( key, length, "index" ) ) {
+      index = ( int ) reader_number( r );
+      has_index = true;
+    } else if ( reader_is( key, length, "wire_index" ) ) {
+      wire_index = ( int ) reader_number( r );
+      has_wire_index = true;
+    } else if ( reader_is( key, length, "constant" ) ) {
+      constant = reader_number( r );
+      has_constant = true;
+    } else if ( reader_is( key, length, "expression1" ) )
+      e1 = reader_exp( r );
+    else if ( reader_is( key, length, "expression2" ) )
+      e2 = reader_exp( r );
+    else {
+      has_name = has_name || reader_is( key, length, "name" );
+      reader_skip( r );
+    }
+  }
+  if ( type == NULL )
+    reader_error( r, "no \"type\" in expression" );
+  char buf[ 16 ];
+  enum CASE_EXPRESSION exp_type =
+    exp_type_lexer( reader_type( type, type_length, buf, 16 ) );
+  expression res = NULL;
+  switch ( exp_type ) {
+    case VAR:
+      // as in [cJSON_to_exp], variables are named after their wire
+      if ( ! has_index || has_name || ! has_wire_index )
+        reader_error( r, "variables need an \"index\" and a \"wire_index\" "
+                      "(and no \"name\")" );
+      res = exp_wire_var( index, wire_index );
+      if ( res == NULL )
+        reader_error( r, "incompatible \"index\" and \"wire_index\"" );
+      return res;
+    case CONST:
+      if ( ! has_constant )
+        reader_error( r, "no \"constant\" in constant" );
+      return exp_const( constant );
+    case OPP:
+    case LOG:
+      if ( e1 == NULL )
+        reader_error( r, "no \"expression1\" in unary expression" );
+      return exp_unary( e1, exp_type );
+    default:
+      if ( e1 == NULL || e2 == NULL )
+        reader_error( r, "no \"expression1\" or \"expression2\" in binary "
+                      "expression" );
+      return exp_binary( e1, e2, exp_type );
+  }
+}
+
+// reads an array of objects with an "index" and either an "expression" (if
+// [exps] is not NULL) or a "value", storing them in [exps] or [values] (grown
+// as needed, their size being [size]), and returns the largest index plus one
+int reader_indexed( reader r, expression** exps, double** values,
+                    int* size ) {
+  int num = 0;
+  reader_expect( r, '[' );
+  bool first_element = true;
+  while ( reader_element( r, &first_element ) ) {
+    reader_expect( r, '{' );
+    int index = -1;
+    expression e = NULL;
+    double value = 0;
+    char* key;
+    int length;
+    bool first = true;
+    while ( reader_member( r, &first, &key, &length ) ) {
+      if ( reader_is( key, length, "index" ) )
+        index = ( int ) reader_number( r );
+      else if ( exps != NULL && reader_is( key, length, "expression" ) )
+        e = reader_exp( r );
+      else if ( exps == NULL && reader_is( key, length, "value" ) )
+        value = reader_number( r );
+      else
+        reader_skip( r );
+    }
+    if ( index < 0 )
+      reader_error( r, "no \"index\"" );
+    if ( exps != NULL && e == NULL )
+      reader_error( r, "no \"expression\"" );
+    if ( index >= *size ) {
+      int grown = 2 * *size > index + 1 ? 2 * *size : index + 1;
+      if ( exps != NULL ) {
+        expression* copy = GC_MALLOC( grown * sizeof( expression ) );
+        if ( *size > 0 )
+          memcpy( copy, *exps, *size * sizeof( expression ) );
+        *exps = copy;
+      } else {
+        double* copy = GC_MALLOC_ATOMIC( grown * sizeof( double ) );
+        if ( *size > 0 )
+          memcpy( copy, *values, *size * sizeof( double ) );
+        for ( int i = *size; i < grown; ++i )
+          copy[ i ] = 0;
+        *values = copy;
+      }
+      *size = grown;
+    }
+    if ( exps != NULL )
+      ( *exps )[ index ] = e;
+    else
+      ( *values )[ index ] = value;
+    if ( index + 1 > num )
+      num = index + 1;
+  }
+  return num;
+}
+
+problem reader_problem( char* text, size_t length ) {
+  reader r = reader_new( text, length );
+  problem p = GC_MALLOC( sizeof( struct problem_s ) );
+  p->ft = NULL;
+  p->cfd_num = 0;
+  p->cfd_res = NULL;
+  p->point_num = 0;
+  p->point = NULL;
+  p->json = cJSON_CreateObject();
+  p->ft_text = NULL;
+  p->ft_length = 0;
+  p->cfd_text = NULL;
+  p->cfd_length = 0;
+  int size;
+  reader_expect( r, '{' );
+  char* key;
+  int key_length;
+  bool first = true;
+  while ( reader_member( r, &first, &key, &key_length ) ) {
+    reader_ws( r );
+    char* start = r->pos;
+    if ( reader_is( key, key_length, "ft" ) ) {
+      p->ft = reader_fltt( r );
+      p->ft_text = start;
+      p->ft_length = r->pos - start;
+    } else if ( reader_is( key, key_length, "conf_funcs" ) ) {
+      size = 0;
+      p->cfd_num = reader_indexed( r, &p->cfd_res, NULL, &size );
+      p->cfd_text = start;
+      p->cfd_length = r->pos - start;
+    } else if ( reader_is( key, key_length, "point" ) ) {
+      size = 0;
+      p->point_num = reader_indexed( r, NULL, &p->point, &size );
+    } else {
+      // the other fields are parsed in place
+      reader_skip( r );
+      cJSON* item = cJSON_ParseWithLength( start, r->pos - start );
+      if ( item == NULL )
+        reader_error( r, "invalid JSON" );
+      char* name = GC_MALLOC_ATOMIC( ( key_length + 1 ) * sizeof( char ) );
+      memcpy( name, key, key_length );
+      name[ key_length ] = '\0';
+      cJSON_AddItemToObject( p->json, name, item );
+    }
+  }
+  return p;
+}
+
+uint64_t reader_key( problem p ) {
+  cJSON* ft = cJSON_ParseWithLength( p->ft_text, p->ft_length );
+  cJSON* cfd_funcs = p->cfd_text == NULL ? NULL :
+    cJSON_ParseWithLength( p->cfd_text, p->cfd_length );
+  uint64_t key = ws_key( ft, cfd_funcs );
+  cJSON_Delete( ft );
+  cJSON_Delete( cfd_funcs );
+  return key;
+}
@@ -0,0 +1,107 @@
+/********************************************************************
+ * reader.h
+ *
+ * Header of reader.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_READER_H__
+#define __CCL_READER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cjson/cJSON.h>
+#include "expression.h"
+#include "fault_tree.h"
+
+/*********
+ * Types *
+ *********/
+
+/* The type structure for streaming JSON readers, i.e., cursors over a JSON
+ * text (typically a mapped file, see [file_map]) building fault trees and
+ * expressions directly as they read them, without building a JSON document
+ * or copying strings:
+ * - [start] and [end]: the text (not necessarily terminated by '\0'),
+ * - [pos]: the current position.
+ */
+typedef struct reader_s {
+  char* start;
+  char* end;
+  char* pos;
+} *reader;
+
+/* The type structure for problems read by [reader_problem]:
+ * - [ft]: the fault tree ("ft"),
+ * - [cfd_num] and [cfd_res]: the confidence functions ("conf_funcs"), the one
+ *   of index i being at i (NULL for missing ones), [cfd_num] being the largest
+ *   index plus one (0 if there is none),
+ * - [point_num] and [point]: the point ("point"), the value of index i being
+ *   at i (0 for missing ones), [point_num] being the largest index plus one,
+ * - [json]: the other fields (e.g., "resources", "uncertainty", or "costs"),
+ *   which are small, as a JSON object (to delete with [cJSON_Delete]),
+ * - [ft_text], [ft_length], [cfd_text], and [cfd_length]: the texts of "ft"
+ *   and "conf_funcs" (to identify the problem, see [reader_key]).
+ */
+typedef struct problem_s {
+  fault_tree ft;
+  int cfd_num;
+  expression* cfd_res;
+  int point_num;
+  double* point;
+  cJSON* json;
+  char* ft_text;
+  size_t ft_length;
+  char* cfd_text;
+  size_t cfd_length;
+} *problem;
+
+/************
+ * Creation *
+ ************/
+
+/* reader_new: creates a reader at the start of a text.
+ * inputs:
+ * - the [text],
+ * - its [length].
+ * output: the reader.
+ */
+reader reader_new( char* text, size_t length );
+
+/***********
+ * Reading *
+ ***********/
+
+/* reader_fltt: reads a fault tree (see [cJSON_to_fltt]).
+ * inputs:
+ * - the reader [r], before the fault tree.
+ * output: the fault tree ([r] being after it).
+ */
+fault_tree reader_fltt( reader r );
+
+/* reader_exp: reads an expression (see [cJSON_to_exp]).
+ * inputs:
+ * - the reader [r], before the expression.
+ * output: the expression ([r] being after it).
+ */
+expression reader_exp( reader r );
+
+/* reader_problem: reads the input of a mode, streaming its fault tree,
+ * confidence functions, and point, and parsing its other fields with cJSON.
+ * inputs:
+ * - the [text] of the input,
+ * - its [length].
+ * output: the problem.
+ */
+problem reader_problem( char* text, size_t length );
+
+/* reader_key: computes the key of a problem in warm-start caches (see
+ * [ws_key]).
+ * inputs:
+ * - the problem [p].
+ * output: the key.
+ */
+uint64_t reader_key( problem p );
+
+#endif // __CCL_READER_H__
@@ -0,0 +1,186 @@
+/********************************************************************
+ * robust.c
+ *
+ * Defines functions to optimise the confidence in a proof robustly with
+ * respect to uncertain constants of confidence functions.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gc.h>
+#include <cjson/cJSON.h>
+#include "utils.h"
+#include "expression.h"
+#include "proof.h"
+#include "objective.h"
+#include "robust.h"
+
+/*
+ * Creation
+ */
+
+robust_params robust_params_new() {
+  robust_params res = GC_MALLOC( sizeof( struct robust_params_s ) );
+  res->robust = OBJ_EXPECTED;
+  res->scenarios = 100;
+  return res;
+}
+
+robust_params cJSON_to_robust_params( cJSON* json ) {
+  if ( json == NULL )
+    return NULL;
+  robust_params res = robust_params_new();
+  cJSON* item = cJSON_GetObjectItemCaseSensitive( json, "mode" );
+  if ( item != NULL ) {
+    if ( cJSON_IsString( item ) &&
+         strcmp( item->valuestring, "expected" ) == 0 )
+      res->robust = OBJ_EXPECTED;
+    else if ( cJSON_IsString( item ) &&
+              strcmp( item->valuestring, "worst" ) == 0 )
+      res->robust = OBJ_WORST;
+    else {
+      fprintf( stderr, "Unknown robust optimisation mode.\n" );
+      error_exit();
+    }
+  }
+  item = cJSON_GetObjectItemCaseSensitive( json, "scenarios" );
+  if ( cJSON_IsNumber( item ) )
+    res->scenarios = item->valueint;
+  if ( res->scenarios < 1 ) {
+    fprintf( stderr, "Robust optimisation needs at least one scenario.\n" );
+    error_exit();
+  }
+  return res;
+}
+
+// reads the number [key] of [json], or returns [def] if it is missing
+double robust_get_double( cJSON* json, char* key, double def ) {
+  cJSON* item = cJSON_GetObjectItemCaseSensitive( json, key );
+  if ( item == NULL )
+    return def;
+  if ( ! cJSON_IsNumber( item ) ) {
+    fprintf( stderr, "cJSON_to_uncertainty: \"%s\" is not a number.\n", key );
+    error_exit();
+  }
+  return item->valuedouble;
+}
+
+uncertainty cJSON_to_uncertainty( cJSON* json, int cfd_num ) {
+  if ( json == NULL )
+    return NULL;
+  uncertainty u = GC_MALLOC( sizeof( struct uncertainty_s ) );
+  u->cfd_num = cfd_num;
+  u->num = cJSON_GetArraySize( json );
+  u->indices = GC_MALLOC_ATOMIC( u->num * sizeof( int ) );
+  u->constants = GC_MALLOC_ATOMIC( u->num * sizeof( double ) );
+  u->dists =
+    GC_MALLOC_ATOMIC( u->num * sizeof( enum CASE_UNCERTAINTY_DIST ) );
+  u->sds = GC_MALLOC_ATOMIC( u->num * sizeof( double ) );
+  u->mins = GC_MALLOC_ATOMIC( u->num * sizeof( double ) );
+  u->maxs = GC_MALLOC_ATOMIC( u->num * sizeof( double ) );
+  cJSON* item;
+  int k = 0;
+  cJSON_ArrayForEach( item, json ) {
+    cJSON* index = cJSON_GetObjectItemCaseSensitive( item, "index" );
+    cJSON* constant = cJSON_GetObjectItemCaseSensitive( item, "constant" );
+    if ( ! cJSON_IsNumber( index ) || ! cJSON_IsNumber( constant ) ) {
+      fprintf( stderr, "cJSON_to_uncertainty: uncertain constant %d needs an "
+               "\"index\" and a \"constant\".\n", k );
+      error_exit();
+    }
+    u->indices[ k ] = index->valueint;
+    if ( u->indices[ k ] < 0 || u->indices[ k ] >= cfd_num ) {
+      fprintf( stderr, "cJSON_to_uncertainty: unknown confidence function "
+               "(%d).\n", u->indices[ k ] );
+      error_exit();
+    }
+    u->constants[ k ] = constant->valuedouble;
+    u->sds[ k ] = robust_get_double( item, "sd", 0 );
+    u->mins[ k ] = robust_get_double( item, "min", - INFINITY );
+    u->maxs[ k ] = robust_get_double( item, "max", INFINITY );
+    if ( cJSON_GetObjectItemCaseSensitive( item, "sd" ) != NULL )
+      u->dists[ k ] = UNCERTAINTY_NORMAL;
+    else if ( isfinite( u->mins[ k ] ) && isfinite( u->maxs[ k ] ) )
+      u->dists[ k ] = UNCERTAINTY_UNIFORM;
+    else {
+      fprintf( stderr, "cJSON_to_uncertainty: uncertain constant %d needs "
+               "either \"sd\" or \"min\" and \"max\".\n", k );
+      error_exit();
+    }
+    if ( u->mins[ k ] > u->maxs[ k ] || u->sds[ k ] < 0 ) {
+      fprintf( stderr, "cJSON_to_uncertainty: uncertain constant %d has an "
+               "empty interval or a negative \"sd\".\n", k );
+      error_exit();
+    }
+    ++k;
+  }
+  return u;
+}
+
+/*
+ * Scenarios
+ */
+
+// draws a value of the uncertain constant [k] of [u]
+double robust_draw( uncertainty u, int k ) {
+  double x, y, z[ 2 ];
+  if ( u->dists[ k ] == UNCERTAINTY_UNIFORM )
+    return u->mins[ k ] +
+           ( u->maxs[ k ] - u->mins[ k ] ) * rng_rand() / RAND_MAX;
+  x = ( ( double ) rng_rand() + 1 ) / ( ( double ) RAND_MAX + 1 );
+  y = ( double ) rng_rand() / RAND_MAX;
+  box_muller( x, y, z );
+  z[ 0 ] = u->constants[ k ] + u->sds[ k ] * z[ 0 ];
+  return fmin( fmax( z[ 0 ], u->mins[ k ] ), u->maxs[ k ] );
+}
+
+// replaces the constants equal to [from] in [e] by [to], and returns how many
+// there were
+int robust_replace( expression e, double from, double to ) {
+  if ( e == NULL )
+    return 0;
+  int res = e->expression_type == CONST && e->constant == from;
+  if ( res )
+    e->constant = to;
+  return res + robust_replace( e->child1, from, to ) +
+         robust_replace( e->child2, from, to );
+}
+
+objective robust_objective( int n, proof p, expression* cfd_res, uncertainty u,
+                            robust_params params ) {
+  objective obj = obj_from_proof( n, p, cfd_res );
+  int num = params->scenarios;
+  double* scenarios =
+    GC_MALLOC_ATOMIC( num * obj->const_num * sizeof( double ) );
+  expression* cfd = GC_MALLOC( u->cfd_num * sizeof( expression ) );
+  // the confidence functions of each scenario are compiled the same way as
+  // the nominal ones, so that their constants are in the same order
+  for ( int s = 0; s < num; ++s ) {
+    for ( int i = 0; i < u->cfd_num; ++i )
+      cfd[ i ] = cfd_res[ i ];
+    for ( int k = 0; k < u->num; ++k ) {
+      int i = u->indices[ k ];
+      if ( cfd_res[ i ] == NULL ) {
+        fprintf( stderr, "robust_objective: no confidence function %d.\n", i );
+        error_exit();
+      }
+      if ( cfd[ i ] == cfd_res[ i ] )
+        cfd[ i ] = exp_copy( cfd_res[ i ] );
+      if ( robust_replace( cfd[ i ], u->constants[ k ],
+                           robust_draw( u, k ) ) == 0 ) {
+        fprintf( stderr, "robust_objective: constant %g does not occur in "
+                 "confidence function %d.\n", u->constants[ k ], i );
+        error_exit();
+      }
+    }
+    objective scenario = obj_from_proof( n, p, cfd );
+    for ( int c = 0; c < obj->const_num; ++c )
+      scenarios[ s * obj->const_num + c ] = scenario->constants[ c ];
+  }
+  obj_set_scenarios( obj, num, scenarios, params->robust );
+  return obj;
+}
@@ -0,0 +1,109 @@
+/********************************************************************
+ * robust.h
+ *
+ * Header of robust.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_ROBUST_H__
+#define __CCL_ROBUST_H__
+
+#include <cjson/cJSON.h>
+#include "expression.h"
+#include "proof.h"
+#include "objective.h"
+
+/*********
+ * Types *
+ *********/
+
+/* Different possible distributions of uncertain constants:
+ * - uniform: uniform over an interval,
+ * - normal: normal around the nominal value, possibly truncated to an
+ *   interval.
+ */
+enum CASE_UNCERTAINTY_DIST {
+  UNCERTAINTY_UNIFORM,
+  UNCERTAINTY_NORMAL
+};
+
+/* The type structure for uncertain constants of confidence functions:
+ * - [cfd_num]: the number of confidence functions,
+ * - [num]: the number of uncertain constants,
+ * - [indices]: the index of the confidence function of each constant,
+ * - [constants]: their nominal values (all the constants of the confidence
+ *   function equal to the nominal value take the same value in a scenario),
+ * - [dists]: their distributions,
+ * - [sds]: the standard deviations of normal distributions,
+ * - [mins] and [maxs]: the intervals of uniform distributions, or the bounds
+ *   of normal ones (possibly infinite).
+ */
+typedef struct uncertainty_s {
+  int cfd_num;
+  int num;
+  int* indices;
+  double* constants;
+  enum CASE_UNCERTAINTY_DIST* dists;
+  double* sds;
+  double* mins;
+  double* maxs;
+} *uncertainty;
+
+/* The type structure of parameters for robust optimisation (by sample average
+ * approximation, i.e., on a fixed sample of scenarios):
+ * - [robust]: the aggregation of the scenarios (expected or worst-case
+ *   confidence),
+ * - [scenarios]: the number of scenarios.
+ */
+typedef struct robust_params_s {
+  enum CASE_OBJ_ROBUST robust;
+  int scenarios;
+} *robust_params;
+
+/************
+ * Creation *
+ ************/
+
+/* robust_params_new: creates robust optimisation parameters with default
+ * values (expected confidence over 100 scenarios).
+ * output: the parameters.
+ */
+robust_params robust_params_new();
+
+/* cJSON_to_robust_params: reads robust optimisation parameters from a JSON
+ * object with optional fields "mode" ("expected" or "worst") and "scenarios".
+ * inputs:
+ * - the JSON object [json] (or NULL for no robust optimisation).
+ * output: the parameters (NULL if [json] is NULL).
+ */
+robust_params cJSON_to_robust_params( cJSON* json );
+
+/* cJSON_to_uncertainty: reads uncertain constants from JSON, i.e., an array of
+ * objects with an "index" (of a confidence function), a nominal "constant",
+ * and either "min" and "max" (uniform distribution) or "sd" (normal
+ * distribution, with optional "min" and "max" bounds).
+ * inputs:
+ * - the JSON array [json] (or NULL for no uncertainty),
+ * - the number [cfd_num] of confidence functions.
+ * output: the uncertain constants (NULL if [json] is NULL).
+ */
+uncertainty cJSON_to_uncertainty( cJSON* json, int cfd_num );
+
+/* robust_objective: compiles the confidence in a proof as a function of the
+ * resources spent on its hypotheses, aggregated over scenarios of uncertain
+ * constants of the confidence functions drawn at random.
+ * inputs:
+ * - the number [n] of hypotheses,
+ * - the proof [p],
+ * - an array [cfd_res] of expressions describing the confidence reached by
+ *   spending some amount of resources on the hypotheses (for the nominal
+ *   constants),
+ * - the uncertain constants [u],
+ * - robust optimisation parameters [params].
+ * output: the robust objective.
+ */
+objective robust_objective( int n, proof p, expression* cfd_res, uncertainty u,
+                            robust_params params );
+
+#endif // __CCL_ROBUST_H__
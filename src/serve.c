@@ -0,0 +1,292 @@
+/********************************************************************
+ * serve.c
+ *
+ * Defines functions to answer requests from clients connected to a
+ * Unix socket, keeping their problems in memory.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#define _POSIX_C_SOURCE 200809L // for fdopen, dup, lstat, open_memstream,
+                                // nanosleep, and clock_gettime
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <gc.h>
+#include <cjson/cJSON.h>
+#include "utils.h"
+#include "optimisation.h"
+#include "parallel.h"
+#include "batch.h"
+#include "serve.h"
+
+// the names of the modes, in the order of the metrics
+char* serve_modes[ SERVE_MODES ] = {
+  ARGS_MODE_PROPAGATE_STR,
+  ARGS_MODE_SPLITS_STR,
+  ARGS_MODE_SWEEP_STR
+};
+
+/*
+ * Creation
+ */
+
+serve serve_new( optim_params params, char* filename, int threads ) {
+  serve s = GC_MALLOC( sizeof( struct serve_s ) );
+  s->problems = batch_cache_new( params, filename );
+  s->threads = parallel_threads( threads );
+  s->fd = -1;
+  s->room = 8;
+  s->queue = GC_MALLOC_ATOMIC( s->room * sizeof( int ) );
+  s->head = 0;
+  s->pending = 0;
+  pthread_cond_init( &s->ready, NULL );
+  s->connections = 0;
+  for ( int m = 0; m < SERVE_MODES; ++m ) {
+    s->metrics[ m ].requests = 0;
+    s->metrics[ m ].errors = 0;
+    s->metrics[ m ].total = 0;
+    s->metrics[ m ].max = 0;
+  }
+  pthread_mutex_init( &s->lock, NULL );
+  return s;
+}
+
+/*
+ * Usage
+ */
+
+// the time elapsed since [start], in seconds
+double serve_elapsed( struct timespec* start ) {
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return ( now.tv_sec - start->tv_sec ) +
+         ( now.tv_nsec - start->tv_nsec ) * 1e-9;
+}
+
+// prints the "id" field of [request] (if any) on [out], after [sep]
+void serve_print_id( FILE* out, cJSON* request, char* sep ) {
+  cJSON* id = cJSON_GetObjectItemCaseSensitive( request, "id" );
+  if ( id == NULL )
+    return;
+  char* s = cJSON_PrintUnformatted( id );
+  fprintf( out, "%s\"id\":%s", sep, s );
+  free( s );
+}
+
+// answers [request] with the [error] message
+void serve_error( FILE* out, cJSON* request, char* error ) {
+  fprintf( out, "{" );
+  serve_print_id( out, request, "" );
+  fprintf( out, "%s\"error\":\"%s\"}\n",
+           cJSON_GetObjectItemCaseSensitive( request, "id" ) ? "," : "",
+           error );
+}
+
+// answers a "metrics" request
+void serve_print_metrics( serve s, cJSON* request, FILE* out ) {
+  pthread_mutex_lock( &s->problems->lock );
+  int size = s->problems->size;
+  pthread_mutex_unlock( &s->problems->lock );
+  pthread_mutex_lock( &s->lock );
+  fprintf( out, "{" );
+  serve_print_id( out, request, "" );
+  fprintf( out, "%s\"connections\":%ld,\"problems\":%d,\"modes\":{",
+           cJSON_GetObjectItemCaseSensitive( request, "id" ) ? "," : "",
+           s->connections, size );
+  for ( int m = 0; m < SERVE_MODES; ++m ) {
+    serve_metrics* mt = s->metrics + m;
+    fprintf( out, "%s\"%s\":{\"requests\":%ld,\"errors\":%ld,"
+             "\"mean\":%.*g,\"max\":%.*g}", m == 0 ? "" : ",",
+             serve_modes[ m ], mt->requests, mt->errors, DBL_DIG,
+             mt->requests > 0 ? mt->total / mt->requests : 0,
+             DBL_DIG, mt->max );
+  }
+  fprintf( out, "}}\n" );
+  pthread_mutex_unlock( &s->lock );
+}
+
+void serve_answer( serve s, cJSON* request, FILE* out ) {
+  struct timespec start;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  cJSON* mode = cJSON_GetObjectItemCaseSensitive( request, "mode" );
+  int m = 1;
+  if ( cJSON_IsString( mode ) ) {
+    if ( strcmp( mode->valuestring, "metrics" ) == 0 ) {
+      serve_print_metrics( s, request, out );
+      return;
+    }
+    for ( int k = 0; k < SERVE_MODES; ++k )
+      if ( strcmp( mode->valuestring, serve_modes[ k ] ) == 0 )
+        m = k;
+  }
+  // the answer is written to memory first, so that requests failing halfway
+  // (see [error_exit]) are only answered with their error, and the server
+  // keeps serving the other ones
+  char* answer = NULL;
+  size_t size = 0;
+  FILE* volatile mem = NULL;
+  char* volatile error = "no fault tree";
+  error_handler h;
+  if ( setjmp( h.env ) != 0 )
+    error = "malformed request (see the standard error of the server)";
+  else {
+    error_push( &h );
+    batch b = batch_cache_get( s->problems, request );
+    if ( b != NULL ) {
+      mem = open_memstream( &answer, &size );
+      if ( mem == NULL ) {
+        fprintf( stderr, "serve_answer: could not open memory stream.\n" );
+        error_exit();
+      }
+      error = batch_request( b, request, BATCH_JSONL, 0, mem );
+    }
+    error_pop( &h );
+  }
+  if ( mem != NULL )
+    fclose( mem );
+  if ( error != NULL )
+    serve_error( out, request, error );
+  else
+    fwrite( answer, sizeof( char ), size, out );
+  free( answer );
+  double latency = serve_elapsed( &start );
+  pthread_mutex_lock( &s->lock );
+  serve_metrics* mt = s->metrics + m;
+  if ( error != NULL )
+    ++mt->errors;
+  else {
+    ++mt->requests;
+    mt->total += latency;
+    if ( latency > mt->max )
+      mt->max = latency;
+  }
+  pthread_mutex_unlock( &s->lock );
+}
+
+// answers the requests of the client connected to [fd], until it disconnects
+void serve_client( serve s, int fd ) {
+  int dup_fd = dup( fd );
+  FILE* in = fdopen( fd, "r" );
+  FILE* out = dup_fd < 0 ? NULL : fdopen( dup_fd, "w" );
+  if ( in == NULL || out == NULL ) {
+    // the client is dropped, the others are still served
+    fprintf( stderr, "serve_client: could not open connection.\n" );
+    if ( in != NULL )
+      fclose( in );
+    else
+      close( fd );
+    if ( dup_fd >= 0 && out == NULL )
+      close( dup_fd );
+    return;
+  }
+  char* line;
+  while ( ( line = batch_read_line( in ) ) != NULL ) {
+    if ( strspn( line, " \t" ) == strlen( line ) )
+      continue;
+    cJSON* request = cJSON_Parse( line );
+    if ( request == NULL )
+      fprintf( out, "{\"error\":\"invalid JSON\"}\n" );
+    else {
+      serve_answer( s, request, out );
+      cJSON_Delete( request );
+    }
+    if ( fflush( out ) != 0 )
+      break;
+  }
+  fclose( in );
+  fclose( out );
+}
+
+// the thread accepting clients (thread 0) or answering them (the others)
+void serve_worker( int worker, void* arg ) {
+  serve s = arg;
+  // the delay before accepting clients again after an error (in nanoseconds)
+  long delay = 0;
+  while ( true ) {
+    if ( worker == 0 ) {
+      int fd = accept( s->fd, NULL, NULL );
+      if ( fd < 0 ) {
+        // interrupted calls are retried at once, other errors (e.g., too many
+        // open files) after a delay, doubled up to a second while they last
+        if ( errno == EINTR )
+          continue;
+        if ( delay == 0 )
+          fprintf( stderr, "serve_worker: could not accept a client (%s).\n",
+                   strerror( errno ) );
+        delay = delay == 0 ? 10000000 : 2 * delay;
+        if ( delay > 1000000000 )
+          delay = 1000000000;
+        struct timespec pause = { delay / 1000000000, delay % 1000000000 };
+        nanosleep( &pause, NULL );
+        continue;
+      }
+      delay = 0;
+      pthread_mutex_lock( &s->lock );
+      ++s->connections;
+      if ( s->pending == s->room ) {
+        int* queue = GC_MALLOC_ATOMIC( 2 * s->room * sizeof( int ) );
+        for ( int i = 0; i < s->pending; ++i )
+          queue[ i ] = s->queue[ ( s->head + i ) % s->room ];
+        s->queue = queue;
+        s->head = 0;
+        s->room *= 2;
+      }
+      s->queue[ ( s->head + s->pending++ ) % s->room ] = fd;
+      pthread_cond_signal( &s->ready );
+      pthread_mutex_unlock( &s->lock );
+    } else {
+      pthread_mutex_lock( &s->lock );
+      while ( s->pending == 0 )
+        pthread_cond_wait( &s->ready, &s->lock );
+      int fd = s->queue[ s->head ];
+      s->head = ( s->head + 1 ) % s->room;
+      --s->pending;
+      pthread_mutex_unlock( &s->lock );
+      serve_client( s, fd );
+    }
+  }
+}
+
+void serve_run( serve s, char* path ) {
+  struct sockaddr_un addr;
+  if ( strlen( path ) >= sizeof( addr.sun_path ) ) {
+    fprintf( stderr, "serve_run: socket path too long (%s).\n", path );
+    error_exit();
+  }
+  memset( &addr, 0, sizeof( addr ) );
+  addr.sun_family = AF_UNIX;
+  strcpy( addr.sun_path, path );
+  // only a socket left by a previous server is replaced
+  struct stat st;
+  if ( lstat( path, &st ) == 0 ) {
+    if ( ! S_ISSOCK( st.st_mode ) ) {
+      fprintf( stderr, "serve_run: \"%s\" exists and is not a socket.\n",
+               path );
+      error_exit();
+    }
+    unlink( path );
+  }
+  s->fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+  if ( s->fd < 0 ||
+       bind( s->fd, ( struct sockaddr* ) &addr, sizeof( addr ) ) != 0 ||
+       listen( s->fd, SOMAXCONN ) != 0 ) {
+    fprintf( stderr, "serve_run: could not listen on \"%s\".\n", path );
+    error_exit();
+  }
+  // clients leaving before their answers are written must not stop the server
+  signal( SIGPIPE, SIG_IGN );
+  parallel_run( s->threads + 1, serve_worker, s );
+}
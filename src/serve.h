@@ -0,0 +1,113 @@
+/********************************************************************
+ * serve.h
+ *
+ * Header of serve.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_SERVE_H__
+#define __CCL_SERVE_H__
+
+#include <stdio.h>
+#include <pthread.h>
+#include <cjson/cJSON.h>
+#include "optimisation.h"
+#include "batch.h"
+
+/*********
+ * Types *
+ *********/
+
+// the modes of the requests, in the order of the metrics
+#define SERVE_MODES 3
+
+/* The type structure for metrics on the requests of a mode:
+ * - [requests]: the number of requests answered,
+ * - [errors]: the number of malformed requests,
+ * - [total] and [max]: the total and largest time (in seconds) taken to answer
+ *   a request.
+ */
+typedef struct serve_metrics_s {
+  long requests;
+  long errors;
+  double total;
+  double max;
+} serve_metrics;
+
+/* The type structure for allocation servers, i.e., processes answering
+ * requests (see [batch_request]) from clients connected to a Unix socket, and
+ * keeping the problems of the requests (parsed and compiled once) in memory:
+ * - [problems]: the problems of the requests,
+ * - [threads]: the number of threads answering clients (see
+ *   [parallel_threads]),
+ * - [fd]: the socket clients connect to (-1 until [serve_run]),
+ * - [queue], [head], [pending], and [room]: the connections waiting for a
+ *   thread (a circular buffer of [room] connections, [pending] of them from
+ *   [head]),
+ * - [ready]: the condition signalled when a connection is queued,
+ * - [connections] and [metrics]: the number of connections accepted, and the
+ *   metrics of each mode ("propagate", "splits", and "sweep"),
+ * - [lock]: the lock protecting the queue and the metrics.
+ */
+typedef struct serve_s {
+  batch_cache problems;
+  int threads;
+  int fd;
+  int* queue;
+  int head;
+  int pending;
+  int room;
+  pthread_cond_t ready;
+  long connections;
+  serve_metrics metrics[ SERVE_MODES ];
+  pthread_mutex_t lock;
+} *serve;
+
+/************
+ * Creation *
+ ************/
+
+/* serve_new: creates a server with no problem in memory.
+ * inputs:
+ * - the default optimisation parameters [params] (or NULL),
+ * - the [filename] of a warm-start cache (or NULL),
+ * - the number of [threads] answering clients (0 or less for one per
+ *   processor).
+ * output: the server.
+ */
+serve serve_new( optim_params params, char* filename, int threads );
+
+/*********
+ * Usage *
+ *********/
+
+/* serve_answer: answers a request, i.e., a JSON object with the fields of a
+ * batch request (see [batch_request]) and of its problem (see
+ * [problem_to_batch], the "algorithm" only overriding the default optimisation
+ * parameters), whose problem is parsed and compiled only if none of the
+ * previous requests had the same one (see [batch_cache_get]). Malformed
+ * requests (including those failing halfway, whose partial answer is dropped)
+ * are answered with an "error" message, and requests with "mode" "metrics" with
+ * the number of "connections", of "problems" in memory, and the metrics of each
+ * mode (see [serve_metrics], latencies in seconds).
+ * inputs:
+ * - the server [s],
+ * - the [request],
+ * - the stream [out] the answer is printed to (on a single line).
+ * output: nothing.
+ */
+void serve_answer( serve s, cJSON* request, FILE* out );
+
+/* serve_run: listens on a Unix socket (replacing any socket at its path, but
+ * failing if another kind of file is there) and answers the requests of its
+ * clients, one per line (JSON Lines), until the process is killed. Each client
+ * is served by one thread, in order.
+ * inputs:
+ * - the server [s],
+ * - the [path] of the socket.
+ * output: nothing.
+ */
+void serve_run( serve s, char* path );
+
+#endif // __CCL_SERVE_H__
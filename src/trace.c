@@ -0,0 +1,140 @@
+/********************************************************************
+ * trace.c
+ *
+ * Defines functions to follow and interrupt optimisations.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#define _POSIX_C_SOURCE 199309L // for clock_gettime
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+#include <gc.h>
+#include <cjson/cJSON.h>
+#include "utils.h"
+#include "trace.h"
+
+/*
+ * Creation
+ */
+
+trace trace_new() {
+  trace tr = GC_MALLOC( sizeof( struct trace_s ) );
+  tr->file = NULL;
+  tr->format = TRACE_CSV;
+  tr->every = 100;
+  tr->anytime = false;
+  tr->time_limit = 0;
+  tr->target = INFINITY;
+  tr->n = 0;
+  tr->sigma = NULL;
+  return tr;
+}
+
+trace cJSON_to_trace( cJSON* json ) {
+  trace tr = trace_new();
+  if ( json == NULL )
+    return tr;
+  cJSON* item = cJSON_GetObjectItemCaseSensitive( json, "format" );
+  if ( cJSON_IsString( item ) ) {
+    if ( strcmp( item->valuestring, "csv" ) == 0 )
+      tr->format = TRACE_CSV;
+    else if ( strcmp( item->valuestring, "binary" ) == 0 )
+      tr->format = TRACE_BINARY;
+    else {
+      fprintf( stderr, "Unknown trace format (%s).\n", item->valuestring );
+      error_exit();
+    }
+  }
+  item = cJSON_GetObjectItemCaseSensitive( json, "every" );
+  if ( cJSON_IsNumber( item ) )
+    tr->every = item->valueint;
+  if ( tr->every < 1 ) {
+    fprintf( stderr, "Trace \"every\" should be positive.\n" );
+    error_exit();
+  }
+  item = cJSON_GetObjectItemCaseSensitive( json, "anytime" );
+  if ( item != NULL )
+    tr->anytime = cJSON_IsTrue( item );
+  item = cJSON_GetObjectItemCaseSensitive( json, "time_limit" );
+  if ( cJSON_IsNumber( item ) )
+    tr->time_limit = item->valuedouble;
+  item = cJSON_GetObjectItemCaseSensitive( json, "target" );
+  if ( cJSON_IsNumber( item ) )
+    tr->target = item->valuedouble;
+  item = cJSON_GetObjectItemCaseSensitive( json, "file" );
+  if ( cJSON_IsString( item ) ) {
+    tr->file = fopen( item->valuestring,
+                      tr->format == TRACE_BINARY ? "wb" : "w" );
+    if ( tr->file == NULL ) {
+      fprintf( stderr, "Error while opening: \"%s\"\n", item->valuestring );
+      error_exit();
+    }
+    if ( tr->format == TRACE_CSV )
+      fprintf( tr->file, "step,value,temperature,acceptance,best\n" );
+  }
+  return tr;
+}
+
+/*
+ * Usage
+ */
+
+void trace_start( trace tr, int n, double* sigma ) {
+  tr->n = n;
+  tr->sigma = sigma;
+  clock_gettime( CLOCK_MONOTONIC, &tr->start );
+}
+
+bool trace_due( trace tr, int step ) {
+  return step % tr->every == 0;
+}
+
+void trace_record( trace tr, int step, double value, double temperature,
+                   double acceptance, double best ) {
+  if ( tr->file == NULL )
+    return;
+  if ( tr->format == TRACE_BINARY ) {
+    double record[ 5 ] = { step, value, temperature, acceptance, best };
+    fwrite( record, sizeof( double ), 5, tr->file );
+  } else
+    fprintf( tr->file, "%d,%.*g,%.*g,%.*g,%.*g\n", step, DBL_DIG, value,
+             DBL_DIG, temperature, DBL_DIG, acceptance, DBL_DIG, best );
+}
+
+double trace_elapsed( trace tr ) {
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return ( now.tv_sec - tr->start.tv_sec ) +
+         ( now.tv_nsec - tr->start.tv_nsec ) * 1e-9;
+}
+
+bool trace_improved( trace tr, double cfd, double* point ) {
+  if ( tr->anytime ) {
+    printf( "# time=%.*f confidence=%.*f", DBL_DIG, trace_elapsed( tr ),
+            DBL_DIG, cfd );
+    for ( int i = 0; i < tr->n; ++i )
+      printf( " %d=%.*f", i, DBL_DIG, point[ i ] - tr->sigma[ i ] );
+    printf( "\n" );
+    fflush( stdout );
+  }
+  return cfd >= tr->target;
+}
+
+bool trace_stop( trace tr, double cfd ) {
+  return cfd >= tr->target ||
+         ( tr->time_limit > 0 && trace_elapsed( tr ) >= tr->time_limit );
+}
+
+void trace_close( trace tr ) {
+  if ( tr->file == NULL )
+    return;
+  if ( fclose( tr->file ) != 0 )
+    fprintf( stderr, "trace_close: could not write the trace.\n" );
+  tr->file = NULL;
+}
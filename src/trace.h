@@ -0,0 +1,147 @@
+/********************************************************************
+ * trace.h
+ *
+ * Header of trace.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_TRACE_H__
+#define __CCL_TRACE_H__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <cjson/cJSON.h>
+
+/*********
+ * Types *
+ *********/
+
+/* Different possible formats for traces:
+ * - CSV, with a header line,
+ * - binary, each record being 5 doubles (in the byte order of the machine).
+ */
+enum TRACE_FORMAT {
+  TRACE_CSV,
+  TRACE_BINARY
+};
+
+/* The type structure for traces of optimisations, i.e., records of their
+ * progress every few steps, and for anytime optimisation, i.e., printing the
+ * improved allocations as they are found and stopping at a deadline or at a
+ * confidence target:
+ * - [file]: the file records are written to (NULL for no record),
+ * - [format]: the format of the records,
+ * - [every]: the number of steps between records (and between checks of the
+ *   deadline),
+ * - [anytime]: whether improved allocations are printed (on comment lines of
+ *   the standard output),
+ * - [time_limit]: the deadline in seconds after [trace_start] (0 for none),
+ * - [target]: the confidence at which optimisation stops (INFINITY for none),
+ * - [start]: the time of [trace_start],
+ * - [n] and [sigma]: the number of hypotheses and the resources already spent
+ *   on them (so that allocations are printed as resources to spend).
+ */
+typedef struct trace_s {
+  FILE* file;
+  enum TRACE_FORMAT format;
+  int every;
+  bool anytime;
+  double time_limit;
+  double target;
+  struct timespec start;
+  int n;
+  double* sigma;
+} *trace;
+
+/************
+ * Creation *
+ ************/
+
+/* trace_new: creates a trace that records nothing and never stops
+ * optimisation.
+ * output: the trace.
+ */
+trace trace_new();
+
+/* cJSON_to_trace: reads a trace from a (possibly NULL) JSON object with
+ * optional fields "file", "format" ("csv" or "binary"), "every", "anytime",
+ * "time_limit", and "target", and opens its file (writing the CSV header).
+ * inputs:
+ * - the JSON object [json].
+ * output: the trace.
+ */
+trace cJSON_to_trace( cJSON* json );
+
+/*********
+ * Usage *
+ *********/
+
+/* trace_start: starts the clock of a trace, at the beginning of an
+ * optimisation.
+ * inputs:
+ * - the trace [tr],
+ * - the number [n] of hypotheses,
+ * - an array [sigma] of size [n] of the resources already spent.
+ * output: nothing.
+ */
+void trace_start( trace tr, int n, double* sigma );
+
+/* trace_due: tests whether a step should be recorded (and the deadline
+ * checked).
+ * inputs:
+ * - the trace [tr],
+ * - the [step].
+ * output: true iff [step] is a multiple of [tr]->every.
+ */
+bool trace_due( trace tr, int step );
+
+/* trace_record: records the state of an optimisation (if the trace has a
+ * file).
+ * inputs:
+ * - the trace [tr],
+ * - the [step],
+ * - the current [value] (e.g., energy),
+ * - the [temperature] (or step size),
+ * - the [acceptance] rate since the last record,
+ * - the [best] value so far.
+ * output: nothing.
+ */
+void trace_record( trace tr, int step, double value, double temperature,
+                   double acceptance, double best );
+
+/* trace_elapsed: gives the time elapsed since [trace_start].
+ * inputs:
+ * - the trace [tr].
+ * output: the time, in seconds.
+ */
+double trace_elapsed( trace tr );
+
+/* trace_improved: signals an improved allocation, printed in anytime mode.
+ * inputs:
+ * - the trace [tr],
+ * - the confidence [cfd] of the allocation,
+ * - an array [point] of size [tr]->n of the resources on each hypothesis
+ *   (including the resources already spent).
+ * output: true iff [cfd] reaches the target of [tr].
+ */
+bool trace_improved( trace tr, double cfd, double* point );
+
+/* trace_stop: tests whether an optimisation should stop.
+ * inputs:
+ * - the trace [tr],
+ * - the best confidence [cfd] so far.
+ * output: true iff the deadline is past or [cfd] reaches the target.
+ */
+bool trace_stop( trace tr, double cfd );
+
+/* trace_close: closes the file of a trace (if any), writing its last
+ * records, after which the trace records nothing.
+ * inputs:
+ * - the trace [tr].
+ * output: nothing.
+ */
+void trace_close( trace tr );
+
+#endif // __CCL_TRACE_H__
@@ -6,12 +6,19 @@
  * Author: Clovis Eberhart
  ********************************************************************/
 
+#define _POSIX_C_SOURCE 200809L // for mmap
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <math.h>
 #include <float.h>
 #include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <gc.h>
 #include "utils.h"
 
@@ -53,7 +60,7 @@ double l1_norm( int n, double* v ) {
     if ( dcompare( v[ i ], 0, 1 ) < 0 ) {
       if ( v[ i ] < 0 )
       fprintf( stderr, "l1_norm: v[ %d ] = %f < 0.\n", i, v[ i ] );
-      exit( 1 );
+      error_exit();
     }
     res += v[ i ];
   }
@@ -76,6 +83,13 @@ args args_new() {
   res->mode = NULL;
   res->filename = NULL;
   res->filename_optimisation = NULL;
+  res->filename_cache = NULL;
+  res->filename_requests = NULL;
+  res->filename_model = NULL;
+  res->filename_presets = NULL;
+  res->socket = NULL;
+  res->format = NULL;
+  res->threads = 0;
   return res;
 }
 
@@ -107,11 +121,20 @@ void args_read( args a, int argc, char** argv ) {
           } else if ( strcmp( argv[ i ], "logic" ) == 0 ) {
             if ( ( a->test >> TEST_LOGIC_BIT ) % 2 == 0 )
               a->test += 1 << TEST_LOGIC_BIT;
+          } else if ( strcmp( argv[ i ], "objective" ) == 0 ) {
+            if ( ( a->test >> TEST_OBJECTIVE_BIT ) % 2 == 0 )
+              a->test += 1 << TEST_OBJECTIVE_BIT;
+          } else if ( strcmp( argv[ i ], "batch" ) == 0 ) {
+            if ( ( a->test >> TEST_BATCH_BIT ) % 2 == 0 )
+              a->test += 1 << TEST_BATCH_BIT;
+          } else if ( strcmp( argv[ i ], "astrahl" ) == 0 ) {
+            if ( ( a->test >> TEST_ASTRAHL_BIT ) % 2 == 0 )
+              a->test += 1 << TEST_ASTRAHL_BIT;
           } else if ( strcmp( argv[ i ], "all" ) == 0 )
             a->test = ( 1 << TEST_INT ) - 1;
           else {
             fprintf( stderr, "Unknown test option (%s).\n", argv[ i ] );
-            exit( 1 );
+            error_exit();
           }
         }
       } else {
@@ -121,7 +144,7 @@ void args_read( args a, int argc, char** argv ) {
     } else if ( strcmp( argv[ i ], "--verbosity" ) == 0 ) {
       if ( ++i == argc ) {
         fprintf( stderr, "--verbosity needs an argument" );
-        exit( 1 );
+        error_exit();
       }
       a->print_level = atoi( argv[ i++ ] );
     } else if ( strcmp( argv[ i ], "-f" ) == 0 ||
@@ -130,7 +153,7 @@ void args_read( args a, int argc, char** argv ) {
         a->filename = argv[ i++ ];
       } else {
         fprintf( stderr, "No filename specified.\n" );
-        exit( 1 );
+        error_exit();
       }
     } else if ( strcmp( argv[ i ], "-o" ) == 0 ||
                 strcmp( argv[ i ], "--optimisation" ) == 0 ) {
@@ -138,24 +161,95 @@ void args_read( args a, int argc, char** argv ) {
         a->filename_optimisation = argv[ i++ ];
       } else {
         fprintf( stderr, "No optimisation filename specified.\n" );
-        exit( 1 );
+        error_exit();
+      }
+    } else if ( strcmp( argv[ i ], "-c" ) == 0 ||
+                strcmp( argv[ i ], "--cache" ) == 0 ) {
+      if ( ++i < argc ) {
+        a->filename_cache = argv[ i++ ];
+      } else {
+        fprintf( stderr, "No cache filename specified.\n" );
+        error_exit();
+      }
+    } else if ( strcmp( argv[ i ], "-r" ) == 0 ||
+                strcmp( argv[ i ], "--requests" ) == 0 ) {
+      if ( ++i < argc ) {
+        a->filename_requests = argv[ i++ ];
+      } else {
+        fprintf( stderr, "No requests filename specified.\n" );
+        error_exit();
+      }
+    } else if ( strcmp( argv[ i ], "-m" ) == 0 ||
+                strcmp( argv[ i ], "--model" ) == 0 ) {
+      if ( ++i < argc ) {
+        a->filename_model = argv[ i++ ];
+      } else {
+        fprintf( stderr, "No model filename specified.\n" );
+        error_exit();
+      }
+    } else if ( strcmp( argv[ i ], "-p" ) == 0 ||
+                strcmp( argv[ i ], "--presets" ) == 0 ) {
+      if ( ++i < argc ) {
+        a->filename_presets = argv[ i++ ];
+      } else {
+        fprintf( stderr, "No presets filename specified.\n" );
+        error_exit();
+      }
+    } else if ( strcmp( argv[ i ], "-s" ) == 0 ||
+                strcmp( argv[ i ], "--socket" ) == 0 ) {
+      if ( ++i < argc ) {
+        a->socket = argv[ i++ ];
+      } else {
+        fprintf( stderr, "No socket path specified.\n" );
+        error_exit();
+      }
+    } else if ( strcmp( argv[ i ], "-F" ) == 0 ||
+                strcmp( argv[ i ], "--format" ) == 0 ) {
+      if ( ++i < argc ) {
+        a->format = argv[ i++ ];
+      } else {
+        fprintf( stderr, "No output format specified.\n" );
+        error_exit();
+      }
+    } else if ( strcmp( argv[ i ], "-t" ) == 0 ||
+                strcmp( argv[ i ], "--threads" ) == 0 ) {
+      if ( ++i < argc ) {
+        a->threads = atoi( argv[ i++ ] );
+      } else {
+        fprintf( stderr, "No number of threads specified.\n" );
+        error_exit();
       }
     } else if ( a->mode != NULL ) {
       fprintf( stderr, "Two modes specified (%s and %s).\n", a->mode,
                argv[ i ] );
-      exit( 1 );
+      error_exit();
     } else if ( strcmp( argv[ i ], ARGS_MODE_PROPAGATE_STR ) == 0 ) {
       a->mode = ARGS_MODE_PROPAGATE_STR;
       i++;
     } else if ( strcmp( argv[ i ], ARGS_MODE_SPLITS_STR ) == 0 ) {
       a->mode = ARGS_MODE_SPLITS_STR;
       i++;
+    } else if ( strcmp( argv[ i ], ARGS_MODE_SWEEP_STR ) == 0 ) {
+      a->mode = ARGS_MODE_SWEEP_STR;
+      i++;
+    } else if ( strcmp( argv[ i ], ARGS_MODE_PARETO_STR ) == 0 ) {
+      a->mode = ARGS_MODE_PARETO_STR;
+      i++;
+    } else if ( strcmp( argv[ i ], ARGS_MODE_BATCH_STR ) == 0 ) {
+      a->mode = ARGS_MODE_BATCH_STR;
+      i++;
+    } else if ( strcmp( argv[ i ], ARGS_MODE_SERVE_STR ) == 0 ) {
+      a->mode = ARGS_MODE_SERVE_STR;
+      i++;
+    } else if ( strcmp( argv[ i ], ARGS_MODE_COMPILE_STR ) == 0 ) {
+      a->mode = ARGS_MODE_COMPILE_STR;
+      i++;
     } else if ( strcmp( argv[ i ], ARGS_MODE_BENCHMARK_STR ) == 0 ) {
       a->mode = ARGS_MODE_BENCHMARK_STR;
       i++;
     } else {
       fprintf( stderr, "Unknown mode (%s).\n", argv[ i ] );
-      exit( 1 );
+      error_exit();
     }
   }
 }
@@ -190,3 +284,335 @@ double square_norm( int n, double* v ) {
     res += v[ i ] * v[ i ];
   return res;
 }
+
+void project_simplex( int n, double* v, double* lower, double total ) {
+  // we look for tau such that sum max( lower_i, v_i - tau ) = total, i.e.,
+  // sum max( 0, d_i - tau ) = r with d_i = v_i - lower_i
+  double r = total;
+  for ( int i = 0; i < n; ++i )
+    r -= lower[ i ];
+  double sum = 0;
+  for ( int i = 0; i < n; ++i )
+    sum += v[ i ] - lower[ i ];
+  double tau = ( sum - r ) / n;
+  int active = n, prev_active = n + 1;
+  // the active set only shrinks, so this loop stops after at most n rounds
+  while ( active > 0 && active < prev_active ) {
+    prev_active = active;
+    active = 0;
+    sum = 0;
+    for ( int i = 0; i < n; ++i )
+      if ( v[ i ] - lower[ i ] > tau ) {
+        sum += v[ i ] - lower[ i ];
+        active++;
+      }
+    if ( active > 0 )
+      tau = ( sum - r ) / active;
+  }
+  for ( int i = 0; i < n; ++i ) {
+    if ( v[ i ] - lower[ i ] > tau )
+      v[ i ] -= tau;
+    else
+      v[ i ] = lower[ i ];
+  }
+}
+
+void project_tangent( int n, double* v, double* x, double* lower ) {
+  double mean = 0, prev_mean;
+  for ( int i = 0; i < n; ++i )
+    mean += v[ i ] / n;
+  // coordinates at their bound whose component is below the mean are fixed,
+  // which raises the mean, so this loop stops after at most n rounds
+  do {
+    prev_mean = mean;
+    double sum = 0;
+    int free = 0;
+    for ( int i = 0; i < n; ++i )
+      if ( x[ i ] > lower[ i ] || v[ i ] >= prev_mean ) {
+        sum += v[ i ];
+        free++;
+      }
+    mean = sum / free;
+  } while ( mean > prev_mean );
+  for ( int i = 0; i < n; ++i ) {
+    if ( x[ i ] > lower[ i ] || v[ i ] >= prev_mean )
+      v[ i ] -= mean;
+    else
+      v[ i ] = 0;
+  }
+}
+
+void hyperplane_from_basis( int n, double* coefs, double* v ) {
+  // coordinate j gets the suffix sum of the a_i coefs_i for i >= j, where
+  // a_i = 1 / sqrt((i+1) + (i+1)^2), minus j a_{j-1} coefs_{j-1}
+  double suffix = 0, a;
+  for ( int j = n - 1; j >= 0; --j ) {
+    if ( j < n - 1 )
+      suffix += coefs[ j ] / sqrt( ( j + 1 ) + ( j + 1 ) * ( j + 1 ) );
+    v[ j ] += suffix;
+    if ( j > 0 ) {
+      a = 1 / sqrt( j + j * j );
+      v[ j ] -= j * a * coefs[ j - 1 ];
+    }
+  }
+}
+
+void hyperplane_to_basis( int n, double* v, double* coefs ) {
+  double prefix = 0;
+  for ( int i = 0; i < n - 1; ++i ) {
+    prefix += v[ i ];
+    coefs[ i ] = ( prefix - ( i + 1 ) * v[ i + 1 ] ) /
+                 sqrt( ( i + 1 ) + ( i + 1 ) * ( i + 1 ) );
+  }
+}
+
+/*
+ * Matrices
+ */
+
+void eigen_symmetric( int n, double* a, double* vals, double* vecs ) {
+  double off, theta, t, c, s, tau, app, aqq, apq;
+  for ( int i = 0; i < n; ++i )
+    for ( int j = 0; j < n; ++j )
+      vecs[ i * n + j ] = i == j;
+  for ( int sweep = 0; sweep < 50; ++sweep ) {
+    off = 0;
+    for ( int p = 0; p < n; ++p )
+      for ( int q = p + 1; q < n; ++q )
+        off += a[ p * n + q ] * a[ p * n + q ];
+    if ( off < DBL_MIN )
+      break;
+    for ( int p = 0; p < n; ++p )
+      for ( int q = p + 1; q < n; ++q ) {
+        apq = a[ p * n + q ];
+        if ( apq == 0 )
+          continue;
+        app = a[ p * n + p ];
+        aqq = a[ q * n + q ];
+        // rotation zeroing a[p][q]
+        theta = ( aqq - app ) / ( 2 * apq );
+        t = ( theta >= 0 ? 1 : -1 ) /
+            ( fabs( theta ) + sqrt( theta * theta + 1 ) );
+        c = 1 / sqrt( t * t + 1 );
+        s = t * c;
+        tau = s / ( 1 + c );
+        a[ p * n + p ] = app - t * apq;
+        a[ q * n + q ] = aqq + t * apq;
+        a[ p * n + q ] = 0;
+        a[ q * n + p ] = 0;
+        for ( int r = 0; r < n; ++r ) {
+          if ( r != p && r != q ) {
+            double arp = a[ r * n + p ], arq = a[ r * n + q ];
+            a[ r * n + p ] = arp - s * ( arq + tau * arp );
+            a[ p * n + r ] = a[ r * n + p ];
+            a[ r * n + q ] = arq + s * ( arp - tau * arq );
+            a[ q * n + r ] = a[ r * n + q ];
+          }
+          double vrp = vecs[ r * n + p ], vrq = vecs[ r * n + q ];
+          vecs[ r * n + p ] = vrp - s * ( vrq + tau * vrp );
+          vecs[ r * n + q ] = vrq + s * ( vrp - tau * vrq );
+        }
+      }
+  }
+  for ( int i = 0; i < n; ++i )
+    vals[ i ] = a[ i * n + i ];
+}
+
+bool linear_solve( int n, double* a, double* b ) {
+  double scale = 0;
+  for ( int i = 0; i < n * n; ++i )
+    if ( fabs( a[ i ] ) > scale )
+      scale = fabs( a[ i ] );
+  for ( int k = 0; k < n; ++k ) {
+    int pivot = k;
+    for ( int i = k + 1; i < n; ++i )
+      if ( fabs( a[ i * n + k ] ) > fabs( a[ pivot * n + k ] ) )
+        pivot = i;
+    if ( fabs( a[ pivot * n + k ] ) <= scale * n * DBL_EPSILON )
+      return false;
+    if ( pivot != k ) {
+      for ( int j = k; j < n; ++j ) {
+        double t = a[ k * n + j ];
+        a[ k * n + j ] = a[ pivot * n + j ];
+        a[ pivot * n + j ] = t;
+      }
+      double t = b[ k ];
+      b[ k ] = b[ pivot ];
+      b[ pivot ] = t;
+    }
+    for ( int i = k + 1; i < n; ++i ) {
+      double f = a[ i * n + k ] / a[ k * n + k ];
+      if ( f == 0 )
+        continue;
+      for ( int j = k; j < n; ++j )
+        a[ i * n + j ] -= f * a[ k * n + j ];
+      b[ i ] -= f * b[ k ];
+    }
+  }
+  for ( int i = n - 1; i >= 0; --i ) {
+    for ( int j = i + 1; j < n; ++j )
+      b[ i ] -= a[ i * n + j ] * b[ j ];
+    b[ i ] /= a[ i * n + i ];
+  }
+  return true;
+}
+
+/*
+ * Files
+ */
+
+char* file_map( char* filename, size_t* length ) {
+  int fd = open( filename, O_RDONLY );
+  struct stat st;
+  if ( fd < 0 || fstat( fd, &st ) != 0 ) {
+    fprintf( stderr, "Error while opening: \"%s\"\n", filename );
+    error_exit();
+  }
+  *length = st.st_size;
+  // empty files cannot be mapped
+  if ( *length == 0 ) {
+    close( fd );
+    return "";
+  }
+  char* contents = mmap( NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if ( contents == MAP_FAILED ) {
+    fprintf( stderr, "Error while mapping: \"%s\"\n", filename );
+    error_exit();
+  }
+  return contents;
+}
+
+void file_unmap( char* contents, size_t length ) {
+  if ( length > 0 )
+    munmap( contents, length );
+}
+
+/*
+ * Hashing
+ */
+
+uint64_t hash_string( char* s, uint64_t h ) {
+  for ( ; *s != '\0'; ++s ) {
+    h ^= ( unsigned char ) *s;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/*
+ * Random numbers
+ */
+
+// the key of the state of the generator of each thread (NULL until the thread
+// seeds it), which is not allocated by the collector since the collector does
+// not scan thread-specific data
+pthread_key_t rng_key;
+pthread_once_t rng_once = PTHREAD_ONCE_INIT;
+
+void rng_init() {
+  pthread_key_create( &rng_key, free );
+}
+
+void rng_seed( uint64_t seed ) {
+  pthread_once( &rng_once, rng_init );
+  uint64_t* state = pthread_getspecific( rng_key );
+  if ( state == NULL ) {
+    state = malloc( sizeof( uint64_t ) );
+    pthread_setspecific( rng_key, state );
+  }
+  *state = seed;
+}
+
+int rng_rand() {
+  pthread_once( &rng_once, rng_init );
+  uint64_t* state = pthread_getspecific( rng_key );
+  if ( state == NULL )
+    return rand();
+  uint64_t z = ( *state += 0x9e3779b97f4a7c15ULL );
+  z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+  z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  return ( int ) ( z % ( ( uint64_t ) RAND_MAX + 1 ) );
+}
+
+/*
+ * Errors
+ */
+
+// the key of the last error handler of each thread (NULL if it has none)
+pthread_key_t error_key;
+pthread_once_t error_once = PTHREAD_ONCE_INIT;
+
+void error_init() {
+  pthread_key_create( &error_key, NULL );
+}
+
+void error_push( error_handler* h ) {
+  pthread_once( &error_once, error_init );
+  h->previous = pthread_getspecific( error_key );
+  pthread_setspecific( error_key, h );
+}
+
+void error_pop( error_handler* h ) {
+  pthread_once( &error_once, error_init );
+  pthread_setspecific( error_key, h->previous );
+}
+
+void error_return() {
+  pthread_once( &error_once, error_init );
+  error_handler* h = pthread_getspecific( error_key );
+  if ( h == NULL )
+    return;
+  pthread_setspecific( error_key, h->previous );
+  longjmp( h->env, 1 );
+}
+
+/*
+ * Intervals
+ */
+
+// the smallest interval containing four values, where NaNs (from 0 * inf or
+// inf - inf) make the result unbounded
+void interval_hull( double a, double b, double c, double d, double* res ) {
+  if ( isnan( a ) || isnan( b ) || isnan( c ) || isnan( d ) ) {
+    res[ 0 ] = - INFINITY;
+    res[ 1 ] = INFINITY;
+    return;
+  }
+  res[ 0 ] = fmin( fmin( a, b ), fmin( c, d ) );
+  res[ 1 ] = fmax( fmax( a, b ), fmax( c, d ) );
+}
+
+void interval_mul( double* x, double* y, double* res ) {
+  interval_hull( x[ 0 ] * y[ 0 ], x[ 0 ] * y[ 1 ],
+                 x[ 1 ] * y[ 0 ], x[ 1 ] * y[ 1 ], res );
+}
+
+void interval_div( double* x, double* y, double* res ) {
+  if ( y[ 0 ] <= 0 && y[ 1 ] >= 0 ) {
+    res[ 0 ] = - INFINITY;
+    res[ 1 ] = INFINITY;
+    return;
+  }
+  interval_hull( x[ 0 ] / y[ 0 ], x[ 0 ] / y[ 1 ],
+                 x[ 1 ] / y[ 0 ], x[ 1 ] / y[ 1 ], res );
+}
+
+void interval_pow( double* x, double* y, double* res ) {
+  // on non-negative bases, pow is monotone in each argument, so that its
+  // extrema are reached at the corners
+  if ( x[ 0 ] < 0 ) {
+    res[ 0 ] = - INFINITY;
+    res[ 1 ] = INFINITY;
+    return;
+  }
+  interval_hull( pow( x[ 0 ], y[ 0 ] ), pow( x[ 0 ], y[ 1 ] ),
+                 pow( x[ 1 ], y[ 0 ] ), pow( x[ 1 ], y[ 1 ] ), res );
+}
+
+void interval_log( double* x, double* res ) {
+  double hi = x[ 1 ];
+  res[ 0 ] = x[ 0 ] > 0 ? log( x[ 0 ] ) : - INFINITY;
+  res[ 1 ] = hi > 0 ? log( hi ) : - INFINITY;
+}
@@ -9,7 +9,11 @@
 #ifndef __CCL_UTILS_H__
 #define __CCL_UTILS_H__
 
+#include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <setjmp.h>
 
 /************
  * Integers *
@@ -85,16 +89,24 @@ void box_muller( double x, double y, double* res );
  * Arguments *
  *************/
 
-#define TEST_INT            6
+#define TEST_INT            9
 #define TEST_EXPRESSION_BIT 0
 #define TEST_FORMULA_BIT    1
 #define TEST_SEQUENT_BIT    2
 #define TEST_PROOF_BIT      3
 #define TEST_FAULT_TREE_BIT 4
 #define TEST_LOGIC_BIT      5
+#define TEST_OBJECTIVE_BIT  6
+#define TEST_BATCH_BIT      7
+#define TEST_ASTRAHL_BIT    8
 
 #define ARGS_MODE_PROPAGATE_STR "propagate"
 #define ARGS_MODE_SPLITS_STR "splits"
+#define ARGS_MODE_SWEEP_STR "sweep"
+#define ARGS_MODE_PARETO_STR "pareto"
+#define ARGS_MODE_BATCH_STR "batch"
+#define ARGS_MODE_SERVE_STR "serve"
+#define ARGS_MODE_COMPILE_STR "compile"
 #define ARGS_MODE_BENCHMARK_STR "benchmark"
 
 typedef struct args_s {
@@ -103,6 +115,13 @@ typedef struct args_s {
   char* mode;
   char* filename;
   char* filename_optimisation;
+  char* filename_cache;
+  char* filename_requests;
+  char* filename_model;
+  char* filename_presets;
+  char* socket;
+  char* format;
+  int threads;
 } *args;
 
 args args_new();
@@ -144,4 +163,206 @@ void printf_reset();
  */
 double square_norm( int n, double* v );
 
+/* project_simplex: computes the Euclidean projection of a vector on the set of
+ * vectors that lie above a lower bound and whose coordinates sum to a given
+ * total (Michelot's algorithm, no allocation).
+ * inputs:
+ * - the size [n] of the vectors,
+ * - an array [v] of doubles representing the vector to project,
+ * - an array [lower] of doubles representing the lower bound,
+ * - a double [total] representing the sum of the coordinates of the result
+ *   (should be at least the sum of [lower]).
+ * output: nothing (the projection is stored in [v]).
+ */
+void project_simplex( int n, double* v, double* lower, double total );
+
+/* project_tangent: projects a direction on the tangent cone of the set of
+ * [project_simplex] at a point, i.e., removes the component orthogonal to the
+ * hyperplane and the components that would push coordinates already at their
+ * lower bound further down.
+ * inputs:
+ * - the size [n] of the vectors,
+ * - an array [v] of doubles representing the direction,
+ * - an array [x] of doubles representing the point,
+ * - an array [lower] of doubles representing the lower bound.
+ * output: nothing (the projection is stored in [v]).
+ */
+void project_tangent( int n, double* v, double* x, double* lower );
+
+/* The orthonormal basis (v_0,...,v_{n-2}) of the hyperplane of vectors of size
+ * [n] whose coordinates sum to 0 used by optimisation algorithms is given by
+ * (v_i)_j =
+ * - 1 / sqrt((i+1) + (i+1)^2) if j < i+1,
+ * - - (i+1) / sqrt((i+1) + (i+1)^2) if j = i+1,
+ * - 0 if j > i+1.
+ */
+
+/* hyperplane_from_basis: adds a linear combination of the basis of the
+ * hyperplane to a vector (in linear time).
+ * inputs:
+ * - the size [n] of the vectors,
+ * - an array [coefs] of [n]-1 doubles representing the coefficients,
+ * - an array [v] of doubles representing the vector.
+ * output: nothing (the result is stored in [v]).
+ */
+void hyperplane_from_basis( int n, double* coefs, double* v );
+
+/* hyperplane_to_basis: computes the coordinates of the projection of a vector
+ * on the hyperplane in its basis (in linear time).
+ * inputs:
+ * - the size [n] of the vectors,
+ * - an array [v] of doubles representing the vector,
+ * - an array [coefs] of [n]-1 doubles to store the coordinates.
+ * output: nothing (stored in [coefs]).
+ */
+void hyperplane_to_basis( int n, double* v, double* coefs );
+
+/************
+ * Matrices *
+ ************/
+
+/* eigen_symmetric: computes the eigendecomposition of a symmetric matrix
+ * (cyclic Jacobi method).
+ * inputs:
+ * - the size [n] of the matrix,
+ * - an array [a] of [n]*[n] doubles representing the matrix (row-major),
+ *   which is destroyed,
+ * - an array [vals] of [n] doubles to store the eigenvalues,
+ * - an array [vecs] of [n]*[n] doubles to store the eigenvectors (as columns,
+ *   row-major).
+ * output: nothing (stored in [vals] and [vecs]).
+ */
+void eigen_symmetric( int n, double* a, double* vals, double* vecs );
+
+/* linear_solve: solves a linear system (Gaussian elimination with partial
+ * pivoting).
+ * inputs:
+ * - the size [n] of the system,
+ * - an array [a] of [n]*[n] doubles representing the matrix (row-major),
+ *   which is destroyed,
+ * - an array [b] of [n] doubles representing the right-hand side, which is
+ *   replaced by the solution.
+ * output: false iff the matrix is (numerically) singular.
+ */
+bool linear_solve( int n, double* a, double* b );
+
+/*********
+ * Files *
+ *********/
+
+/* file_map: maps a file in memory (read-only), so that it is read from the
+ * page cache as it is used, without copy.
+ * inputs:
+ * - the [filename],
+ * - a pointer to store the [length] of the file.
+ * output: the contents of the file (not terminated by '\0'), to release with
+ * [file_unmap].
+ */
+char* file_map( char* filename, size_t* length );
+
+/* file_unmap: releases the contents of a file mapped by [file_map].
+ * inputs:
+ * - the [contents] of the file,
+ * - its [length].
+ * output: nothing.
+ */
+void file_unmap( char* contents, size_t length );
+
+/***********
+ * Hashing *
+ ***********/
+
+/* hash_string: hashes a string (64-bit FNV-1a), possibly continuing the hash
+ * of previous strings.
+ * inputs:
+ * - the string [s],
+ * - the hash [h] of the previous strings (or HASH_INIT).
+ * output: the hash.
+ */
+#define HASH_INIT 14695981039346656037ULL
+uint64_t hash_string( char* s, uint64_t h );
+
+/******************
+ * Random numbers *
+ ******************/
+
+/* rng_seed: seeds the random number generator of the calling thread
+ * (SplitMix64), so that the numbers drawn by a thread do not depend on the
+ * other threads.
+ * inputs:
+ * - the [seed].
+ * output: nothing.
+ */
+void rng_seed( uint64_t seed );
+
+/* rng_rand: draws a random integer, like [rand], from the generator of the
+ * calling thread if it was seeded (see [rng_seed]), and from [rand] otherwise.
+ * output: an integer between 0 and RAND_MAX.
+ */
+int rng_rand();
+
+/**********
+ * Errors *
+ **********/
+
+/* The type structure for error handlers, i.e., points the calling thread
+ * returns to on errors (see [error_exit]) instead of ending the process, so
+ * that the library (see [astrahl.h]) reports errors to its callers:
+ * - [env]: the point to return to (see [setjmp]),
+ * - [previous]: the handler set before it (or NULL).
+ */
+typedef struct error_handler_s {
+  jmp_buf env;
+  struct error_handler_s* previous;
+} error_handler;
+
+/* error_push: sets an error handler of the calling thread, after [setjmp] on
+ * its [env] returned 0. The handler is removed when an error returns to it.
+ * inputs:
+ * - the handler [h].
+ * output: nothing.
+ */
+void error_push( error_handler* h );
+
+/* error_pop: removes the last error handler of the calling thread.
+ * inputs:
+ * - the handler [h] (the last one set).
+ * output: nothing.
+ */
+void error_pop( error_handler* h );
+
+/* error_return: returns to the last error handler of the calling thread (whose
+ * [setjmp] then returns 1), if it has one.
+ * output: nothing (only if the thread has no handler).
+ */
+void error_return();
+
+/* error_exit: ends the process (with status 1) after an error, whose message
+ * is already printed, or returns to the last error handler of the calling
+ * thread (see [error_return]) if it has one.
+ */
+#define error_exit() ( error_return(), exit( 1 ) )
+
+/*************
+ * Intervals *
+ *************/
+
+/* Intervals are arrays of two doubles (lower and upper bound). The following
+ * functions compute (possibly infinite) intervals containing all the results of
+ * an operation applied to elements of the input intervals. Each result is
+ * stored in an array [res] of size 2, which may be one of the inputs.
+ */
+
+/* interval_mul: multiplies two intervals [x] and [y]. */
+void interval_mul( double* x, double* y, double* res );
+
+/* interval_div: divides an interval [x] by an interval [y]. */
+void interval_div( double* x, double* y, double* res );
+
+/* interval_pow: raises an interval [x] to the power of an interval [y]. */
+void interval_pow( double* x, double* y, double* res );
+
+/* interval_log: computes the logarithm of an interval [x]. */
+void interval_log( double* x, double* res );
+
 #endif // __CCL_UTILS_H__
@@ -0,0 +1,136 @@
+/********************************************************************
+ * warm_start.c
+ *
+ * Defines functions to reuse previous allocations as starting points.
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <gc.h>
+#include <cjson/cJSON.h>
+#include "utils.h"
+#include "warm_start.h"
+
+/*
+ * Creation
+ */
+
+uint64_t ws_key( cJSON* ft, cJSON* conf_funcs ) {
+  char* s = cJSON_PrintUnformatted( ft );
+  uint64_t h = hash_string( s, HASH_INIT );
+  free( s );
+  s = cJSON_PrintUnformatted( conf_funcs );
+  h = hash_string( s, h );
+  free( s );
+  return h;
+}
+
+// adds an allocation to the arrays of [ws] (but not to its file)
+void ws_add( warm_start ws, double* sigma, double res, double* result ) {
+  if ( ws->size == ws->capacity ) {
+    ws->capacity = 2 * ws->capacity + 8;
+    double* budgets = GC_MALLOC_ATOMIC( ws->capacity * sizeof( double ) );
+    double** points = GC_MALLOC( ws->capacity * sizeof( double* ) );
+    double** results = GC_MALLOC( ws->capacity * sizeof( double* ) );
+    for ( int i = 0; i < ws->size; ++i ) {
+      budgets[ i ] = ws->budgets[ i ];
+      points[ i ] = ws->points[ i ];
+      results[ i ] = ws->results[ i ];
+    }
+    ws->budgets = budgets;
+    ws->points = points;
+    ws->results = results;
+  }
+  ws->budgets[ ws->size ] = res;
+  ws->points[ ws->size ] = GC_MALLOC_ATOMIC( ws->n * sizeof( double ) );
+  ws->results[ ws->size ] = GC_MALLOC_ATOMIC( ws->n * sizeof( double ) );
+  for ( int i = 0; i < ws->n; ++i ) {
+    ws->points[ ws->size ][ i ] = sigma[ i ];
+    ws->results[ ws->size ][ i ] = result[ i ];
+  }
+  ws->size++;
+}
+
+warm_start ws_load( char* filename, uint64_t key, int n ) {
+  warm_start ws = GC_MALLOC( sizeof( struct warm_start_s ) );
+  ws->filename = filename;
+  ws->key = key;
+  ws->n = n;
+  ws->size = 0;
+  ws->capacity = 0;
+  if ( filename == NULL )
+    return ws;
+  FILE* f = fopen( filename, "r" );
+  if ( f == NULL )
+    return ws;
+  double* sigma = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  double* result = GC_MALLOC_ATOMIC( n * sizeof( double ) );
+  uint64_t k;
+  int m, c;
+  double res;
+  while ( fscanf( f, "%" SCNx64 " %d %lf", &k, &m, &res ) == 3 ) {
+    bool ok = k == key && m == n;
+    for ( int i = 0; ok && i < n; ++i )
+      ok = fscanf( f, "%lf", sigma + i ) == 1;
+    for ( int i = 0; ok && i < n; ++i )
+      ok = fscanf( f, "%lf", result + i ) == 1;
+    if ( ok )
+      ws_add( ws, sigma, res, result );
+    // skip the rest of the line (other problems)
+    while ( ( c = fgetc( f ) ) != EOF && c != '\n' );
+  }
+  fclose( f );
+  return ws;
+}
+
+/*
+ * Usage
+ */
+
+double* ws_seed( warm_start ws, double* sigma, double res ) {
+  int best = -1;
+  double best_dist = 0, dist, spent;
+  // starting points and budgets are both amounts of resources
+  for ( int j = 0; j < ws->size; ++j ) {
+    dist = ( res - ws->budgets[ j ] ) * ( res - ws->budgets[ j ] );
+    for ( int i = 0; i < ws->n; ++i )
+      dist += ( sigma[ i ] - ws->points[ j ][ i ] ) *
+              ( sigma[ i ] - ws->points[ j ][ i ] );
+    if ( best < 0 || dist < best_dist ) {
+      best = j;
+      best_dist = dist;
+    }
+  }
+  if ( best < 0 )
+    return NULL;
+  spent = 0;
+  for ( int i = 0; i < ws->n; ++i )
+    spent += ws->results[ best ][ i ];
+  if ( spent <= 0 )
+    return NULL;
+  double* seed = GC_MALLOC_ATOMIC( ws->n * sizeof( double ) );
+  for ( int i = 0; i < ws->n; ++i )
+    seed[ i ] = ws->results[ best ][ i ] * res / spent;
+  return seed;
+}
+
+void ws_store( warm_start ws, double* sigma, double res, double* result ) {
+  ws_add( ws, sigma, res, result );
+  if ( ws->filename == NULL )
+    return;
+  FILE* f = fopen( ws->filename, "a" );
+  if ( f == NULL ) {
+    fprintf( stderr, "Error while opening: \"%s\"\n", ws->filename );
+    error_exit();
+  }
+  fprintf( f, "%016" PRIx64 " %d %.17g", ws->key, ws->n, res );
+  for ( int i = 0; i < ws->n; ++i )
+    fprintf( f, " %.17g", sigma[ i ] );
+  for ( int i = 0; i < ws->n; ++i )
+    fprintf( f, " %.17g", result[ i ] );
+  fprintf( f, "\n" );
+  fclose( f );
+}
@@ -0,0 +1,91 @@
+/********************************************************************
+ * warm_start.h
+ *
+ * Header of warm_start.c
+ *
+ * Author: Clovis Eberhart
+ ********************************************************************/
+
+#ifndef __CCL_WARM_START_H__
+#define __CCL_WARM_START_H__
+
+#include <stdint.h>
+#include <cjson/cJSON.h>
+
+/*********
+ * Types *
+ *********/
+
+/* The type structure for warm-start caches, i.e., allocations computed
+ * previously for the same problem (fault tree and confidence functions), used
+ * to seed the optimisation of nearby problems (other starting points or
+ * budgets):
+ * - [filename]: the file storing the cache (one line per allocation: the key,
+ *   the number of wires, the budget, the starting point, and the allocation),
+ * - [key]: the hash of the problem,
+ * - [n]: the number of wires,
+ * - [size]: the number of allocations known for this problem,
+ * - [capacity]: the size of the arrays,
+ * - [budgets]: the budget of each allocation,
+ * - [points]: the starting point of each allocation,
+ * - [results]: the allocations (amounts spent on each wire).
+ */
+typedef struct warm_start_s {
+  char* filename;
+  uint64_t key;
+  int n;
+  int size;
+  int capacity;
+  double* budgets;
+  double** points;
+  double** results;
+} *warm_start;
+
+/************
+ * Creation *
+ ************/
+
+/* ws_key: computes the key of a problem.
+ * inputs:
+ * - the JSON objects [ft] and [conf_funcs] describing the problem.
+ * output: the key.
+ */
+uint64_t ws_key( cJSON* ft, cJSON* conf_funcs );
+
+/* ws_load: loads the allocations known for a problem from a cache file (which
+ * need not exist yet).
+ * inputs:
+ * - the [filename] of the cache (NULL for a cache kept in memory only),
+ * - the [key] of the problem,
+ * - the number [n] of wires.
+ * output: the cache.
+ */
+warm_start ws_load( char* filename, uint64_t key, int n );
+
+/*********
+ * Usage *
+ *********/
+
+/* ws_seed: computes a starting allocation from the known allocation whose
+ * starting point and budget are the closest to the given ones, scaled to the
+ * given budget.
+ * inputs:
+ * - the cache [ws],
+ * - the starting point [sigma] (an array of [ws]->n doubles),
+ * - the budget [res].
+ * output: the allocation (an array of [ws]->n non-negative doubles summing to
+ * [res]), or NULL if no allocation is known.
+ */
+double* ws_seed( warm_start ws, double* sigma, double res );
+
+/* ws_store: adds an allocation to a cache (and to its file, if it has one).
+ * inputs:
+ * - the cache [ws],
+ * - the starting point [sigma] (an array of [ws]->n doubles),
+ * - the budget [res],
+ * - the allocation [result] (an array of [ws]->n doubles).
+ * output: nothing.
+ */
+void ws_store( warm_start ws, double* sigma, double res, double* result );
+
+#endif // __CCL_WARM_START_H__